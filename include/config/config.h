@@ -62,6 +62,7 @@ struct config {
         double ninb_opacity;
 
         char *font_path;
+        char *font_prewarm;
     } theme;
 
     struct {
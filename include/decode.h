@@ -0,0 +1,88 @@
+#ifndef WAYWALL_DECODE_H
+#define WAYWALL_DECODE_H
+
+#include "util/avif.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <wayland-server-core.h>
+
+struct ww_decode_job;
+
+typedef void (*ww_decode_func_t)(struct ww_decode_job *job, void *data);
+typedef void (*ww_decode_destroy_func_t)(void *data);
+
+enum ww_decode_format {
+    WW_DECODE_PNG,
+    WW_DECODE_AVIF,
+};
+
+enum ww_decode_state {
+    WW_DECODE_QUEUED,
+    WW_DECODE_RUNNING,
+    WW_DECODE_COMPLETED,
+};
+
+// Decodes PNG and AVIF images on a pool of worker threads. Completed jobs are handed back to the
+// main thread through an eventfd on the event loop, where their done callback is called.
+struct ww_decode_pool {
+    pthread_t *threads;
+    size_t thread_count;
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond_queued; // signalled when a job is queued or the pool is shutting down
+    pthread_cond_t cond_idle;   // signalled when a job finishes
+
+    struct wl_list queued;    // ww_decode_job.link
+    struct wl_list completed; // ww_decode_job.link
+    size_t busy;              // queued + running jobs
+    bool should_exit;
+
+    int fd;
+    struct wl_event_source *src;
+};
+
+struct ww_decode_job {
+    struct wl_list link; // ww_decode_pool.queued or ww_decode_pool.completed
+
+    enum ww_decode_format format;
+    enum ww_decode_state state;
+    bool cancelled;
+
+    // Either path is set, or data holds a copy of the encoded image.
+    char *path;
+    char *data;
+    size_t data_size;
+    unsigned int max_size;
+
+    // The decoded image. PNGs are decoded to a single frame. frames is NULL if decoding failed. The
+    // done callback may take ownership of the result by copying it and zeroing job->result.
+    struct util_avif result;
+
+    // done is called on the main thread once the job has been decoded. destroy is called instead
+    // if the job is cancelled or the pool is destroyed first. Either may be NULL.
+    ww_decode_func_t done;
+    ww_decode_destroy_func_t destroy;
+    void *userdata;
+};
+
+struct ww_decode_pool *ww_decode_pool_create(struct wl_event_loop *loop, size_t thread_count);
+void ww_decode_pool_destroy(struct ww_decode_pool *pool);
+
+// Blocks until every submitted job has been decoded, then dispatches their callbacks.
+void ww_decode_pool_flush(struct ww_decode_pool *pool);
+
+struct ww_decode_job *ww_decode_pool_submit_file(struct ww_decode_pool *pool,
+                                                 enum ww_decode_format format, const char *path,
+                                                 unsigned int max_size, ww_decode_func_t done,
+                                                 ww_decode_destroy_func_t destroy, void *data);
+struct ww_decode_job *ww_decode_pool_submit_raw(struct ww_decode_pool *pool,
+                                                enum ww_decode_format format, const char *data,
+                                                size_t data_size, unsigned int max_size,
+                                                ww_decode_func_t done,
+                                                ww_decode_destroy_func_t destroy, void *userdata);
+
+// Cancels a job which has not yet had its done callback called. The job must not be used again.
+void ww_decode_job_cancel(struct ww_decode_pool *pool, struct ww_decode_job *job);
+
+#endif
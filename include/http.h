@@ -1,52 +1,96 @@
 #ifndef HTTP_H
 #define HTTP_H
 #include "lua.h"
+#include "util/cache.h"
+#include "util/spsc.h"
 #include <curl/curl.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <wayland-server-core.h>
 
 #define MAX_CLIENTS 8
 #define MAX_QUEUED 1024
 
+// The maximum number of transfers a single client will run concurrently. Requests beyond this are
+// kept in a priority-ordered pending list until a transfer finishes.
+#define MAX_IN_FLIGHT 32
+#define MAX_HOST_CONNECTIONS 6
+
+struct response_buffer {
+    char *data;
+    size_t size;
+};
+
 struct queued_response {
     char *data;
     size_t size;
     char *url;
-};
 
-struct response_queue {
-    struct queued_response *responses[MAX_QUEUED];
-    int write_pos;
-    int read_pos;
+    // A Lua registry reference to the callback for this request, or LUA_NOREF to use the client's
+    // callback.
+    int callback;
 };
 
 struct pending_request {
+    struct wl_list link; // Http_client.pending or Http_client.active
     char *url;
     // headers is null terminated
     char **headers;
+    int priority;
+    int callback;
+
+    // Only used by the worker thread while the request is in flight.
+    CURL *curl;
+    struct curl_slist *header_list;
+    struct response_buffer body;
+
+    // The on-disk cache entry for this request (if any) and the caching-related response headers.
+    char *cache_key;
+    struct util_cache_http cached;
+    bool have_cached;
+    char *etag, *last_modified;
+    long max_age;
+    bool no_store;
 };
 
 struct Http_client {
-    CURL *curl;
     int callback;
     int index;
     pthread_t thread_id;
     bool thread_running;
-    struct response_queue response_queue;
-    pthread_mutex_t queue_mutex;
-    pthread_mutex_t request_mutex;
     struct config_vm *vm;
 
-    struct pending_request *pending_requests[MAX_QUEUED];
-    int request_write_pos;
-    int request_read_pos;
-    pthread_cond_t request_cond;
-    bool should_exit;
+    // requests: main thread -> worker, responses: worker -> main thread
+    struct spsc_queue requests;
+    struct spsc_queue responses;
+
+    // The number of requests which have been submitted but whose responses have not yet been
+    // dispatched. Only accessed from the main thread. Keeping this below MAX_QUEUED guarantees that
+    // neither queue can overflow.
+    int outstanding;
+
+    // request_fd is polled by the worker alongside its transfers. response_fd is watched by the main
+    // event loop.
+    int request_fd;
+    int response_fd;
+    struct wl_event_source *src_response;
+
+    // Owned by the worker thread until it has been joined.
+    CURLM *multi;
+    struct wl_list pending; // pending_request.link
+    struct wl_list active;  // pending_request.link
+    int in_flight;
+    CURL *idle[MAX_IN_FLIGHT];
+    int idle_count;
+
+    atomic_bool should_exit;
 };
 
-struct Http_client *http_client_create(int callback, lua_State *L);
-void manage_new_responses();
+struct Http_client *http_client_create(struct wl_event_loop *loop, int callback, lua_State *L);
 void http_client_get(struct Http_client *client, char *url, char **headers);
+void http_client_request(struct Http_client *client, char *url, char **headers, int priority,
+                         int callback);
 void http_client_destroy(struct Http_client *client);
 
 #endif
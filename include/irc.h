@@ -2,35 +2,35 @@
 #define IRC_H
 
 #include "lua.h"
+#include "util/spsc.h"
 #include <libircclient/libircclient.h>
 #include <pthread.h>
 #include <stdbool.h>
+#include <wayland-server-core.h>
 
 #define MAX_CLIENTS 8
 #define MAX_QUEUED_MESSAGES 64
 #define MAX_MESSAGE_LENGTH 1024
 
-struct message_queue {
-    char *messages[MAX_QUEUED_MESSAGES];
-    int write_pos;
-    int read_pos;
-};
-
 struct Irc_client {
     irc_session_t *session;
     int callback;
     int index;
     pthread_t thread_id;
     bool thread_running;
-    struct message_queue message_queue;
-    pthread_mutex_t queue_mutex;
     struct config_vm *vm;
+
+    // messages: IRC thread -> main thread. message_fd is signalled after every push and is watched
+    // by the main event loop.
+    struct spsc_queue messages;
+    int message_fd;
+    struct wl_event_source *src_message;
 };
 
-struct Irc_client *irc_client_create(const char *ip, long port, const char *nick, const char *pass,
-                                     int callback, lua_State *L);
-void manage_new_messages();
+struct Irc_client *irc_client_create(struct wl_event_loop *loop, const char *ip, long port,
+                                     const char *nick, const char *pass, int callback,
+                                     lua_State *L);
 void irc_client_send(struct Irc_client *client, const char *message);
 void irc_client_destroy(struct Irc_client *client);
 
-#endif
\ No newline at end of file
+#endif
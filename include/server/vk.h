@@ -6,6 +6,7 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <vulkan/vulkan.h>
 #include <wayland-server-core.h>
 
@@ -14,11 +15,33 @@ struct config;
 struct server;
 struct server_surface;
 struct gbm_device;
-struct util_avif_frame;
+struct text_vertex;
+struct vk_glyph_worker;
+struct vk_layout_entry;
+struct vk_memory_block;
+struct vk_render_item;
+struct vk_retired_buffer;
+struct vk_upload_batch;
+struct ww_decode_job;
+struct ww_decode_pool;
+
+// A range of device memory, either sub-allocated from a shared block or (for large resources) a
+// dedicated VkDeviceMemory. mapped is set if the memory is host-visible.
+struct vk_allocation {
+    struct vk_memory_block *block;  // NULL for dedicated allocations
+    VkDeviceMemory memory;
+    VkDeviceSize offset;
+    VkDeviceSize size;
+    void *mapped;  // Host pointer to offset, or NULL
+};
+
+// Slot of the texture table (server_vk.textures) which holds no texture
+#define VK_TEXTURE_NONE UINT32_MAX
 
 // Mirror with optional color keying
 struct vk_mirror {
     struct wl_list link;  // server_vk.mirrors
+    struct server_vk *vk;
 
     // Source region in game (pixels)
     struct box src;
@@ -46,9 +69,14 @@ struct vk_atlas {
     uint32_t height;
 
     VkImage image;
-    VkDeviceMemory memory;
+    struct vk_allocation memory;
     VkImageView view;
-    VkDescriptorSet descriptor_set;
+    uint32_t texture;  // Slot in the texture table
+
+    // Inserts still being decoded on the worker pool, and whether any insert has failed to decode
+    // or upload since server_vk_atlas_take_failed was last called.
+    uint32_t pending_inserts;
+    bool insert_failed;
 
     uint32_t refcount;
 };
@@ -56,64 +84,55 @@ struct vk_atlas {
 // Image overlay (loaded from PNG file)
 struct vk_image {
     struct wl_list link;  // server_vk.images
+    struct server_vk *vk;
 
     // Optional atlas backing (shared texture + descriptor set)
     struct vk_atlas *atlas;
 
     // Vulkan resources
     VkImage image;
-    VkDeviceMemory memory;
+    struct vk_allocation memory;
     VkImageView view;
-    VkDescriptorSet descriptor_set;
+    uint32_t texture;  // Slot in the texture table, or VK_TEXTURE_NONE
 
-    // Optional per-image quad vertex buffer (for atlas UVs)
-    VkBuffer vertex_buffer;
-    VkDeviceMemory vertex_memory;
+    // Source rect within the texture (normalized x, y, w, h), e.g. atlas UVs
+    float uv[4];
 
     // Image dimensions
     int32_t width, height;
 
-    // Optional animated frames (AVIF). Only valid when owns_image=true.
-    struct util_avif_frame *frames;
-    size_t frame_count;
-    size_t frame_index;
-    uint64_t next_frame_ms;
+    // The pending decode for this image, if it is still being decoded. Images are kept on
+    // server_vk.pending_images until their texture has been uploaded, or until decoding or
+    // uploading fails, which sets failed.
+    struct ww_decode_job *decode;
+    bool failed;
+
+    // Animated images (AVIF) hold one frame per array layer of the texture. The layer to draw is
+    // picked from a shared clock, so animating never touches the texture. Only valid when
+    // owns_image=true.
+    uint32_t frame_count;     // Number of layers (1 for still images)
+    uint32_t frame_index;     // Layer currently drawn
+    uint64_t *frame_ends_ms;  // End time of each frame within one loop, or NULL if not animated
+    uint64_t next_frame_ms;   // When frame_index next changes
 
     // Destination region on screen (pixels)
     struct box dst;
 
     int32_t depth;
 
-    bool owns_descriptor_set;
+    bool owns_texture;
     bool owns_image;
     bool enabled;
 };
 
-// Glyph metadata for font atlas
+// Glyph metadata for the font atlas. Metrics are in pixels at the size of the distance field.
 struct vk_glyph {
     uint32_t codepoint;
     int width, height;
     int bearing_x, bearing_y;
-    int advance;
+    float advance;
     int atlas_x, atlas_y;
-};
-
-// Font size cache
-struct vk_font_size {
-    uint32_t size;
-    struct vk_glyph *glyphs;
-    size_t glyph_count;
-    size_t glyph_capacity;
-
-    // Atlas for this font size
-    VkImage atlas_image;
-    VkDeviceMemory atlas_memory;
-    VkImageView atlas_view;
-    VkDescriptorSet atlas_descriptor;
-    int atlas_width, atlas_height;
-    int atlas_x, atlas_y;  // Current packing position
-    int atlas_row_height;
-    bool atlas_initialized;
+    bool ready;  // Rendered by the glyph worker and present in the atlas
 };
 
 // Text overlay
@@ -131,13 +150,18 @@ struct vk_text {
 
     int32_t depth;
 
-    // Vertex buffer for glyph quads
-    VkBuffer vertex_buffer;
-    VkDeviceMemory vertex_memory;
+    // Glyph quads, built on the CPU. While the text keeps changing they are streamed through
+    // server_vk.text_stream every frame. Once they have been left alone for a while they are copied
+    // into a device-local vertex buffer.
+    struct text_vertex *vertices;
+    size_t vertex_capacity;
     size_t vertex_count;
-
-    // Reference to font size cache
-    struct vk_font_size *font;
+    uint32_t stream_first;  // First vertex in the current frame's stream region
+    uint32_t idle_frames;   // Frames drawn since the vertices last changed
+    VkBuffer vertex_buffer;  // Device-local copy, or VK_NULL_HANDLE while streamed
+    struct vk_allocation vertex_memory;
+    struct box bounds;  // Screen-space extent of the glyph quads
+    bool pending_glyphs;  // Built while some glyphs were still being rendered
 
     bool enabled;
     bool dirty;  // Needs rebuild
@@ -157,6 +181,20 @@ struct vk_view {
 // Maximum frames in flight for triple buffering
 #define VK_MAX_FRAMES_IN_FLIGHT 2
 
+// Window-space damage, kept as a bounding box (x2/y2 exclusive). Empty when x2 <= x1.
+struct vk_damage {
+    int32_t x1, y1, x2, y2;
+    bool full;
+};
+
+// dma-buf import strategies compared by the import tuner (see server_vk.import_tune)
+enum vk_import_strategy {
+    VK_IMPORT_MODIFIER,        // Tiled image imported with its DRM format modifier
+    VK_IMPORT_LINEAR_IMAGE,    // LINEAR image sampled directly
+    VK_IMPORT_STORAGE_BUFFER,  // LINEAR memory read through a stride-aware storage buffer
+    VK_IMPORT_STRATEGY_COUNT,
+};
+
 // Vulkan buffer for imported dma-bufs
 struct vk_buffer {
     struct wl_list link;  // server_vk.capture.buffers
@@ -170,17 +208,6 @@ struct vk_buffer {
     VkImageView optimal_view;
     bool optimal_valid;
 
-    // Double-buffered optimal-tiling copy for async pipelining
-    VkImage optimal_images[2];
-    VkDeviceMemory optimal_memories[2];
-    VkImageView optimal_views[2];
-    VkDescriptorSet optimal_descriptors[2];
-    int optimal_read_index;    // Index being read (rendered)
-    int optimal_write_index;   // Index being written (copy target)
-    VkFence copy_fence;        // Fence for async copy completion
-    bool copy_pending;         // True if async copy in progress
-    bool async_optimal_valid;  // True if double-buffered optimal is ready
-
     // Imported dma-buf memory
     VkDeviceMemory memory;
 
@@ -211,10 +238,138 @@ struct vk_buffer {
     int32_t width, height;
     uint32_t stride;  // Actual dma-buf stride in bytes
     bool source_prepared;
+    enum vk_import_strategy strategy;
 
     bool destroyed;
 };
 
+// Device-local copy of the part of a NATIVE capture buffer which is drawn in a frame. The game
+// blit and every mirror sample this instead of reading the foreign dma-buf directly. Each frame
+// in flight has its own, so it can be rewritten once the frame's fence has signalled.
+struct vk_resident_capture {
+    VkImage image;
+    struct vk_allocation memory;
+    VkImageView view;
+    VkDescriptorSet descriptor_set;
+    int32_t width, height;  // Size of the image, which may exceed box
+
+    struct box box;  // Region of the game copied to the top-left corner of the image
+    bool valid;      // The copy was recorded into the current frame
+};
+
+// Maximum number of copies in the capture copy pipeline (see server_vk.capture_copy)
+#define VK_CAPTURE_COPY_MAX_DEPTH 4
+
+// Frames measured per import strategy before the import tuner compares them
+#define VK_IMPORT_TUNE_FRAMES 600
+// Frames an imported buffer is assumed to be read for, over which its import cost is spread
+#define VK_IMPORT_TUNE_BUFFER_FRAMES 1000
+// Sessions which may try modifier imports without the game ever allocating a tiled buffer
+#define VK_IMPORT_TUNE_MODIFIER_ATTEMPTS 3
+#define VK_IMPORT_TUNE_MAX_RECORDS 64
+
+// Import tuner measurements for one device, driver, game GPU and capture resolution. Records are
+// persisted in the cache as they are.
+struct vk_import_tune_record {
+    uint32_t vendor_id, device_id, driver_version;
+    uint32_t peer;  // Hash of the GPU the game is offloaded to (DRI_PRIME), 0 if none
+    int32_t width, height;
+    uint32_t modifier_attempts;  // Sessions which tried modifier imports for this record
+    uint32_t reserved;
+    struct {
+        uint32_t imports;
+        uint32_t frames;
+        uint64_t import_ns;  // Total CPU time spent importing buffers
+        uint64_t frame_ns;   // Total GPU time spent reading the capture
+    } strategies[VK_IMPORT_STRATEGY_COUNT];
+};
+
+// Number of consecutive capture commits with nothing drawn over the game before it is passed
+// through to the parent compositor (see server_vk.passthrough)
+#define VK_PASSTHROUGH_ENTER_COMMITS 30
+
+// Wakes the event loop once a submission has finished. The submission signals a binary semaphore,
+// which is then exported as a sync_file and watched for readability (see release_watch_arm).
+struct vk_release_watch {
+    struct server_vk *vk;
+    VkSemaphore semaphore;        // VK_NULL_HANDLE if sync_file export is unsupported
+    struct wl_event_source *src;  // Set while the submission is pending
+    int fd;                       // Exported sync_file, valid while src is set
+};
+
+// Resident copy of a NATIVE capture, made on the transfer queue when the capture is committed
+// (see server_vk.capture_copy).
+struct vk_capture_copy {
+    struct vk_resident_capture resident;  // valid once a copy has been submitted
+    VkCommandBuffer cmd;
+
+    struct vk_buffer *source;  // Buffer which was copied, or NULL
+    bool held;                 // source is locked until the copy finishes
+    uint64_t value;            // capture_copy.timeline value signalled once the copy is done
+    uint64_t read_frame;       // upload.frame_timeline value of the last frame which sampled it
+
+    uint64_t submit_ns;  // When the copy was submitted
+    bool timed;          // GPU timestamps were written around the copy
+
+    struct vk_release_watch release;  // Releases source once the copy is done
+};
+
+// Number of frames kept in the frame timing ring buffer
+#define VK_FRAME_STATS_LEN 256
+
+// GPU timestamps written per frame (see server_vk_begin_frame/end_frame)
+enum vk_timestamp {
+    VK_TS_BEGIN,     // Start of command buffer
+    VK_TS_ACQUIRE,   // After capture acquire barrier
+    VK_TS_CAPTURE,   // After draw_captured_frame
+    VK_TS_OVERLAYS,  // After draw_sorted_objects
+    VK_TS_END,       // After capture release barrier
+    VK_TS_COUNT,
+};
+
+// Timing sample for a single presented frame. All fields are 64-bit so the
+// struct has no padding and can be written to the trace file as-is.
+struct vk_frame_stats {
+    uint64_t seq;  // Frame sequence number
+
+    // CPU timestamps (CLOCK_MONOTONIC, ns). commit_ns is 0 if the frame was
+    // not triggered by a capture surface commit (e.g. overlay tick).
+    uint64_t commit_ns;
+    uint64_t submit_ns;
+    uint64_t present_ns;
+
+    // CPU spans (ns)
+    uint64_t cpu_record_ns;   // begin_frame -> command buffer recorded
+    uint64_t cpu_submit_ns;   // vkQueueSubmit
+    uint64_t cpu_present_ns;  // vkQueuePresentKHR
+
+    // GPU stage durations (ns), only meaningful if gpu_valid is set
+    uint64_t gpu_acquire_ns;
+    uint64_t gpu_capture_ns;
+    uint64_t gpu_overlays_ns;
+    uint64_t gpu_release_ns;
+    uint64_t gpu_total_ns;
+    uint64_t gpu_valid;
+
+    // Capture copy sampled by the frame, only meaningful if copy_valid is set
+    uint64_t copy_submit_ns;  // When the copy was submitted (CLOCK_MONOTONIC)
+    uint64_t gpu_copy_ns;     // Duration of the copy on the transfer queue, 0 if unknown
+    uint64_t copy_pending;    // The copy had not finished when the frame was presented
+    uint64_t copy_valid;
+};
+
+// Device memory usage, as reported by server_vk_get_memory_stats.
+struct vk_memory_stats {
+    uint64_t block_count;       // Shared blocks
+    uint64_t block_bytes;       // Total size of the shared blocks
+    uint64_t used_bytes;        // Bytes sub-allocated from the shared blocks
+    uint64_t allocation_count;  // Live sub-allocations
+    uint64_t free_ranges;       // Free ranges across all blocks (fragmentation)
+    uint64_t largest_free;      // Largest free range in any block
+    uint64_t dedicated_count;   // Dedicated allocations
+    uint64_t dedicated_bytes;   // Total size of the dedicated allocations
+};
+
 // Shader pipeline
 struct vk_pipeline {
     VkShaderModule vert;
@@ -241,7 +396,6 @@ struct server_vk {
     uint32_t present_family;
     uint32_t transfer_family;
     VkCommandPool transfer_pool;
-    bool async_pipelining_enabled;
 
     // Memory properties for allocation
     VkPhysicalDeviceMemoryProperties memory_properties;
@@ -254,6 +408,8 @@ struct server_vk {
         VkSwapchainKHR swapchain;
         VkFormat format;
         VkExtent2D extent;
+        bool opaque;       // Presented with VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR
+        bool transfer_dst; // Images can be written by transfer commands
 
         uint32_t image_count;
         VkImage *images;
@@ -261,8 +417,12 @@ struct server_vk {
         VkFramebuffer *framebuffers;
     } swapchain;
 
-    // Render pass
+    // Render passes. render_pass clears the whole image; render_pass_load keeps the
+    // previous contents for partial redraws (see damage below).
     VkRenderPass render_pass;
+    VkRenderPass render_pass_load;
+    bool incremental_present;  // VK_KHR_incremental_present is enabled
+    bool host_query_reset;     // hostQueryReset is enabled
 
     // Command pools and buffers
     VkCommandPool command_pool;
@@ -283,14 +443,63 @@ struct server_vk {
     uint32_t current_image_index;  // Current swapchain image being rendered to
     uint64_t fps_last_time_ms;
     uint32_t fps_frame_count;
+
+    // Frame timing (GPU timestamp queries + CPU spans)
+    struct {
+        VkQueryPool query_pool;  // VK_TS_COUNT queries per frame in flight
+        float timestamp_period;  // ns per timestamp tick
+        uint64_t timestamp_mask;
+
+        struct vk_frame_stats ring[VK_FRAME_STATS_LEN];
+        size_t head;   // Next slot to write
+        size_t count;  // Number of valid entries
+        uint64_t seq;
+
+        // Ring entry awaiting GPU results per frame in flight (-1 if none)
+        int32_t pending[VK_MAX_FRAMES_IN_FLIGHT];
+
+        // Capture copy sampled by each pending frame, whose timestamps are read along with it
+        struct {
+            int32_t index;  // -1 if none
+            uint64_t value;
+        } pending_copy[VK_MAX_FRAMES_IN_FLIGHT];
+
+        uint64_t commit_ns;  // Set by on_surface_commit, consumed at submit
+        uint64_t begin_ns;   // Set by server_vk_begin_frame
+
+        FILE *trace;  // Optional binary trace (WAYWALL_VK_FRAME_TRACE)
+    } timing;
     bool disable_capture_sync_wait;
     bool allow_modifiers;  // Allow tiled modifier imports (better cross-GPU perf)
 
+    // Import tuner. The cost of importing and reading the capture is measured for each import
+    // strategy and capture resolution, and the cheapest strategy is used once all viable ones
+    // have been measured. Modifier imports are chosen per session, through the dma-buf feedback
+    // sent to the game; LINEAR image and storage buffer reads are chosen per imported buffer.
+    struct {
+        struct vk_import_tune_record *records;
+        size_t count;
+        struct vk_import_tune_record key;  // Device, driver and game GPU of this session
+
+        // Record and strategy measured by each frame in flight (record is -1 if none)
+        struct {
+            int32_t record;
+            enum vk_import_strategy strategy;
+        } pending[VK_MAX_FRAMES_IN_FLIGHT];
+
+        bool dirty;
+        bool disabled;  // WAYWALL_VK_NO_IMPORT_TUNE, or a dma-buf layout was chosen by hand
+    } import_tune;
+
     // Descriptor pool for texture sampling
     VkDescriptorPool descriptor_pool;
     VkSampler sampler;
+    VkSampler linear_sampler;  // Used for the font atlas
 
-    // Pipelines
+    // Pipelines. The pipeline cache is loaded from and saved to the on-disk cache so that
+    // pipelines do not have to be compiled from scratch on every launch.
+    VkPipelineCache pipeline_cache;
+    size_t pipeline_cache_size;  // Size of the cache data when it was last loaded or saved
     struct vk_pipeline texcopy_pipeline;
     struct vk_pipeline text_pipeline;
     struct vk_pipeline blit_pipeline;  // Simple fullscreen blit
@@ -303,23 +512,110 @@ struct server_vk {
         VkShaderModule frag;
     } buffer_blit;
 
-    // Mirror pipeline (samples game with color keying)
+    // Mirror pipeline (samples game with color keying). The resident variant samples
+    // server_vk.capture.resident instead of the capture's storage buffer.
     struct {
         VkPipelineLayout layout;
         VkPipeline pipeline;
         VkShaderModule frag;
+
+        VkPipelineLayout resident_layout;
+        VkPipeline resident_pipeline;
+        VkShaderModule resident_frag;
     } mirror_pipeline;
 
     // Vertex buffer for quad rendering
     VkBuffer quad_vertex_buffer;
     VkDeviceMemory quad_vertex_memory;
 
+    // Instanced overlay batching (mirrors and images). Each frame in flight
+    // has its own persistently mapped instance buffer, grown on demand.
+    struct {
+        VkShaderModule vert;
+        VkBuffer instance_buffers[VK_MAX_FRAMES_IN_FLIGHT];
+        VkDeviceMemory instance_memories[VK_MAX_FRAMES_IN_FLIGHT];
+        void *instance_mapped[VK_MAX_FRAMES_IN_FLIGHT];
+        size_t instance_capacity[VK_MAX_FRAMES_IN_FLIGHT];
+    } overlay;
+
     // Mirrors list
     struct wl_list mirrors;  // vk_mirror.link
 
     // Images list
     struct wl_list images;  // vk_image.link
 
+    // Images which are still being decoded (or failed to decode)
+    struct wl_list pending_images;  // vk_image.link
+
+    // Worker pool for PNG/AVIF decoding
+    struct ww_decode_pool *decode_pool;
+
+    // Capture copy pipeline. Rather than copying the resident capture inside every frame, each
+    // commit of a NATIVE capture is copied into the next of depth resident images on the transfer
+    // queue, so that the copy overlaps the rendering of the previous frame. Copies wait on
+    // upload.frame_timeline for the last frame which sampled their image, and frames wait on
+    // timeline for the copy they sample. The CPU only waits once all depth copies are queued.
+    struct {
+        uint32_t depth;  // 0 if disabled (WAYWALL_VK_COPY_DEPTH)
+        struct vk_capture_copy copies[VK_CAPTURE_COPY_MAX_DEPTH];
+        int32_t latest;   // Index of the newest copy, or -1
+        int32_t sampled;  // Copy sampled by the frame being recorded, or -1
+
+        VkSemaphore timeline;  // Signalled by each copy
+        uint64_t submitted;    // Value of the last submitted copy
+
+        VkQueryPool query_pool;  // Two timestamps per copy, if the transfer queue has them
+        float timestamp_period;
+        uint64_t timestamp_mask;
+    } capture_copy;
+
+    // Passthrough. While nothing is drawn over the game and it fits in the window uncropped, the
+    // capture surface is shown by the parent compositor as a subsurface below the swapchain, and
+    // frames stop drawing (and copying) it. Passthrough is entered after a streak of qualifying
+    // commits and left as soon as anything would be drawn over the game.
+    struct {
+        struct wl_subsurface *subsurface;  // Set while passthrough is active or being left
+        int32_t x, y;     // Position of the subsurface in the window
+        uint32_t streak;  // Consecutive commits which could have been passed through
+        bool clear;       // The swapchain still shows the game and has to be cleared
+        bool leaving;     // The next frame draws the game again, then the subsurface is unmapped
+        bool disabled;    // WAYWALL_VK_NO_PASSTHROUGH
+    } passthrough;
+
+    // Transfer present. A frame which only shows the game, unscaled and with nothing drawn over it,
+    // copies the capture straight into the swapchain image instead of running a render pass.
+    struct {
+        bool active;    // The frame being recorded is a copy
+        bool disabled;  // WAYWALL_VK_NO_TRANSFER_PRESENT
+    } transfer_present;
+
+    // Texture uploads. Pixels are staged in a persistently mapped ring buffer and copied into
+    // device-local images on the transfer queue. Copies are batched until the next frame is
+    // submitted and ordered against rendering with timeline semaphores, never a CPU wait.
+    struct {
+        VkBuffer ring;
+        VkDeviceMemory ring_memory;
+        unsigned char *ring_mapped;
+        uint64_t head, tail;  // Total bytes allocated from / released back to the ring
+
+        VkSemaphore timeline;        // Signalled by each upload batch
+        uint64_t submitted;          // Value of the last submitted upload batch
+        VkSemaphore frame_timeline;  // Signalled by each rendered frame
+        uint64_t frames_submitted;   // Value of the last submitted frame
+
+        struct vk_upload_batch *open;  // Batch being recorded, or NULL
+        struct wl_list batches;        // vk_upload_batch.link, oldest first
+        bool concurrent;  // Graphics and transfer queues are in different families
+    } upload;
+
+    // Device memory for images, atlases and buffers. Small resources are sub-allocated from
+    // shared blocks so that loading hundreds of emotes does not mean hundreds of allocations.
+    struct {
+        struct wl_list blocks;  // vk_memory_block.link
+        uint64_t dedicated_count;
+        uint64_t dedicated_bytes;
+    } memory;
+
     // Atlases list
     struct wl_list atlases;  // vk_atlas.link
 
@@ -329,35 +625,108 @@ struct server_vk {
     // Floating views list
     struct wl_list views;  // vk_view.link
 
+    // Enabled overlays sorted by depth. Rebuilt lazily before drawing when
+    // dirty (object added/removed, shown/hidden or depth changed).
+    struct {
+        struct vk_render_item *items;
+        size_t count;
+        size_t capacity;
+        size_t quad_count;  // Mirrors and images (instanced overlay quads)
+        bool dirty;
+    } render_list;
+
+    // Damage tracking. `frame` is what changed since the last present (reported to the
+    // parent compositor); each swapchain image also accumulates everything that changed
+    // since it was last drawn, which bounds the redraw when it is acquired again.
+    struct {
+        struct vk_damage frame;
+        struct vk_damage *images;  // One per swapchain image
+        VkRect2D scissor;          // Redrawn area of the frame being recorded
+        int32_t capture_width, capture_height;
+        bool disabled;  // WAYWALL_VK_NO_DAMAGE
+    } damage;
+
+    // Bindless texture table. Every overlay texture (images, atlases and font atlases) is written
+    // to a slot of one large descriptor array when it is created, and draws select the texture by
+    // index instead of binding a descriptor set per object.
+    struct {
+        VkDescriptorSetLayout layout;
+        VkDescriptorPool pool;
+        VkDescriptorSet set;
+        uint32_t capacity;
+        uint32_t *free;  // Stack of free slots
+        uint32_t free_count;
+    } textures;
+
     // Image pipeline (simple textured quad)
     struct {
         VkPipelineLayout layout;
         VkPipeline pipeline;
-        VkDescriptorSetLayout descriptor_layout;
     } image_pipeline;
 
     // Text pipeline (font atlas sampling)
     struct {
         VkPipelineLayout layout;
         VkPipeline pipeline;
-        VkDescriptorSetLayout descriptor_layout;
     } text_vk_pipeline;
 
-    // Font rendering (FreeType)
+    // Vertices of text which is still changing. Each frame in flight has its own persistently
+    // mapped region, which is rewritten when the frame is recorded.
+    struct {
+        VkBuffer buffers[VK_MAX_FRAMES_IN_FLIGHT];
+        struct vk_allocation memories[VK_MAX_FRAMES_IN_FLIGHT];
+        size_t capacity[VK_MAX_FRAMES_IN_FLIGHT];  // In vertices
+        size_t used;  // Vertices written for the frame being recorded
+
+        // Device-local text buffers which a submitted frame may still read
+        struct vk_retired_buffer *retired;
+        size_t retired_count;
+        size_t retired_capacity;
+    } text_stream;
+
+    // Font rendering (FreeType). Every text size is drawn from one signed distance field atlas.
     struct {
         void *ft_library;  // FT_Library
         void *ft_face;     // FT_Face
-        struct vk_font_size *sizes;
-        size_t sizes_count;
-        size_t sizes_capacity;
-        uint32_t base_font_size;
+
+        struct vk_glyph *glyphs;
+        size_t glyph_count;
+        size_t glyph_capacity;
+        uint32_t *glyph_table;  // Open-addressing hash of codepoints to indices into glyphs
+        size_t glyph_table_size;
+
+        struct vk_glyph_worker *worker;  // Renders glyphs off the main thread
+
+        VkImage atlas_image;
+        struct vk_allocation atlas_memory;
+        VkImageView atlas_view;
+        uint32_t atlas_texture;  // Slot in the texture table
+        int atlas_width, atlas_height;
+        int atlas_x, atlas_y;  // Current packing position
+        int atlas_row_height;
     } font;
 
+    // Results of server_vk_text_layout and server_vk_text_advance
+    struct {
+        struct vk_layout_entry *entries;  // Allocated on first use
+    } layout_cache;
+
     // Capture surface (imported from client)
     struct {
         struct server_surface *surface;
         struct wl_list buffers;  // vk_buffer.link
         struct vk_buffer *current;
+
+        // Buffer read by each frame in flight. Its parent wl_buffer stays locked (not
+        // released to the client) until the slot's in_flight fence signals.
+        struct vk_buffer *in_flight[VK_MAX_FRAMES_IN_FLIGHT];
+        struct vk_release_watch release[VK_MAX_FRAMES_IN_FLIGHT];  // Signalled by each frame
+        bool release_signals;  // Submissions export sync_files (else released in begin_frame)
+        bool deferred;         // Newest buffer is latched but waiting for a free frame slot
+        uint64_t superseded;   // Commits replaced before they were rendered
+
+        struct vk_resident_capture resident[VK_MAX_FRAMES_IN_FLIGHT];
+        bool resident_disabled;  // Sample the capture buffer directly (WAYWALL_VK_NO_RESIDENT)
     } capture;
 
     // Event listeners
@@ -370,6 +739,25 @@ struct server_vk {
     struct wl_event_source *overlay_tick;
     int32_t overlay_tick_ms;
 
+    // Frame pacing (WAYWALL_VK_PACING). Capture commits only latch the newest buffer;
+    // it is rendered once per output refresh, offset_ns before the predicted vblank.
+    struct {
+        bool enabled;
+        bool pending;  // A latched buffer is waiting to be rendered
+        bool armed;    // timer_fd is set for the next deadline
+        bool dropped;  // The last frame had damage but no swapchain image could be acquired
+
+        int timer_fd;
+        struct wl_event_source *timer;
+
+        uint64_t offset_ns;       // WAYWALL_VK_PACING_OFFSET_MS
+        uint64_t refresh_ns;      // From presentation feedback (0 if none yet)
+        uint64_t last_vblank_ns;  // CLOCK_MONOTONIC, from presentation feedback
+        uint64_t last_target_ns;  // Vblank the last scheduled render was aimed at
+
+        struct wl_list feedbacks;  // vk_present_feedback.link
+    } pacing;
+
     // Events
     struct {
         struct wl_signal frame;  // data: NULL
@@ -417,6 +805,7 @@ struct vk_mirror_options {
 struct vk_mirror *server_vk_add_mirror(struct server_vk *vk, const struct vk_mirror_options *options);
 void server_vk_remove_mirror(struct server_vk *vk, struct vk_mirror *mirror);
 void server_vk_mirror_set_enabled(struct vk_mirror *mirror, bool enabled);
+void server_vk_mirror_set_depth(struct vk_mirror *mirror, int32_t depth);
 
 // Image options for creating images
 struct vk_image_options {
@@ -429,6 +818,9 @@ struct vk_image *server_vk_add_image(struct server_vk *vk, const char *path, con
 struct vk_image *server_vk_add_avif_image(struct server_vk *vk, const char *path, const struct vk_image_options *options);
 void server_vk_remove_image(struct server_vk *vk, struct vk_image *image);
 void server_vk_image_set_enabled(struct vk_image *image, bool enabled);
+bool server_vk_image_is_ready(struct vk_image *image);
+bool server_vk_image_has_failed(struct vk_image *image);
+void server_vk_image_set_depth(struct vk_image *image, int32_t depth);
 
 // Text options for creating text
 struct vk_text_options {
@@ -443,6 +835,7 @@ struct vk_text_options {
 struct vk_text *server_vk_add_text(struct server_vk *vk, const char *text, const struct vk_text_options *options);
 void server_vk_remove_text(struct server_vk *vk, struct vk_text *text);
 void server_vk_text_set_enabled(struct vk_text *text, bool enabled);
+void server_vk_text_set_depth(struct vk_text *text, int32_t depth);
 void server_vk_text_set_text(struct vk_text *text, const char *new_text);
 void server_vk_text_set_color(struct vk_text *text, uint32_t color);
 
@@ -453,6 +846,25 @@ struct vk_advance_ret {
 
 struct vk_advance_ret server_vk_text_advance(struct server_vk *vk, const char *data, size_t data_len, uint32_t size);
 
+// A line of laid out text, as byte offsets into the string (end exclusive) and its width in pixels.
+struct vk_text_line {
+    size_t start, end;
+    int32_t width;
+};
+
+// Splits a string into lines no wider than max_width, breaking at spaces where possible. If
+// max_width is not positive, lines only end at newlines. Returns the number of lines and points out
+// at them. Results are cached, and the lines stay valid until the next layout or advance call.
+size_t server_vk_text_layout(struct server_vk *vk, const char *data, size_t data_len, uint32_t size,
+                             int32_t max_width, const struct vk_text_line **out);
+
+// Frame timing API. Copies up to max of the most recent samples (oldest first)
+// into out and returns the number copied.
+size_t server_vk_get_frame_stats(struct server_vk *vk, struct vk_frame_stats *out, size_t max);
+
+// Device memory API
+void server_vk_get_memory_stats(struct server_vk *vk, struct vk_memory_stats *out);
+
 // Atlas / atlas image API (Vulkan-only mode)
 struct vk_atlas *server_vk_create_atlas(struct server_vk *vk, uint32_t width, const char *rgba_data,
                                         size_t rgba_len);
@@ -460,6 +872,8 @@ void server_vk_atlas_ref(struct vk_atlas *atlas);
 void server_vk_atlas_unref(struct vk_atlas *atlas);
 bool server_vk_atlas_insert_raw(struct vk_atlas *atlas, const char *data, size_t data_len, uint32_t x,
                                 uint32_t y);
+bool server_vk_atlas_is_ready(struct vk_atlas *atlas);
+bool server_vk_atlas_take_failed(struct vk_atlas *atlas);
 char *server_vk_atlas_get_dump(struct vk_atlas *atlas, size_t *out_len);
 
 struct vk_image *server_vk_add_image_from_atlas(struct server_vk *vk, struct vk_atlas *atlas, struct box src,
@@ -28,6 +28,10 @@ struct server_region {
     struct wl_region *remote;
 };
 
+struct server_surface_damage {
+    int32_t x, y, width, height;
+};
+
 struct server_surface {
     struct wl_resource *resource;
 
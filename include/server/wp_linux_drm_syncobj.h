@@ -24,7 +24,6 @@ struct server_drm_syncobj_surface {
     struct wp_linux_drm_syncobj_surface_v1 *remote;
 
     VkSemaphore vk_sem;
-    int imported_fd;
 
     VkSemaphore vk_sem_release;
     int imported_release_fd;
@@ -22,6 +22,11 @@ struct util_avif {
     // For single-frame AVIFs, only frames[0] is used
     int32_t width;
     int32_t height;
+
+    // Images loaded from the cache point their frame data into a read-only mapping of the cache
+    // entry instead of owning it. NULL for decoded images.
+    void *map;
+    size_t map_size;
 };
 
 // Decode a single-frame or animated AVIF from a file path
@@ -30,7 +35,7 @@ struct util_avif util_avif_decode(const char *path, unsigned int max_size);
 // Decode a single-frame or animated AVIF from raw data
 struct util_avif util_avif_decode_raw(const char *data, size_t data_size, unsigned int max_size);
 
-// Free all resources associated with a util_avif structure
+// Free all resources associated with a util_avif structure, unmapping it if it came from the cache
 void util_avif_free(struct util_avif *avif);
 
 #endif
@@ -0,0 +1,50 @@
+#ifndef WAYWALL_UTIL_CACHE_H
+#define WAYWALL_UTIL_CACHE_H
+
+#include "util/avif.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// A persistent on-disk cache under $XDG_CACHE_HOME/waywall (or ~/.cache/waywall). It holds HTTP
+// responses keyed by their request, decoded images keyed by the hash of their encoded contents, and named
+// blobs such as the Vulkan pipeline cache. All functions are safe to call from any thread. Entries
+// are written to a temporary file and renamed into place, so concurrent writers never expose a
+// partially written entry.
+//
+// HTTP responses and decoded images are each limited in size (128 MiB and 512 MiB). Storing an
+// entry past the limit removes the least recently used entries.
+//
+// The cache can be disabled by setting WAYWALL_NO_CACHE=1.
+
+struct util_cache_http {
+    char *etag;          // May be NULL.
+    char *last_modified; // May be NULL.
+    uint64_t expires;    // Unix time (seconds) until which the entry is fresh, or 0.
+
+    char *body;
+    size_t body_size;
+};
+
+uint64_t util_cache_hash(const void *data, size_t size);
+
+// Returns true and fills out if an entry exists for the given key. The key identifies the request,
+// i.e. its URL and anything else the response depends on.
+bool util_cache_http_load(const char *key, struct util_cache_http *out);
+void util_cache_http_store(const char *key, const struct util_cache_http *entry);
+void util_cache_http_free(struct util_cache_http *entry);
+
+// Decoded images are stored as RGBA8 frames, using struct util_avif as a generic container for both
+// still and animated images. max_size is part of the key since it affects whether decoding
+// succeeds. Loaded frames point into a read-only mapping of the entry, which util_avif_free unmaps.
+bool util_cache_image_load(const char *data, size_t data_size, unsigned int max_size,
+                           struct util_avif *out);
+void util_cache_image_store(const char *data, size_t data_size, unsigned int max_size,
+                            const struct util_avif *image);
+
+// Arbitrary blobs stored by name directly under the cache directory (e.g. the Vulkan pipeline
+// cache). The caller is responsible for validating the contents. *out must be freed by the caller.
+bool util_cache_blob_load(const char *name, char **out, size_t *out_size);
+void util_cache_blob_store(const char *name, const void *data, size_t size);
+
+#endif
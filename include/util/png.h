@@ -1,6 +1,7 @@
 #ifndef WAYWALL_UTIL_PNG_H
 #define WAYWALL_UTIL_PNG_H
 
+#include "util/avif.h"
 #include <stddef.h>
 #include <stdint.h>
 
@@ -14,4 +15,10 @@ struct util_png {
 struct util_png util_png_decode(const char *path, unsigned int max_size);
 struct util_png util_png_decode_raw(const char *data, size_t data_size, unsigned int max_size);
 
+// Decode a PNG into a single-frame util_avif, which must be freed with util_avif_free. Images found
+// in the cache point into the cache entry rather than being copied.
+struct util_avif util_png_decode_image(const char *path, unsigned int max_size);
+struct util_avif util_png_decode_image_raw(const char *data, size_t data_size,
+                                           unsigned int max_size);
+
 #endif
@@ -0,0 +1,70 @@
+#ifndef WAYWALL_UTIL_SPSC_H
+#define WAYWALL_UTIL_SPSC_H
+
+#include "util/alloc.h"
+#include "util/prelude.h"
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+// A bounded, lock-free queue of pointers with exactly one producer thread and exactly one consumer
+// thread. The capacity must be a power of two. One slot is always left empty so that a full queue
+// can be distinguished from an empty one.
+struct spsc_queue {
+    void **slots;
+    size_t mask;
+
+    // head is only written by the consumer and tail is only written by the producer. They are kept
+    // on separate cache lines so the two threads do not contend on every push and pop.
+    alignas(64) _Atomic size_t head;
+    alignas(64) _Atomic size_t tail;
+};
+
+static inline void
+spsc_queue_init(struct spsc_queue *queue, size_t capacity) {
+    ww_assert(capacity > 1 && (capacity & (capacity - 1)) == 0);
+
+    queue->slots = zalloc(capacity, sizeof(*queue->slots));
+    queue->mask = capacity - 1;
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+}
+
+static inline void
+spsc_queue_finish(struct spsc_queue *queue) {
+    free(queue->slots);
+    queue->slots = NULL;
+    queue->mask = 0;
+}
+
+// Producer side. Returns false if the queue is full.
+static inline bool
+spsc_queue_push(struct spsc_queue *queue, void *item) {
+    size_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    size_t next = (tail + 1) & queue->mask;
+    if (next == atomic_load_explicit(&queue->head, memory_order_acquire)) {
+        return false;
+    }
+
+    queue->slots[tail] = item;
+    atomic_store_explicit(&queue->tail, next, memory_order_release);
+    return true;
+}
+
+// Consumer side. Returns NULL if the queue is empty.
+static inline void *
+spsc_queue_pop(struct spsc_queue *queue) {
+    size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    if (head == atomic_load_explicit(&queue->tail, memory_order_acquire)) {
+        return NULL;
+    }
+
+    void *item = queue->slots[head];
+    queue->slots[head] = NULL;
+    atomic_store_explicit(&queue->head, (head + 1) & queue->mask, memory_order_release);
+    return item;
+}
+
+#endif
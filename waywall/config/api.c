@@ -228,6 +228,30 @@ vk_mirror_hide(lua_State *L) {
     return 0;
 }
 
+static int
+vk_mirror_get_depth(lua_State *L) {
+    struct vk_mirror **mirror = lua_touserdata(L, 1);
+    if (!*mirror) {
+        return luaL_error(L, "object already closed");
+    }
+
+    lua_pushinteger(L, (*mirror)->depth);
+    return 1;
+}
+
+static int
+vk_mirror_set_depth(lua_State *L) {
+    struct vk_mirror **mirror = lua_touserdata(L, 1);
+    if (!*mirror) {
+        return luaL_error(L, "object already closed");
+    }
+
+    int depth = luaL_checkint(L, 2);
+
+    server_vk_mirror_set_depth(*mirror, depth);
+    return 0;
+}
+
 static int
 vk_mirror_index(lua_State *L) {
     const char *key = luaL_checkstring(L, 2);
@@ -238,6 +262,10 @@ vk_mirror_index(lua_State *L) {
         lua_pushcfunction(L, vk_mirror_show);
     } else if (strcmp(key, "hide") == 0) {
         lua_pushcfunction(L, vk_mirror_hide);
+    } else if (strcmp(key, "get_depth") == 0) {
+        lua_pushcfunction(L, vk_mirror_get_depth);
+    } else if (strcmp(key, "set_depth") == 0) {
+        lua_pushcfunction(L, vk_mirror_set_depth);
     } else {
         lua_pushnil(L);
     }
@@ -297,6 +325,45 @@ vk_image_hide(lua_State *L) {
     return 0;
 }
 
+static int
+vk_image_ready(lua_State *L) {
+    struct vk_image **image = lua_touserdata(L, 1);
+    if (!*image) {
+        return luaL_error(L, "object already closed");
+    }
+
+    if (server_vk_image_has_failed(*image)) {
+        return luaL_error(L, "failed to load image");
+    }
+
+    lua_pushboolean(L, server_vk_image_is_ready(*image));
+    return 1;
+}
+
+static int
+vk_image_get_depth(lua_State *L) {
+    struct vk_image **image = lua_touserdata(L, 1);
+    if (!*image) {
+        return luaL_error(L, "object already closed");
+    }
+
+    lua_pushinteger(L, (*image)->depth);
+    return 1;
+}
+
+static int
+vk_image_set_depth(lua_State *L) {
+    struct vk_image **image = lua_touserdata(L, 1);
+    if (!*image) {
+        return luaL_error(L, "object already closed");
+    }
+
+    int depth = luaL_checkint(L, 2);
+
+    server_vk_image_set_depth(*image, depth);
+    return 0;
+}
+
 static int
 vk_image_index(lua_State *L) {
     const char *key = luaL_checkstring(L, 2);
@@ -307,6 +374,12 @@ vk_image_index(lua_State *L) {
         lua_pushcfunction(L, vk_image_show);
     } else if (strcmp(key, "hide") == 0) {
         lua_pushcfunction(L, vk_image_hide);
+    } else if (strcmp(key, "ready") == 0) {
+        lua_pushcfunction(L, vk_image_ready);
+    } else if (strcmp(key, "get_depth") == 0) {
+        lua_pushcfunction(L, vk_image_get_depth);
+    } else if (strcmp(key, "set_depth") == 0) {
+        lua_pushcfunction(L, vk_image_set_depth);
     } else {
         lua_pushnil(L);
     }
@@ -423,6 +496,30 @@ vk_text_set_color(lua_State *L) {
     return 0;
 }
 
+static int
+vk_text_get_depth(lua_State *L) {
+    struct vk_text **text = lua_touserdata(L, 1);
+    if (!*text) {
+        return luaL_error(L, "object already closed");
+    }
+
+    lua_pushinteger(L, (*text)->depth);
+    return 1;
+}
+
+static int
+vk_text_set_depth(lua_State *L) {
+    struct vk_text **text = lua_touserdata(L, 1);
+    if (!*text) {
+        return luaL_error(L, "object already closed");
+    }
+
+    int depth = luaL_checkint(L, 2);
+
+    server_vk_text_set_depth(*text, depth);
+    return 0;
+}
+
 static int
 vk_text_index(lua_State *L) {
     const char *key = luaL_checkstring(L, 2);
@@ -433,6 +530,10 @@ vk_text_index(lua_State *L) {
         lua_pushcfunction(L, vk_text_show);
     } else if (strcmp(key, "hide") == 0) {
         lua_pushcfunction(L, vk_text_hide);
+    } else if (strcmp(key, "get_depth") == 0) {
+        lua_pushcfunction(L, vk_text_get_depth);
+    } else if (strcmp(key, "set_depth") == 0) {
+        lua_pushcfunction(L, vk_text_set_depth);
     } else if (strcmp(key, "set_text") == 0) {
         lua_pushcfunction(L, vk_text_set_text);
     } else if (strcmp(key, "set_color") == 0) {
@@ -494,6 +595,21 @@ vk_atlas_raw(lua_State *L) {
     return 0;
 }
 
+static int
+vk_atlas_ready(lua_State *L) {
+    struct vk_atlas **atlas = lua_touserdata(L, 1);
+    if (!atlas || !*atlas) {
+        return luaL_error(L, "invalid atlas");
+    }
+
+    if (server_vk_atlas_take_failed(*atlas)) {
+        return luaL_error(L, "failed to insert image into atlas");
+    }
+
+    lua_pushboolean(L, server_vk_atlas_is_ready(*atlas));
+    return 1;
+}
+
 static int
 vk_atlas_get_raw(lua_State *L) {
     struct vk_atlas **atlas = lua_touserdata(L, 1);
@@ -521,6 +637,8 @@ vk_atlas_index(lua_State *L) {
         lua_pushcfunction(L, vk_atlas_close);
     } else if (strcmp(key, "insert_raw") == 0) {
         lua_pushcfunction(L, vk_atlas_raw);
+    } else if (strcmp(key, "ready") == 0) {
+        lua_pushcfunction(L, vk_atlas_ready);
     } else if (strcmp(key, "get_dump") == 0) {
         lua_pushcfunction(L, vk_atlas_get_raw);
     } else {
@@ -740,6 +858,105 @@ http_client_get_(lua_State *L) {
     return 0;
 }
 
+static char **
+http_headers_from_table(lua_State *L, int idx) {
+    size_t len = lua_objlen(L, idx);
+    if (len == 0) {
+        return NULL;
+    }
+
+    char **headers = zalloc(len + 1, sizeof(*headers));
+    for (size_t i = 0; i < len; i++) {
+        lua_rawgeti(L, idx, i + 1);
+        const char *header = lua_tostring(L, -1);
+        if (header) {
+            headers[i] = strdup(header);
+            check_alloc(headers[i]);
+        }
+        lua_pop(L, 1);
+        if (!header) {
+            for (size_t j = 0; j < i; j++) {
+                free(headers[j]);
+            }
+            free(headers);
+            luaL_error(L, "expected header %d to be a string", (int)(i + 1));
+            return NULL;
+        }
+    }
+
+    return headers;
+}
+
+static int
+http_client_get_many_(lua_State *L) {
+    static const int ARG_CLIENT = 1;
+    static const int ARG_REQUESTS = 2;
+
+    struct Http_client **client = lua_touserdata(L, ARG_CLIENT);
+    if (!*client) {
+        return luaL_error(L, "http client is closed");
+    }
+
+    luaL_checktype(L, ARG_REQUESTS, LUA_TTABLE);
+
+    // Each entry is either a URL or a table of the form
+    //   { url = "...", headers = { "...", ... }, priority = 0, callback = function(body, url) end }
+    // Requests with a higher priority are started first. Requests without a callback use the
+    // callback the client was created with.
+    size_t len = lua_objlen(L, ARG_REQUESTS);
+    for (size_t i = 0; i < len; i++) {
+        lua_rawgeti(L, ARG_REQUESTS, i + 1);
+
+        if (lua_type(L, -1) == LUA_TSTRING) {
+            char *url = strdup(lua_tostring(L, -1));
+            check_alloc(url);
+            http_client_request(*client, url, NULL, 0, LUA_NOREF);
+            lua_pop(L, 1);
+            continue;
+        }
+
+        if (lua_type(L, -1) != LUA_TTABLE) {
+            return luaL_error(L, "expected request %d to be a string or table", (int)(i + 1));
+        }
+        int entry = lua_gettop(L);
+
+        lua_getfield(L, entry, "url");
+        if (lua_type(L, -1) != LUA_TSTRING) {
+            return luaL_error(L, "expected request %d to have a string url", (int)(i + 1));
+        }
+
+        lua_getfield(L, entry, "priority");
+        int priority = lua_isnumber(L, -1) ? (int)lua_tointeger(L, -1) : 0;
+        lua_pop(L, 1);
+
+        char **headers = NULL;
+        lua_getfield(L, entry, "headers");
+        if (lua_type(L, -1) == LUA_TTABLE) {
+            headers = http_headers_from_table(L, lua_gettop(L));
+        }
+        lua_pop(L, 1);
+
+        char *url = strdup(lua_tostring(L, -1));
+        check_alloc(url);
+        lua_pop(L, 1);
+
+        int callback = LUA_NOREF;
+        lua_getfield(L, entry, "callback");
+        if (lua_type(L, -1) == LUA_TFUNCTION) {
+            callback = luaL_ref(L, LUA_REGISTRYINDEX);
+        } else {
+            lua_pop(L, 1);
+        }
+
+        // http request takes ownership of the url, headers, and callback reference
+        http_client_request(*client, url, headers, priority, callback);
+
+        lua_pop(L, 1);
+    }
+
+    return 0;
+}
+
 static int
 http_client_index(lua_State *L) {
     const char *key = luaL_checkstring(L, 2);
@@ -748,6 +965,8 @@ http_client_index(lua_State *L) {
         lua_pushcfunction(L, http_client_close_);
     } else if (strcmp(key, "get") == 0) {
         lua_pushcfunction(L, http_client_get_);
+    } else if (strcmp(key, "get_many") == 0) {
+        lua_pushcfunction(L, http_client_get_many_);
     } else {
         lua_pushnil(L);
     }
@@ -827,6 +1046,8 @@ atlas_index(lua_State *L) {
         lua_pushcfunction(L, atlas_close_);
     } else if (strcmp(key, "insert_raw") == 0) {
         lua_pushcfunction(L, atlas_raw);
+    } else if (strcmp(key, "ready") == 0) {
+        lua_pushcfunction(L, vk_atlas_ready);
     } else if (strcmp(key, "get_dump") == 0) {
         lua_pushcfunction(L, atlas_get_raw);
     } else {
@@ -1044,6 +1265,83 @@ l_floating_shown(lua_State *L) {
     return 1;
 }
 
+static int
+l_frame_stats(lua_State *L) {
+    static const int ARG_COUNT = 1;
+
+    // Prologue
+    struct config_vm *vm = config_vm_from(L);
+    struct wrap *wrap = config_vm_get_wrap(vm);
+    if (!wrap) {
+        return luaL_error(L, STARTUP_ERRMSG("frame_stats"));
+    }
+
+    lua_Integer max = luaL_optinteger(L, ARG_COUNT, VK_FRAME_STATS_LEN);
+    if (max < 0) {
+        return luaL_error(L, "expected count to be non-negative");
+    } else if (max > VK_FRAME_STATS_LEN) {
+        max = VK_FRAME_STATS_LEN;
+    }
+
+    // Body
+    struct vk_frame_stats *stats = NULL;
+    size_t count = 0;
+    if (wrap->vk && max > 0) {
+        stats = zalloc(max, sizeof(*stats));
+        count = server_vk_get_frame_stats(wrap->vk, stats, max);
+    }
+
+    // Epilogue. Durations are returned in milliseconds.
+    lua_createtable(L, count, 0);
+    for (size_t i = 0; i < count; i++) {
+        const struct vk_frame_stats *s = &stats[i];
+
+        lua_createtable(L, 0, 15);
+        lua_pushinteger(L, s->seq);
+        lua_setfield(L, -2, "seq");
+        if (s->commit_ns) {
+            lua_pushnumber(L, (double)(s->submit_ns - s->commit_ns) / 1e6);
+            lua_setfield(L, -2, "commit_to_submit");
+            lua_pushnumber(L, (double)(s->present_ns - s->commit_ns) / 1e6);
+            lua_setfield(L, -2, "commit_to_present");
+        }
+        lua_pushnumber(L, (double)s->cpu_record_ns / 1e6);
+        lua_setfield(L, -2, "cpu_record");
+        lua_pushnumber(L, (double)s->cpu_submit_ns / 1e6);
+        lua_setfield(L, -2, "cpu_submit");
+        lua_pushnumber(L, (double)s->cpu_present_ns / 1e6);
+        lua_setfield(L, -2, "cpu_present");
+        if (s->gpu_valid) {
+            lua_pushnumber(L, (double)s->gpu_acquire_ns / 1e6);
+            lua_setfield(L, -2, "gpu_acquire");
+            lua_pushnumber(L, (double)s->gpu_capture_ns / 1e6);
+            lua_setfield(L, -2, "gpu_capture");
+            lua_pushnumber(L, (double)s->gpu_overlays_ns / 1e6);
+            lua_setfield(L, -2, "gpu_overlays");
+            lua_pushnumber(L, (double)s->gpu_release_ns / 1e6);
+            lua_setfield(L, -2, "gpu_release");
+            lua_pushnumber(L, (double)s->gpu_total_ns / 1e6);
+            lua_setfield(L, -2, "gpu_total");
+        }
+        if (s->copy_valid) {
+            if (s->commit_ns && s->copy_submit_ns >= s->commit_ns) {
+                lua_pushnumber(L, (double)(s->copy_submit_ns - s->commit_ns) / 1e6);
+                lua_setfield(L, -2, "commit_to_copy");
+            }
+            if (s->gpu_copy_ns) {
+                lua_pushnumber(L, (double)s->gpu_copy_ns / 1e6);
+                lua_setfield(L, -2, "gpu_copy");
+            }
+            lua_pushboolean(L, s->copy_pending != 0);
+            lua_setfield(L, -2, "copy_pending");
+        }
+        lua_rawseti(L, -2, i + 1);
+    }
+
+    free(stats);
+    return 1;
+}
+
 static int
 l_image(lua_State *L) {
     static const int ARG_PATH = 1;
@@ -1316,6 +1614,42 @@ l_animated_image(lua_State *L) {
     return 1;
 }
 
+static int
+l_memory_stats(lua_State *L) {
+    // Prologue
+    struct config_vm *vm = config_vm_from(L);
+    struct wrap *wrap = config_vm_get_wrap(vm);
+    if (!wrap) {
+        return luaL_error(L, STARTUP_ERRMSG("memory_stats"));
+    }
+
+    // Body
+    struct vk_memory_stats stats = {0};
+    if (wrap->vk) {
+        server_vk_get_memory_stats(wrap->vk, &stats);
+    }
+
+    // Epilogue
+    lua_createtable(L, 0, 8);
+    lua_pushinteger(L, stats.block_count);
+    lua_setfield(L, -2, "block_count");
+    lua_pushinteger(L, stats.block_bytes);
+    lua_setfield(L, -2, "block_bytes");
+    lua_pushinteger(L, stats.used_bytes);
+    lua_setfield(L, -2, "used_bytes");
+    lua_pushinteger(L, stats.allocation_count);
+    lua_setfield(L, -2, "allocation_count");
+    lua_pushinteger(L, stats.free_ranges);
+    lua_setfield(L, -2, "free_ranges");
+    lua_pushinteger(L, stats.largest_free);
+    lua_setfield(L, -2, "largest_free");
+    lua_pushinteger(L, stats.dedicated_count);
+    lua_setfield(L, -2, "dedicated_count");
+    lua_pushinteger(L, stats.dedicated_bytes);
+    lua_setfield(L, -2, "dedicated_bytes");
+    return 1;
+}
+
 static int
 l_mirror(lua_State *L) {
     static const int ARG_OPTIONS = 1;
@@ -2063,6 +2397,46 @@ l_text_advance(lua_State *L) {
     return 1;
 }
 
+static int
+l_text_layout(lua_State *L) {
+    static const int ARG_TEXT = 1;
+    static const int ARG_SIZE = 2;
+    static const int ARG_WIDTH = 3;
+
+    // Prologue
+    struct config_vm *vm = config_vm_from(L);
+    struct wrap *wrap = config_vm_get_wrap(vm);
+    if (!wrap) {
+        return luaL_error(L, STARTUP_ERRMSG("text_layout"));
+    }
+
+    size_t data_size = 0;
+    const char *data = luaL_checklstring(L, ARG_TEXT, &data_size);
+    const uint32_t size = (uint32_t)luaL_checkinteger(L, ARG_SIZE);
+    const int32_t max_width = (int32_t)luaL_checkinteger(L, ARG_WIDTH);
+
+    // Body
+    const struct vk_text_line *lines = NULL;
+    size_t line_count = 0;
+    if (wrap->vk) {
+        line_count = server_vk_text_layout(wrap->vk, data, data_size, size, max_width, &lines);
+    }
+
+    // Epilogue
+    lua_createtable(L, line_count, 0);
+    for (size_t i = 0; i < line_count; i++) {
+        lua_createtable(L, 0, 3);
+        lua_pushinteger(L, lines[i].start + 1);
+        lua_setfield(L, -2, "first");
+        lua_pushinteger(L, lines[i].end);
+        lua_setfield(L, -2, "last");
+        lua_pushinteger(L, lines[i].width);
+        lua_setfield(L, -2, "width");
+        lua_rawseti(L, -2, i + 1);
+    }
+    return 1;
+}
+
 static int
 l_log(lua_State *L) {
     ww_log(LOG_INFO, "lua: %s", lua_tostring(L, 1));
@@ -2171,7 +2545,8 @@ l_irc_client(lua_State *L) {
     luaL_getmetatable(L, METATABLE_IRC);
     lua_setmetatable(L, -2);
 
-    *client = irc_client_create(server, port, nick, pass, callback, L);
+    struct wl_event_loop *loop = wl_display_get_event_loop(wrap->server->display);
+    *client = irc_client_create(loop, server, port, nick, pass, callback, L);
     if (!*client) {
         luaL_unref(L, LUA_REGISTRYINDEX, callback);
         return luaL_error(L, "failed to create irc client");
@@ -2202,7 +2577,8 @@ l_http_client(lua_State *L) {
     luaL_getmetatable(L, METATABLE_HTTP);
     lua_setmetatable(L, -2);
 
-    *client = http_client_create(callback, L);
+    struct wl_event_loop *loop = wl_display_get_event_loop(wrap->server->display);
+    *client = http_client_create(loop, callback, L);
     if (!*client) {
         luaL_unref(L, LUA_REGISTRYINDEX, callback);
         return luaL_error(L, "failed to create http client");
@@ -2300,7 +2676,9 @@ static const struct luaL_Reg lua_lib[] = {
     {"current_time", l_current_time},
     {"exec", l_exec},
     {"floating_shown", l_floating_shown},
+    {"frame_stats", l_frame_stats},
     {"image", l_image},
+    {"memory_stats", l_memory_stats},
     {"mirror", l_mirror},
     {"press_key", l_press_key},
     {"get_key", l_get_key},
@@ -2320,6 +2698,7 @@ static const struct luaL_Reg lua_lib[] = {
     {"image_a", l_image_from_atlas},
     {"animated_image", l_animated_image},
     {"text_advance", l_text_advance},
+    {"text_layout", l_text_layout},
 
     // private (see init.lua)
     {"log", l_log},
@@ -56,6 +56,7 @@ static const struct config defaults = {
             .ninb_anchor = ANCHOR_NONE,
             .ninb_opacity = 1.0,
             .font_path = "",
+            .font_prewarm = "",
         },
     .shaders = {0},
 };
@@ -693,6 +694,11 @@ process_config_theme(struct config *cfg) {
         return 1;
     }
 
+    if (get_string(cfg, "font_prewarm", &cfg->theme.font_prewarm, "theme.font_prewarm", false) !=
+        0) {
+        return 1;
+    }
+
     return 0;
 }
 
@@ -839,6 +845,7 @@ config_create() {
         {&cfg->theme.cursor_theme, "theme.cursor_theme"},
         {&cfg->theme.cursor_icon, "theme.cursor_icon"},
         {&cfg->theme.font_path, "theme.font_path"},
+        {&cfg->theme.font_prewarm, "theme.font_prewarm"},
     };
 
     for (size_t i = 0; i < STATIC_ARRLEN(strings); i++) {
@@ -870,6 +877,7 @@ config_destroy(struct config *cfg) {
     free(cfg->theme.cursor_theme);
     free(cfg->theme.cursor_icon);
     free(cfg->theme.font_path);
+    free(cfg->theme.font_prewarm);
 
     for (size_t i = 0; i < cfg->shaders.count; i++) {
         free(cfg->shaders.data[i].name);
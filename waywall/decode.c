@@ -0,0 +1,290 @@
+#include "decode.h"
+#include "util/alloc.h"
+#include "util/avif.h"
+#include "util/log.h"
+#include "util/png.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <wayland-server-core.h>
+
+static void
+job_free(struct ww_decode_job *job) {
+    util_avif_free(&job->result);
+    free(job->path);
+    free(job->data);
+    free(job);
+}
+
+static void
+job_decode(struct ww_decode_job *job) {
+    switch (job->format) {
+    case WW_DECODE_PNG:
+        job->result = job->path
+                          ? util_png_decode_image(job->path, job->max_size)
+                          : util_png_decode_image_raw(job->data, job->data_size, job->max_size);
+        break;
+    case WW_DECODE_AVIF:
+        job->result = job->path ? util_avif_decode(job->path, job->max_size)
+                                : util_avif_decode_raw(job->data, job->data_size, job->max_size);
+        break;
+    }
+
+    // The encoded data is no longer needed once it has been decoded.
+    free(job->data);
+    job->data = NULL;
+}
+
+static void *
+decode_thread(void *arg) {
+    struct ww_decode_pool *pool = arg;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (wl_list_empty(&pool->queued) && !pool->should_exit) {
+            pthread_cond_wait(&pool->cond_queued, &pool->lock);
+        }
+        if (pool->should_exit) {
+            break;
+        }
+
+        struct ww_decode_job *job = wl_container_of(pool->queued.prev, job, link);
+        wl_list_remove(&job->link);
+        job->state = WW_DECODE_RUNNING;
+        pthread_mutex_unlock(&pool->lock);
+
+        job_decode(job);
+
+        pthread_mutex_lock(&pool->lock);
+        job->state = WW_DECODE_COMPLETED;
+        wl_list_insert(pool->completed.prev, &job->link);
+        pool->busy--;
+        pthread_cond_broadcast(&pool->cond_idle);
+
+        uint64_t one = 1;
+        if (write(pool->fd, &one, sizeof(one)) != sizeof(one)) {
+            ww_log_errno(LOG_ERROR, "failed to write to decode eventfd");
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+static void
+dispatch_completed(struct ww_decode_pool *pool) {
+    struct wl_list completed;
+
+    pthread_mutex_lock(&pool->lock);
+    wl_list_init(&completed);
+    wl_list_insert_list(&completed, &pool->completed);
+    wl_list_init(&pool->completed);
+    pthread_mutex_unlock(&pool->lock);
+
+    // Jobs in the local list can no longer be touched by the workers, and cancelling one only marks
+    // it as cancelled.
+    while (!wl_list_empty(&completed)) {
+        struct ww_decode_job *job = wl_container_of(completed.next, job, link);
+        wl_list_remove(&job->link);
+
+        if (!job->cancelled && job->done) {
+            job->done(job, job->userdata);
+        }
+        job_free(job);
+    }
+}
+
+static int
+handle_decode_fd(int32_t fd, uint32_t mask, void *data) {
+    struct ww_decode_pool *pool = data;
+
+    uint64_t count;
+    if (read(fd, &count, sizeof(count)) == -1 && errno != EAGAIN) {
+        ww_log_errno(LOG_ERROR, "failed to read from decode eventfd");
+    }
+
+    dispatch_completed(pool);
+    return 0;
+}
+
+struct ww_decode_pool *
+ww_decode_pool_create(struct wl_event_loop *loop, size_t thread_count) {
+    struct ww_decode_pool *pool = zalloc(1, sizeof(*pool));
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->cond_queued, NULL);
+    pthread_cond_init(&pool->cond_idle, NULL);
+    wl_list_init(&pool->queued);
+    wl_list_init(&pool->completed);
+
+    pool->fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (pool->fd == -1) {
+        ww_log_errno(LOG_ERROR, "failed to create decode eventfd");
+        goto fail_eventfd;
+    }
+
+    pool->src = wl_event_loop_add_fd(loop, pool->fd, WL_EVENT_READABLE, handle_decode_fd, pool);
+    if (!pool->src) {
+        ww_log(LOG_ERROR, "failed to add decode eventfd to event loop");
+        goto fail_source;
+    }
+
+    pool->threads = zalloc(thread_count, sizeof(*pool->threads));
+    for (size_t i = 0; i < thread_count; i++) {
+        if (pthread_create(&pool->threads[i], NULL, decode_thread, pool) != 0) {
+            ww_log(LOG_ERROR, "failed to create decode thread");
+            break;
+        }
+        pool->thread_count++;
+    }
+    if (pool->thread_count == 0) {
+        goto fail_threads;
+    }
+
+    return pool;
+
+fail_threads:
+    free(pool->threads);
+    wl_event_source_remove(pool->src);
+
+fail_source:
+    close(pool->fd);
+
+fail_eventfd:
+    pthread_cond_destroy(&pool->cond_idle);
+    pthread_cond_destroy(&pool->cond_queued);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+    return NULL;
+}
+
+void
+ww_decode_pool_destroy(struct ww_decode_pool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->should_exit = true;
+    pthread_cond_broadcast(&pool->cond_queued);
+    pthread_mutex_unlock(&pool->lock);
+
+    // Workers finish the job they are currently decoding before exiting.
+    for (size_t i = 0; i < pool->thread_count; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    free(pool->threads);
+
+    struct ww_decode_job *job, *tmp;
+    wl_list_for_each_safe (job, tmp, &pool->queued, link) {
+        wl_list_remove(&job->link);
+        if (job->destroy) {
+            job->destroy(job->userdata);
+        }
+        job_free(job);
+    }
+    wl_list_for_each_safe (job, tmp, &pool->completed, link) {
+        wl_list_remove(&job->link);
+        if (!job->cancelled && job->destroy) {
+            job->destroy(job->userdata);
+        }
+        job_free(job);
+    }
+
+    wl_event_source_remove(pool->src);
+    close(pool->fd);
+
+    pthread_cond_destroy(&pool->cond_idle);
+    pthread_cond_destroy(&pool->cond_queued);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+}
+
+void
+ww_decode_pool_flush(struct ww_decode_pool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    while (pool->busy > 0) {
+        pthread_cond_wait(&pool->cond_idle, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    dispatch_completed(pool);
+}
+
+static struct ww_decode_job *
+submit(struct ww_decode_pool *pool, struct ww_decode_job *job) {
+    pthread_mutex_lock(&pool->lock);
+    job->state = WW_DECODE_QUEUED;
+    wl_list_insert(&pool->queued, &job->link);
+    pool->busy++;
+    pthread_cond_signal(&pool->cond_queued);
+    pthread_mutex_unlock(&pool->lock);
+
+    return job;
+}
+
+struct ww_decode_job *
+ww_decode_pool_submit_file(struct ww_decode_pool *pool, enum ww_decode_format format,
+                           const char *path, unsigned int max_size, ww_decode_func_t done,
+                           ww_decode_destroy_func_t destroy, void *data) {
+    struct ww_decode_job *job = zalloc(1, sizeof(*job));
+    job->format = format;
+    job->path = strdup(path);
+    check_alloc(job->path);
+    job->max_size = max_size;
+    job->done = done;
+    job->destroy = destroy;
+    job->userdata = data;
+
+    return submit(pool, job);
+}
+
+struct ww_decode_job *
+ww_decode_pool_submit_raw(struct ww_decode_pool *pool, enum ww_decode_format format,
+                          const char *data, size_t data_size, unsigned int max_size,
+                          ww_decode_func_t done, ww_decode_destroy_func_t destroy,
+                          void *userdata) {
+    struct ww_decode_job *job = zalloc(1, sizeof(*job));
+    job->format = format;
+    job->data = malloc(data_size);
+    check_alloc(job->data);
+    memcpy(job->data, data, data_size);
+    job->data_size = data_size;
+    job->max_size = max_size;
+    job->done = done;
+    job->destroy = destroy;
+    job->userdata = userdata;
+
+    return submit(pool, job);
+}
+
+void
+ww_decode_job_cancel(struct ww_decode_pool *pool, struct ww_decode_job *job) {
+    pthread_mutex_lock(&pool->lock);
+    if (job->cancelled) {
+        pthread_mutex_unlock(&pool->lock);
+        return;
+    }
+
+    if (job->state == WW_DECODE_QUEUED) {
+        wl_list_remove(&job->link);
+        pool->busy--;
+        pthread_cond_broadcast(&pool->cond_idle);
+        pthread_mutex_unlock(&pool->lock);
+
+        if (job->destroy) {
+            job->destroy(job->userdata);
+        }
+        job_free(job);
+        return;
+    }
+
+    // The job is being decoded or is waiting to be dispatched. It is freed once it reaches the main
+    // thread.
+    job->cancelled = true;
+    pthread_mutex_unlock(&pool->lock);
+
+    if (job->destroy) {
+        job->destroy(job->userdata);
+    }
+}
@@ -1,26 +1,29 @@
 #include "http.h"
+#include "util/alloc.h"
 #include "util/log.h"
 #include <config/vm.h>
 #include <curl/curl.h>
+#include <errno.h>
 #include <lua.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
 
 static struct Http_client *all_clients[MAX_CLIENTS] = {0};
 static int client_count = 0;
 static pthread_mutex_t clients_mutex = PTHREAD_MUTEX_INITIALIZER;
 
-static int pushed_count = 0;
-static int popped_count = 0;
-
-struct response_buffer {
-    char *data;
-    size_t size;
-};
+static atomic_int pushed_count = 0;
+static atomic_int popped_count = 0;
 
 static size_t
 write_callback(void *contents, size_t size, size_t nmemb, struct response_buffer *buffer) {
@@ -39,233 +42,469 @@ write_callback(void *contents, size_t size, size_t nmemb, struct response_buffer
     return realsize;
 }
 
-static bool
-response_queue_is_full(struct response_queue *q) {
-    return ((q->write_pos + 1) % MAX_QUEUED) == q->read_pos;
-}
+// Returns a copy of the value of the given header if line contains it, or NULL otherwise.
+static char *
+header_value(const char *line, size_t len, const char *name) {
+    size_t name_len = strlen(name);
+    if (len <= name_len || strncasecmp(line, name, name_len) != 0 || line[name_len] != ':') {
+        return NULL;
+    }
 
-static bool
-response_queue_is_empty(struct response_queue *q) {
-    return q->write_pos == q->read_pos;
+    const char *start = line + name_len + 1;
+    const char *end = line + len;
+    while (start < end && (*start == ' ' || *start == '\t')) {
+        start++;
+    }
+    while (end > start && (end[-1] == '\r' || end[-1] == '\n' || end[-1] == ' ')) {
+        end--;
+    }
+
+    return strndup(start, end - start);
 }
 
-static bool
-request_queue_is_full(struct Http_client *client) {
-    return ((client->request_write_pos + 1) % MAX_QUEUED) == client->request_read_pos;
+static size_t
+header_callback(char *buffer, size_t size, size_t nitems, struct pending_request *req) {
+    size_t len = size * nitems;
+
+    // A new status line means curl followed a redirect. Only the headers of the final response
+    // are relevant.
+    if (len >= 5 && strncmp(buffer, "HTTP/", 5) == 0) {
+        free(req->etag);
+        free(req->last_modified);
+        req->etag = NULL;
+        req->last_modified = NULL;
+        req->max_age = 0;
+        req->no_store = false;
+        return len;
+    }
+
+    // Responses which may differ for another user, or which vary on request headers other than the
+    // ones in the cache key, are not stored.
+
+    char *value;
+    if ((value = header_value(buffer, len, "ETag"))) {
+        free(req->etag);
+        req->etag = value;
+    } else if ((value = header_value(buffer, len, "Last-Modified"))) {
+        free(req->last_modified);
+        req->last_modified = value;
+    } else if ((value = header_value(buffer, len, "Cache-Control"))) {
+        if (strstr(value, "no-store") || strstr(value, "private")) {
+            req->no_store = true;
+        }
+        char *max_age = strstr(value, "max-age=");
+        if (max_age) {
+            req->max_age = strtol(max_age + STATIC_STRLEN("max-age="), NULL, 10);
+        }
+        free(value);
+    } else if ((value = header_value(buffer, len, "Vary"))) {
+        if (strchr(value, '*')) {
+            req->no_store = true;
+        }
+        free(value);
+    }
+
+    return len;
 }
 
-static bool
-request_queue_is_empty(struct Http_client *client) {
-    return client->request_write_pos == client->request_read_pos;
+// Returns the key of the request's cache entry. Request headers (e.g. Authorization) can change
+// the response, so they are part of the key. Requests without headers are keyed by their URL.
+static char *
+cache_key(struct pending_request *req) {
+    size_t len = strlen(req->url);
+    for (int i = 0; req->headers && req->headers[i]; i++) {
+        len += 1 + strlen(req->headers[i]);
+    }
+
+    char *key = malloc(len + 1);
+    check_alloc(key);
+
+    char *ptr = stpcpy(key, req->url);
+    for (int i = 0; req->headers && req->headers[i]; i++) {
+        *ptr++ = '\n';
+        ptr = stpcpy(ptr, req->headers[i]);
+    }
+    return key;
 }
 
 static void
-response_queue_init(struct response_queue *q) {
-    if (!q)
-        return;
-    for (int i = 0; i < MAX_QUEUED; i++) {
-        free(q->responses[i]);
-        q->responses[i] = NULL;
+signal_fd(int fd) {
+    uint64_t one = 1;
+    if (write(fd, &one, sizeof(one)) != sizeof(one)) {
+        ww_log_errno(LOG_ERROR, "failed to write to eventfd");
     }
-    q->write_pos = 0;
-    q->read_pos = 0;
 }
 
 static void
-request_queue_init(struct Http_client *client) {
-    if (!client)
-        return;
-    for (int i = 0; i < MAX_QUEUED; i++) {
-        free(client->pending_requests[i]);
-        client->pending_requests[i] = NULL;
+drain_fd(int fd) {
+    uint64_t count;
+    if (read(fd, &count, sizeof(count)) == -1 && errno != EAGAIN) {
+        ww_log_errno(LOG_ERROR, "failed to read from eventfd");
     }
-    client->request_write_pos = 0;
-    client->request_read_pos = 0;
 }
 
+// Frees a request without touching its Lua callback reference, which can only be released from the
+// main thread.
 static void
-response_queue_push(struct Http_client *client, const char *response, size_t response_len,
-                    char *url) {
-    pthread_mutex_lock(&client->queue_mutex);
-    struct response_queue *q = &client->response_queue;
-
-    if (response_queue_is_full(q)) {
-        ww_log(LOG_WARN, "Response queue full for client %d. Dropping response.", client->index);
-        pthread_mutex_unlock(&client->queue_mutex);
-        return;
+free_request(struct pending_request *req) {
+    if (req->headers) {
+        for (int i = 0; req->headers[i]; i++) {
+            free(req->headers[i]);
+        }
+        free(req->headers);
     }
+    curl_slist_free_all(req->header_list);
+    util_cache_http_free(&req->cached);
+    free(req->cache_key);
+    free(req->etag);
+    free(req->last_modified);
+    free(req->body.data);
+    free(req->url);
+    free(req);
+}
 
-    struct queued_response *qr = malloc(sizeof(*qr));
-    if (!qr) {
-        ww_log(LOG_ERROR, "malloc failed for queued_response");
-        pthread_mutex_unlock(&client->queue_mutex);
-        return;
-    }
+static void
+free_response(struct queued_response *qr) {
+    free(qr->data);
+    free(qr->url);
+    free(qr);
+}
 
-    qr->data = malloc(response_len);
-    if (!qr->data) {
-        ww_log(LOG_ERROR, "malloc failed for response data");
-        free(qr);
-        pthread_mutex_unlock(&client->queue_mutex);
-        return;
+// ==== Worker thread ====
+
+static void
+pending_insert(struct Http_client *client, struct pending_request *req) {
+    // Keep the pending list sorted by descending priority. Requests with equal priority are started
+    // in the order they were submitted.
+    struct pending_request *prev;
+    wl_list_for_each_reverse (prev, &client->pending, link) {
+        if (prev->priority >= req->priority) {
+            wl_list_insert(&prev->link, &req->link);
+            return;
+        }
     }
+    wl_list_insert(&client->pending, &req->link);
+}
 
-    memcpy(qr->data, response, response_len);
-    qr->size = response_len;
+static void
+release_handle(struct Http_client *client, CURL *curl) {
+    curl_multi_remove_handle(client->multi, curl);
+
+    // Keeping the easy handle around lets later requests reuse its DNS and TLS session caches. Open
+    // connections are owned by the multi handle and are reused regardless.
+    if (client->idle_count < MAX_IN_FLIGHT) {
+        curl_easy_reset(curl);
+        client->idle[client->idle_count++] = curl;
+    } else {
+        curl_easy_cleanup(curl);
+    }
+}
 
-    qr->url = strdup(url);
+static void
+finish_request(struct Http_client *client, struct pending_request *req, const char *error) {
+    if (req->curl) {
+        release_handle(client, req->curl);
+        req->curl = NULL;
+        client->in_flight--;
+    }
+    wl_list_remove(&req->link);
+
+    // Every finished request must reach the main thread, which releases its callback and its
+    // slot in the outstanding count.
+    struct queued_response *qr = zalloc(1, sizeof(*qr));
+
+    if (error) {
+        ww_log(LOG_WARN, "HTTP request failed: %s", error);
+        qr->data = strdup(error);
+        check_alloc(qr->data);
+        qr->size = strlen(error);
+    } else if (req->body.data) {
+        qr->data = req->body.data;
+        qr->size = req->body.size;
+        req->body.data = NULL;
+    } else {
+        qr->data = strdup("");
+        check_alloc(qr->data);
+        qr->size = 0;
+    }
 
-    q->responses[q->write_pos] = qr;
-    q->write_pos = (q->write_pos + 1) % MAX_QUEUED;
+    qr->url = req->url;
+    qr->callback = req->callback;
+    req->url = NULL;
+    free_request(req);
 
-    pushed_count++;
+    // The main thread never allows more than MAX_QUEUED - 1 requests to be outstanding, so there is
+    // always room for the response.
+    ww_assert(spsc_queue_push(&client->responses, qr));
 
-    pthread_mutex_unlock(&client->queue_mutex);
+    atomic_fetch_add_explicit(&pushed_count, 1, memory_order_relaxed);
+    signal_fd(client->response_fd);
 }
 
 static void
-request_queue_push(struct Http_client *client, char *url, char **headers) {
-    pthread_mutex_lock(&client->request_mutex);
-
-    if (request_queue_is_full(client)) {
-        ww_log(LOG_WARN, "Request queue full for client %d. Dropping request.", client->index);
-        pthread_mutex_unlock(&client->request_mutex);
+start_request(struct Http_client *client, struct pending_request *req) {
+    wl_list_insert(&client->active, &req->link);
+
+    req->cache_key = cache_key(req);
+    req->have_cached = util_cache_http_load(req->cache_key, &req->cached);
+    if (req->have_cached && req->cached.expires > (uint64_t)time(NULL)) {
+        // The cached response is still fresh and can be used without asking the server.
+        req->body.data = req->cached.body;
+        req->body.size = req->cached.body_size;
+        req->cached.body = NULL;
+        finish_request(client, req, NULL);
         return;
     }
 
-    client->pending_requests[client->request_write_pos] = malloc(sizeof(struct pending_request));
-    if (!client->pending_requests[client->request_write_pos]) {
-        ww_log(LOG_ERROR, "malloc failed for pending_request");
-        pthread_mutex_unlock(&client->request_mutex);
+    CURL *curl = client->idle_count > 0 ? client->idle[--client->idle_count] : curl_easy_init();
+    if (!curl) {
+        finish_request(client, req, "failed to initialize curl");
         return;
     }
 
-    client->pending_requests[client->request_write_pos]->url = url;
-    client->pending_requests[client->request_write_pos]->headers = headers;
-    client->request_write_pos = (client->request_write_pos + 1) % MAX_QUEUED;
-
-    // Signal the worker thread that a new request is available
-    pthread_cond_signal(&client->request_cond);
-    pthread_mutex_unlock(&client->request_mutex);
-}
-
-static struct pending_request *
-request_queue_pop(struct Http_client *client) {
-    pthread_mutex_lock(&client->request_mutex);
-
-    while (request_queue_is_empty(client) && !client->should_exit) {
-        pthread_cond_wait(&client->request_cond, &client->request_mutex);
+    if (req->headers) {
+        for (int i = 0; req->headers[i]; i++) {
+            req->header_list = curl_slist_append(req->header_list, req->headers[i]);
+        }
     }
 
-    if (client->should_exit) {
-        pthread_mutex_unlock(&client->request_mutex);
-        return NULL;
+    // Revalidate a stale cache entry instead of downloading it again.
+    if (req->have_cached) {
+        char buf[512];
+        if (req->cached.etag) {
+            snprintf(buf, sizeof(buf), "If-None-Match: %s", req->cached.etag);
+            req->header_list = curl_slist_append(req->header_list, buf);
+        }
+        if (req->cached.last_modified) {
+            snprintf(buf, sizeof(buf), "If-Modified-Since: %s", req->cached.last_modified);
+            req->header_list = curl_slist_append(req->header_list, buf);
+        }
     }
 
-    struct pending_request *ret = client->pending_requests[client->request_read_pos];
-    client->pending_requests[client->request_read_pos] = NULL;
-    client->request_read_pos = (client->request_read_pos + 1) % MAX_QUEUED;
+    if (req->header_list)
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, req->header_list);
+
+    // configure curl
+    curl_easy_setopt(curl, CURLOPT_URL, req->url);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &req->body);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, header_callback);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, req);
+    curl_easy_setopt(curl, CURLOPT_PRIVATE, req);
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L);
+    curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+
+    // Prefer multiplexing many requests over one HTTP/2 connection to opening a new connection for
+    // each of them.
+    curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);
+    curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+
+    CURLMcode mc = curl_multi_add_handle(client->multi, curl);
+    if (mc != CURLM_OK) {
+        curl_easy_cleanup(curl);
+        finish_request(client, req, curl_multi_strerror(mc));
+        return;
+    }
 
-    pthread_mutex_unlock(&client->request_mutex);
-    return ret;
+    req->curl = curl;
+    client->in_flight++;
 }
 
 static void
-response_queue_cleanup(struct response_queue *q) {
-    if (!q)
-        return;
-    for (int i = 0; i < MAX_QUEUED; i++) {
-        if (q->responses[i]) {
-            free(q->responses[i]->data);
-            free(q->responses[i]->url);
-            free(q->responses[i]);
-            q->responses[i] = NULL;
+update_cache(struct pending_request *req) {
+    long status = 0;
+    curl_easy_getinfo(req->curl, CURLINFO_RESPONSE_CODE, &status);
+
+    if (status == 304 && req->have_cached) {
+        // The cached response is still valid. Keep any validators the server did not resend.
+        free(req->body.data);
+        req->body.data = req->cached.body;
+        req->body.size = req->cached.body_size;
+        req->cached.body = NULL;
+
+        if (!req->etag) {
+            req->etag = req->cached.etag;
+            req->cached.etag = NULL;
+        }
+        if (!req->last_modified) {
+            req->last_modified = req->cached.last_modified;
+            req->cached.last_modified = NULL;
         }
+    } else if (status != 200) {
+        return;
+    }
+
+    if (req->no_store || (!req->etag && !req->last_modified && req->max_age <= 0)) {
+        return;
     }
-    q->write_pos = 0;
-    q->read_pos = 0;
+
+    struct util_cache_http entry = {
+        .etag = req->etag,
+        .last_modified = req->last_modified,
+        .expires = req->max_age > 0 ? (uint64_t)time(NULL) + (uint64_t)req->max_age : 0,
+        .body = req->body.data,
+        .body_size = req->body.size,
+    };
+    util_cache_http_store(req->cache_key, &entry);
 }
 
 static void
-request_queue_cleanup(struct Http_client *client) {
-    if (!client)
-        return;
-    for (int i = 0; i < MAX_QUEUED; i++) {
-        free(client->pending_requests[i]);
-        client->pending_requests[i] = NULL;
+process_completed(struct Http_client *client) {
+    CURLMsg *msg;
+    int remaining;
+    while ((msg = curl_multi_info_read(client->multi, &remaining))) {
+        if (msg->msg != CURLMSG_DONE) {
+            continue;
+        }
+
+        // msg is invalidated once the handle is removed from the multi handle.
+        CURLcode res = msg->data.result;
+        struct pending_request *req = NULL;
+        curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &req);
+
+        if (res == CURLE_OK) {
+            update_cache(req);
+        }
+        finish_request(client, req, res == CURLE_OK ? NULL : curl_easy_strerror(res));
     }
-    client->request_write_pos = 0;
-    client->request_read_pos = 0;
 }
 
 static void *
 http_thread(void *arg) {
     struct Http_client *client = arg;
-    if (!client || !client->curl) {
+    if (!client || !client->multi) {
         ww_log(LOG_ERROR, "Invalid client in HTTP thread");
         return NULL;
     }
 
-    while (!client->should_exit) {
+    while (!atomic_load(&client->should_exit)) {
+        struct pending_request *req;
+        while ((req = spsc_queue_pop(&client->requests))) {
+            pending_insert(client, req);
+        }
 
-        struct pending_request *req = request_queue_pop(client);
+        while (client->in_flight < MAX_IN_FLIGHT && !wl_list_empty(&client->pending)) {
+            req = wl_container_of(client->pending.next, req, link);
+            wl_list_remove(&req->link);
+            start_request(client, req);
+        }
 
-        if (!req)
+        int running;
+        CURLMcode mc = curl_multi_perform(client->multi, &running);
+        if (mc != CURLM_OK) {
+            ww_log(LOG_ERROR, "curl_multi_perform failed: %s", curl_multi_strerror(mc));
             break;
+        }
 
-        struct response_buffer response = {0};
-
-        struct curl_slist *headers = NULL;
-
-        if (req->headers) {
-            for (int i = 0; req->headers[i]; i++) {
-                headers = curl_slist_append(headers, req->headers[i]);
-            }
+        process_completed(client);
 
-            if (headers)
-                curl_easy_setopt(client->curl, CURLOPT_HTTPHEADER, headers);
+        // Start any queued requests which now have a free transfer slot before going to sleep.
+        if (client->in_flight < MAX_IN_FLIGHT && !wl_list_empty(&client->pending)) {
+            continue;
         }
 
-        // configure curl
-        curl_easy_setopt(client->curl, CURLOPT_URL, req->url);
-        curl_easy_setopt(client->curl, CURLOPT_WRITEFUNCTION, write_callback);
-        curl_easy_setopt(client->curl, CURLOPT_WRITEDATA, &response);
-        curl_easy_setopt(client->curl, CURLOPT_FOLLOWLOCATION, 1L);
-        curl_easy_setopt(client->curl, CURLOPT_TIMEOUT, 30L);
-
-        // make request
-        CURLcode res = curl_easy_perform(client->curl);
-
-        if (res != CURLE_OK) {
-            const char *error_msg = curl_easy_strerror(res);
-            response_queue_push(client, error_msg, strlen(error_msg), req->url);
-            ww_log(LOG_WARN, "HTTP request failed: %s", error_msg);
-        } else if (response.data && response.size > 0) {
-            response_queue_push(client, response.data, response.size, req->url);
-        } else {
-            const char *empty = "";
-            response_queue_push(client, empty, 0, req->url);
+        struct curl_waitfd wake = {
+            .fd = client->request_fd,
+            .events = CURL_WAIT_POLLIN,
+        };
+        mc = curl_multi_poll(client->multi, &wake, 1, 1000, NULL);
+        if (mc != CURLM_OK) {
+            ww_log(LOG_ERROR, "curl_multi_poll failed: %s", curl_multi_strerror(mc));
+            break;
         }
 
-        if (response.data) {
-            free(response.data);
-            response.data = NULL;
-        }
-        if (req->headers) {
-            for (int i = 0; req->headers[i]; i++) {
-                free(req->headers[i]);
-            }
-            free(req->headers);
-            curl_slist_free_all(headers);
+        if (wake.revents) {
+            drain_fd(client->request_fd);
         }
-        free(req->url);
     }
 
     return NULL;
 }
 
+// ==== Main thread ====
+
+static void
+release_request(struct Http_client *client, struct pending_request *req) {
+    if (req->curl) {
+        curl_multi_remove_handle(client->multi, req->curl);
+        curl_easy_cleanup(req->curl);
+    }
+    if (req->callback != LUA_NOREF) {
+        luaL_unref(client->vm->L, LUA_REGISTRYINDEX, req->callback);
+    }
+    free_request(req);
+}
+
+static void
+release_response(struct Http_client *client, struct queued_response *qr) {
+    if (qr->callback != LUA_NOREF) {
+        luaL_unref(client->vm->L, LUA_REGISTRYINDEX, qr->callback);
+    }
+    free_response(qr);
+}
+
+// Must only be called once the worker thread has exited (or was never started).
+static void
+requests_cleanup(struct Http_client *client) {
+    struct pending_request *req, *tmp;
+    while ((req = spsc_queue_pop(&client->requests))) {
+        release_request(client, req);
+    }
+    wl_list_for_each_safe (req, tmp, &client->pending, link) {
+        wl_list_remove(&req->link);
+        release_request(client, req);
+    }
+    wl_list_for_each_safe (req, tmp, &client->active, link) {
+        wl_list_remove(&req->link);
+        release_request(client, req);
+    }
+
+    struct queued_response *qr;
+    while ((qr = spsc_queue_pop(&client->responses))) {
+        release_response(client, qr);
+    }
+
+    for (int i = 0; i < client->idle_count; i++) {
+        curl_easy_cleanup(client->idle[i]);
+    }
+    client->idle_count = 0;
+
+    spsc_queue_finish(&client->requests);
+    spsc_queue_finish(&client->responses);
+}
+
+static int
+handle_response_fd(int32_t fd, uint32_t mask, void *data) {
+    struct Http_client *client = data;
+
+    drain_fd(fd);
+
+    struct queued_response *qr;
+    while ((qr = spsc_queue_pop(&client->responses))) {
+        client->outstanding--;
+
+        int callback = qr->callback != LUA_NOREF ? qr->callback : client->callback;
+        lua_rawgeti(client->vm->L, LUA_REGISTRYINDEX, callback);
+        lua_pushlstring(client->vm->L, qr->data, qr->size);
+        lua_pushstring(client->vm->L, qr->url);
+
+        bool consumed = config_vm_try_callback_args2(client->vm);
+
+        if (!consumed) {
+            ww_log(LOG_WARN, "HTTP callback did not consume response");
+        }
+
+        release_response(client, qr);
+        atomic_fetch_add_explicit(&popped_count, 1, memory_order_relaxed);
+    }
+
+    return 0;
+}
+
 struct Http_client *
-http_client_create(int callback, lua_State *L) {
+http_client_create(struct wl_event_loop *loop, int callback, lua_State *L) {
     if (!L) {
         ww_log(LOG_ERROR, "Invalid parameters for HTTP client creation");
         return NULL;
@@ -299,68 +538,136 @@ http_client_create(int callback, lua_State *L) {
         return NULL;
     }
 
-    CURL *curl = curl_easy_init();
-    if (!curl) {
+    CURLM *multi = curl_multi_init();
+    if (!multi) {
         ww_log(LOG_ERROR, "Failed to initialize curl");
         pthread_mutex_unlock(&clients_mutex);
         return NULL;
     }
 
+    curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, (long)MAX_HOST_CONNECTIONS);
+    curl_multi_setopt(multi, CURLMOPT_MAXCONNECTS, (long)MAX_IN_FLIGHT);
+
     struct Http_client *client = calloc(1, sizeof(struct Http_client));
     if (!client) {
-        curl_easy_cleanup(curl);
+        curl_multi_cleanup(multi);
         pthread_mutex_unlock(&clients_mutex);
         return NULL;
     }
 
-    client->curl = curl;
+    client->multi = multi;
     client->callback = callback;
     client->index = slot;
     client->thread_running = false;
-    client->should_exit = false;
-    response_queue_init(&client->response_queue);
-    request_queue_init(client);
-    pthread_mutex_init(&client->queue_mutex, NULL);
-    pthread_mutex_init(&client->request_mutex, NULL);
-    pthread_cond_init(&client->request_cond, NULL);
+    atomic_init(&client->should_exit, false);
+    spsc_queue_init(&client->requests, MAX_QUEUED);
+    spsc_queue_init(&client->responses, MAX_QUEUED);
+    wl_list_init(&client->pending);
+    wl_list_init(&client->active);
     client->vm = config_vm_from(L);
 
-    all_clients[slot] = client;
-    client_count++;
+    client->request_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (client->request_fd == -1) {
+        ww_log_errno(LOG_ERROR, "failed to create request eventfd");
+        goto fail_request_fd;
+    }
+
+    client->response_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (client->response_fd == -1) {
+        ww_log_errno(LOG_ERROR, "failed to create response eventfd");
+        goto fail_response_fd;
+    }
+
+    client->src_response = wl_event_loop_add_fd(loop, client->response_fd, WL_EVENT_READABLE,
+                                                handle_response_fd, client);
+    if (!client->src_response) {
+        ww_log(LOG_ERROR, "failed to add response eventfd to event loop");
+        goto fail_source;
+    }
 
     if (pthread_create(&client->thread_id, NULL, http_thread, client) != 0) {
         ww_log(LOG_ERROR, "Failed to create HTTP thread");
-        all_clients[slot] = NULL;
-        client_count--;
-        response_queue_cleanup(&client->response_queue);
-        request_queue_cleanup(client);
-        curl_easy_cleanup(curl);
-        pthread_mutex_destroy(&client->queue_mutex);
-        pthread_mutex_destroy(&client->request_mutex);
-        pthread_cond_destroy(&client->request_cond);
-        free(client);
-        pthread_mutex_unlock(&clients_mutex);
-        return NULL;
+        goto fail_thread;
     }
 
+    all_clients[slot] = client;
+    client_count++;
+
     client->thread_running = true;
     pthread_mutex_unlock(&clients_mutex);
     return client;
+
+fail_thread:
+    wl_event_source_remove(client->src_response);
+
+fail_source:
+    close(client->response_fd);
+
+fail_response_fd:
+    close(client->request_fd);
+
+fail_request_fd:
+    requests_cleanup(client);
+    curl_multi_cleanup(multi);
+    free(client);
+    pthread_mutex_unlock(&clients_mutex);
+    return NULL;
 }
 
 void
-http_client_get(struct Http_client *client, char *url, char **headers) {
-    if (!client || !client->curl || !url) {
+http_client_request(struct Http_client *client, char *url, char **headers, int priority,
+                    int callback) {
+    if (!client || !client->multi || !url) {
         ww_log(LOG_WARN, "Invalid parameters for HTTP GET");
-        return;
+        goto fail;
     }
 
     if (!client->thread_running) {
         ww_log(LOG_WARN, "Cannot send request to stopped HTTP client");
-        return;
+        goto fail;
     }
 
-    request_queue_push(client, url, headers);
+    if (client->outstanding >= MAX_QUEUED - 1) {
+        ww_log(LOG_WARN, "Request queue full for client %d. Dropping request.", client->index);
+        goto fail;
+    }
+
+    struct pending_request *req = calloc(1, sizeof(*req));
+    if (!req) {
+        ww_log(LOG_ERROR, "calloc failed for pending_request");
+        goto fail;
+    }
+
+    req->url = url;
+    req->headers = headers;
+    req->priority = priority;
+    req->callback = callback;
+
+    // This cannot fail, since the number of outstanding requests is bounded above.
+    ww_assert(spsc_queue_push(&client->requests, req));
+    client->outstanding++;
+
+    // Wake the worker thread if it is waiting on its transfers.
+    signal_fd(client->request_fd);
+    return;
+
+fail:
+    if (headers) {
+        for (int i = 0; headers[i]; i++) {
+            free(headers[i]);
+        }
+        free(headers);
+    }
+    free(url);
+    if (client && callback != LUA_NOREF) {
+        luaL_unref(client->vm->L, LUA_REGISTRYINDEX, callback);
+    }
+}
+
+void
+http_client_get(struct Http_client *client, char *url, char **headers) {
+    http_client_request(client, url, headers, 0, LUA_NOREF);
 }
 
 void
@@ -370,28 +677,24 @@ http_client_destroy(struct Http_client *client) {
         return;
 
     if (client->thread_running) {
-        // Signal the thread to exit
-        pthread_mutex_lock(&client->request_mutex);
-        client->should_exit = true;
-        pthread_cond_signal(&client->request_cond);
-        pthread_mutex_unlock(&client->request_mutex);
+        // Signal the thread to exit and wait for it to finish
+        atomic_store(&client->should_exit, true);
+        signal_fd(client->request_fd);
 
-        // Wait for thread to finish
         pthread_join(client->thread_id, NULL);
         client->thread_running = false;
     }
 
-    if (client->curl) {
-        curl_easy_cleanup(client->curl);
-        client->curl = NULL;
-    }
+    wl_event_source_remove(client->src_response);
+    close(client->response_fd);
+    close(client->request_fd);
 
-    response_queue_cleanup(&client->response_queue);
-    request_queue_cleanup(client);
+    requests_cleanup(client);
 
-    pthread_mutex_destroy(&client->queue_mutex);
-    pthread_mutex_destroy(&client->request_mutex);
-    pthread_cond_destroy(&client->request_cond);
+    if (client->multi) {
+        curl_multi_cleanup(client->multi);
+        client->multi = NULL;
+    }
 
     luaL_unref(client->vm->L, LUA_REGISTRYINDEX, client->callback);
 
@@ -404,46 +707,3 @@ http_client_destroy(struct Http_client *client) {
 
     free(client);
 }
-
-void
-manage_new_responses() {
-    struct Http_client *clients_snapshot[MAX_CLIENTS];
-    int count = 0;
-
-    pthread_mutex_lock(&clients_mutex);
-    for (int i = 0; i < MAX_CLIENTS; i++) {
-        if (all_clients[i]) {
-            clients_snapshot[count++] = all_clients[i];
-        }
-    }
-    pthread_mutex_unlock(&clients_mutex);
-
-    for (int i = 0; i < count; i++) {
-        struct Http_client *client = clients_snapshot[i];
-        pthread_mutex_lock(&client->queue_mutex);
-        struct response_queue *q = &client->response_queue;
-
-        while (!response_queue_is_empty(q)) {
-            struct queued_response *qr = q->responses[q->read_pos];
-            q->responses[q->read_pos] = NULL;
-            q->read_pos = (q->read_pos + 1) % MAX_QUEUED;
-
-            lua_rawgeti(client->vm->L, LUA_REGISTRYINDEX, client->callback);
-            lua_pushlstring(client->vm->L, qr->data, qr->size);
-            lua_pushstring(client->vm->L, qr->url);
-
-            bool consumed = config_vm_try_callback_args2(client->vm);
-
-            if (!consumed) {
-                ww_log(LOG_WARN, "HTTP callback did not consume response");
-            }
-
-            free(qr->data);
-            free(qr->url);
-            free(qr);
-            popped_count++;
-        }
-
-        pthread_mutex_unlock(&client->queue_mutex);
-    }
-}
@@ -1,13 +1,18 @@
 #include "irc.h"
 #include "util/log.h"
 #include <config/vm.h>
+#include <errno.h>
 #include <libircclient/libircclient.h>
 #include <lua.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 
 static struct Irc_client *all_clients[MAX_CLIENTS] = {0};
 static int client_count = 0;
@@ -18,81 +23,73 @@ static pthread_mutex_t clients_mutex =
 static irc_callbacks_t callbacks = {0};
 static bool callbacks_initialized = false;
 
-static int pushed_count = 0;
-static int popped_count = 0;
-
-static bool
-queue_is_full(struct message_queue *q) {
-    return ((q->write_pos + 1) % MAX_QUEUED_MESSAGES) == q->read_pos;
-}
-
-static bool
-queue_is_empty(struct message_queue *q) {
-    return q->write_pos == q->read_pos;
-}
-
-static void
-queue_init(struct message_queue *q) {
-    if (!q)
-        return;
-    for (int i = 0; i < MAX_QUEUED_MESSAGES; i++) {
-        free(q->messages[i]);
-        q->messages[i] = NULL;
-    }
-    q->write_pos = 0;
-    q->read_pos = 0;
-}
+static atomic_int pushed_count = 0;
+static atomic_int popped_count = 0;
 
 static void
 queue_push(struct Irc_client *client, const char *message) {
-    pthread_mutex_lock(&client->queue_mutex);
-    struct message_queue *q = &client->message_queue;
-
-    if (queue_is_full(q)) {
-        ww_log(LOG_WARN, "Message queue full for client %d. Dropping message.", client->index);
-        pthread_mutex_unlock(&client->queue_mutex);
-        return;
-    }
-
     char *copy = strdup(message);
     if (!copy) {
         ww_log(LOG_ERROR, "strdup failed");
-        pthread_mutex_unlock(&client->queue_mutex);
         return;
     }
 
-    q->messages[q->write_pos] = copy;
-    q->write_pos = (q->write_pos + 1) % MAX_QUEUED_MESSAGES;
+    if (!spsc_queue_push(&client->messages, copy)) {
+        ww_log(LOG_WARN, "Message queue full for client %d. Dropping message.", client->index);
+        free(copy);
+        return;
+    }
 
-    pushed_count++;
+    atomic_fetch_add_explicit(&pushed_count, 1, memory_order_relaxed);
 
-    pthread_mutex_unlock(&client->queue_mutex);
+    uint64_t one = 1;
+    if (write(client->message_fd, &one, sizeof(one)) != sizeof(one)) {
+        ww_log_errno(LOG_ERROR, "failed to write to message eventfd");
+    }
 }
 
 static void
-queue_cleanup(struct message_queue *q) {
-    if (!q)
-        return;
-    for (int i = 0; i < MAX_QUEUED_MESSAGES; i++) {
-        free(q->messages[i]);
-        q->messages[i] = NULL;
+queue_cleanup(struct Irc_client *client) {
+    char *msg;
+    while ((msg = spsc_queue_pop(&client->messages))) {
+        free(msg);
     }
-    q->write_pos = 0;
-    q->read_pos = 0;
+    spsc_queue_finish(&client->messages);
 }
 
-static struct Irc_client *
-find_client_by_session(irc_session_t *session) {
-    pthread_mutex_lock(&clients_mutex);
-    for (int i = 0; i < MAX_CLIENTS; i++) {
-        if (all_clients[i] && all_clients[i]->session == session) {
-            struct Irc_client *client = all_clients[i];
-            pthread_mutex_unlock(&clients_mutex);
-            return client;
+static int
+handle_message_fd(int32_t fd, uint32_t mask, void *data) {
+    struct Irc_client *client = data;
+
+    uint64_t count;
+    if (read(fd, &count, sizeof(count)) == -1 && errno != EAGAIN) {
+        ww_log_errno(LOG_ERROR, "failed to read from message eventfd");
+    }
+
+    char *msg;
+    while ((msg = spsc_queue_pop(&client->messages))) {
+        // push callback function and argument onto vm->L stack
+        lua_rawgeti(client->vm->L, LUA_REGISTRYINDEX, client->callback);
+        lua_pushstring(client->vm->L, msg);
+
+        bool consumed = config_vm_try_callback_arg(client->vm);
+
+        if (!consumed) {
+            ww_log(LOG_WARN, "IRC callback did not consume message");
         }
+
+        free(msg);
+        atomic_fetch_add_explicit(&popped_count, 1, memory_order_relaxed);
     }
-    pthread_mutex_unlock(&clients_mutex);
-    return NULL;
+
+    return 0;
+}
+
+static struct Irc_client *
+find_client_by_session(irc_session_t *session) {
+    // The context is set before the session connects, so it is always valid by the time any event
+    // callback runs on the IRC thread.
+    return irc_get_ctx(session);
 }
 
 static void
@@ -168,8 +165,8 @@ irc_thread(void *arg) {
 }
 
 struct Irc_client *
-irc_client_create(const char *ip, long port, const char *nick, const char *pass, int callback,
-                  lua_State *L) {
+irc_client_create(struct wl_event_loop *loop, const char *ip, long port, const char *nick,
+                  const char *pass, int callback, lua_State *L) {
     if (!ip || !nick || !L) {
         ww_log(LOG_ERROR, "Invalid parameters for IRC client creation");
         return NULL;
@@ -179,6 +176,7 @@ irc_client_create(const char *ip, long port, const char *nick, const char *pass,
 
     if (client_count >= MAX_CLIENTS) {
         ww_log(LOG_ERROR, "Too many IRC clients (max %d)", MAX_CLIENTS);
+        pthread_mutex_unlock(&clients_mutex);
         return NULL;
     }
 
@@ -225,42 +223,54 @@ irc_client_create(const char *ip, long port, const char *nick, const char *pass,
     client->callback = callback;
     client->index = slot;
     client->thread_running = false;
-    queue_init(&client->message_queue);
-    pthread_mutex_init(&client->queue_mutex, NULL);
+    spsc_queue_init(&client->messages, MAX_QUEUED_MESSAGES);
     client->vm = config_vm_from(L);
+    irc_set_ctx(session, client);
 
-    all_clients[slot] = client;
-    client_count++;
+    client->message_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (client->message_fd == -1) {
+        ww_log_errno(LOG_ERROR, "failed to create message eventfd");
+        goto fail_message_fd;
+    }
+
+    client->src_message = wl_event_loop_add_fd(loop, client->message_fd, WL_EVENT_READABLE,
+                                               handle_message_fd, client);
+    if (!client->src_message) {
+        ww_log(LOG_ERROR, "failed to add message eventfd to event loop");
+        goto fail_source;
+    }
 
     if (irc_connect(session, ip, port, pass, nick, nick, nick) != 0) {
         ww_log(LOG_ERROR, "IRC connection failed: %s", irc_strerror(irc_errno(session)));
-        all_clients[slot] = NULL;
-        client_count--;
-        queue_cleanup(&client->message_queue);
-        irc_destroy_session(session);
-        pthread_mutex_destroy(&client->queue_mutex);
-        free(client);
-        pthread_mutex_unlock(&clients_mutex);
-        return NULL;
+        goto fail_connect;
     }
 
     if (pthread_create(&client->thread_id, NULL, irc_thread, client) != 0) {
         ww_log(LOG_ERROR, "Failed to create IRC thread");
         irc_disconnect(session);
-        all_clients[slot] = NULL;
-        client_count--;
-        queue_cleanup(&client->message_queue);
-        irc_destroy_session(session);
-        pthread_mutex_destroy(&client->queue_mutex);
-        free(client);
-        pthread_mutex_unlock(&clients_mutex);
-        return NULL;
+        goto fail_connect;
     }
 
+    all_clients[slot] = client;
+    client_count++;
+
     client->thread_running = true;
     ww_log(LOG_INFO, "IRC client created successfully (slot %d)", slot);
     pthread_mutex_unlock(&clients_mutex);
     return client;
+
+fail_connect:
+    wl_event_source_remove(client->src_message);
+
+fail_source:
+    close(client->message_fd);
+
+fail_message_fd:
+    queue_cleanup(client);
+    irc_destroy_session(session);
+    free(client);
+    pthread_mutex_unlock(&clients_mutex);
+    return NULL;
 }
 
 void
@@ -300,9 +310,10 @@ irc_client_destroy(struct Irc_client *client) {
         client->session = NULL;
     }
 
-    queue_cleanup(&client->message_queue);
+    wl_event_source_remove(client->src_message);
+    close(client->message_fd);
 
-    pthread_mutex_destroy(&client->queue_mutex);
+    queue_cleanup(client);
 
     luaL_unref(client->vm->L, LUA_REGISTRYINDEX, client->callback);
 
@@ -315,49 +326,7 @@ irc_client_destroy(struct Irc_client *client) {
 
     free(client);
     ww_log(LOG_INFO, "IRC client destroyed");
-    ww_log(LOG_INFO, "%d pushed, %d popped.", pushed_count, popped_count);
+    ww_log(LOG_INFO, "%d pushed, %d popped.", atomic_load(&pushed_count),
+           atomic_load(&popped_count));
 }
 
-void
-manage_new_messages() {
-    struct Irc_client *clients_snapshot[MAX_CLIENTS];
-    int count = 0;
-
-    pthread_mutex_lock(&clients_mutex);
-    for (int i = 0; i < MAX_CLIENTS; i++) {
-        if (all_clients[i]) {
-            clients_snapshot[count++] = all_clients[i];
-        }
-    }
-    pthread_mutex_unlock(&clients_mutex);
-
-    for (int i = 0; i < count; i++) {
-        struct Irc_client *client = clients_snapshot[i];
-        pthread_mutex_lock(&client->queue_mutex);
-        struct message_queue *q = &client->message_queue;
-
-        while (!queue_is_empty(q)) {
-            char *msg = q->messages[q->read_pos];
-            q->messages[q->read_pos] = NULL;
-            q->read_pos = (q->read_pos + 1) % MAX_QUEUED_MESSAGES;
-
-            pthread_mutex_unlock(&client->queue_mutex);
-
-            // push callback function and argument onto vm->L stack
-            lua_rawgeti(client->vm->L, LUA_REGISTRYINDEX, client->callback);
-            lua_pushstring(client->vm->L, msg);
-
-            bool consumed = config_vm_try_callback_arg(client->vm);
-
-            if (!consumed) {
-                ww_log(LOG_WARN, "IRC callback did not consume message");
-            }
-
-            free(msg);
-            popped_count++;
-            pthread_mutex_lock(&client->queue_mutex);
-        }
-
-        pthread_mutex_unlock(&client->queue_mutex);
-    }
-}
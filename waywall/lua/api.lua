@@ -81,12 +81,33 @@ M.exec = priv.exec
 -- @return shown Whether floating windows are shown.
 M.floating_shown = priv.floating_shown
 
+--- Returns timing information for recently presented frames (Vulkan only).
+-- Each entry contains `seq`, `cpu_record`, `cpu_submit` and `cpu_present`, plus
+-- `commit_to_submit` and `commit_to_present` when the frame was triggered by a
+-- game commit, and `gpu_acquire`, `gpu_capture`, `gpu_overlays`, `gpu_release`
+-- and `gpu_total` when GPU timestamps are available. Frames which sampled a
+-- capture copy also contain `copy_pending` (whether the copy was still running
+-- when the frame was presented), `commit_to_copy` and, if the transfer queue
+-- has timestamps, `gpu_copy`. All durations are in milliseconds.
+-- @param count The maximum number of frames to return (optional, default 256).
+-- @return stats A list of per-frame tables, oldest first.
+M.frame_stats = priv.frame_stats
+
 --- Creates an image object which displays a PNG image from the filesystem.
 -- @param path The filepath to the image.
 -- @param options The options to create the image with.
 -- @return image The image object.
 M.image = priv.image
 
+--- Returns device memory usage for images, atlases and text (Vulkan only).
+-- Small resources share large memory blocks. The returned table contains
+-- `block_count`, `block_bytes`, `used_bytes` and `allocation_count` for the
+-- shared blocks, `free_ranges` and `largest_free` (in bytes) to show how
+-- fragmented they are, and `dedicated_count` and `dedicated_bytes` for
+-- resources too large to share a block.
+-- @return stats The memory statistics.
+M.memory_stats = priv.memory_stats
+
 --- Creates a "mirror" object which mirrors part of the Minecraft window.
 -- @param options The options to create the mirror with.
 -- @return mirror The mirror object.
@@ -161,6 +182,9 @@ M.irc_client_create = priv.irc_client_create
 
 --- Creates a http client
 -- @param callback The function that will be called when the message is recieved.
+-- @return http-client The http client object. Use get(url, ...headers) for a single request, or
+-- get_many(requests) to submit a batch of requests which are fetched concurrently. Each entry in
+-- requests is a URL or a table of the form { url, headers, priority, callback }.
 M.http_client_create = priv.http_client_create
 
 --- Creates a atlas which can be used to store images
@@ -183,4 +207,15 @@ M.animated_image = priv.animated_image
 -- @param size The font size to use
 M.text_advance = priv.text_advance
 
+--- Splits text into lines no wider than a given width, for word wrapping.
+-- Lines break at spaces where possible, and words wider than a whole line are
+-- split. Each line is a table with `first` and `last` (byte indices for use
+-- with `string.sub`) and `width` (in pixels). Results are cached, so laying
+-- out the same text again is cheap.
+-- @param text The text to lay out
+-- @param size The font size to use
+-- @param max_width The maximum width of a line in pixels, or 0 to only break at newlines
+-- @return lines The list of lines
+M.text_layout = priv.text_layout
+
 package.loaded["waywall"] = M
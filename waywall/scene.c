@@ -193,13 +193,13 @@ void
 scene_object_set_depth(struct scene_object *object, int32_t depth) {
     switch (object->type) {
         case SCENE_OBJECT_IMAGE:
-            ((struct vk_image *)object->vk_obj)->depth = depth;
+            server_vk_image_set_depth((struct vk_image *)object->vk_obj, depth);
             break;
         case SCENE_OBJECT_MIRROR:
-            ((struct vk_mirror *)object->vk_obj)->depth = depth;
+            server_vk_mirror_set_depth((struct vk_mirror *)object->vk_obj, depth);
             break;
         case SCENE_OBJECT_TEXT:
-            ((struct vk_text *)object->vk_obj)->depth = depth;
+            server_vk_text_set_depth((struct vk_text *)object->vk_obj, depth);
             break;
     }
 }
@@ -4,6 +4,7 @@
 #include "linux-dmabuf-v1-client-protocol.h"
 #include "linux-drm-syncobj-v1-client-protocol.h"
 #include "pointer-constraints-unstable-v1-client-protocol.h"
+#include "presentation-time-client-protocol.h"
 #include "relative-pointer-unstable-v1-client-protocol.h"
 #include "single-pixel-buffer-v1-client-protocol.h"
 #include "tearing-control-v1-client-protocol.h"
@@ -26,6 +27,7 @@
 #define USE_LINUX_DMABUF_VERSION 4
 #define USE_LINUX_DRM_SYNCOBJ_VERSION 1
 #define USE_POINTER_CONSTRAINTS_VERSION 1
+#define USE_PRESENTATION_VERSION 1
 #define USE_RELATIVE_POINTER_MANAGER_VERSION 1
 #define USE_SEAT_VERSION 5
 #define USE_SHM_VERSION 1
@@ -150,6 +152,17 @@ static const struct wl_shm_listener shm_listener = {
     .format = on_shm_format,
 };
 
+static void
+on_presentation_clock_id(void *data, struct wp_presentation *wl, uint32_t clk_id) {
+    struct server_backend *backend = data;
+
+    backend->presentation_clock = clk_id;
+}
+
+static const struct wp_presentation_listener presentation_listener = {
+    .clock_id = on_presentation_clock_id,
+};
+
 static void
 on_xdg_wm_base_ping(void *data, struct xdg_wm_base *xdg_wm_base, uint32_t serial) {
     xdg_wm_base_pong(xdg_wm_base, serial);
@@ -253,6 +266,18 @@ on_registry_global(void *data, struct wl_registry *wl, uint32_t name, const char
             wl_registry_bind(wl, name, &zwp_relative_pointer_manager_v1_interface,
                              USE_RELATIVE_POINTER_MANAGER_VERSION);
         check_alloc(backend->relative_pointer_manager);
+    } else if (strcmp(iface, wp_presentation_interface.name) == 0) {
+        if (version < USE_PRESENTATION_VERSION) {
+            ww_log(LOG_WARN, "host compositor provides outdated wp_presentation (%d < %d)", version,
+                   USE_PRESENTATION_VERSION);
+            return;
+        }
+
+        backend->presentation =
+            wl_registry_bind(wl, name, &wp_presentation_interface, USE_PRESENTATION_VERSION);
+        check_alloc(backend->presentation);
+
+        wp_presentation_add_listener(backend->presentation, &presentation_listener, backend);
     } else if (strcmp(iface, wl_seat_interface.name) == 0) {
         if (version < USE_SEAT_VERSION) {
             ww_log(LOG_ERROR, "host compositor provides outdated wl_seat (%d < %d)", version,
@@ -455,6 +480,9 @@ server_backend_create() {
     if (!backend->linux_drm_syncobj_manager) {
         ww_log(LOG_INFO, "host compositor does not provide wp_linux_drm_syncobj_manager");
     }
+    if (!backend->presentation) {
+        ww_log(LOG_INFO, "host compositor does not provide wp_presentation");
+    }
     if (!backend->single_pixel_buffer_manager) {
         ww_log(LOG_INFO, "host compositor does not provide wp_single_pixel_buffer_manager");
     }
@@ -552,6 +580,9 @@ server_backend_destroy(struct server_backend *backend) {
     if (backend->linux_drm_syncobj_manager) {
         wp_linux_drm_syncobj_manager_v1_destroy(backend->linux_drm_syncobj_manager);
     }
+    if (backend->presentation) {
+        wp_presentation_destroy(backend->presentation);
+    }
     if (backend->single_pixel_buffer_manager) {
         wp_single_pixel_buffer_manager_v1_destroy(backend->single_pixel_buffer_manager);
     }
@@ -1,8 +1,6 @@
 #include "server/server.h"
 
 #include "config/config.h"
-#include "http.h"
-#include "irc.h"
 #include "server/backend.h"
 #include "server/cursor.h"
 #include "server/ui.h"
@@ -148,12 +146,6 @@ backend_display_tick(int fd, uint32_t mask, void *data) {
         return 0;
     }
 
-    // irc client poll
-    manage_new_messages();
-
-    // http client poll
-    manage_new_responses();
-
     return num_dispatched > 0;
 }
 
@@ -2,6 +2,7 @@
 
 #include "server/vk.h"
 #include "config/config.h"
+#include "decode.h"
 #include "server/backend.h"
 #include "server/buffer.h"
 #include "server/server.h"
@@ -9,23 +10,31 @@
 #include "server/wl_compositor.h"
 #include "server/wp_linux_drm_syncobj.h"
 #include "server/wp_linux_dmabuf.h"
+#include "presentation-time-client-protocol.h"
 #include "util/alloc.h"
 #include "util/avif.h"
+#include "util/cache.h"
 #include "util/log.h"
 #include "util/png.h"
 #include "util/prelude.h"
 
 #include <ft2build.h>
 #include FT_FREETYPE_H
+#include FT_ADVANCES_H
+#include FT_MODULE_H
 
 #include <errno.h>
 #include <fcntl.h>
 #include <inttypes.h>
 #include <math.h>
+#include <pthread.h>
 #include <stddef.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/eventfd.h>
 #include <sys/ioctl.h>
+#include <sys/timerfd.h>
 #include <time.h>
 #include <unistd.h>
 
@@ -33,6 +42,7 @@
 #include <vulkan/vulkan_wayland.h>
 
 static PFN_vkImportSemaphoreFdKHR pfn_vkImportSemaphoreFdKHR = NULL;
+static PFN_vkGetSemaphoreFdKHR pfn_vkGetSemaphoreFdKHR = NULL;
 
 #include <wayland-client-protocol.h>
 
@@ -49,6 +59,13 @@ now_ms(void) {
     return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
 }
 
+static uint64_t
+now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
 static int32_t
 refresh_mhz_to_ms(int32_t refresh_mhz) {
     if (refresh_mhz <= 0) {
@@ -64,38 +81,12 @@ refresh_mhz_to_ms(int32_t refresh_mhz) {
 // Forward decls for helpers used before definition
 static void on_ui_refresh(struct wl_listener *listener, void *data);
 static int handle_overlay_tick(void *data);
+static int handle_capture_release(int fd, uint32_t mask, void *data);
 
 // Forward decls for helpers used before definition
 static uint32_t find_memory_type(struct server_vk *vk, uint32_t type_filter, VkMemoryPropertyFlags properties);
 static VkFormat drm_format_to_vk(uint32_t drm_format);
-
-static void
-destroy_double_buffered_optimal(struct server_vk *vk, struct vk_buffer *buf) {
-    for (int i = 0; i < 2; i++) {
-        if (buf->optimal_descriptors[i]) {
-            vkFreeDescriptorSets(vk->device, vk->descriptor_pool, 1, &buf->optimal_descriptors[i]);
-            buf->optimal_descriptors[i] = VK_NULL_HANDLE;
-        }
-        if (buf->optimal_views[i]) {
-            vkDestroyImageView(vk->device, buf->optimal_views[i], NULL);
-            buf->optimal_views[i] = VK_NULL_HANDLE;
-        }
-        if (buf->optimal_images[i]) {
-            vkDestroyImage(vk->device, buf->optimal_images[i], NULL);
-            buf->optimal_images[i] = VK_NULL_HANDLE;
-        }
-        if (buf->optimal_memories[i]) {
-            vkFreeMemory(vk->device, buf->optimal_memories[i], NULL);
-            buf->optimal_memories[i] = VK_NULL_HANDLE;
-        }
-    }
-    if (buf->copy_fence) {
-        vkDestroyFence(vk->device, buf->copy_fence, NULL);
-        buf->copy_fence = VK_NULL_HANDLE;
-    }
-    buf->async_optimal_valid = false;
-    buf->copy_pending = false;
-}
+static void damage_box(struct server_vk *vk, const struct box *box);
 
 static void
 destroy_optimal_copy(struct server_vk *vk, struct vk_buffer *buf) {
@@ -333,548 +324,217 @@ copy_to_optimal(struct server_vk *vk, struct vk_buffer *buf) {
     return submit_res == VK_SUCCESS;
 }
 
-static bool
-create_double_buffered_optimal(struct server_vk *vk, struct vk_buffer *src_buf) {
-    if (!vk->async_pipelining_enabled) {
-        return false;
-    }
+// Picks the frame each animated image shows. Every image runs off the same clock, so emotes with
+// the same timing stay in sync, and only images whose frame changed need to be redrawn.
+static void
+vk_update_animated_images(struct server_vk *vk) {
+    if (!vk || !vk->device) return;
 
-    VkFormat format = src_buf->view ? VK_FORMAT_B8G8R8A8_UNORM : VK_FORMAT_UNDEFINED;
-    if (format == VK_FORMAT_UNDEFINED) {
-        return false;
-    }
+    const uint64_t now = now_ms();
+    struct vk_image *image;
+    wl_list_for_each(image, &vk->images, link) {
+        if (!image->enabled) continue;
+        if (!image->frame_ends_ms) continue;
+        if (now < image->next_frame_ms) continue;
 
-    // Create fence for async copy synchronization
-    VkFenceCreateInfo fence_info = {
-        .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
-        .flags = VK_FENCE_CREATE_SIGNALED_BIT,  // Start signaled
-    };
-    VkResult res = vkCreateFence(vk->device, &fence_info, NULL, &src_buf->copy_fence);
-    if (res != VK_SUCCESS) {
-        return false;
-    }
+        const uint64_t loop_ms = image->frame_ends_ms[image->frame_count - 1];
+        const uint64_t t = now % loop_ms;
 
-    // Create two optimal images for double-buffering
-    for (int i = 0; i < 2; i++) {
-        VkImageCreateInfo img_info = {
-            .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
-            .imageType = VK_IMAGE_TYPE_2D,
-            .format = format,
-            .extent = { (uint32_t)src_buf->width, (uint32_t)src_buf->height, 1 },
-            .mipLevels = 1,
-            .arrayLayers = 1,
-            .samples = VK_SAMPLE_COUNT_1_BIT,
-            .tiling = VK_IMAGE_TILING_OPTIMAL,
-            .usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-            .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
-            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-        };
+        // Find the first frame which ends after t.
+        uint32_t lo = 0, hi = image->frame_count - 1;
+        while (lo < hi) {
+            uint32_t mid = lo + (hi - lo) / 2;
+            if (image->frame_ends_ms[mid] > t) {
+                hi = mid;
+            } else {
+                lo = mid + 1;
+            }
+        }
 
-        res = vkCreateImage(vk->device, &img_info, NULL, &src_buf->optimal_images[i]);
-        if (res != VK_SUCCESS) {
-            destroy_double_buffered_optimal(vk, src_buf);
-            return false;
+        image->next_frame_ms = now - t + image->frame_ends_ms[lo];
+        if (image->frame_index != lo) {
+            image->frame_index = lo;
+            damage_box(vk, &image->dst);
         }
+    }
+}
 
-        VkMemoryRequirements mem_reqs;
-        vkGetImageMemoryRequirements(vk->device, src_buf->optimal_images[i], &mem_reqs);
+// Generated SPIR-V shader bytecode
+#include "shader_spirv.h"
 
-        uint32_t mem_type_index = find_memory_type(vk, mem_reqs.memoryTypeBits,
-                                                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-        if (mem_type_index == UINT32_MAX) {
-            destroy_double_buffered_optimal(vk, src_buf);
-            return false;
-        }
+// Required instance extensions
+static const char *INSTANCE_EXTENSIONS[] = {
+    VK_KHR_SURFACE_EXTENSION_NAME,
+    VK_KHR_WAYLAND_SURFACE_EXTENSION_NAME,
+    VK_KHR_EXTERNAL_MEMORY_CAPABILITIES_EXTENSION_NAME,
+    VK_KHR_EXTERNAL_SEMAPHORE_CAPABILITIES_EXTENSION_NAME,
+};
 
-        VkMemoryAllocateInfo alloc_info = {
-            .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-            .allocationSize = mem_reqs.size,
-            .memoryTypeIndex = mem_type_index,
-        };
+// Required device extensions
+static const char *DEVICE_EXTENSIONS[] = {
+    VK_KHR_SWAPCHAIN_EXTENSION_NAME,
+    VK_KHR_EXTERNAL_MEMORY_EXTENSION_NAME,
+    VK_KHR_EXTERNAL_MEMORY_FD_EXTENSION_NAME,
+    VK_KHR_EXTERNAL_SEMAPHORE_EXTENSION_NAME,
+    VK_KHR_EXTERNAL_SEMAPHORE_FD_EXTENSION_NAME,
+    VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME,
+    VK_EXT_EXTERNAL_MEMORY_DMA_BUF_EXTENSION_NAME,
+    VK_EXT_IMAGE_DRM_FORMAT_MODIFIER_EXTENSION_NAME,
+    VK_EXT_QUEUE_FAMILY_FOREIGN_EXTENSION_NAME,  // For cross-GPU queue family transfers
+};
 
-        res = vkAllocateMemory(vk->device, &alloc_info, NULL, &src_buf->optimal_memories[i]);
-        if (res != VK_SUCCESS) {
-            destroy_double_buffered_optimal(vk, src_buf);
-            return false;
-        }
+// Optional device extensions, enabled when the driver supports them
+static const char *OPTIONAL_DEVICE_EXTENSIONS[] = {
+    VK_KHR_INCREMENTAL_PRESENT_EXTENSION_NAME,  // Report damaged regions on present
+};
 
-        res = vkBindImageMemory(vk->device, src_buf->optimal_images[i], src_buf->optimal_memories[i], 0);
-        if (res != VK_SUCCESS) {
-            destroy_double_buffered_optimal(vk, src_buf);
-            return false;
-        }
+#define ARRAY_LEN(arr) (sizeof(arr) / sizeof((arr)[0]))
 
-        VkImageViewCreateInfo view_info = {
-            .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
-            .image = src_buf->optimal_images[i],
-            .viewType = VK_IMAGE_VIEW_TYPE_2D,
-            .format = format,
-            .components = {
-                .r = VK_COMPONENT_SWIZZLE_IDENTITY,
-                .g = VK_COMPONENT_SWIZZLE_IDENTITY,
-                .b = VK_COMPONENT_SWIZZLE_IDENTITY,
-                .a = VK_COMPONENT_SWIZZLE_IDENTITY,
-            },
-            .subresourceRange = {
-                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-                .baseMipLevel = 0,
-                .levelCount = 1,
-                .baseArrayLayer = 0,
-                .layerCount = 1,
-            },
-        };
+// Logging helper
+#define vk_log(lvl, fmt, ...) \
+    util_log(lvl, "[vk] " fmt, ##__VA_ARGS__)
 
-        res = vkCreateImageView(vk->device, &view_info, NULL, &src_buf->optimal_views[i]);
-        if (res != VK_SUCCESS) {
-            destroy_double_buffered_optimal(vk, src_buf);
-            return false;
-        }
+#define vk_check(result, msg) \
+    do { \
+        if ((result) != VK_SUCCESS) { \
+            vk_log(LOG_ERROR, "%s: %d", msg, (int)(result)); \
+            return false; \
+        } \
+    } while (0)
 
-        // Allocate descriptor set for this buffer
-        VkDescriptorSetAllocateInfo desc_alloc = {
-            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-            .descriptorPool = vk->descriptor_pool,
-            .descriptorSetCount = 1,
-            .pSetLayouts = &vk->blit_pipeline.descriptor_layout,
-        };
+// Forward declarations
+static void vk_buffer_destroy(struct vk_buffer *buffer);
+static struct vk_buffer *vk_buffer_import(struct server_vk *vk, struct server_buffer *buffer);
+static void on_surface_commit(struct wl_listener *listener, void *data);
+static void on_surface_destroy(struct wl_listener *listener, void *data);
+static void on_ui_resize(struct wl_listener *listener, void *data);
+static bool create_frame_pacing(struct server_vk *vk);
+static void destroy_frame_pacing(struct server_vk *vk);
+static void frame_pacing_request_feedback(struct server_vk *vk);
+static uint32_t find_memory_type(struct server_vk *vk, uint32_t type_filter, VkMemoryPropertyFlags properties);
 
-        res = vkAllocateDescriptorSets(vk->device, &desc_alloc, &src_buf->optimal_descriptors[i]);
-        if (res != VK_SUCCESS) {
-            destroy_double_buffered_optimal(vk, src_buf);
-            return false;
-        }
+// Text rendering forward declarations
+static bool init_font_system(struct server_vk *vk, const char *font_path, const char *prewarm);
+static void destroy_font_system(struct server_vk *vk);
+static bool create_text_vk_pipeline(struct server_vk *vk);
+static void stream_texts(struct server_vk *vk, uint32_t slot);
+static void destroy_text_stream(struct server_vk *vk);
+static void destroy_layout_cache(struct server_vk *vk);
+static void destroy_resident_capture(struct server_vk *vk, struct vk_resident_capture *resident);
+static bool create_capture_copy(struct server_vk *vk);
+static void destroy_capture_copy(struct server_vk *vk);
+static bool release_watch_create(struct server_vk *vk, struct vk_release_watch *watch);
+static void release_watch_arm(struct server_vk *vk, struct vk_release_watch *watch);
+static void release_watch_destroy(struct server_vk *vk, struct vk_release_watch *watch);
+static void import_tune_resolve(struct server_vk *vk, uint32_t slot,
+                                const struct vk_frame_stats *stats);
+static void passthrough_unmap(struct server_vk *vk);
+// static void draw_texts(struct server_vk *vk, VkCommandBuffer cmd);
 
-        VkDescriptorImageInfo image_desc = {
-            .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-            .imageView = src_buf->optimal_views[i],
-            .sampler = vk->sampler,
-        };
+// ============================================================================
+// Instance Creation
+// ============================================================================
 
-        VkWriteDescriptorSet desc_write = {
-            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-            .dstSet = src_buf->optimal_descriptors[i],
-            .dstBinding = 0,
-            .dstArrayElement = 0,
-            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-            .descriptorCount = 1,
-            .pImageInfo = &image_desc,
-        };
+static bool
+check_instance_extensions(void) {
+    uint32_t count = 0;
+    vkEnumerateInstanceExtensionProperties(NULL, &count, NULL);
 
-        vkUpdateDescriptorSets(vk->device, 1, &desc_write, 0, NULL);
-    }
+    VkExtensionProperties *props = zalloc(count, sizeof(*props));
+    vkEnumerateInstanceExtensionProperties(NULL, &count, props);
 
-    src_buf->optimal_read_index = 0;
-    src_buf->optimal_write_index = 1;
-    src_buf->copy_pending = false;
-    src_buf->async_optimal_valid = true;
+    for (size_t i = 0; i < ARRAY_LEN(INSTANCE_EXTENSIONS); i++) {
+        bool found = false;
+        for (uint32_t j = 0; j < count; j++) {
+            if (strcmp(INSTANCE_EXTENSIONS[i], props[j].extensionName) == 0) {
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            vk_log(LOG_ERROR, "missing instance extension: %s", INSTANCE_EXTENSIONS[i]);
+            free(props);
+            return false;
+        }
+    }
 
-    // Note: vk_log not available here, will log in vk_buffer_import
+    free(props);
     return true;
 }
 
-static void
-start_async_copy_to_optimal(struct server_vk *vk, struct vk_buffer *buf) {
-    if (!buf->async_optimal_valid || buf->copy_pending || !buf->image) {
-        return;
+static bool
+create_instance(struct server_vk *vk) {
+    if (!check_instance_extensions()) {
+        return false;
     }
 
-    int write_idx = buf->optimal_write_index;
+    VkApplicationInfo app_info = {
+        .sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
+        .pApplicationName = "waywall",
+        .applicationVersion = VK_MAKE_VERSION(1, 0, 0),
+        .pEngineName = "waywall",
+        .engineVersion = VK_MAKE_VERSION(1, 0, 0),
+        .apiVersion = VK_API_VERSION_1_2,
+    };
 
-    // Allocate command buffer from transfer pool
-    VkCommandBufferAllocateInfo alloc_info = {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-        .commandPool = vk->transfer_pool,
-        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-        .commandBufferCount = 1,
+    VkInstanceCreateInfo create_info = {
+        .sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+        .pApplicationInfo = &app_info,
+        .enabledExtensionCount = ARRAY_LEN(INSTANCE_EXTENSIONS),
+        .ppEnabledExtensionNames = INSTANCE_EXTENSIONS,
     };
 
-    VkCommandBuffer cmd = VK_NULL_HANDLE;
-    if (vkAllocateCommandBuffers(vk->device, &alloc_info, &cmd) != VK_SUCCESS) {
-        return;
-    }
+    VkResult result = vkCreateInstance(&create_info, NULL, &vk->instance);
+    vk_check(result, "failed to create Vulkan instance");
 
-    VkCommandBufferBeginInfo begin_info = {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
-    };
-    vkBeginCommandBuffer(cmd, &begin_info);
+    vk_log(LOG_INFO, "created Vulkan instance");
+    return true;
+}
 
-    // Transition layouts for copy
-    VkImageMemoryBarrier barriers[2] = {
-        {
-            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-            .srcAccessMask = 0,
-            .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
-            .oldLayout = VK_IMAGE_LAYOUT_PREINITIALIZED,
-            .newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-            .image = buf->image,
-            .subresourceRange = {
-                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-                .baseMipLevel = 0,
-                .levelCount = 1,
-                .baseArrayLayer = 0,
-                .layerCount = 1,
-            },
-        },
-        {
-            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-            .srcAccessMask = 0,
-            .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
-            .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-            .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-            .image = buf->optimal_images[write_idx],
-            .subresourceRange = {
-                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-                .baseMipLevel = 0,
-                .levelCount = 1,
-                .baseArrayLayer = 0,
-                .layerCount = 1,
-            },
-        },
-    };
+// ============================================================================
+// Physical Device Selection
+// ============================================================================
 
-    vkCmdPipelineBarrier(cmd,
-                         VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-                         VK_PIPELINE_STAGE_TRANSFER_BIT,
-                         0, 0, NULL, 0, NULL, 2, barriers);
+static bool
+check_device_extensions(VkPhysicalDevice device) {
+    uint32_t count = 0;
+    vkEnumerateDeviceExtensionProperties(device, NULL, &count, NULL);
 
-    VkImageCopy region = {
-        .srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 },
-        .srcOffset = { 0, 0, 0 },
-        .dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 },
-        .dstOffset = { 0, 0, 0 },
-        .extent = { (uint32_t)buf->width, (uint32_t)buf->height, 1 },
-    };
-    vkCmdCopyImage(cmd,
-                   buf->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                   buf->optimal_images[write_idx], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                   1, &region);
+    VkExtensionProperties *props = zalloc(count, sizeof(*props));
+    vkEnumerateDeviceExtensionProperties(device, NULL, &count, props);
 
-    // Transition to shader read
-    VkImageMemoryBarrier post_barrier = {
-        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
-        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
-        .oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-        .newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-        .image = buf->optimal_images[write_idx],
-        .subresourceRange = {
-            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-            .baseMipLevel = 0,
-            .levelCount = 1,
-            .baseArrayLayer = 0,
-            .layerCount = 1,
-        },
-    };
-
-    vkCmdPipelineBarrier(cmd,
-                         VK_PIPELINE_STAGE_TRANSFER_BIT,
-                         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-                         0, 0, NULL, 0, NULL, 1, &post_barrier);
-
-    vkEndCommandBuffer(cmd);
-
-    // Check if previous copy is done (NON-BLOCKING) - skip if still in progress
-    VkResult fence_status = vkGetFenceStatus(vk->device, buf->copy_fence);
-    if (fence_status != VK_SUCCESS) {
-        // Previous copy still running, skip this one to avoid stalling
-        vkFreeCommandBuffers(vk->device, vk->transfer_pool, 1, &cmd);
-        return;
-    }
-    vkResetFences(vk->device, 1, &buf->copy_fence);
-
-    VkSubmitInfo submit = {
-        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-        .commandBufferCount = 1,
-        .pCommandBuffers = &cmd,
-    };
-    VkResult submit_res = vkQueueSubmit(vk->transfer_queue, 1, &submit, buf->copy_fence);
-
-    vkFreeCommandBuffers(vk->device, vk->transfer_pool, 1, &cmd);
-
-    if (submit_res == VK_SUCCESS) {
-        buf->copy_pending = true;
-    }
-}
-
-static void
-try_swap_optimal_buffers(struct server_vk *vk, struct vk_buffer *buf) {
-    if (!buf->async_optimal_valid || !buf->copy_pending) {
-        return;
-    }
-
-    // Check if copy finished (non-blocking)
-    VkResult result = vkGetFenceStatus(vk->device, buf->copy_fence);
-    if (result == VK_SUCCESS) {
-        // Swap indices
-        int tmp = buf->optimal_read_index;
-        buf->optimal_read_index = buf->optimal_write_index;
-        buf->optimal_write_index = tmp;
-
-        // Update descriptor to point to new read buffer
-        buf->descriptor_set = buf->optimal_descriptors[buf->optimal_read_index];
-
-        buf->copy_pending = false;
-    }
-}
-
-static bool
-vk_image_write_rgba(struct server_vk *vk, struct vk_image *image, const unsigned char *rgba, uint32_t width,
-                    uint32_t height) {
-    if (!vk || !vk->device || !image || !image->owns_image || !image->image || !image->memory || !rgba) {
-        return false;
-    }
-    if (width == 0 || height == 0) {
-        return false;
-    }
-
-    VkMemoryRequirements mem_reqs;
-    vkGetImageMemoryRequirements(vk->device, image->image, &mem_reqs);
-
-    void *mapped = NULL;
-    if (vkMapMemory(vk->device, image->memory, 0, mem_reqs.size, 0, &mapped) != VK_SUCCESS) {
-        return false;
-    }
-
-    VkImageSubresource subres = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT};
-    VkSubresourceLayout layout;
-    vkGetImageSubresourceLayout(vk->device, image->image, &subres, &layout);
-
-    const unsigned char *src = rgba;
-    unsigned char *dst = (unsigned char *)mapped + layout.offset;
-    const size_t src_row = (size_t)width * 4;
-
-    for (uint32_t y = 0; y < height; y++) {
-        memcpy(dst, src, src_row);
-        src += src_row;
-        dst += layout.rowPitch;
-    }
-
-    vkUnmapMemory(vk->device, image->memory);
-
-    VkCommandBuffer cmd = VK_NULL_HANDLE;
-    VkCommandBufferAllocateInfo cmd_alloc = {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-        .commandPool = vk->command_pool,
-        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-        .commandBufferCount = 1,
-    };
-    if (vkAllocateCommandBuffers(vk->device, &cmd_alloc, &cmd) != VK_SUCCESS) {
-        return false;
-    }
-
-    VkCommandBufferBeginInfo begin_info = {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
-    };
-    vkBeginCommandBuffer(cmd, &begin_info);
-
-    VkImageMemoryBarrier barrier = {
-        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-        .oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-        .newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-        .image = image->image,
-        .subresourceRange = {
-            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-            .baseMipLevel = 0,
-            .levelCount = 1,
-            .baseArrayLayer = 0,
-            .layerCount = 1,
-        },
-        .srcAccessMask = VK_ACCESS_HOST_WRITE_BIT,
-        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
-    };
-
-    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_HOST_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0,
-                         NULL, 1, &barrier);
-    vkEndCommandBuffer(cmd);
-
-    VkSubmitInfo submit = {
-        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-        .commandBufferCount = 1,
-        .pCommandBuffers = &cmd,
-    };
-    vkQueueSubmit(vk->graphics_queue, 1, &submit, VK_NULL_HANDLE);
-    vkQueueWaitIdle(vk->graphics_queue);
-    vkFreeCommandBuffers(vk->device, vk->command_pool, 1, &cmd);
-    return true;
-}
-
-static void
-vk_update_animated_images(struct server_vk *vk) {
-    if (!vk || !vk->device) return;
-
-    const uint64_t now = now_ms();
-    bool waited = false;
-    struct vk_image *image;
-    wl_list_for_each(image, &vk->images, link) {
-        if (!image->enabled) continue;
-        if (!image->owns_image) continue;
-        if (!image->frames || image->frame_count <= 1) continue;
-        if (now < image->next_frame_ms) continue;
-
-        if (!waited) {
-            vkDeviceWaitIdle(vk->device);
-            waited = true;
-        }
-
-        image->frame_index = (image->frame_index + 1) % image->frame_count;
-        struct util_avif_frame *frame = &image->frames[image->frame_index];
-        (void)vk_image_write_rgba(vk, image, (const unsigned char *)frame->data, (uint32_t)frame->width,
-                                  (uint32_t)frame->height);
-
-        double dur_s = frame->duration;
-        if (!(dur_s > 0.0)) dur_s = 0.1;
-        uint64_t dur_ms = (uint64_t)llround(dur_s * 1000.0);
-        if (dur_ms == 0) dur_ms = 1;
-        image->next_frame_ms = now + dur_ms;
-    }
-}
-
-// Generated SPIR-V shader bytecode
-#include "shader_spirv.h"
-
-// Required instance extensions
-static const char *INSTANCE_EXTENSIONS[] = {
-    VK_KHR_SURFACE_EXTENSION_NAME,
-    VK_KHR_WAYLAND_SURFACE_EXTENSION_NAME,
-    VK_KHR_EXTERNAL_MEMORY_CAPABILITIES_EXTENSION_NAME,
-    VK_KHR_EXTERNAL_SEMAPHORE_CAPABILITIES_EXTENSION_NAME,
-};
-
-// Required device extensions
-static const char *DEVICE_EXTENSIONS[] = {
-    VK_KHR_SWAPCHAIN_EXTENSION_NAME,
-    VK_KHR_EXTERNAL_MEMORY_EXTENSION_NAME,
-    VK_KHR_EXTERNAL_MEMORY_FD_EXTENSION_NAME,
-    VK_KHR_EXTERNAL_SEMAPHORE_EXTENSION_NAME,
-    VK_KHR_EXTERNAL_SEMAPHORE_FD_EXTENSION_NAME,
-    VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME,
-    VK_EXT_EXTERNAL_MEMORY_DMA_BUF_EXTENSION_NAME,
-    VK_EXT_IMAGE_DRM_FORMAT_MODIFIER_EXTENSION_NAME,
-    VK_EXT_QUEUE_FAMILY_FOREIGN_EXTENSION_NAME,  // For cross-GPU queue family transfers
-};
-
-#define ARRAY_LEN(arr) (sizeof(arr) / sizeof((arr)[0]))
-
-// Logging helper
-#define vk_log(lvl, fmt, ...) \
-    util_log(lvl, "[vk] " fmt, ##__VA_ARGS__)
-
-#define vk_check(result, msg) \
-    do { \
-        if ((result) != VK_SUCCESS) { \
-            vk_log(LOG_ERROR, "%s: %d", msg, (int)(result)); \
-            return false; \
-        } \
-    } while (0)
-
-// Forward declarations
-static void vk_buffer_destroy(struct vk_buffer *buffer);
-static struct vk_buffer *vk_buffer_import(struct server_vk *vk, struct server_buffer *buffer);
-static void on_surface_commit(struct wl_listener *listener, void *data);
-static void on_surface_destroy(struct wl_listener *listener, void *data);
-static void on_ui_resize(struct wl_listener *listener, void *data);
-static uint32_t find_memory_type(struct server_vk *vk, uint32_t type_filter, VkMemoryPropertyFlags properties);
-
-// Text rendering forward declarations
-static bool init_font_system(struct server_vk *vk, const char *font_path, uint32_t base_size);
-static void destroy_font_system(struct server_vk *vk);
-static bool create_text_vk_pipeline(struct server_vk *vk);
-// static void draw_texts(struct server_vk *vk, VkCommandBuffer cmd);
-
-// ============================================================================
-// Instance Creation
-// ============================================================================
-
-static bool
-check_instance_extensions(void) {
-    uint32_t count = 0;
-    vkEnumerateInstanceExtensionProperties(NULL, &count, NULL);
-
-    VkExtensionProperties *props = zalloc(count, sizeof(*props));
-    vkEnumerateInstanceExtensionProperties(NULL, &count, props);
-
-    for (size_t i = 0; i < ARRAY_LEN(INSTANCE_EXTENSIONS); i++) {
-        bool found = false;
+    size_t found_count = 0;
+    for (size_t i = 0; i < ARRAY_LEN(DEVICE_EXTENSIONS); i++) {
         for (uint32_t j = 0; j < count; j++) {
-            if (strcmp(INSTANCE_EXTENSIONS[i], props[j].extensionName) == 0) {
-                found = true;
+            if (strcmp(DEVICE_EXTENSIONS[i], props[j].extensionName) == 0) {
+                found_count++;
                 break;
             }
         }
-        if (!found) {
-            vk_log(LOG_ERROR, "missing instance extension: %s", INSTANCE_EXTENSIONS[i]);
-            free(props);
-            return false;
-        }
     }
 
     free(props);
-    return true;
-}
-
-static bool
-create_instance(struct server_vk *vk) {
-    if (!check_instance_extensions()) {
-        return false;
-    }
-
-    VkApplicationInfo app_info = {
-        .sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
-        .pApplicationName = "waywall",
-        .applicationVersion = VK_MAKE_VERSION(1, 0, 0),
-        .pEngineName = "waywall",
-        .engineVersion = VK_MAKE_VERSION(1, 0, 0),
-        .apiVersion = VK_API_VERSION_1_2,
-    };
-
-    VkInstanceCreateInfo create_info = {
-        .sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
-        .pApplicationInfo = &app_info,
-        .enabledExtensionCount = ARRAY_LEN(INSTANCE_EXTENSIONS),
-        .ppEnabledExtensionNames = INSTANCE_EXTENSIONS,
-    };
-
-    VkResult result = vkCreateInstance(&create_info, NULL, &vk->instance);
-    vk_check(result, "failed to create Vulkan instance");
-
-    vk_log(LOG_INFO, "created Vulkan instance");
-    return true;
+    return found_count == ARRAY_LEN(DEVICE_EXTENSIONS);
 }
 
-// ============================================================================
-// Physical Device Selection
-// ============================================================================
-
 static bool
-check_device_extensions(VkPhysicalDevice device) {
+has_device_extension(VkPhysicalDevice device, const char *name) {
     uint32_t count = 0;
     vkEnumerateDeviceExtensionProperties(device, NULL, &count, NULL);
 
     VkExtensionProperties *props = zalloc(count, sizeof(*props));
     vkEnumerateDeviceExtensionProperties(device, NULL, &count, props);
 
-    size_t found_count = 0;
-    for (size_t i = 0; i < ARRAY_LEN(DEVICE_EXTENSIONS); i++) {
-        for (uint32_t j = 0; j < count; j++) {
-            if (strcmp(DEVICE_EXTENSIONS[i], props[j].extensionName) == 0) {
-                found_count++;
-                break;
-            }
+    bool found = false;
+    for (uint32_t i = 0; i < count; i++) {
+        if (strcmp(name, props[i].extensionName) == 0) {
+            found = true;
+            break;
         }
     }
 
     free(props);
-    return found_count == ARRAY_LEN(DEVICE_EXTENSIONS);
+    return found;
 }
 
 static bool
@@ -1130,12 +790,6 @@ select_physical_device(struct server_vk *vk) {
 
     vkGetPhysicalDeviceMemoryProperties(selected, &vk->memory_properties);
 
-    // Enable async pipelining if dual-GPU and env var is set
-    vk->async_pipelining_enabled = vk->dual_gpu && getenv("WAYWALL_ASYNC_PIPELINING") != NULL;
-    if (vk->async_pipelining_enabled) {
-        vk_log(LOG_INFO, "Async pipelining ENABLED for dual-GPU setup");
-    }
-
     return true;
 }
 
@@ -1170,20 +824,79 @@ create_device(struct server_vk *vk) {
         };
     }
 
-    VkPhysicalDeviceFeatures features = {0};
+    // Descriptor indexing backs the texture table. Overlay textures are picked per instance, so the
+    // index is not uniform across a draw.
+    VkPhysicalDeviceDescriptorIndexingFeatures indexing_supported = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES,
+    };
+    VkPhysicalDeviceFeatures2 supported = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .pNext = &indexing_supported,
+    };
+    vkGetPhysicalDeviceFeatures2(vk->physical_device, &supported);
+    if (!supported.features.shaderSampledImageArrayDynamicIndexing ||
+        !indexing_supported.shaderSampledImageArrayNonUniformIndexing ||
+        !indexing_supported.descriptorBindingSampledImageUpdateAfterBind ||
+        !indexing_supported.descriptorBindingUpdateUnusedWhilePending ||
+        !indexing_supported.descriptorBindingPartiallyBound ||
+        !indexing_supported.runtimeDescriptorArray) {
+        vk_log(LOG_ERROR, "device does not support descriptor indexing");
+        return false;
+    }
+
+    VkPhysicalDeviceFeatures features = {
+        .shaderSampledImageArrayDynamicIndexing = VK_TRUE,
+    };
+
+    VkPhysicalDeviceDescriptorIndexingFeatures indexing_features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES,
+        .shaderSampledImageArrayNonUniformIndexing = VK_TRUE,
+        .descriptorBindingSampledImageUpdateAfterBind = VK_TRUE,
+        .descriptorBindingUpdateUnusedWhilePending = VK_TRUE,
+        .descriptorBindingPartiallyBound = VK_TRUE,
+        .runtimeDescriptorArray = VK_TRUE,
+    };
+
+    // Lets the capture copy pipeline reset its timestamp queries, which can't be done on a
+    // transfer queue.
+    VkPhysicalDeviceHostQueryResetFeatures host_query_reset_features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_QUERY_RESET_FEATURES,
+    };
+    VkPhysicalDeviceFeatures2 supported_features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .pNext = &host_query_reset_features,
+    };
+    vkGetPhysicalDeviceFeatures2(vk->physical_device, &supported_features);
+    vk->host_query_reset = host_query_reset_features.hostQueryReset;
+    host_query_reset_features.pNext = &indexing_features;
 
     VkPhysicalDeviceTimelineSemaphoreFeatures timeline_features = {
         .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES,
+        .pNext = &host_query_reset_features,
         .timelineSemaphore = VK_TRUE,
     };
 
-    VkDeviceCreateInfo create_info = {
-        .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+    const char *extensions[ARRAY_LEN(DEVICE_EXTENSIONS) + ARRAY_LEN(OPTIONAL_DEVICE_EXTENSIONS)];
+    uint32_t extension_count = 0;
+    for (size_t i = 0; i < ARRAY_LEN(DEVICE_EXTENSIONS); i++) {
+        extensions[extension_count++] = DEVICE_EXTENSIONS[i];
+    }
+    for (size_t i = 0; i < ARRAY_LEN(OPTIONAL_DEVICE_EXTENSIONS); i++) {
+        if (has_device_extension(vk->physical_device, OPTIONAL_DEVICE_EXTENSIONS[i])) {
+            extensions[extension_count++] = OPTIONAL_DEVICE_EXTENSIONS[i];
+            if (strcmp(OPTIONAL_DEVICE_EXTENSIONS[i], VK_KHR_INCREMENTAL_PRESENT_EXTENSION_NAME) == 0) {
+                vk->incremental_present = true;
+            }
+        }
+    }
+
+    VkDeviceCreateInfo create_info = {
+        .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
         .pNext = &timeline_features,
         .queueCreateInfoCount = unique_count,
         .pQueueCreateInfos = queue_infos,
-        .enabledExtensionCount = ARRAY_LEN(DEVICE_EXTENSIONS),
-        .ppEnabledExtensionNames = DEVICE_EXTENSIONS,
+        .enabledExtensionCount = extension_count,
+        .ppEnabledExtensionNames = extensions,
         .pEnabledFeatures = &features,
     };
 
@@ -1198,763 +911,3097 @@ create_device(struct server_vk *vk) {
     if (!pfn_vkImportSemaphoreFdKHR) {
         vk_log(LOG_WARN, "failed to load vkImportSemaphoreFdKHR - explicit sync disabled");
     }
+    pfn_vkGetSemaphoreFdKHR = (PFN_vkGetSemaphoreFdKHR)vkGetDeviceProcAddr(vk->device, "vkGetSemaphoreFdKHR");
 
-    // Create transfer command pool if async pipelining is enabled
-    if (vk->async_pipelining_enabled) {
-        VkCommandPoolCreateInfo pool_info = {
-            .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
-            .queueFamilyIndex = vk->transfer_family,
-            .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
-        };
-        result = vkCreateCommandPool(vk->device, &pool_info, NULL, &vk->transfer_pool);
-        if (result != VK_SUCCESS) {
-            vk_log(LOG_ERROR, "failed to create transfer command pool: %d", result);
-            vk->async_pipelining_enabled = false;
-        } else {
-            vk_log(LOG_INFO, "created transfer command pool for async pipelining");
-        }
-    }
+    // Transfer command pool, used for texture uploads and capture copies
+    VkCommandPoolCreateInfo pool_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .queueFamilyIndex = vk->transfer_family,
+        .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+    };
+    result = vkCreateCommandPool(vk->device, &pool_info, NULL, &vk->transfer_pool);
+    vk_check(result, "failed to create transfer command pool");
 
-    vk_log(LOG_INFO, "created logical device");
+    vk_log(LOG_INFO, "created logical device (incremental_present=%s)",
+           vk->incremental_present ? "true" : "false");
     return true;
 }
 
 // ============================================================================
-// Swapchain Creation
+// Device Memory
 // ============================================================================
 
-static VkSurfaceFormatKHR
-choose_surface_format(VkPhysicalDevice device, VkSurfaceKHR surface) {
-    uint32_t count = 0;
-    vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &count, NULL);
+// Size of the shared memory blocks. Host-visible memory is only used for small buffers and the font
+// atlases, so its blocks are smaller. Resources larger than half a block get a dedicated allocation.
+#define VK_MEMORY_BLOCK_SIZE (32 * 1024 * 1024)
+#define VK_HOST_MEMORY_BLOCK_SIZE (4 * 1024 * 1024)
 
-    VkSurfaceFormatKHR *formats = zalloc(count, sizeof(*formats));
-    vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &count, formats);
+struct vk_memory_range {
+    VkDeviceSize offset;
+    VkDeviceSize size;
+};
 
-    // Prefer BGRA8 UNORM (pass-through sRGB values without re-encoding)
-    VkSurfaceFormatKHR selected = formats[0];
-    for (uint32_t i = 0; i < count; i++) {
-        if (formats[i].format == VK_FORMAT_B8G8R8A8_UNORM &&
-            formats[i].colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
-            selected = formats[i];
-            break;
+// A VkDeviceMemory which resources are sub-allocated from. Buffers and linear images are kept in
+// separate blocks from optimal images, so bufferImageGranularity never has to be considered.
+struct vk_memory_block {
+    struct wl_list link;  // server_vk.memory.blocks
+    VkDeviceMemory memory;
+    VkDeviceSize size;
+    uint32_t type;
+    bool linear;
+    void *mapped;  // Persistently mapped if host-visible memory was requested
+
+    VkDeviceSize used;
+    uint32_t allocation_count;
+
+    // Free ranges, sorted by offset. Adjacent free ranges are always merged.
+    struct vk_memory_range *free;
+    size_t free_count, free_capacity;
+};
+
+static void
+block_insert_range(struct vk_memory_block *block, size_t index, VkDeviceSize offset, VkDeviceSize size) {
+    if (block->free_count == block->free_capacity) {
+        block->free_capacity *= 2;
+        block->free = realloc(block->free, block->free_capacity * sizeof(*block->free));
+        check_alloc(block->free);
+    }
+
+    memmove(&block->free[index + 1], &block->free[index],
+            (block->free_count - index) * sizeof(*block->free));
+    block->free[index] = (struct vk_memory_range){offset, size};
+    block->free_count++;
+}
+
+static void
+block_remove_range(struct vk_memory_block *block, size_t index) {
+    memmove(&block->free[index], &block->free[index + 1],
+            (block->free_count - index - 1) * sizeof(*block->free));
+    block->free_count--;
+}
+
+static bool
+block_alloc(struct vk_memory_block *block, VkDeviceSize size, VkDeviceSize alignment,
+            VkDeviceSize *out_offset) {
+    // Memory alignments are always a power of two.
+    for (size_t i = 0; i < block->free_count; i++) {
+        struct vk_memory_range *range = &block->free[i];
+        VkDeviceSize offset = (range->offset + alignment - 1) & ~(alignment - 1);
+        VkDeviceSize end = range->offset + range->size;
+        if (offset + size > end) {
+            continue;
         }
-        if (formats[i].format == VK_FORMAT_B8G8R8A8_SRGB) {
-            selected = formats[i];
+
+        // Keep whatever is left on either side of the allocation (including alignment padding) as
+        // free ranges.
+        VkDeviceSize before = offset - range->offset;
+        VkDeviceSize after = end - (offset + size);
+        if (before > 0 && after > 0) {
+            range->size = before;
+            block_insert_range(block, i + 1, offset + size, after);
+        } else if (before > 0) {
+            range->size = before;
+        } else if (after > 0) {
+            range->offset = offset + size;
+            range->size = after;
+        } else {
+            block_remove_range(block, i);
         }
+
+        *out_offset = offset;
+        return true;
     }
 
-    free(formats);
-    return selected;
+    return false;
 }
 
-static VkPresentModeKHR
-choose_present_mode(VkPhysicalDevice device, VkSurfaceKHR surface) {
-    uint32_t count = 0;
-    vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &count, NULL);
+static void
+block_free(struct vk_memory_block *block, VkDeviceSize offset, VkDeviceSize size) {
+    size_t i = 0;
+    while (i < block->free_count && block->free[i].offset < offset) {
+        i++;
+    }
+
+    bool merge_prev = i > 0 && block->free[i - 1].offset + block->free[i - 1].size == offset;
+    bool merge_next = i < block->free_count && offset + size == block->free[i].offset;
+
+    if (merge_prev && merge_next) {
+        block->free[i - 1].size += size + block->free[i].size;
+        block_remove_range(block, i);
+    } else if (merge_prev) {
+        block->free[i - 1].size += size;
+    } else if (merge_next) {
+        block->free[i].offset = offset;
+        block->free[i].size += size;
+    } else {
+        block_insert_range(block, i, offset, size);
+    }
+}
 
-    VkPresentModeKHR *modes = zalloc(count, sizeof(*modes));
-    vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &count, modes);
+static struct vk_memory_block *
+create_memory_block(struct server_vk *vk, uint32_t type, bool linear, bool host_visible) {
+    struct vk_memory_block *block = zalloc(1, sizeof(*block));
+    block->size = host_visible ? VK_HOST_MEMORY_BLOCK_SIZE : VK_MEMORY_BLOCK_SIZE;
+    block->type = type;
+    block->linear = linear;
 
-    // Optional override via env: WAYWALL_PRESENT_MODE=IMMEDIATE|MAILBOX|FIFO
-    VkPresentModeKHR forced = VK_PRESENT_MODE_MAX_ENUM_KHR;
-    const char *env_mode = getenv("WAYWALL_PRESENT_MODE");
-    if (env_mode) {
-        if (strcasecmp(env_mode, "IMMEDIATE") == 0) forced = VK_PRESENT_MODE_IMMEDIATE_KHR;
-        else if (strcasecmp(env_mode, "MAILBOX") == 0) forced = VK_PRESENT_MODE_MAILBOX_KHR;
-        else if (strcasecmp(env_mode, "FIFO") == 0) forced = VK_PRESENT_MODE_FIFO_KHR;
+    VkMemoryAllocateInfo alloc_info = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .allocationSize = block->size,
+        .memoryTypeIndex = type,
+    };
+    if (vkAllocateMemory(vk->device, &alloc_info, NULL, &block->memory) != VK_SUCCESS) {
+        vk_log(LOG_ERROR, "failed to allocate memory block (type %" PRIu32 ")", type);
+        goto fail_alloc;
     }
 
-    // Prefer IMMEDIATE (no vsync) > MAILBOX (low latency) > FIFO (vsync)
-    VkPresentModeKHR selected = VK_PRESENT_MODE_FIFO_KHR;  // Always available
-    for (uint32_t i = 0; i < count; i++) {
-        if (forced != VK_PRESENT_MODE_MAX_ENUM_KHR && modes[i] == forced) {
-            selected = modes[i];
-            break;
-        }
-        if (modes[i] == VK_PRESENT_MODE_IMMEDIATE_KHR) {
-            selected = VK_PRESENT_MODE_IMMEDIATE_KHR;
-            break;
-        }
-        if (modes[i] == VK_PRESENT_MODE_MAILBOX_KHR && selected != VK_PRESENT_MODE_IMMEDIATE_KHR) {
-            selected = VK_PRESENT_MODE_MAILBOX_KHR;
+    if (host_visible) {
+        if (vkMapMemory(vk->device, block->memory, 0, VK_WHOLE_SIZE, 0, &block->mapped) != VK_SUCCESS) {
+            vk_log(LOG_ERROR, "failed to map memory block (type %" PRIu32 ")", type);
+            goto fail_map;
         }
     }
 
-    const char *sel_name = "UNKNOWN";
-    switch (selected) {
-    case VK_PRESENT_MODE_IMMEDIATE_KHR: sel_name = "IMMEDIATE"; break;
-    case VK_PRESENT_MODE_MAILBOX_KHR: sel_name = "MAILBOX"; break;
-    case VK_PRESENT_MODE_FIFO_KHR: sel_name = "FIFO"; break;
-    case VK_PRESENT_MODE_FIFO_RELAXED_KHR: sel_name = "FIFO_RELAXED"; break;
-    default: break;
-    }
-    if (forced != VK_PRESENT_MODE_MAX_ENUM_KHR) {
-        vk_log(LOG_INFO, "Present mode: forced %s (selected=%s)", env_mode ? env_mode : "?", sel_name);
-    } else {
-        vk_log(LOG_INFO, "Present mode: selected=%s", sel_name);
-    }
+    block->free_capacity = 16;
+    block->free = zalloc(block->free_capacity, sizeof(*block->free));
+    block->free[0] = (struct vk_memory_range){0, block->size};
+    block->free_count = 1;
 
-    free(modes);
-    return selected;
+    wl_list_insert(vk->memory.blocks.prev, &block->link);
+    return block;
+
+fail_map:
+    vkFreeMemory(vk->device, block->memory, NULL);
+
+fail_alloc:
+    free(block);
+    return NULL;
 }
 
-static bool
-create_swapchain(struct server_vk *vk, uint32_t width, uint32_t height, VkSwapchainKHR old_swapchain) {
-    VkSurfaceCapabilitiesKHR caps;
-    vkGetPhysicalDeviceSurfaceCapabilitiesKHR(vk->physical_device, vk->swapchain.surface, &caps);
+static void
+destroy_memory_block(struct server_vk *vk, struct vk_memory_block *block) {
+    wl_list_remove(&block->link);
+    vkFreeMemory(vk->device, block->memory, NULL);
+    free(block->free);
+    free(block);
+}
 
-    // Prefer BGRA8 UNORM (pass-through sRGB values without re-encoding)
-    VkSurfaceFormatKHR format = choose_surface_format(vk->physical_device, vk->swapchain.surface);
-    VkPresentModeKHR present_mode = choose_present_mode(vk->physical_device, vk->swapchain.surface);
+static void
+destroy_memory_blocks(struct server_vk *vk) {
+    struct vk_memory_block *block, *tmp;
+    wl_list_for_each_safe(block, tmp, &vk->memory.blocks, link) {
+        destroy_memory_block(vk, block);
+    }
+}
 
-    // Clamp extent to surface capabilities
-    VkExtent2D extent = { width, height };
-    if (caps.currentExtent.width != UINT32_MAX) {
-        extent = caps.currentExtent;
-    } else {
-        extent.width = (extent.width < caps.minImageExtent.width) ? caps.minImageExtent.width :
-                       (extent.width > caps.maxImageExtent.width) ? caps.maxImageExtent.width :
-                       extent.width;
-        extent.height = (extent.height < caps.minImageExtent.height) ? caps.minImageExtent.height :
-                        (extent.height > caps.maxImageExtent.height) ? caps.maxImageExtent.height :
-                        extent.height;
+// Allocates memory for a resource with the given requirements. linear must be set for buffers and
+// linear images. The first memory type with all of the given properties is used, and the memory is
+// mapped if HOST_VISIBLE was requested.
+static bool
+vk_alloc(struct server_vk *vk, const VkMemoryRequirements *reqs, VkMemoryPropertyFlags properties,
+         bool linear, struct vk_allocation *out) {
+    *out = (struct vk_allocation){0};
+
+    uint32_t type = find_memory_type(vk, reqs->memoryTypeBits, properties);
+    if (type == UINT32_MAX) {
+        return false;
     }
+    bool host_visible = properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+    VkDeviceSize block_size = host_visible ? VK_HOST_MEMORY_BLOCK_SIZE : VK_MEMORY_BLOCK_SIZE;
 
-    // Request one more image than minimum for triple buffering
-    uint32_t image_count = caps.minImageCount + 1;
-    if (caps.maxImageCount > 0 && image_count > caps.maxImageCount) {
-        image_count = caps.maxImageCount;
+    if (reqs->size > block_size / 2) {
+        VkMemoryAllocateInfo alloc_info = {
+            .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+            .allocationSize = reqs->size,
+            .memoryTypeIndex = type,
+        };
+        if (vkAllocateMemory(vk->device, &alloc_info, NULL, &out->memory) != VK_SUCCESS) {
+            return false;
+        }
+        if (host_visible) {
+            if (vkMapMemory(vk->device, out->memory, 0, VK_WHOLE_SIZE, 0, &out->mapped) != VK_SUCCESS) {
+                vkFreeMemory(vk->device, out->memory, NULL);
+                out->memory = VK_NULL_HANDLE;
+                return false;
+            }
+        }
+
+        out->size = reqs->size;
+        vk->memory.dedicated_count++;
+        vk->memory.dedicated_bytes += reqs->size;
+        return true;
     }
 
-    // Check for transparent compositing support (for background visibility)
-    VkCompositeAlphaFlagBitsKHR composite_alpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-    if (caps.supportedCompositeAlpha & VK_COMPOSITE_ALPHA_PRE_MULTIPLIED_BIT_KHR) {
-        composite_alpha = VK_COMPOSITE_ALPHA_PRE_MULTIPLIED_BIT_KHR;
+    VkDeviceSize offset = 0;
+    struct vk_memory_block *block = NULL, *iter;
+    wl_list_for_each(iter, &vk->memory.blocks, link) {
+        if (iter->type == type && iter->linear == linear && !!iter->mapped == host_visible &&
+            block_alloc(iter, reqs->size, reqs->alignment, &offset)) {
+            block = iter;
+            break;
+        }
     }
 
-    VkSwapchainCreateInfoKHR create_info = {
-        .sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
-        .surface = vk->swapchain.surface,
-        .minImageCount = image_count,
-        .imageFormat = format.format,
-        .imageColorSpace = format.colorSpace,
-        .imageExtent = extent,
-        .imageArrayLayers = 1,
-        .imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
-        .preTransform = caps.currentTransform,
-        .compositeAlpha = composite_alpha,
-        .presentMode = present_mode,
-        .clipped = VK_TRUE,
-        .oldSwapchain = old_swapchain,
-    };
+    if (!block) {
+        block = create_memory_block(vk, type, linear, host_visible);
+        if (!block) {
+            return false;
+        }
 
-    uint32_t queue_families[] = { vk->graphics_family, vk->present_family };
-    if (vk->graphics_family != vk->present_family) {
-        create_info.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
-        create_info.queueFamilyIndexCount = 2;
-        create_info.pQueueFamilyIndices = queue_families;
-    } else {
-        create_info.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        // A fresh block always has room for an allocation of at most half its size.
+        bool ok = block_alloc(block, reqs->size, reqs->alignment, &offset);
+        ww_assert(ok);
     }
 
-    VkResult result = vkCreateSwapchainKHR(vk->device, &create_info, NULL, &vk->swapchain.swapchain);
-    vk_check(result, "failed to create swapchain");
+    block->used += reqs->size;
+    block->allocation_count++;
 
-    vk->swapchain.format = format.format;
-    vk->swapchain.extent = extent;
+    out->block = block;
+    out->memory = block->memory;
+    out->offset = offset;
+    out->size = reqs->size;
+    out->mapped = block->mapped ? (unsigned char *)block->mapped + offset : NULL;
+    return true;
+}
 
-    // Get swapchain images
-    vkGetSwapchainImagesKHR(vk->device, vk->swapchain.swapchain, &vk->swapchain.image_count, NULL);
-    vk->swapchain.images = zalloc(vk->swapchain.image_count, sizeof(VkImage));
-    vkGetSwapchainImagesKHR(vk->device, vk->swapchain.swapchain, &vk->swapchain.image_count,
-                            vk->swapchain.images);
+static void
+vk_free(struct server_vk *vk, struct vk_allocation *alloc) {
+    if (!alloc->memory) {
+        return;
+    }
 
-    // Create image views
-    vk->swapchain.views = zalloc(vk->swapchain.image_count, sizeof(VkImageView));
-    for (uint32_t i = 0; i < vk->swapchain.image_count; i++) {
-        VkImageViewCreateInfo view_info = {
-            .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
-            .image = vk->swapchain.images[i],
-            .viewType = VK_IMAGE_VIEW_TYPE_2D,
-            .format = vk->swapchain.format,
-            .components = {
-                .r = VK_COMPONENT_SWIZZLE_IDENTITY,
-                .g = VK_COMPONENT_SWIZZLE_IDENTITY,
-                .b = VK_COMPONENT_SWIZZLE_IDENTITY,
-                .a = VK_COMPONENT_SWIZZLE_IDENTITY,
-            },
-            .subresourceRange = {
-                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-                .baseMipLevel = 0,
-                .levelCount = 1,
-                .baseArrayLayer = 0,
-                .layerCount = 1,
-            },
-        };
+    struct vk_memory_block *block = alloc->block;
+    if (!block) {
+        vk->memory.dedicated_count--;
+        vk->memory.dedicated_bytes -= alloc->size;
+        vkFreeMemory(vk->device, alloc->memory, NULL);
+        *alloc = (struct vk_allocation){0};
+        return;
+    }
 
-        result = vkCreateImageView(vk->device, &view_info, NULL, &vk->swapchain.views[i]);
-        if (result != VK_SUCCESS) {
-            vk_log(LOG_ERROR, "failed to create swapchain image view");
-            return false;
+    block_free(block, alloc->offset, alloc->size);
+    block->used -= alloc->size;
+    block->allocation_count--;
+    *alloc = (struct vk_allocation){0};
+
+    // Empty blocks are released, except for the last one of their kind so that repeatedly adding
+    // and removing a single image does not allocate a new block each time.
+    if (block->allocation_count == 0) {
+        struct vk_memory_block *other;
+        wl_list_for_each(other, &vk->memory.blocks, link) {
+            if (other != block && other->type == block->type && other->linear == block->linear &&
+                !!other->mapped == !!block->mapped) {
+                destroy_memory_block(vk, block);
+                return;
+            }
         }
     }
+}
+
+static bool
+vk_alloc_image(struct server_vk *vk, VkImage image, VkMemoryPropertyFlags properties, bool linear,
+               struct vk_allocation *out) {
+    VkMemoryRequirements mem_reqs;
+    vkGetImageMemoryRequirements(vk->device, image, &mem_reqs);
+
+    if (!vk_alloc(vk, &mem_reqs, properties, linear, out)) {
+        return false;
+    }
+    if (vkBindImageMemory(vk->device, image, out->memory, out->offset) != VK_SUCCESS) {
+        vk_free(vk, out);
+        return false;
+    }
+    return true;
+}
+
+static bool
+vk_alloc_buffer(struct server_vk *vk, VkBuffer buffer, VkMemoryPropertyFlags properties,
+                struct vk_allocation *out) {
+    VkMemoryRequirements mem_reqs;
+    vkGetBufferMemoryRequirements(vk->device, buffer, &mem_reqs);
 
+    if (!vk_alloc(vk, &mem_reqs, properties, true, out)) {
+        return false;
+    }
+    if (vkBindBufferMemory(vk->device, buffer, out->memory, out->offset) != VK_SUCCESS) {
+        vk_free(vk, out);
+        return false;
+    }
     return true;
 }
 
+void
+server_vk_get_memory_stats(struct server_vk *vk, struct vk_memory_stats *out) {
+    *out = (struct vk_memory_stats){
+        .dedicated_count = vk->memory.dedicated_count,
+        .dedicated_bytes = vk->memory.dedicated_bytes,
+    };
+
+    struct vk_memory_block *block;
+    wl_list_for_each(block, &vk->memory.blocks, link) {
+        out->block_count++;
+        out->block_bytes += block->size;
+        out->used_bytes += block->used;
+        out->allocation_count += block->allocation_count;
+        out->free_ranges += block->free_count;
+
+        for (size_t i = 0; i < block->free_count; i++) {
+            if (block->free[i].size > out->largest_free) {
+                out->largest_free = block->free[i].size;
+            }
+        }
+    }
+}
+
 // ============================================================================
-// Render Pass
+// Texture Uploads
 // ============================================================================
 
-static bool
-create_render_pass(struct server_vk *vk) {
-    VkAttachmentDescription color_attachment = {
-        .format = vk->swapchain.format,
-        .samples = VK_SAMPLE_COUNT_1_BIT,
-        .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
-        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
-        .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
-        .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-        .finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-    };
+// Size of the staging ring. Uploads which do not fit in the free part of the ring get a dedicated
+// staging buffer, which is freed along with the batch it was recorded into.
+#define VK_STAGING_RING_SIZE (16 * 1024 * 1024)
+#define VK_STAGING_ALIGN 16
 
-    VkAttachmentReference color_ref = {
-        .attachment = 0,
-        .layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-    };
+struct vk_staging_buffer {
+    struct wl_list link;  // vk_upload_batch.staging
+    VkBuffer buffer;
+    VkDeviceMemory memory;
+};
 
-    VkSubpassDescription subpass = {
-        .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
-        .colorAttachmentCount = 1,
-        .pColorAttachments = &color_ref,
-    };
+// A command buffer of copies on the transfer queue. Once upload.timeline reaches value, its
+// command buffer and staging memory can be reused.
+struct vk_upload_batch {
+    struct wl_list link;  // server_vk.upload.batches
+    VkCommandBuffer cmd;
+    uint64_t value;
+    uint64_t ring_end;       // upload.head when the batch was submitted
+    VkDeviceSize size;       // Bytes staged by the batch
+    struct wl_list staging;  // vk_staging_buffer.link
+};
 
-    VkSubpassDependency dependency = {
-        .srcSubpass = VK_SUBPASS_EXTERNAL,
-        .dstSubpass = 0,
-        .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-        .srcAccessMask = 0,
-        .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-        .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+static bool
+create_host_buffer(struct server_vk *vk, VkDeviceSize size, VkBuffer *buffer, VkDeviceMemory *memory,
+                   void **mapped) {
+    VkBufferCreateInfo buffer_ci = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = size,
+        .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
     };
+    if (vkCreateBuffer(vk->device, &buffer_ci, NULL, buffer) != VK_SUCCESS) {
+        return false;
+    }
 
-    VkRenderPassCreateInfo create_info = {
-        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
-        .attachmentCount = 1,
-        .pAttachments = &color_attachment,
-        .subpassCount = 1,
-        .pSubpasses = &subpass,
-        .dependencyCount = 1,
-        .pDependencies = &dependency,
+    VkMemoryRequirements mem_reqs;
+    vkGetBufferMemoryRequirements(vk->device, *buffer, &mem_reqs);
+
+    uint32_t mem_type = find_memory_type(vk, mem_reqs.memoryTypeBits,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    if (mem_type == UINT32_MAX) {
+        goto fail_buffer;
+    }
+
+    VkMemoryAllocateInfo alloc_info = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .allocationSize = mem_reqs.size,
+        .memoryTypeIndex = mem_type,
     };
+    if (vkAllocateMemory(vk->device, &alloc_info, NULL, memory) != VK_SUCCESS) {
+        goto fail_buffer;
+    }
 
-    VkResult result = vkCreateRenderPass(vk->device, &create_info, NULL, &vk->render_pass);
-    vk_check(result, "failed to create render pass");
+    if (vkBindBufferMemory(vk->device, *buffer, *memory, 0) != VK_SUCCESS ||
+        vkMapMemory(vk->device, *memory, 0, VK_WHOLE_SIZE, 0, mapped) != VK_SUCCESS) {
+        goto fail_memory;
+    }
 
     return true;
-}
 
-// ============================================================================
-// Framebuffers
-// ============================================================================
+fail_memory:
+    vkFreeMemory(vk->device, *memory, NULL);
+    *memory = VK_NULL_HANDLE;
+
+fail_buffer:
+    vkDestroyBuffer(vk->device, *buffer, NULL);
+    *buffer = VK_NULL_HANDLE;
+    return false;
+}
 
 static bool
-create_framebuffers(struct server_vk *vk) {
-    vk->swapchain.framebuffers = zalloc(vk->swapchain.image_count, sizeof(VkFramebuffer));
+create_uploader(struct server_vk *vk) {
+    vk->upload.concurrent = vk->transfer_family != vk->graphics_family;
 
-    for (uint32_t i = 0; i < vk->swapchain.image_count; i++) {
-        VkFramebufferCreateInfo create_info = {
-            .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
-            .renderPass = vk->render_pass,
-            .attachmentCount = 1,
-            .pAttachments = &vk->swapchain.views[i],
-            .width = vk->swapchain.extent.width,
-            .height = vk->swapchain.extent.height,
-            .layers = 1,
-        };
+    VkSemaphoreTypeCreateInfo type_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+        .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+        .initialValue = 0,
+    };
+    VkSemaphoreCreateInfo sem_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        .pNext = &type_info,
+    };
 
-        VkResult result = vkCreateFramebuffer(vk->device, &create_info, NULL,
-                                               &vk->swapchain.framebuffers[i]);
-        if (result != VK_SUCCESS) {
-            vk_log(LOG_ERROR, "failed to create framebuffer");
-            return false;
-        }
+    VkResult result = vkCreateSemaphore(vk->device, &sem_info, NULL, &vk->upload.timeline);
+    vk_check(result, "failed to create upload timeline semaphore");
+    result = vkCreateSemaphore(vk->device, &sem_info, NULL, &vk->upload.frame_timeline);
+    vk_check(result, "failed to create frame timeline semaphore");
+
+    void *mapped = NULL;
+    if (!create_host_buffer(vk, VK_STAGING_RING_SIZE, &vk->upload.ring, &vk->upload.ring_memory, &mapped)) {
+        vk_log(LOG_ERROR, "failed to create staging ring");
+        return false;
     }
+    vk->upload.ring_mapped = mapped;
 
+    vk_log(LOG_INFO, "created staging ring (%d MiB, %s transfer queue)", VK_STAGING_RING_SIZE / (1024 * 1024),
+           vk->upload.concurrent ? "dedicated" : "shared");
     return true;
 }
 
-// ============================================================================
-// Command Pool and Buffers
-// ============================================================================
+static void
+upload_batch_destroy(struct server_vk *vk, struct vk_upload_batch *batch) {
+    struct vk_staging_buffer *staging, *tmp;
+    wl_list_for_each_safe(staging, tmp, &batch->staging, link) {
+        vkFreeMemory(vk->device, staging->memory, NULL);
+        vkDestroyBuffer(vk->device, staging->buffer, NULL);
+        wl_list_remove(&staging->link);
+        free(staging);
+    }
+
+    vkFreeCommandBuffers(vk->device, vk->transfer_pool, 1, &batch->cmd);
+    wl_list_remove(&batch->link);
+    free(batch);
+}
 
-static bool
-create_command_pool(struct server_vk *vk) {
-    VkCommandPoolCreateInfo create_info = {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
-        .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
-        .queueFamilyIndex = vk->graphics_family,
-    };
+// Must be called after the device is idle.
+static void
+destroy_uploader(struct server_vk *vk) {
+    if (vk->upload.open) {
+        upload_batch_destroy(vk, vk->upload.open);
+        vk->upload.open = NULL;
+    }
 
-    VkResult result = vkCreateCommandPool(vk->device, &create_info, NULL, &vk->command_pool);
-    vk_check(result, "failed to create command pool");
+    struct vk_upload_batch *batch, *tmp;
+    wl_list_for_each_safe(batch, tmp, &vk->upload.batches, link) {
+        upload_batch_destroy(vk, batch);
+    }
 
-    VkCommandBufferAllocateInfo alloc_info = {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-        .commandPool = vk->command_pool,
-        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-        .commandBufferCount = VK_MAX_FRAMES_IN_FLIGHT,
-    };
+    if (vk->upload.ring_memory) {
+        vkFreeMemory(vk->device, vk->upload.ring_memory, NULL);
+    }
+    if (vk->upload.ring) {
+        vkDestroyBuffer(vk->device, vk->upload.ring, NULL);
+    }
+    if (vk->upload.timeline) {
+        vkDestroySemaphore(vk->device, vk->upload.timeline, NULL);
+    }
+    if (vk->upload.frame_timeline) {
+        vkDestroySemaphore(vk->device, vk->upload.frame_timeline, NULL);
+    }
+    if (vk->transfer_pool) {
+        vkDestroyCommandPool(vk->device, vk->transfer_pool, NULL);
+    }
+}
 
-    result = vkAllocateCommandBuffers(vk->device, &alloc_info, vk->command_buffers);
-    vk_check(result, "failed to allocate command buffers");
+// Frees every batch the transfer queue has finished with.
+static void
+upload_retire(struct server_vk *vk) {
+    if (wl_list_empty(&vk->upload.batches)) {
+        return;
+    }
 
-    return true;
-}
+    uint64_t completed = 0;
+    if (vkGetSemaphoreCounterValue(vk->device, vk->upload.timeline, &completed) != VK_SUCCESS) {
+        return;
+    }
 
-// ============================================================================
-// Synchronization Objects
-// ============================================================================
+    struct vk_upload_batch *batch, *tmp;
+    wl_list_for_each_safe(batch, tmp, &vk->upload.batches, link) {
+        if (batch->value > completed) {
+            break;
+        }
+        vk->upload.tail = batch->ring_end;
+        upload_batch_destroy(vk, batch);
+    }
+}
 
+// Submits the copies recorded since the last flush. They start once the GPU has finished with the
+// last submitted frame, so they cannot overwrite a texture which is still being sampled.
 static bool
-create_sync_objects(struct server_vk *vk) {
-    VkSemaphoreCreateInfo sem_info = {
-        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
-    };
+upload_flush(struct server_vk *vk) {
+    struct vk_upload_batch *batch = vk->upload.open;
+    if (!batch) {
+        return true;
+    }
+    vk->upload.open = NULL;
 
-    VkFenceCreateInfo fence_info = {
-        .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
-        .flags = VK_FENCE_CREATE_SIGNALED_BIT,  // Start signaled
+    vkEndCommandBuffer(batch->cmd);
+    batch->value = vk->upload.submitted + 1;
+    batch->ring_end = vk->upload.head;
+
+    uint64_t wait_value = vk->upload.frames_submitted;
+    VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    VkTimelineSemaphoreSubmitInfo timeline_info = {
+        .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+        .waitSemaphoreValueCount = 1,
+        .pWaitSemaphoreValues = &wait_value,
+        .signalSemaphoreValueCount = 1,
+        .pSignalSemaphoreValues = &batch->value,
+    };
+    VkSubmitInfo submit = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = &timeline_info,
+        .waitSemaphoreCount = 1,
+        .pWaitSemaphores = &vk->upload.frame_timeline,
+        .pWaitDstStageMask = &wait_stage,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &batch->cmd,
+        .signalSemaphoreCount = 1,
+        .pSignalSemaphores = &vk->upload.timeline,
     };
 
-    for (int i = 0; i < VK_MAX_FRAMES_IN_FLIGHT; i++) {
-        if (vkCreateSemaphore(vk->device, &sem_info, NULL, &vk->image_available[i]) != VK_SUCCESS ||
-            vkCreateSemaphore(vk->device, &sem_info, NULL, &vk->render_finished[i]) != VK_SUCCESS ||
-            vkCreateFence(vk->device, &fence_info, NULL, &vk->in_flight[i]) != VK_SUCCESS) {
-            vk_log(LOG_ERROR, "failed to create sync objects");
-            return false;
-        }
+    VkResult result = vkQueueSubmit(vk->transfer_queue, 1, &submit, VK_NULL_HANDLE);
+    if (result != VK_SUCCESS) {
+        // Nothing in the batch will execute. Its part of the ring is released along with the next
+        // batch which completes.
+        vk_log(LOG_ERROR, "failed to submit texture uploads: %d", (int)result);
+        upload_batch_destroy(vk, batch);
+        return false;
     }
 
+    vk->upload.submitted = batch->value;
+    wl_list_insert(vk->upload.batches.prev, &batch->link);
     return true;
 }
 
-// ============================================================================
-// Sampler
-// ============================================================================
-
+// Blocks until every submitted upload has completed. Only used when the CPU needs to read back
+// texture contents.
 static bool
-create_sampler(struct server_vk *vk) {
-    VkSamplerCreateInfo create_info = {
-        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
-        .magFilter = VK_FILTER_NEAREST,
-        .minFilter = VK_FILTER_NEAREST,
-        .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
-        .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
-        .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
-        .anisotropyEnable = VK_FALSE,
-        .borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK,
-        .unnormalizedCoordinates = VK_FALSE,
-        .compareEnable = VK_FALSE,
-        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
-    };
-
-    VkResult result = vkCreateSampler(vk->device, &create_info, NULL, &vk->sampler);
-    vk_check(result, "failed to create sampler");
+upload_wait(struct server_vk *vk) {
+    if (!upload_flush(vk)) {
+        return false;
+    }
 
-    return true;
+    VkSemaphoreWaitInfo wait_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+        .semaphoreCount = 1,
+        .pSemaphores = &vk->upload.timeline,
+        .pValues = &vk->upload.submitted,
+    };
+    return vkWaitSemaphores(vk->device, &wait_info, UINT64_MAX) == VK_SUCCESS;
 }
 
-// ============================================================================
-// Descriptor Pool
-// ============================================================================
+static struct vk_upload_batch *
+upload_begin(struct server_vk *vk) {
+    if (vk->upload.open) {
+        return vk->upload.open;
+    }
 
-static bool
-create_descriptor_pool(struct server_vk *vk) {
-    VkDescriptorPoolSize pool_sizes[] = {
-        {
-            .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-            .descriptorCount = 100,
-        },
-        {
-            .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-            .descriptorCount = 100,
-        },
+    upload_retire(vk);
+
+    VkCommandBufferAllocateInfo cmd_alloc = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .commandPool = vk->transfer_pool,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = 1,
     };
+    VkCommandBuffer cmd = VK_NULL_HANDLE;
+    if (vkAllocateCommandBuffers(vk->device, &cmd_alloc, &cmd) != VK_SUCCESS) {
+        vk_log(LOG_ERROR, "failed to allocate upload command buffer");
+        return NULL;
+    }
 
-    VkDescriptorPoolCreateInfo create_info = {
-        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-        .flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
-        .maxSets = 200,
-        .poolSizeCount = ARRAY_LEN(pool_sizes),
-        .pPoolSizes = pool_sizes,
+    VkCommandBufferBeginInfo begin_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
     };
+    vkBeginCommandBuffer(cmd, &begin_info);
 
-    VkResult result = vkCreateDescriptorPool(vk->device, &create_info, NULL, &vk->descriptor_pool);
-    vk_check(result, "failed to create descriptor pool");
+    struct vk_upload_batch *batch = zalloc(1, sizeof(*batch));
+    batch->cmd = cmd;
+    wl_list_init(&batch->link);
+    wl_list_init(&batch->staging);
 
-    return true;
+    vk->upload.open = batch;
+    return batch;
 }
 
-// ============================================================================
-// Fullscreen Quad Vertex Buffer
-// ============================================================================
-
-// Simple fullscreen quad vertices (position + texcoord)
-struct quad_vertex {
-    float pos[2];
-    float uv[2];
-};
-
-static const struct quad_vertex QUAD_VERTICES[] = {
-    // First triangle (top-left, bottom-left, bottom-right)
-    {{ -1.0f, -1.0f }, { 0.0f, 0.0f }},
-    {{ -1.0f,  1.0f }, { 0.0f, 1.0f }},
-    {{  1.0f,  1.0f }, { 1.0f, 1.0f }},
-    // Second triangle (top-left, bottom-right, top-right)
-    {{ -1.0f, -1.0f }, { 0.0f, 0.0f }},
-    {{  1.0f,  1.0f }, { 1.0f, 1.0f }},
-    {{  1.0f, -1.0f }, { 1.0f, 0.0f }},
-};
-
+// Allocates size bytes of staging memory for the open batch.
 static bool
-create_quad_vertex_buffer(struct server_vk *vk) {
-    VkDeviceSize buffer_size = sizeof(QUAD_VERTICES);
+upload_alloc(struct server_vk *vk, struct vk_upload_batch *batch, VkDeviceSize size, VkBuffer *buffer,
+             VkDeviceSize *offset, void **mapped) {
+    size = (size + VK_STAGING_ALIGN - 1) & ~(VkDeviceSize)(VK_STAGING_ALIGN - 1);
+    batch->size += size;
+
+    if (size <= VK_STAGING_RING_SIZE) {
+        upload_retire(vk);
+
+        // Allocations never wrap around the end of the ring. The skipped bytes are released with
+        // the batch.
+        uint64_t head = vk->upload.head;
+        uint64_t pos = head % VK_STAGING_RING_SIZE;
+        if (pos + size > VK_STAGING_RING_SIZE) {
+            head += VK_STAGING_RING_SIZE - pos;
+            pos = 0;
+        }
 
-    VkBufferCreateInfo buffer_info = {
-        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-        .size = buffer_size,
-        .usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
-    };
+        if (head + size - vk->upload.tail <= VK_STAGING_RING_SIZE) {
+            vk->upload.head = head + size;
+            *buffer = vk->upload.ring;
+            *offset = pos;
+            *mapped = vk->upload.ring_mapped + pos;
+            return true;
+        }
+    }
 
-    VkResult result = vkCreateBuffer(vk->device, &buffer_info, NULL, &vk->quad_vertex_buffer);
-    if (result != VK_SUCCESS) {
-        vk_log(LOG_ERROR, "failed to create quad vertex buffer");
+    struct vk_staging_buffer *staging = zalloc(1, sizeof(*staging));
+    if (!create_host_buffer(vk, size, &staging->buffer, &staging->memory, mapped)) {
+        vk_log(LOG_ERROR, "failed to allocate %zu byte staging buffer", (size_t)size);
+        free(staging);
         return false;
     }
+    wl_list_insert(batch->staging.prev, &staging->link);
 
-    VkMemoryRequirements mem_reqs;
-    vkGetBufferMemoryRequirements(vk->device, vk->quad_vertex_buffer, &mem_reqs);
+    *buffer = staging->buffer;
+    *offset = 0;
+    return true;
+}
 
-    uint32_t mem_type = find_memory_type(vk, mem_reqs.memoryTypeBits,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+// Records a copy of RGBA pixels into a region of one layer of a device-local image. src_stride is
+// the distance between rows of rgba in bytes. If initialized is false, the previous contents of the
+// layer are discarded. The layer is left in SHADER_READ_ONLY_OPTIMAL layout, and the copy is
+// submitted with the next frame.
+static bool
+upload_image_region(struct server_vk *vk, VkImage image, bool initialized, uint32_t layer, uint32_t x,
+                    uint32_t y, uint32_t width, uint32_t height, const unsigned char *rgba, size_t src_stride) {
+    struct vk_upload_batch *batch = upload_begin(vk);
+    if (!batch) {
+        return false;
+    }
 
-    if (mem_type == UINT32_MAX) {
-        vk_log(LOG_ERROR, "no suitable memory type for quad vertex buffer");
+    const size_t row_size = (size_t)width * 4;
+    VkBuffer buffer;
+    VkDeviceSize offset;
+    void *mapped;
+    if (!upload_alloc(vk, batch, (VkDeviceSize)row_size * height, &buffer, &offset, &mapped)) {
         return false;
     }
 
-    VkMemoryAllocateInfo alloc_info = {
-        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-        .allocationSize = mem_reqs.size,
-        .memoryTypeIndex = mem_type,
-    };
-
-    result = vkAllocateMemory(vk->device, &alloc_info, NULL, &vk->quad_vertex_memory);
-    if (result != VK_SUCCESS) {
-        vk_log(LOG_ERROR, "failed to allocate quad vertex memory");
-        return false;
+    unsigned char *dst = mapped;
+    for (uint32_t row = 0; row < height; row++) {
+        memcpy(dst + row * row_size, rgba + row * src_stride, row_size);
     }
 
-    vkBindBufferMemory(vk->device, vk->quad_vertex_buffer, vk->quad_vertex_memory, 0);
-
-    // Copy vertex data
-    void *data;
-    vkMapMemory(vk->device, vk->quad_vertex_memory, 0, buffer_size, 0, &data);
-    memcpy(data, QUAD_VERTICES, buffer_size);
-    vkUnmapMemory(vk->device, vk->quad_vertex_memory);
-
-    vk_log(LOG_INFO, "created quad vertex buffer");
-    return true;
-}
-
-// ============================================================================
-// Pipeline Creation
-// ============================================================================
-
-// Push constant layout for vertex shader
-struct vk_push_constants {
-    float src_size[2];
-    float dst_size[2];
-};
-
-static VkShaderModule
-create_shader_module(VkDevice device, const uint32_t *code, size_t size) {
-    VkShaderModuleCreateInfo create_info = {
-        .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
-        .codeSize = size,
-        .pCode = code,
+    VkImageSubresourceRange range = {
+        .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+        .baseMipLevel = 0,
+        .levelCount = 1,
+        .baseArrayLayer = layer,
+        .layerCount = 1,
     };
 
-    VkShaderModule module;
-    if (vkCreateShaderModule(device, &create_info, NULL, &module) != VK_SUCCESS) {
-        return VK_NULL_HANDLE;
-    }
-    return module;
-}
-
-static bool
-create_descriptor_set_layout(struct server_vk *vk, VkDescriptorSetLayout *layout) {
-    VkDescriptorSetLayoutBinding binding = {
-        .binding = 0,
-        .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-        .descriptorCount = 1,
-        .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+    // Rendering is ordered against the copy by the timeline semaphores, so the barriers only need
+    // to cover earlier copies into the same image.
+    VkImageMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask = initialized ? VK_ACCESS_TRANSFER_WRITE_BIT : 0,
+        .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .oldLayout = initialized ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED,
+        .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = image,
+        .subresourceRange = range,
     };
+    vkCmdPipelineBarrier(batch->cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0,
+                         NULL, 0, NULL, 1, &barrier);
 
-    VkDescriptorSetLayoutCreateInfo layout_info = {
-        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-        .bindingCount = 1,
-        .pBindings = &binding,
+    VkBufferImageCopy region = {
+        .bufferOffset = offset,
+        .bufferRowLength = 0,
+        .bufferImageHeight = 0,
+        .imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, layer, 1 },
+        .imageOffset = { (int32_t)x, (int32_t)y, 0 },
+        .imageExtent = { width, height, 1 },
     };
+    vkCmdCopyBufferToImage(batch->cmd, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
 
-    return vkCreateDescriptorSetLayout(vk->device, &layout_info, NULL, layout) == VK_SUCCESS;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = 0;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    vkCmdPipelineBarrier(batch->cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0,
+                         NULL, 0, NULL, 1, &barrier);
+
+    // Don't let a burst of uploads hold on to most of the ring until the next frame.
+    if (batch->size >= VK_STAGING_RING_SIZE / 2) {
+        upload_flush(vk);
+    }
+    return true;
 }
 
+// Copies the contents of the first layer of an image into out, which must hold width * height * 4 bytes. Blocks until
+// the copy has completed.
 static bool
-create_texcopy_pipeline(struct server_vk *vk) {
-    // Create shader modules
-    vk->texcopy_pipeline.vert = create_shader_module(vk->device, texcopy_vert_spv, texcopy_vert_spv_size);
-    vk->texcopy_pipeline.frag = create_shader_module(vk->device, texcopy_frag_spv, texcopy_frag_spv_size);
-
-    if (!vk->texcopy_pipeline.vert || !vk->texcopy_pipeline.frag) {
-        vk_log(LOG_ERROR, "failed to create shader modules");
+download_image(struct server_vk *vk, VkImage image, uint32_t width, uint32_t height, unsigned char *out) {
+    struct vk_upload_batch *batch = upload_begin(vk);
+    if (!batch) {
         return false;
     }
 
-    // Create descriptor set layout
-    if (!create_descriptor_set_layout(vk, &vk->texcopy_pipeline.descriptor_layout)) {
-        vk_log(LOG_ERROR, "failed to create descriptor set layout");
+    const size_t size = (size_t)width * height * 4;
+    VkBuffer buffer;
+    VkDeviceSize offset;
+    void *mapped;
+    if (!upload_alloc(vk, batch, size, &buffer, &offset, &mapped)) {
         return false;
     }
 
-    // Push constant range
-    VkPushConstantRange push_constant = {
-        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
-        .offset = 0,
-        .size = sizeof(struct vk_push_constants),
+    VkImageMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+        .oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        .newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = image,
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        },
     };
+    vkCmdPipelineBarrier(batch->cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0,
+                         NULL, 0, NULL, 1, &barrier);
 
-    // Pipeline layout
-    VkPipelineLayoutCreateInfo layout_info = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-        .setLayoutCount = 1,
-        .pSetLayouts = &vk->texcopy_pipeline.descriptor_layout,
-        .pushConstantRangeCount = 1,
-        .pPushConstantRanges = &push_constant,
+    VkBufferImageCopy region = {
+        .bufferOffset = offset,
+        .imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 },
+        .imageOffset = { 0, 0, 0 },
+        .imageExtent = { width, height, 1 },
     };
+    vkCmdCopyImageToBuffer(batch->cmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buffer, 1, &region);
 
-    if (vkCreatePipelineLayout(vk->device, &layout_info, NULL, &vk->texcopy_pipeline.layout) != VK_SUCCESS) {
-        vk_log(LOG_ERROR, "failed to create pipeline layout");
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = 0;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    VkBufferMemoryBarrier host_barrier = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .buffer = buffer,
+        .offset = offset,
+        .size = size,
+    };
+    vkCmdPipelineBarrier(batch->cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0, 0, NULL, 1,
+                         &host_barrier, 1, &barrier);
+
+    // The staging memory stays valid until the next allocation retires the batch.
+    if (!upload_wait(vk)) {
         return false;
     }
+    memcpy(out, mapped, size);
+    return true;
+}
 
-    // Shader stages
-    VkPipelineShaderStageCreateInfo shader_stages[] = {
-        {
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-            .stage = VK_SHADER_STAGE_VERTEX_BIT,
-            .module = vk->texcopy_pipeline.vert,
-            .pName = "main",
-        },
-        {
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-            .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
-            .module = vk->texcopy_pipeline.frag,
-            .pName = "main",
-        },
-    };
-
-    // Vertex input - matches the GL vertex layout
-    VkVertexInputBindingDescription binding = {
-        .binding = 0,
-        .stride = sizeof(float) * 12,  // v_src_pos(2) + v_dst_pos(2) + v_src_rgba(4) + v_dst_rgba(4)
-        .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
-    };
+// ============================================================================
+// Damage Tracking
+// ============================================================================
 
-    VkVertexInputAttributeDescription attributes[] = {
-        { .location = 0, .binding = 0, .format = VK_FORMAT_R32G32_SFLOAT, .offset = 0 },                    // v_src_pos
-        { .location = 1, .binding = 0, .format = VK_FORMAT_R32G32_SFLOAT, .offset = sizeof(float) * 2 },    // v_dst_pos
-        { .location = 2, .binding = 0, .format = VK_FORMAT_R32G32B32A32_SFLOAT, .offset = sizeof(float) * 4 },  // v_src_rgba
-        { .location = 3, .binding = 0, .format = VK_FORMAT_R32G32B32A32_SFLOAT, .offset = sizeof(float) * 8 },  // v_dst_rgba
-    };
+static inline bool
+damage_empty(const struct vk_damage *damage) {
+    return !damage->full && (damage->x2 <= damage->x1 || damage->y2 <= damage->y1);
+}
 
-    VkPipelineVertexInputStateCreateInfo vertex_input = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
-        .vertexBindingDescriptionCount = 1,
-        .pVertexBindingDescriptions = &binding,
-        .vertexAttributeDescriptionCount = ARRAY_LEN(attributes),
-        .pVertexAttributeDescriptions = attributes,
-    };
+static void
+damage_union(struct vk_damage *damage, int32_t x1, int32_t y1, int32_t x2, int32_t y2) {
+    if (damage->full || x2 <= x1 || y2 <= y1) {
+        return;
+    }
 
-    // Input assembly - triangles
-    VkPipelineInputAssemblyStateCreateInfo input_assembly = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
-        .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
-        .primitiveRestartEnable = VK_FALSE,
-    };
+    if (damage_empty(damage)) {
+        *damage = (struct vk_damage){ .x1 = x1, .y1 = y1, .x2 = x2, .y2 = y2 };
+        return;
+    }
 
-    // Dynamic viewport and scissor
-    VkDynamicState dynamic_states[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
-    VkPipelineDynamicStateCreateInfo dynamic_state = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
-        .dynamicStateCount = ARRAY_LEN(dynamic_states),
-        .pDynamicStates = dynamic_states,
-    };
+    damage->x1 = damage->x1 < x1 ? damage->x1 : x1;
+    damage->y1 = damage->y1 < y1 ? damage->y1 : y1;
+    damage->x2 = damage->x2 > x2 ? damage->x2 : x2;
+    damage->y2 = damage->y2 > y2 ? damage->y2 : y2;
+}
 
-    VkPipelineViewportStateCreateInfo viewport_state = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
-        .viewportCount = 1,
-        .scissorCount = 1,
-    };
+// Marks a window-space rectangle as changed, both for the next present and for every
+// swapchain image (each has to catch up on it the next time it is drawn).
+static void
+damage_rect(struct server_vk *vk, int32_t x, int32_t y, int32_t width, int32_t height) {
+    int32_t x1 = x > 0 ? x : 0;
+    int32_t y1 = y > 0 ? y : 0;
+    int32_t x2 = x + width;
+    int32_t y2 = y + height;
+    if (x2 > (int32_t)vk->swapchain.extent.width) x2 = (int32_t)vk->swapchain.extent.width;
+    if (y2 > (int32_t)vk->swapchain.extent.height) y2 = (int32_t)vk->swapchain.extent.height;
+
+    damage_union(&vk->damage.frame, x1, y1, x2, y2);
+    for (uint32_t i = 0; i < vk->swapchain.image_count && vk->damage.images; i++) {
+        damage_union(&vk->damage.images[i], x1, y1, x2, y2);
+    }
+}
 
-    // Rasterization
-    VkPipelineRasterizationStateCreateInfo rasterization = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
-        .depthClampEnable = VK_FALSE,
-        .rasterizerDiscardEnable = VK_FALSE,
-        .polygonMode = VK_POLYGON_MODE_FILL,
-        .lineWidth = 1.0f,
-        .cullMode = VK_CULL_MODE_NONE,
-        .frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE,
-        .depthBiasEnable = VK_FALSE,
-    };
+static void
+damage_box(struct server_vk *vk, const struct box *box) {
+    damage_rect(vk, box->x, box->y, box->width, box->height);
+}
 
-    // Multisampling disabled
-    VkPipelineMultisampleStateCreateInfo multisampling = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
-        .sampleShadingEnable = VK_FALSE,
-        .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
-    };
+static void
+damage_full(struct server_vk *vk) {
+    vk->damage.frame.full = true;
+    for (uint32_t i = 0; i < vk->swapchain.image_count && vk->damage.images; i++) {
+        vk->damage.images[i].full = true;
+    }
+}
 
-    // Color blending - standard alpha blending
-    VkPipelineColorBlendAttachmentState blend_attachment = {
-        .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
-                          VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
-        .blendEnable = VK_TRUE,
-        .srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA,
-        .dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
-        .colorBlendOp = VK_BLEND_OP_ADD,
-        .srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
-        .dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
-        .alphaBlendOp = VK_BLEND_OP_ADD,
-    };
+// Translates the damage of a capture surface commit into window space. The game is
+// drawn centered (see draw_captured_frame), so game pixels map to the window by a
+// constant offset. Mirrors whose source overlaps the damage are damaged as well.
+static void
+damage_capture(struct server_vk *vk, struct server_surface *surface, struct vk_buffer *buffer) {
+    if (buffer->width != vk->damage.capture_width || buffer->height != vk->damage.capture_height) {
+        vk->damage.capture_width = buffer->width;
+        vk->damage.capture_height = buffer->height;
+        damage_full(vk);
+        return;
+    }
 
-    VkPipelineColorBlendStateCreateInfo color_blending = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
-        .logicOpEnable = VK_FALSE,
-        .attachmentCount = 1,
-        .pAttachments = &blend_attachment,
-    };
+    struct vk_damage game = {0};
+    struct server_surface_damage *dmg;
+    if (surface->pending.present & SURFACE_STATE_DAMAGE) {
+        wl_array_for_each(dmg, &surface->pending.damage) {
+            damage_union(&game, dmg->x, dmg->y, dmg->x + dmg->width, dmg->y + dmg->height);
+        }
+    }
+    if (surface->pending.present & SURFACE_STATE_DAMAGE_BUFFER) {
+        wl_array_for_each(dmg, &surface->pending.buffer_damage) {
+            damage_union(&game, dmg->x, dmg->y, dmg->x + dmg->width, dmg->y + dmg->height);
+        }
+    }
 
-    // Create the pipeline
-    VkGraphicsPipelineCreateInfo pipeline_info = {
-        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
-        .stageCount = ARRAY_LEN(shader_stages),
-        .pStages = shader_stages,
-        .pVertexInputState = &vertex_input,
-        .pInputAssemblyState = &input_assembly,
-        .pViewportState = &viewport_state,
-        .pRasterizationState = &rasterization,
-        .pMultisampleState = &multisampling,
-        .pColorBlendState = &color_blending,
-        .pDynamicState = &dynamic_state,
-        .layout = vk->texcopy_pipeline.layout,
-        .renderPass = vk->render_pass,
-        .subpass = 0,
-    };
+    // A new buffer without any damage is treated as fully damaged, rather than trusting
+    // every client to follow the protocol.
+    bool any_damage = surface->pending.present & (SURFACE_STATE_DAMAGE | SURFACE_STATE_DAMAGE_BUFFER);
+    if (!any_damage && (surface->pending.present & SURFACE_STATE_BUFFER)) {
+        game = (struct vk_damage){ .x2 = buffer->width, .y2 = buffer->height };
+    }
 
-    VkResult result = vkCreateGraphicsPipelines(vk->device, VK_NULL_HANDLE, 1, &pipeline_info,
-                                                 NULL, &vk->texcopy_pipeline.pipeline);
-    if (result != VK_SUCCESS) {
-        vk_log(LOG_ERROR, "failed to create texcopy pipeline: %d", result);
-        return false;
+    if (game.x1 < 0) game.x1 = 0;
+    if (game.y1 < 0) game.y1 = 0;
+    if (game.x2 > buffer->width) game.x2 = buffer->width;
+    if (game.y2 > buffer->height) game.y2 = buffer->height;
+    if (damage_empty(&game)) {
+        return;
     }
 
-    vk_log(LOG_INFO, "created texcopy pipeline");
-    return true;
+    int32_t off_x = ((int32_t)vk->swapchain.extent.width / 2) - (buffer->width / 2);
+    int32_t off_y = ((int32_t)vk->swapchain.extent.height / 2) - (buffer->height / 2);
+    damage_rect(vk, game.x1 + off_x, game.y1 + off_y, game.x2 - game.x1, game.y2 - game.y1);
+
+    struct vk_mirror *mirror;
+    wl_list_for_each(mirror, &vk->mirrors, link) {
+        if (!mirror->enabled) {
+            continue;
+        }
+        if (mirror->src.x < game.x2 && mirror->src.x + mirror->src.width > game.x1 &&
+            mirror->src.y < game.y2 && mirror->src.y + mirror->src.height > game.y1) {
+            damage_box(vk, &mirror->dst);
+        }
+    }
 }
 
-static bool
-create_text_pipeline(struct server_vk *vk) {
+// ============================================================================
+// Swapchain Creation
+// ============================================================================
+
+static VkSurfaceFormatKHR
+choose_surface_format(VkPhysicalDevice device, VkSurfaceKHR surface) {
+    uint32_t count = 0;
+    vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &count, NULL);
+
+    VkSurfaceFormatKHR *formats = zalloc(count, sizeof(*formats));
+    vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &count, formats);
+
+    // Prefer BGRA8 UNORM (pass-through sRGB values without re-encoding)
+    VkSurfaceFormatKHR selected = formats[0];
+    for (uint32_t i = 0; i < count; i++) {
+        if (formats[i].format == VK_FORMAT_B8G8R8A8_UNORM &&
+            formats[i].colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
+            selected = formats[i];
+            break;
+        }
+        if (formats[i].format == VK_FORMAT_B8G8R8A8_SRGB) {
+            selected = formats[i];
+        }
+    }
+
+    free(formats);
+    return selected;
+}
+
+static VkPresentModeKHR
+choose_present_mode(VkPhysicalDevice device, VkSurfaceKHR surface) {
+    uint32_t count = 0;
+    vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &count, NULL);
+
+    VkPresentModeKHR *modes = zalloc(count, sizeof(*modes));
+    vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &count, modes);
+
+    // Optional override via env: WAYWALL_PRESENT_MODE=IMMEDIATE|MAILBOX|FIFO
+    VkPresentModeKHR forced = VK_PRESENT_MODE_MAX_ENUM_KHR;
+    const char *env_mode = getenv("WAYWALL_PRESENT_MODE");
+    if (env_mode) {
+        if (strcasecmp(env_mode, "IMMEDIATE") == 0) forced = VK_PRESENT_MODE_IMMEDIATE_KHR;
+        else if (strcasecmp(env_mode, "MAILBOX") == 0) forced = VK_PRESENT_MODE_MAILBOX_KHR;
+        else if (strcasecmp(env_mode, "FIFO") == 0) forced = VK_PRESENT_MODE_FIFO_KHR;
+    }
+
+    // Prefer IMMEDIATE (no vsync) > MAILBOX (low latency) > FIFO (vsync)
+    VkPresentModeKHR selected = VK_PRESENT_MODE_FIFO_KHR;  // Always available
+    for (uint32_t i = 0; i < count; i++) {
+        if (forced != VK_PRESENT_MODE_MAX_ENUM_KHR && modes[i] == forced) {
+            selected = modes[i];
+            break;
+        }
+        if (modes[i] == VK_PRESENT_MODE_IMMEDIATE_KHR) {
+            selected = VK_PRESENT_MODE_IMMEDIATE_KHR;
+            break;
+        }
+        if (modes[i] == VK_PRESENT_MODE_MAILBOX_KHR && selected != VK_PRESENT_MODE_IMMEDIATE_KHR) {
+            selected = VK_PRESENT_MODE_MAILBOX_KHR;
+        }
+    }
+
+    const char *sel_name = "UNKNOWN";
+    switch (selected) {
+    case VK_PRESENT_MODE_IMMEDIATE_KHR: sel_name = "IMMEDIATE"; break;
+    case VK_PRESENT_MODE_MAILBOX_KHR: sel_name = "MAILBOX"; break;
+    case VK_PRESENT_MODE_FIFO_KHR: sel_name = "FIFO"; break;
+    case VK_PRESENT_MODE_FIFO_RELAXED_KHR: sel_name = "FIFO_RELAXED"; break;
+    default: break;
+    }
+    if (forced != VK_PRESENT_MODE_MAX_ENUM_KHR) {
+        vk_log(LOG_INFO, "Present mode: forced %s (selected=%s)", env_mode ? env_mode : "?", sel_name);
+    } else {
+        vk_log(LOG_INFO, "Present mode: selected=%s", sel_name);
+    }
+
+    free(modes);
+    return selected;
+}
+
+static bool
+create_swapchain(struct server_vk *vk, uint32_t width, uint32_t height, VkSwapchainKHR old_swapchain) {
+    VkSurfaceCapabilitiesKHR caps;
+    vkGetPhysicalDeviceSurfaceCapabilitiesKHR(vk->physical_device, vk->swapchain.surface, &caps);
+
+    // Prefer BGRA8 UNORM (pass-through sRGB values without re-encoding)
+    VkSurfaceFormatKHR format = choose_surface_format(vk->physical_device, vk->swapchain.surface);
+    VkPresentModeKHR present_mode = choose_present_mode(vk->physical_device, vk->swapchain.surface);
+
+    // Clamp extent to surface capabilities
+    VkExtent2D extent = { width, height };
+    if (caps.currentExtent.width != UINT32_MAX) {
+        extent = caps.currentExtent;
+    } else {
+        extent.width = (extent.width < caps.minImageExtent.width) ? caps.minImageExtent.width :
+                       (extent.width > caps.maxImageExtent.width) ? caps.maxImageExtent.width :
+                       extent.width;
+        extent.height = (extent.height < caps.minImageExtent.height) ? caps.minImageExtent.height :
+                        (extent.height > caps.maxImageExtent.height) ? caps.maxImageExtent.height :
+                        extent.height;
+    }
+
+    // Request one more image than minimum for triple buffering
+    uint32_t image_count = caps.minImageCount + 1;
+    if (caps.maxImageCount > 0 && image_count > caps.maxImageCount) {
+        image_count = caps.maxImageCount;
+    }
+
+    // Check for transparent compositing support (for background visibility)
+    VkCompositeAlphaFlagBitsKHR composite_alpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+    if (caps.supportedCompositeAlpha & VK_COMPOSITE_ALPHA_PRE_MULTIPLIED_BIT_KHR) {
+        composite_alpha = VK_COMPOSITE_ALPHA_PRE_MULTIPLIED_BIT_KHR;
+    }
+
+    // Frames which only show the game copy it into the image (see Transfer Present).
+    VkImageUsageFlags usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    if (caps.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT) {
+        usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    }
+
+    VkSwapchainCreateInfoKHR create_info = {
+        .sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
+        .surface = vk->swapchain.surface,
+        .minImageCount = image_count,
+        .imageFormat = format.format,
+        .imageColorSpace = format.colorSpace,
+        .imageExtent = extent,
+        .imageArrayLayers = 1,
+        .imageUsage = usage,
+        .preTransform = caps.currentTransform,
+        .compositeAlpha = composite_alpha,
+        .presentMode = present_mode,
+        .clipped = VK_TRUE,
+        .oldSwapchain = old_swapchain,
+    };
+
+    uint32_t queue_families[] = { vk->graphics_family, vk->present_family };
+    if (vk->graphics_family != vk->present_family) {
+        create_info.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
+        create_info.queueFamilyIndexCount = 2;
+        create_info.pQueueFamilyIndices = queue_families;
+    } else {
+        create_info.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    }
+
+    VkResult result = vkCreateSwapchainKHR(vk->device, &create_info, NULL, &vk->swapchain.swapchain);
+    vk_check(result, "failed to create swapchain");
+
+    vk->swapchain.format = format.format;
+    vk->swapchain.extent = extent;
+    vk->swapchain.opaque = composite_alpha == VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+    vk->swapchain.transfer_dst = (usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT) != 0;
+
+    // Get swapchain images
+    vkGetSwapchainImagesKHR(vk->device, vk->swapchain.swapchain, &vk->swapchain.image_count, NULL);
+    vk->swapchain.images = zalloc(vk->swapchain.image_count, sizeof(VkImage));
+    vkGetSwapchainImagesKHR(vk->device, vk->swapchain.swapchain, &vk->swapchain.image_count,
+                            vk->swapchain.images);
+
+    // New images have undefined contents, so each one starts out fully damaged.
+    free(vk->damage.images);
+    vk->damage.images = zalloc(vk->swapchain.image_count, sizeof(*vk->damage.images));
+    damage_full(vk);
+
+    // Create image views
+    vk->swapchain.views = zalloc(vk->swapchain.image_count, sizeof(VkImageView));
+    for (uint32_t i = 0; i < vk->swapchain.image_count; i++) {
+        VkImageViewCreateInfo view_info = {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+            .image = vk->swapchain.images[i],
+            .viewType = VK_IMAGE_VIEW_TYPE_2D,
+            .format = vk->swapchain.format,
+            .components = {
+                .r = VK_COMPONENT_SWIZZLE_IDENTITY,
+                .g = VK_COMPONENT_SWIZZLE_IDENTITY,
+                .b = VK_COMPONENT_SWIZZLE_IDENTITY,
+                .a = VK_COMPONENT_SWIZZLE_IDENTITY,
+            },
+            .subresourceRange = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .baseMipLevel = 0,
+                .levelCount = 1,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+        };
+
+        result = vkCreateImageView(vk->device, &view_info, NULL, &vk->swapchain.views[i]);
+        if (result != VK_SUCCESS) {
+            vk_log(LOG_ERROR, "failed to create swapchain image view");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// ============================================================================
+// Render Pass
+// ============================================================================
+
+// Both render passes share the same attachment format and subpass, so they are
+// compatible with the same framebuffers and pipelines.
+static bool
+create_render_pass_with(struct server_vk *vk, VkAttachmentLoadOp load_op, VkRenderPass *out) {
+    bool load = load_op == VK_ATTACHMENT_LOAD_OP_LOAD;
+
+    VkAttachmentDescription color_attachment = {
+        .format = vk->swapchain.format,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .loadOp = load_op,
+        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+        .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+        .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+        .initialLayout = load ? VK_IMAGE_LAYOUT_PRESENT_SRC_KHR : VK_IMAGE_LAYOUT_UNDEFINED,
+        .finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+    };
+
+    VkAttachmentReference color_ref = {
+        .attachment = 0,
+        .layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+    };
+
+    VkSubpassDescription subpass = {
+        .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+        .colorAttachmentCount = 1,
+        .pColorAttachments = &color_ref,
+    };
+
+    VkSubpassDependency dependency = {
+        .srcSubpass = VK_SUBPASS_EXTERNAL,
+        .dstSubpass = 0,
+        .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+        .srcAccessMask = 0,
+        .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+        .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                         (load ? VK_ACCESS_COLOR_ATTACHMENT_READ_BIT : 0),
+    };
+
+    VkRenderPassCreateInfo create_info = {
+        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+        .attachmentCount = 1,
+        .pAttachments = &color_attachment,
+        .subpassCount = 1,
+        .pSubpasses = &subpass,
+        .dependencyCount = 1,
+        .pDependencies = &dependency,
+    };
+
+    VkResult result = vkCreateRenderPass(vk->device, &create_info, NULL, out);
+    vk_check(result, "failed to create render pass");
+
+    return true;
+}
+
+static bool
+create_render_pass(struct server_vk *vk) {
+    return create_render_pass_with(vk, VK_ATTACHMENT_LOAD_OP_CLEAR, &vk->render_pass) &&
+           create_render_pass_with(vk, VK_ATTACHMENT_LOAD_OP_LOAD, &vk->render_pass_load);
+}
+
+// ============================================================================
+// Framebuffers
+// ============================================================================
+
+static bool
+create_framebuffers(struct server_vk *vk) {
+    vk->swapchain.framebuffers = zalloc(vk->swapchain.image_count, sizeof(VkFramebuffer));
+
+    for (uint32_t i = 0; i < vk->swapchain.image_count; i++) {
+        VkFramebufferCreateInfo create_info = {
+            .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+            .renderPass = vk->render_pass,
+            .attachmentCount = 1,
+            .pAttachments = &vk->swapchain.views[i],
+            .width = vk->swapchain.extent.width,
+            .height = vk->swapchain.extent.height,
+            .layers = 1,
+        };
+
+        VkResult result = vkCreateFramebuffer(vk->device, &create_info, NULL,
+                                               &vk->swapchain.framebuffers[i]);
+        if (result != VK_SUCCESS) {
+            vk_log(LOG_ERROR, "failed to create framebuffer");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// ============================================================================
+// Command Pool and Buffers
+// ============================================================================
+
+static bool
+create_command_pool(struct server_vk *vk) {
+    VkCommandPoolCreateInfo create_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+        .queueFamilyIndex = vk->graphics_family,
+    };
+
+    VkResult result = vkCreateCommandPool(vk->device, &create_info, NULL, &vk->command_pool);
+    vk_check(result, "failed to create command pool");
+
+    VkCommandBufferAllocateInfo alloc_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .commandPool = vk->command_pool,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = VK_MAX_FRAMES_IN_FLIGHT,
+    };
+
+    result = vkAllocateCommandBuffers(vk->device, &alloc_info, vk->command_buffers);
+    vk_check(result, "failed to allocate command buffers");
+
+    return true;
+}
+
+// ============================================================================
+// Synchronization Objects
+// ============================================================================
+
+static bool
+create_sync_objects(struct server_vk *vk) {
+    VkSemaphoreCreateInfo sem_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+    };
+
+    VkFenceCreateInfo fence_info = {
+        .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+        .flags = VK_FENCE_CREATE_SIGNALED_BIT,  // Start signaled
+    };
+
+    for (int i = 0; i < VK_MAX_FRAMES_IN_FLIGHT; i++) {
+        if (vkCreateSemaphore(vk->device, &sem_info, NULL, &vk->image_available[i]) != VK_SUCCESS ||
+            vkCreateSemaphore(vk->device, &sem_info, NULL, &vk->render_finished[i]) != VK_SUCCESS ||
+            vkCreateFence(vk->device, &fence_info, NULL, &vk->in_flight[i]) != VK_SUCCESS) {
+            vk_log(LOG_ERROR, "failed to create sync objects");
+            return false;
+        }
+    }
+
+    // Capture buffers are released as soon as the frames reading them finish, which needs a
+    // sync_file to wake the event loop. Without one, they are released when begin_frame waits for
+    // the slot instead.
+    VkPhysicalDeviceExternalSemaphoreInfo external_info = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_SEMAPHORE_INFO,
+        .handleType = VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_SYNC_FD_BIT,
+    };
+    VkExternalSemaphoreProperties external_props = {
+        .sType = VK_STRUCTURE_TYPE_EXTERNAL_SEMAPHORE_PROPERTIES,
+    };
+    vkGetPhysicalDeviceExternalSemaphoreProperties(vk->physical_device, &external_info, &external_props);
+
+    vk->capture.release_signals = !vk->proxy_game && pfn_vkGetSemaphoreFdKHR &&
+                                  (external_props.externalSemaphoreFeatures &
+                                   VK_EXTERNAL_SEMAPHORE_FEATURE_EXPORTABLE_BIT);
+    if (!vk->capture.release_signals && !vk->proxy_game) {
+        vk_log(LOG_WARN, "sync_file export unsupported - capture buffers released on frame start");
+    }
+
+    for (int i = 0; i < VK_MAX_FRAMES_IN_FLIGHT; i++) {
+        if (!release_watch_create(vk, &vk->capture.release[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool
+release_watch_create(struct server_vk *vk, struct vk_release_watch *watch) {
+    watch->vk = vk;
+    watch->fd = -1;
+    if (!vk->capture.release_signals) {
+        return true;
+    }
+
+    VkExportSemaphoreCreateInfo export_info = {
+        .sType = VK_STRUCTURE_TYPE_EXPORT_SEMAPHORE_CREATE_INFO,
+        .handleTypes = VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_SYNC_FD_BIT,
+    };
+    VkSemaphoreCreateInfo sem_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        .pNext = &export_info,
+    };
+    if (vkCreateSemaphore(vk->device, &sem_info, NULL, &watch->semaphore) != VK_SUCCESS) {
+        vk_log(LOG_ERROR, "failed to create release semaphore");
+        return false;
+    }
+    return true;
+}
+
+static void
+release_watch_disarm(struct vk_release_watch *watch) {
+    if (!watch->src) {
+        return;
+    }
+
+    wl_event_source_remove(watch->src);
+    watch->src = NULL;
+    close(watch->fd);
+    watch->fd = -1;
+}
+
+// Watches the submission which was just made with watch->semaphore in its signal list. Exporting
+// the sync_file also unsignals the semaphore, so the next submission can signal it again.
+static void
+release_watch_arm(struct server_vk *vk, struct vk_release_watch *watch) {
+    if (!vk->capture.release_signals || !watch->semaphore) {
+        return;
+    }
+    release_watch_disarm(watch);
+
+    VkSemaphoreGetFdInfoKHR fd_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_GET_FD_INFO_KHR,
+        .semaphore = watch->semaphore,
+        .handleType = VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_SYNC_FD_BIT,
+    };
+    int fd = -1;
+    if (pfn_vkGetSemaphoreFdKHR(vk->device, &fd_info, &fd) != VK_SUCCESS) {
+        // The semaphore can't be signalled again without being exported, so stop using it.
+        vk_log(LOG_ERROR, "failed to export release sync_file - capture buffers released on frame start");
+        vk->capture.release_signals = false;
+        return;
+    }
+
+    // -1 means the submission has already finished. Whatever it held is released by the next
+    // signal or begin_frame.
+    if (fd == -1) {
+        return;
+    }
+
+    struct wl_event_loop *loop = wl_display_get_event_loop(vk->server->display);
+    watch->fd = fd;
+    watch->src = wl_event_loop_add_fd(loop, fd, WL_EVENT_READABLE, handle_capture_release, watch);
+    check_alloc(watch->src);
+}
+
+static void
+release_watch_destroy(struct server_vk *vk, struct vk_release_watch *watch) {
+    release_watch_disarm(watch);
+    if (watch->semaphore) {
+        vkDestroySemaphore(vk->device, watch->semaphore, NULL);
+        watch->semaphore = VK_NULL_HANDLE;
+    }
+}
+
+// ============================================================================
+// Frame Timing
+// ============================================================================
+
+#define VK_FRAME_TRACE_MAGIC "WWFT"
+#define VK_FRAME_TRACE_VERSION 2
+
+static bool
+create_frame_timing(struct server_vk *vk) {
+    for (int i = 0; i < VK_MAX_FRAMES_IN_FLIGHT; i++) {
+        vk->timing.pending[i] = -1;
+        vk->timing.pending_copy[i].index = -1;
+    }
+
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(vk->physical_device, &props);
+
+    uint32_t family_count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(vk->physical_device, &family_count, NULL);
+    VkQueueFamilyProperties *families = zalloc(family_count, sizeof(*families));
+    vkGetPhysicalDeviceQueueFamilyProperties(vk->physical_device, &family_count, families);
+    uint32_t valid_bits =
+        vk->graphics_family < family_count ? families[vk->graphics_family].timestampValidBits : 0;
+    free(families);
+
+    // Timestamps are optional. Without them we still record CPU spans.
+    if (valid_bits == 0 || props.limits.timestampPeriod <= 0.0f) {
+        vk_log(LOG_INFO, "GPU timestamps unsupported on graphics queue, recording CPU timings only");
+    } else {
+        vk->timing.timestamp_period = props.limits.timestampPeriod;
+        vk->timing.timestamp_mask = valid_bits >= 64 ? UINT64_MAX : ((uint64_t)1 << valid_bits) - 1;
+
+        VkQueryPoolCreateInfo pool_info = {
+            .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+            .queryType = VK_QUERY_TYPE_TIMESTAMP,
+            .queryCount = VK_TS_COUNT * VK_MAX_FRAMES_IN_FLIGHT,
+        };
+        VkResult result = vkCreateQueryPool(vk->device, &pool_info, NULL, &vk->timing.query_pool);
+        vk_check(result, "failed to create timestamp query pool");
+    }
+
+    const char *trace_path = getenv("WAYWALL_VK_FRAME_TRACE");
+    if (trace_path && trace_path[0]) {
+        vk->timing.trace = fopen(trace_path, "wb");
+        if (!vk->timing.trace) {
+            vk_log(LOG_WARN, "failed to open frame trace '%s': %s", trace_path, strerror(errno));
+        } else {
+            // Header: magic, version, record size. Records follow back-to-back.
+            uint32_t header[2] = {VK_FRAME_TRACE_VERSION, sizeof(struct vk_frame_stats)};
+            fwrite(VK_FRAME_TRACE_MAGIC, 1, 4, vk->timing.trace);
+            fwrite(header, sizeof(header), 1, vk->timing.trace);
+            vk_log(LOG_INFO, "writing frame trace to '%s'", trace_path);
+        }
+    }
+
+    return true;
+}
+
+static void
+destroy_frame_timing(struct server_vk *vk) {
+    if (vk->timing.query_pool) {
+        vkDestroyQueryPool(vk->device, vk->timing.query_pool, NULL);
+        vk->timing.query_pool = VK_NULL_HANDLE;
+    }
+    if (vk->timing.trace) {
+        fclose(vk->timing.trace);
+        vk->timing.trace = NULL;
+    }
+}
+
+static inline void
+frame_timing_write_ts(struct server_vk *vk, VkCommandBuffer cmd, VkPipelineStageFlagBits stage,
+                      enum vk_timestamp ts) {
+    if (vk->timing.query_pool) {
+        vkCmdWriteTimestamp(cmd, stage, vk->timing.query_pool,
+                            vk->current_frame * VK_TS_COUNT + ts);
+    }
+}
+
+static void
+frame_timing_finish(struct server_vk *vk, struct vk_frame_stats *stats) {
+    if (vk->timing.trace) {
+        fwrite(stats, sizeof(*stats), 1, vk->timing.trace);
+    }
+}
+
+// Collects GPU timestamps for the given frame slot. Must only be called once the
+// slot's in_flight fence has signaled.
+static void
+frame_timing_resolve(struct server_vk *vk, uint32_t slot) {
+    int32_t index = vk->timing.pending[slot];
+    if (index < 0) {
+        return;
+    }
+    vk->timing.pending[slot] = -1;
+
+    struct vk_frame_stats *stats = &vk->timing.ring[index];
+    uint64_t ts[VK_TS_COUNT];
+    VkResult result = vkGetQueryPoolResults(vk->device, vk->timing.query_pool, slot * VK_TS_COUNT,
+                                            VK_TS_COUNT, sizeof(ts), ts, sizeof(ts[0]),
+                                            VK_QUERY_RESULT_64_BIT);
+    if (result == VK_SUCCESS) {
+        double period = vk->timing.timestamp_period;
+        uint64_t mask = vk->timing.timestamp_mask;
+#define TS_DELTA(a, b) (uint64_t)((double)((ts[b] - ts[a]) & mask) * period)
+        stats->gpu_acquire_ns = TS_DELTA(VK_TS_BEGIN, VK_TS_ACQUIRE);
+        stats->gpu_capture_ns = TS_DELTA(VK_TS_ACQUIRE, VK_TS_CAPTURE);
+        stats->gpu_overlays_ns = TS_DELTA(VK_TS_CAPTURE, VK_TS_OVERLAYS);
+        stats->gpu_release_ns = TS_DELTA(VK_TS_OVERLAYS, VK_TS_END);
+        stats->gpu_total_ns = TS_DELTA(VK_TS_BEGIN, VK_TS_END);
+#undef TS_DELTA
+        stats->gpu_valid = 1;
+    }
+
+    // The copy's queries are reused by the next copy into the same image, which may already have
+    // been submitted.
+    int32_t copy_index = vk->timing.pending_copy[slot].index;
+    vk->timing.pending_copy[slot].index = -1;
+    if (copy_index >= 0) {
+        struct vk_capture_copy *copy = &vk->capture_copy.copies[copy_index];
+        uint64_t copy_ts[2];
+        if (copy->timed && copy->value == vk->timing.pending_copy[slot].value &&
+            vkGetQueryPoolResults(vk->device, vk->capture_copy.query_pool, copy_index * 2, 2,
+                                  sizeof(copy_ts), copy_ts, sizeof(copy_ts[0]),
+                                  VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+            uint64_t ticks = (copy_ts[1] - copy_ts[0]) & vk->capture_copy.timestamp_mask;
+            stats->gpu_copy_ns = (uint64_t)((double)ticks * vk->capture_copy.timestamp_period);
+        }
+    }
+
+    import_tune_resolve(vk, slot, stats);
+    frame_timing_finish(vk, stats);
+}
+
+// Appends a ring entry for the frame that was just submitted and presented.
+static void
+frame_timing_record(struct server_vk *vk, uint64_t submit_start, uint64_t submit_end,
+                    uint64_t present_end) {
+    int32_t index = (int32_t)vk->timing.head;
+    struct vk_frame_stats *stats = &vk->timing.ring[index];
+
+    // Don't let a stale pending slot resolve into an entry that is being reused.
+    for (int i = 0; i < VK_MAX_FRAMES_IN_FLIGHT; i++) {
+        if (vk->timing.pending[i] == index) {
+            vk->timing.pending[i] = -1;
+        }
+    }
+
+    *stats = (struct vk_frame_stats){
+        .seq = vk->timing.seq++,
+        .commit_ns = vk->timing.commit_ns,
+        .submit_ns = submit_start,
+        .present_ns = present_end,
+        .cpu_record_ns = submit_start - vk->timing.begin_ns,
+        .cpu_submit_ns = submit_end - submit_start,
+        .cpu_present_ns = present_end - submit_end,
+    };
+    vk->timing.commit_ns = 0;
+
+    int32_t sampled = vk->capture_copy.sampled;
+    if (sampled >= 0) {
+        struct vk_capture_copy *copy = &vk->capture_copy.copies[sampled];
+        uint64_t completed = 0;
+        vkGetSemaphoreCounterValue(vk->device, vk->capture_copy.timeline, &completed);
+
+        stats->copy_submit_ns = copy->submit_ns;
+        stats->copy_pending = completed < copy->value;
+        stats->copy_valid = 1;
+
+        vk->timing.pending_copy[vk->current_frame].index = copy->timed ? sampled : -1;
+        vk->timing.pending_copy[vk->current_frame].value = copy->value;
+    } else {
+        vk->timing.pending_copy[vk->current_frame].index = -1;
+    }
+
+    vk->timing.head = (vk->timing.head + 1) % VK_FRAME_STATS_LEN;
+    if (vk->timing.count < VK_FRAME_STATS_LEN) {
+        vk->timing.count++;
+    }
+
+    if (vk->timing.query_pool) {
+        vk->timing.pending[vk->current_frame] = index;
+    } else {
+        frame_timing_finish(vk, stats);
+    }
+}
+
+size_t
+server_vk_get_frame_stats(struct server_vk *vk, struct vk_frame_stats *out, size_t max) {
+    size_t n = vk->timing.count < max ? vk->timing.count : max;
+    size_t start = (vk->timing.head + VK_FRAME_STATS_LEN - n) % VK_FRAME_STATS_LEN;
+    for (size_t i = 0; i < n; i++) {
+        out[i] = vk->timing.ring[(start + i) % VK_FRAME_STATS_LEN];
+    }
+    return n;
+}
+
+// ============================================================================
+// Import Tuning
+// ============================================================================
+
+#define VK_IMPORT_TUNE_MAGIC "WWTUNE1"
+#define VK_IMPORT_TUNE_CACHE "import-tune.bin"
+
+static const char *IMPORT_STRATEGY_NAMES[VK_IMPORT_STRATEGY_COUNT] = {
+    [VK_IMPORT_MODIFIER] = "modifier",
+    [VK_IMPORT_LINEAR_IMAGE] = "linear image",
+    [VK_IMPORT_STORAGE_BUFFER] = "storage buffer",
+};
+
+static bool
+import_tune_measured(const struct vk_import_tune_record *record, enum vk_import_strategy strategy) {
+    return record->strategies[strategy].frames >= VK_IMPORT_TUNE_FRAMES;
+}
+
+// Returns the average cost of a frame in ns, including its share of the import.
+static double
+import_tune_cost(const struct vk_import_tune_record *record, enum vk_import_strategy strategy) {
+    double cost =
+        (double)record->strategies[strategy].frame_ns / record->strategies[strategy].frames;
+    if (record->strategies[strategy].imports > 0) {
+        cost += (double)record->strategies[strategy].import_ns /
+                record->strategies[strategy].imports / VK_IMPORT_TUNE_BUFFER_FRAMES;
+    }
+    return cost;
+}
+
+static bool
+import_tune_same_setup(const struct vk_import_tune_record *a,
+                       const struct vk_import_tune_record *b) {
+    return a->vendor_id == b->vendor_id && a->device_id == b->device_id &&
+           a->driver_version == b->driver_version && a->peer == b->peer;
+}
+
+// Returns the record for this session's setup at the given capture resolution. A missing record
+// is created if requested, replacing the least measured one once the table is full.
+static struct vk_import_tune_record *
+import_tune_find(struct server_vk *vk, int32_t width, int32_t height, bool create) {
+    for (size_t i = 0; i < vk->import_tune.count; i++) {
+        struct vk_import_tune_record *record = &vk->import_tune.records[i];
+        if (import_tune_same_setup(record, &vk->import_tune.key) && record->width == width &&
+            record->height == height) {
+            return record;
+        }
+    }
+    if (!create) {
+        return NULL;
+    }
+
+    size_t index = vk->import_tune.count;
+    if (index == VK_IMPORT_TUNE_MAX_RECORDS) {
+        uint64_t least = UINT64_MAX;
+        for (size_t i = 0; i < vk->import_tune.count; i++) {
+            uint64_t frames = 0;
+            for (int s = 0; s < VK_IMPORT_STRATEGY_COUNT; s++) {
+                frames += vk->import_tune.records[i].strategies[s].frames;
+            }
+            if (frames < least) {
+                least = frames;
+                index = i;
+            }
+        }
+
+        // Don't let a frame in flight resolve its timings into the record that replaces this one.
+        for (int i = 0; i < VK_MAX_FRAMES_IN_FLIGHT; i++) {
+            if (vk->import_tune.pending[i].record == (int32_t)index) {
+                vk->import_tune.pending[i].record = -1;
+            }
+        }
+    } else {
+        vk->import_tune.count++;
+    }
+
+    struct vk_import_tune_record *record = &vk->import_tune.records[index];
+    *record = vk->import_tune.key;
+    record->width = width;
+    record->height = height;
+    vk->import_tune.dirty = true;
+    return record;
+}
+
+static void
+import_tune_save(struct server_vk *vk) {
+    if (!vk->import_tune.dirty) {
+        return;
+    }
+
+    size_t header = sizeof(VK_IMPORT_TUNE_MAGIC);
+    size_t size = header + vk->import_tune.count * sizeof(struct vk_import_tune_record);
+    char *data = malloc(size);
+    check_alloc(data);
+    memcpy(data, VK_IMPORT_TUNE_MAGIC, header);
+    memcpy(data + header, vk->import_tune.records,
+           vk->import_tune.count * sizeof(struct vk_import_tune_record));
+
+    util_cache_blob_store(VK_IMPORT_TUNE_CACHE, data, size);
+    free(data);
+    vk->import_tune.dirty = false;
+}
+
+// Decides whether the game is offered tiled modifiers this session. The decision is made for the
+// resolution the game has been played at the most, and measures whichever of modifier and LINEAR
+// imports is still unknown.
+static bool
+import_tune_session_modifiers(struct server_vk *vk, bool fallback) {
+    struct vk_import_tune_record *record = NULL;
+    uint64_t most = 0;
+    for (size_t i = 0; i < vk->import_tune.count; i++) {
+        struct vk_import_tune_record *candidate = &vk->import_tune.records[i];
+        if (!import_tune_same_setup(candidate, &vk->import_tune.key)) {
+            continue;
+        }
+
+        uint64_t frames = 0;
+        for (int s = 0; s < VK_IMPORT_STRATEGY_COUNT; s++) {
+            frames += candidate->strategies[s].frames;
+        }
+        if (frames > most) {
+            most = frames;
+            record = candidate;
+        }
+    }
+    if (!record) {
+        return fallback;
+    }
+
+    double linear_cost = 0.0;
+    bool linear = false;
+    for (int s = VK_IMPORT_LINEAR_IMAGE; s <= VK_IMPORT_STORAGE_BUFFER; s++) {
+        if (import_tune_measured(record, s)) {
+            double cost = import_tune_cost(record, s);
+            linear_cost = (!linear || cost < linear_cost) ? cost : linear_cost;
+            linear = true;
+        }
+    }
+
+    if (!import_tune_measured(record, VK_IMPORT_MODIFIER)) {
+        // The game may never allocate a tiled buffer, no matter what it is offered.
+        if (record->strategies[VK_IMPORT_MODIFIER].frames == 0) {
+            if (record->modifier_attempts >= VK_IMPORT_TUNE_MODIFIER_ATTEMPTS) {
+                return false;
+            }
+            if (linear) {
+                record->modifier_attempts++;
+                vk->import_tune.dirty = true;
+            }
+        }
+        if (linear) {
+            vk_log(LOG_INFO, "import tuning: measuring modifier imports of %dx%d captures",
+                   record->width, record->height);
+            return true;
+        }
+        return fallback;
+    }
+    if (!linear) {
+        vk_log(LOG_INFO, "import tuning: measuring LINEAR imports of %dx%d captures",
+               record->width, record->height);
+        return false;
+    }
+
+    double modifier_cost = import_tune_cost(record, VK_IMPORT_MODIFIER);
+    bool modifiers = modifier_cost < linear_cost;
+    vk_log(LOG_INFO, "import tuning: using %s imports for %dx%d captures (%.1f us vs %.1f us)",
+           modifiers ? "modifier" : "LINEAR", record->width, record->height,
+           (modifiers ? modifier_cost : linear_cost) / 1e3,
+           (modifiers ? linear_cost : modifier_cost) / 1e3);
+    return modifiers;
+}
+
+// Loads the measurements of previous sessions and picks the buffer layout the game is offered
+// through dma-buf feedback. Layouts chosen by hand through the environment are left alone.
+static void
+create_import_tune(struct server_vk *vk) {
+    for (uint32_t i = 0; i < VK_MAX_FRAMES_IN_FLIGHT; i++) {
+        vk->import_tune.pending[i].record = -1;
+    }
+
+    vk->import_tune.disabled = vk->proxy_game || !vk->timing.query_pool ||
+                               getenv("WAYWALL_VK_NO_IMPORT_TUNE") ||
+                               getenv("WAYWALL_DMABUF_ALLOW_MODIFIERS") ||
+                               getenv("WAYWALL_FORCE_LINEAR_DMABUF") ||
+                               getenv("WAYWALL_DMABUF_FORCE_INTEL");
+    if (vk->import_tune.disabled) {
+        return;
+    }
+
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(vk->physical_device, &props);
+
+    const char *prime = getenv("WAYWALL_SUBPROC_DRI_PRIME");
+    if (!prime) {
+        prime = vk->server->subprocess_dri_prime;
+    }
+    vk->import_tune.key = (struct vk_import_tune_record){
+        .vendor_id = props.vendorID,
+        .device_id = props.deviceID,
+        .driver_version = props.driverVersion,
+        .peer = (prime && prime[0]) ? (uint32_t)util_cache_hash(prime, strlen(prime)) : 0,
+    };
+
+    vk->import_tune.records = zalloc(VK_IMPORT_TUNE_MAX_RECORDS, sizeof(*vk->import_tune.records));
+
+    char *data = NULL;
+    size_t size = 0;
+    if (util_cache_blob_load(VK_IMPORT_TUNE_CACHE, &data, &size)) {
+        size_t header = sizeof(VK_IMPORT_TUNE_MAGIC);
+        if (size >= header && memcmp(data, VK_IMPORT_TUNE_MAGIC, header) == 0 &&
+            (size - header) % sizeof(struct vk_import_tune_record) == 0) {
+            size_t count = (size - header) / sizeof(struct vk_import_tune_record);
+            count = (count < VK_IMPORT_TUNE_MAX_RECORDS) ? count : VK_IMPORT_TUNE_MAX_RECORDS;
+            memcpy(vk->import_tune.records, data + header,
+                   count * sizeof(struct vk_import_tune_record));
+            vk->import_tune.count = count;
+        } else {
+            vk_log(LOG_INFO, "discarding stale import tuning cache");
+        }
+        free(data);
+    }
+
+    vk->allow_modifiers = import_tune_session_modifiers(vk, vk->allow_modifiers);
+    if (vk->server->linux_dmabuf) {
+        vk->server->linux_dmabuf->allow_modifiers = vk->allow_modifiers;
+    }
+}
+
+// Measurements are only written out here, keeping the cache write off the frame path.
+static void
+destroy_import_tune(struct server_vk *vk) {
+    if (vk->import_tune.records) {
+        import_tune_save(vk);
+        free(vk->import_tune.records);
+        vk->import_tune.records = NULL;
+    }
+}
+
+// Picks how a LINEAR buffer is read. Both strategies are used in turn until each has been
+// measured at this resolution, so that the game's buffers are split between them. image_viable
+// is false if the image would have to be widened to match the dma-buf stride.
+static enum vk_import_strategy
+import_tune_choose_linear(struct server_vk *vk, int32_t width, int32_t height, bool image_viable) {
+    if (vk->import_tune.disabled || !image_viable) {
+        return VK_IMPORT_STORAGE_BUFFER;
+    }
+
+    struct vk_import_tune_record *record = import_tune_find(vk, width, height, true);
+    bool image = import_tune_measured(record, VK_IMPORT_LINEAR_IMAGE);
+    bool storage = import_tune_measured(record, VK_IMPORT_STORAGE_BUFFER);
+    if (image && storage) {
+        return import_tune_cost(record, VK_IMPORT_LINEAR_IMAGE) <
+                       import_tune_cost(record, VK_IMPORT_STORAGE_BUFFER)
+                   ? VK_IMPORT_LINEAR_IMAGE
+                   : VK_IMPORT_STORAGE_BUFFER;
+    }
+    if (image || storage) {
+        return image ? VK_IMPORT_STORAGE_BUFFER : VK_IMPORT_LINEAR_IMAGE;
+    }
+    return (record->strategies[VK_IMPORT_LINEAR_IMAGE].imports <
+            record->strategies[VK_IMPORT_STORAGE_BUFFER].imports)
+               ? VK_IMPORT_LINEAR_IMAGE
+               : VK_IMPORT_STORAGE_BUFFER;
+}
+
+static void
+import_tune_imported(struct server_vk *vk, struct vk_buffer *buffer, uint64_t import_ns) {
+    if (vk->import_tune.disabled) {
+        return;
+    }
+
+    struct vk_import_tune_record *record =
+        import_tune_find(vk, buffer->width, buffer->height, true);
+    record->strategies[buffer->strategy].imports++;
+    record->strategies[buffer->strategy].import_ns += import_ns;
+    vk->import_tune.dirty = true;
+}
+
+// Remembers which strategy the frame being recorded measures. capture is NULL if the frame
+// doesn't draw the capture through the render pass.
+static void
+import_tune_frame(struct server_vk *vk, struct vk_buffer *capture) {
+    vk->import_tune.pending[vk->current_frame].record = -1;
+    if (vk->import_tune.disabled || !capture) {
+        return;
+    }
+
+    struct vk_import_tune_record *record =
+        import_tune_find(vk, capture->width, capture->height, false);
+    if (record && !import_tune_measured(record, capture->strategy)) {
+        vk->import_tune.pending[vk->current_frame].record =
+            (int32_t)(record - vk->import_tune.records);
+        vk->import_tune.pending[vk->current_frame].strategy = capture->strategy;
+    }
+}
+
+// Adds the GPU time a finished frame spent reading the capture to its strategy. This covers the
+// acquire barrier and resident copy, the capture draw, and the capture copy it sampled, if any.
+static void
+import_tune_resolve(struct server_vk *vk, uint32_t slot, const struct vk_frame_stats *stats) {
+    int32_t index = vk->import_tune.pending[slot].record;
+    vk->import_tune.pending[slot].record = -1;
+    if (index < 0 || (size_t)index >= vk->import_tune.count || !stats->gpu_valid) {
+        return;
+    }
+
+    struct vk_import_tune_record *record = &vk->import_tune.records[index];
+    enum vk_import_strategy strategy = vk->import_tune.pending[slot].strategy;
+    if (import_tune_measured(record, strategy)) {
+        return;
+    }
+
+    record->strategies[strategy].frames++;
+    record->strategies[strategy].frame_ns +=
+        stats->gpu_acquire_ns + stats->gpu_capture_ns + stats->gpu_copy_ns;
+    vk->import_tune.dirty = true;
+
+    if (import_tune_measured(record, strategy)) {
+        vk_log(LOG_INFO, "import tuning: measured %s reads of %dx%d captures (%.1f us per frame)",
+               IMPORT_STRATEGY_NAMES[strategy], record->width, record->height,
+               import_tune_cost(record, strategy) / 1e3);
+    }
+}
+
+// ============================================================================
+// Sampler
+// ============================================================================
+
+static bool
+create_sampler(struct server_vk *vk) {
+    VkSamplerCreateInfo create_info = {
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .magFilter = VK_FILTER_NEAREST,
+        .minFilter = VK_FILTER_NEAREST,
+        .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .anisotropyEnable = VK_FALSE,
+        .borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK,
+        .unnormalizedCoordinates = VK_FALSE,
+        .compareEnable = VK_FALSE,
+        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+    };
+
+    VkResult result = vkCreateSampler(vk->device, &create_info, NULL, &vk->sampler);
+    vk_check(result, "failed to create sampler");
+
+    // Distance fields must be interpolated between texels to produce smooth edges.
+    create_info.magFilter = VK_FILTER_LINEAR;
+    create_info.minFilter = VK_FILTER_LINEAR;
+    result = vkCreateSampler(vk->device, &create_info, NULL, &vk->linear_sampler);
+    vk_check(result, "failed to create linear sampler");
+
+    return true;
+}
+
+// ============================================================================
+// Descriptor Pool
+// ============================================================================
+
+static bool
+create_descriptor_pool(struct server_vk *vk) {
+    VkDescriptorPoolSize pool_sizes[] = {
+        {
+            .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .descriptorCount = 100,
+        },
+        {
+            .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 100,
+        },
+    };
+
+    VkDescriptorPoolCreateInfo create_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
+        .maxSets = 200,
+        .poolSizeCount = ARRAY_LEN(pool_sizes),
+        .pPoolSizes = pool_sizes,
+    };
+
+    VkResult result = vkCreateDescriptorPool(vk->device, &create_info, NULL, &vk->descriptor_pool);
+    vk_check(result, "failed to create descriptor pool");
+
+    return true;
+}
+
+// ============================================================================
+// Texture Table
+// ============================================================================
+
+// Upper bound on the number of slots in the texture table. It is clamped to the device limits for
+// update-after-bind descriptors, which are far higher than this on desktop drivers.
+#define VK_TEXTURE_TABLE_SIZE 4096
+
+static bool
+create_texture_table(struct server_vk *vk) {
+    VkPhysicalDeviceDescriptorIndexingProperties indexing_props = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES,
+    };
+    VkPhysicalDeviceProperties2 props = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+        .pNext = &indexing_props,
+    };
+    vkGetPhysicalDeviceProperties2(vk->physical_device, &props);
+
+    // Combined image samplers count against both the sampler and sampled image limits.
+    uint32_t limits[] = {
+        indexing_props.maxDescriptorSetUpdateAfterBindSampledImages,
+        indexing_props.maxDescriptorSetUpdateAfterBindSamplers,
+        indexing_props.maxPerStageDescriptorUpdateAfterBindSampledImages,
+        indexing_props.maxPerStageDescriptorUpdateAfterBindSamplers,
+    };
+    uint32_t capacity = VK_TEXTURE_TABLE_SIZE;
+    for (size_t i = 0; i < ARRAY_LEN(limits); i++) {
+        if (limits[i] < capacity) {
+            capacity = limits[i];
+        }
+    }
+
+    // Slots can be written while frames which do not use them are in flight, and slots which have
+    // never been written (or whose texture was destroyed) may stay invalid.
+    VkDescriptorBindingFlags binding_flags = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+                                             VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT |
+                                             VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+    VkDescriptorSetLayoutBindingFlagsCreateInfo flags_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+        .bindingCount = 1,
+        .pBindingFlags = &binding_flags,
+    };
+    VkDescriptorSetLayoutBinding binding = {
+        .binding = 0,
+        .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        .descriptorCount = capacity,
+        .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+    };
+    VkDescriptorSetLayoutCreateInfo layout_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .pNext = &flags_info,
+        .flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT,
+        .bindingCount = 1,
+        .pBindings = &binding,
+    };
+    VkResult result = vkCreateDescriptorSetLayout(vk->device, &layout_info, NULL, &vk->textures.layout);
+    vk_check(result, "failed to create texture table layout");
+
+    VkDescriptorPoolSize pool_size = {
+        .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        .descriptorCount = capacity,
+    };
+    VkDescriptorPoolCreateInfo pool_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT,
+        .maxSets = 1,
+        .poolSizeCount = 1,
+        .pPoolSizes = &pool_size,
+    };
+    result = vkCreateDescriptorPool(vk->device, &pool_info, NULL, &vk->textures.pool);
+    vk_check(result, "failed to create texture table pool");
+
+    VkDescriptorSetAllocateInfo alloc_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = vk->textures.pool,
+        .descriptorSetCount = 1,
+        .pSetLayouts = &vk->textures.layout,
+    };
+    result = vkAllocateDescriptorSets(vk->device, &alloc_info, &vk->textures.set);
+    vk_check(result, "failed to allocate texture table");
+
+    // Hand out the lowest slots first.
+    vk->textures.capacity = capacity;
+    vk->textures.free = zalloc(capacity, sizeof(*vk->textures.free));
+    for (uint32_t i = 0; i < capacity; i++) {
+        vk->textures.free[i] = capacity - 1 - i;
+    }
+    vk->textures.free_count = capacity;
+
+    vk_log(LOG_INFO, "created texture table (%" PRIu32 " slots)", capacity);
+    return true;
+}
+
+static void
+destroy_texture_table(struct server_vk *vk) {
+    if (vk->textures.pool) {
+        vkDestroyDescriptorPool(vk->device, vk->textures.pool, NULL);
+    }
+    if (vk->textures.layout) {
+        vkDestroyDescriptorSetLayout(vk->device, vk->textures.layout, NULL);
+    }
+    free(vk->textures.free);
+}
+
+// Writes a texture to a free slot of the table and returns the slot, or VK_TEXTURE_NONE if the
+// table is full. The view must stay alive until the slot is released.
+static uint32_t
+texture_table_add(struct server_vk *vk, VkImageView view, VkSampler sampler) {
+    if (vk->textures.free_count == 0) {
+        vk_log(LOG_ERROR, "texture table is full (%" PRIu32 " textures)", vk->textures.capacity);
+        return VK_TEXTURE_NONE;
+    }
+    uint32_t slot = vk->textures.free[--vk->textures.free_count];
+
+    VkDescriptorImageInfo img_info = {
+        .sampler = sampler,
+        .imageView = view,
+        .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+    };
+    VkWriteDescriptorSet write = {
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = vk->textures.set,
+        .dstBinding = 0,
+        .dstArrayElement = slot,
+        .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        .descriptorCount = 1,
+        .pImageInfo = &img_info,
+    };
+    vkUpdateDescriptorSets(vk->device, 1, &write, 0, NULL);
+
+    return slot;
+}
+
+// Releases a slot of the table. The caller must make sure that no frame in flight still samples it.
+static void
+texture_table_remove(struct server_vk *vk, uint32_t slot) {
+    if (slot == VK_TEXTURE_NONE) {
+        return;
+    }
+    ww_assert(vk->textures.free_count < vk->textures.capacity);
+    vk->textures.free[vk->textures.free_count++] = slot;
+}
+
+// ============================================================================
+// Fullscreen Quad Vertex Buffer
+// ============================================================================
+
+// Simple fullscreen quad vertices (position + texcoord)
+struct quad_vertex {
+    float pos[2];
+    float uv[2];
+};
+
+static const struct quad_vertex QUAD_VERTICES[] = {
+    // First triangle (top-left, bottom-left, bottom-right)
+    {{ -1.0f, -1.0f }, { 0.0f, 0.0f }},
+    {{ -1.0f,  1.0f }, { 0.0f, 1.0f }},
+    {{  1.0f,  1.0f }, { 1.0f, 1.0f }},
+    // Second triangle (top-left, bottom-right, top-right)
+    {{ -1.0f, -1.0f }, { 0.0f, 0.0f }},
+    {{  1.0f,  1.0f }, { 1.0f, 1.0f }},
+    {{  1.0f, -1.0f }, { 1.0f, 0.0f }},
+};
+
+static bool
+create_quad_vertex_buffer(struct server_vk *vk) {
+    VkDeviceSize buffer_size = sizeof(QUAD_VERTICES);
+
+    VkBufferCreateInfo buffer_info = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = buffer_size,
+        .usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+    };
+
+    VkResult result = vkCreateBuffer(vk->device, &buffer_info, NULL, &vk->quad_vertex_buffer);
+    if (result != VK_SUCCESS) {
+        vk_log(LOG_ERROR, "failed to create quad vertex buffer");
+        return false;
+    }
+
+    VkMemoryRequirements mem_reqs;
+    vkGetBufferMemoryRequirements(vk->device, vk->quad_vertex_buffer, &mem_reqs);
+
+    uint32_t mem_type = find_memory_type(vk, mem_reqs.memoryTypeBits,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    if (mem_type == UINT32_MAX) {
+        vk_log(LOG_ERROR, "no suitable memory type for quad vertex buffer");
+        return false;
+    }
+
+    VkMemoryAllocateInfo alloc_info = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .allocationSize = mem_reqs.size,
+        .memoryTypeIndex = mem_type,
+    };
+
+    result = vkAllocateMemory(vk->device, &alloc_info, NULL, &vk->quad_vertex_memory);
+    if (result != VK_SUCCESS) {
+        vk_log(LOG_ERROR, "failed to allocate quad vertex memory");
+        return false;
+    }
+
+    vkBindBufferMemory(vk->device, vk->quad_vertex_buffer, vk->quad_vertex_memory, 0);
+
+    // Copy vertex data
+    void *data;
+    vkMapMemory(vk->device, vk->quad_vertex_memory, 0, buffer_size, 0, &data);
+    memcpy(data, QUAD_VERTICES, buffer_size);
+    vkUnmapMemory(vk->device, vk->quad_vertex_memory);
+
+    vk_log(LOG_INFO, "created quad vertex buffer");
+    return true;
+}
+
+// ============================================================================
+// Pipeline Cache
+// ============================================================================
+
+#define VK_PIPELINE_CACHE_MAGIC "WWPIPE1"
+
+// Written in front of the data from vkGetPipelineCacheData. Drivers are supposed to reject data
+// from another driver themselves, but the cache is checked against the device and driver version
+// before it is handed to them anyway.
+struct vk_pipeline_cache_header {
+    char magic[8];
+    uint32_t vendor_id;
+    uint32_t device_id;
+    uint32_t driver_version;
+    uint8_t cache_uuid[VK_UUID_SIZE];
+    uint32_t reserved;
+    uint64_t data_size;
+};
+
+static void
+get_pipeline_cache_info(struct server_vk *vk, struct vk_pipeline_cache_header *header, char *name,
+                        size_t name_size) {
+    VkPhysicalDeviceIDProperties id_props = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES,
+    };
+    VkPhysicalDeviceProperties2 props = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+        .pNext = &id_props,
+    };
+    vkGetPhysicalDeviceProperties2(vk->physical_device, &props);
+
+    *header = (struct vk_pipeline_cache_header){
+        .magic = VK_PIPELINE_CACHE_MAGIC,
+        .vendor_id = props.properties.vendorID,
+        .device_id = props.properties.deviceID,
+        .driver_version = props.properties.driverVersion,
+    };
+    memcpy(header->cache_uuid, props.properties.pipelineCacheUUID, VK_UUID_SIZE);
+
+    // The file is named after the device UUID so that multi-GPU setups keep one cache per device.
+    size_t n = (size_t)snprintf(name, name_size, "pipeline-");
+    for (size_t i = 0; i < VK_UUID_SIZE && n < name_size; i++) {
+        n += (size_t)snprintf(name + n, name_size - n, "%02x", id_props.deviceUUID[i]);
+    }
+    if (n < name_size) {
+        snprintf(name + n, name_size - n, ".bin");
+    }
+}
+
+static void
+create_pipeline_cache(struct server_vk *vk) {
+    struct vk_pipeline_cache_header expected;
+    char name[64];
+    get_pipeline_cache_info(vk, &expected, name, sizeof(name));
+
+    VkPipelineCacheCreateInfo cache_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+    };
+
+    char *data = NULL;
+    size_t size = 0;
+    if (util_cache_blob_load(name, &data, &size)) {
+        struct vk_pipeline_cache_header header = {0};
+        if (size >= sizeof(header)) {
+            memcpy(&header, data, sizeof(header));
+            expected.data_size = header.data_size;
+        }
+
+        if (size >= sizeof(header) && memcmp(&header, &expected, sizeof(header)) == 0 &&
+            header.data_size == size - sizeof(header)) {
+            cache_info.initialDataSize = header.data_size;
+            cache_info.pInitialData = data + sizeof(header);
+        } else {
+            vk_log(LOG_INFO, "discarding stale pipeline cache");
+        }
+    }
+
+    VkResult result = vkCreatePipelineCache(vk->device, &cache_info, NULL, &vk->pipeline_cache);
+    if (result != VK_SUCCESS && cache_info.initialDataSize > 0) {
+        vk_log(LOG_WARN, "failed to load pipeline cache: %d", (int)result);
+        cache_info.initialDataSize = 0;
+        cache_info.pInitialData = NULL;
+        result = vkCreatePipelineCache(vk->device, &cache_info, NULL, &vk->pipeline_cache);
+    }
+    free(data);
+
+    if (result != VK_SUCCESS) {
+        // Pipelines can still be created without a cache.
+        vk_log(LOG_WARN, "failed to create pipeline cache: %d", (int)result);
+        vk->pipeline_cache = VK_NULL_HANDLE;
+        return;
+    }
+
+    vk->pipeline_cache_size = cache_info.initialDataSize;
+    if (cache_info.initialDataSize > 0) {
+        vk_log(LOG_INFO, "loaded pipeline cache (%zu bytes)", cache_info.initialDataSize);
+    }
+}
+
+static void
+save_pipeline_cache(struct server_vk *vk) {
+    if (!vk->pipeline_cache) {
+        return;
+    }
+
+    size_t size = 0;
+    if (vkGetPipelineCacheData(vk->device, vk->pipeline_cache, &size, NULL) != VK_SUCCESS) {
+        return;
+    }
+
+    // Skip the write if nothing has been added since the cache was loaded.
+    if (size == 0 || size == vk->pipeline_cache_size) {
+        return;
+    }
+
+    struct vk_pipeline_cache_header header;
+    char name[64];
+    get_pipeline_cache_info(vk, &header, name, sizeof(name));
+
+    char *data = malloc(sizeof(header) + size);
+    check_alloc(data);
+    if (vkGetPipelineCacheData(vk->device, vk->pipeline_cache, &size, data + sizeof(header)) !=
+        VK_SUCCESS) {
+        free(data);
+        return;
+    }
+
+    header.data_size = size;
+    memcpy(data, &header, sizeof(header));
+    util_cache_blob_store(name, data, sizeof(header) + size);
+
+    vk->pipeline_cache_size = size;
+    free(data);
+}
+
+static void
+destroy_pipeline_cache(struct server_vk *vk) {
+    if (vk->pipeline_cache) {
+        save_pipeline_cache(vk);
+        vkDestroyPipelineCache(vk->device, vk->pipeline_cache, NULL);
+        vk->pipeline_cache = VK_NULL_HANDLE;
+    }
+}
+
+// ============================================================================
+// Pipeline Creation
+// ============================================================================
+
+// Push constant layout for vertex shader
+struct vk_push_constants {
+    float src_size[2];
+    float dst_size[2];
+};
+
+// Push constants for the text pipeline. The shared texcopy vertex shader only reads the sizes.
+struct text_push_constants {
+    float src_size[2];
+    float dst_size[2];
+    uint32_t texture;  // Font atlas slot in the texture table
+};
+
+static VkShaderModule
+create_shader_module(VkDevice device, const uint32_t *code, size_t size) {
+    VkShaderModuleCreateInfo create_info = {
+        .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+        .codeSize = size,
+        .pCode = code,
+    };
+
+    VkShaderModule module;
+    if (vkCreateShaderModule(device, &create_info, NULL, &module) != VK_SUCCESS) {
+        return VK_NULL_HANDLE;
+    }
+    return module;
+}
+
+static bool
+create_descriptor_set_layout(struct server_vk *vk, VkDescriptorSetLayout *layout) {
+    VkDescriptorSetLayoutBinding binding = {
+        .binding = 0,
+        .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        .descriptorCount = 1,
+        .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+    };
+
+    VkDescriptorSetLayoutCreateInfo layout_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .bindingCount = 1,
+        .pBindings = &binding,
+    };
+
+    return vkCreateDescriptorSetLayout(vk->device, &layout_info, NULL, layout) == VK_SUCCESS;
+}
+
+static bool
+create_texcopy_pipeline(struct server_vk *vk) {
+    // Create shader modules
+    vk->texcopy_pipeline.vert = create_shader_module(vk->device, texcopy_vert_spv, texcopy_vert_spv_size);
+    vk->texcopy_pipeline.frag = create_shader_module(vk->device, texcopy_frag_spv, texcopy_frag_spv_size);
+
+    if (!vk->texcopy_pipeline.vert || !vk->texcopy_pipeline.frag) {
+        vk_log(LOG_ERROR, "failed to create shader modules");
+        return false;
+    }
+
+    // Create descriptor set layout
+    if (!create_descriptor_set_layout(vk, &vk->texcopy_pipeline.descriptor_layout)) {
+        vk_log(LOG_ERROR, "failed to create descriptor set layout");
+        return false;
+    }
+
+    // Push constant range
+    VkPushConstantRange push_constant = {
+        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+        .offset = 0,
+        .size = sizeof(struct vk_push_constants),
+    };
+
+    // Pipeline layout
+    VkPipelineLayoutCreateInfo layout_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = 1,
+        .pSetLayouts = &vk->texcopy_pipeline.descriptor_layout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &push_constant,
+    };
+
+    if (vkCreatePipelineLayout(vk->device, &layout_info, NULL, &vk->texcopy_pipeline.layout) != VK_SUCCESS) {
+        vk_log(LOG_ERROR, "failed to create pipeline layout");
+        return false;
+    }
+
+    // Shader stages
+    VkPipelineShaderStageCreateInfo shader_stages[] = {
+        {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_VERTEX_BIT,
+            .module = vk->texcopy_pipeline.vert,
+            .pName = "main",
+        },
+        {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+            .module = vk->texcopy_pipeline.frag,
+            .pName = "main",
+        },
+    };
+
+    // Vertex input - matches the GL vertex layout
+    VkVertexInputBindingDescription binding = {
+        .binding = 0,
+        .stride = sizeof(float) * 12,  // v_src_pos(2) + v_dst_pos(2) + v_src_rgba(4) + v_dst_rgba(4)
+        .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
+    };
+
+    VkVertexInputAttributeDescription attributes[] = {
+        { .location = 0, .binding = 0, .format = VK_FORMAT_R32G32_SFLOAT, .offset = 0 },                    // v_src_pos
+        { .location = 1, .binding = 0, .format = VK_FORMAT_R32G32_SFLOAT, .offset = sizeof(float) * 2 },    // v_dst_pos
+        { .location = 2, .binding = 0, .format = VK_FORMAT_R32G32B32A32_SFLOAT, .offset = sizeof(float) * 4 },  // v_src_rgba
+        { .location = 3, .binding = 0, .format = VK_FORMAT_R32G32B32A32_SFLOAT, .offset = sizeof(float) * 8 },  // v_dst_rgba
+    };
+
+    VkPipelineVertexInputStateCreateInfo vertex_input = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+        .vertexBindingDescriptionCount = 1,
+        .pVertexBindingDescriptions = &binding,
+        .vertexAttributeDescriptionCount = ARRAY_LEN(attributes),
+        .pVertexAttributeDescriptions = attributes,
+    };
+
+    // Input assembly - triangles
+    VkPipelineInputAssemblyStateCreateInfo input_assembly = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+        .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+        .primitiveRestartEnable = VK_FALSE,
+    };
+
+    // Dynamic viewport and scissor
+    VkDynamicState dynamic_states[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo dynamic_state = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+        .dynamicStateCount = ARRAY_LEN(dynamic_states),
+        .pDynamicStates = dynamic_states,
+    };
+
+    VkPipelineViewportStateCreateInfo viewport_state = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+        .viewportCount = 1,
+        .scissorCount = 1,
+    };
+
+    // Rasterization
+    VkPipelineRasterizationStateCreateInfo rasterization = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+        .depthClampEnable = VK_FALSE,
+        .rasterizerDiscardEnable = VK_FALSE,
+        .polygonMode = VK_POLYGON_MODE_FILL,
+        .lineWidth = 1.0f,
+        .cullMode = VK_CULL_MODE_NONE,
+        .frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE,
+        .depthBiasEnable = VK_FALSE,
+    };
+
+    // Multisampling disabled
+    VkPipelineMultisampleStateCreateInfo multisampling = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+        .sampleShadingEnable = VK_FALSE,
+        .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+    };
+
+    // Color blending - standard alpha blending
+    VkPipelineColorBlendAttachmentState blend_attachment = {
+        .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+                          VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
+        .blendEnable = VK_TRUE,
+        .srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA,
+        .dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+        .colorBlendOp = VK_BLEND_OP_ADD,
+        .srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
+        .dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
+        .alphaBlendOp = VK_BLEND_OP_ADD,
+    };
+
+    VkPipelineColorBlendStateCreateInfo color_blending = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+        .logicOpEnable = VK_FALSE,
+        .attachmentCount = 1,
+        .pAttachments = &blend_attachment,
+    };
+
+    // Create the pipeline
+    VkGraphicsPipelineCreateInfo pipeline_info = {
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        .stageCount = ARRAY_LEN(shader_stages),
+        .pStages = shader_stages,
+        .pVertexInputState = &vertex_input,
+        .pInputAssemblyState = &input_assembly,
+        .pViewportState = &viewport_state,
+        .pRasterizationState = &rasterization,
+        .pMultisampleState = &multisampling,
+        .pColorBlendState = &color_blending,
+        .pDynamicState = &dynamic_state,
+        .layout = vk->texcopy_pipeline.layout,
+        .renderPass = vk->render_pass,
+        .subpass = 0,
+    };
+
+    VkResult result = vkCreateGraphicsPipelines(vk->device, vk->pipeline_cache, 1, &pipeline_info,
+                                                 NULL, &vk->texcopy_pipeline.pipeline);
+    if (result != VK_SUCCESS) {
+        vk_log(LOG_ERROR, "failed to create texcopy pipeline: %d", result);
+        return false;
+    }
+
+    vk_log(LOG_INFO, "created texcopy pipeline");
+    return true;
+}
+
+static bool
+create_text_pipeline(struct server_vk *vk) {
     // Text pipeline uses same vertex shader, different fragment shader
     vk->text_pipeline.vert = vk->texcopy_pipeline.vert;  // Shared
     vk->text_pipeline.frag = create_shader_module(vk->device, text_frag_spv, text_frag_spv_size);
 
-    if (!vk->text_pipeline.frag) {
-        vk_log(LOG_ERROR, "failed to create text fragment shader");
+    if (!vk->text_pipeline.frag) {
+        vk_log(LOG_ERROR, "failed to create text fragment shader");
+        return false;
+    }
+
+    // Share descriptor layout with texcopy
+    vk->text_pipeline.descriptor_layout = vk->texcopy_pipeline.descriptor_layout;
+
+    // Push constant range - same as texcopy but also used in fragment
+    VkPushConstantRange push_constant = {
+        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+        .offset = 0,
+        .size = sizeof(struct vk_push_constants),
+    };
+
+    // Pipeline layout
+    VkPipelineLayoutCreateInfo layout_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = 1,
+        .pSetLayouts = &vk->text_pipeline.descriptor_layout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &push_constant,
+    };
+
+    if (vkCreatePipelineLayout(vk->device, &layout_info, NULL, &vk->text_pipeline.layout) != VK_SUCCESS) {
+        vk_log(LOG_ERROR, "failed to create text pipeline layout");
+        return false;
+    }
+
+    // Shader stages
+    VkPipelineShaderStageCreateInfo shader_stages[] = {
+        {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_VERTEX_BIT,
+            .module = vk->text_pipeline.vert,
+            .pName = "main",
+        },
+        {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+            .module = vk->text_pipeline.frag,
+            .pName = "main",
+        },
+    };
+
+    // Same vertex input as texcopy
+    VkVertexInputBindingDescription binding = {
+        .binding = 0,
+        .stride = sizeof(float) * 12,
+        .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
+    };
+
+    VkVertexInputAttributeDescription attributes[] = {
+        { .location = 0, .binding = 0, .format = VK_FORMAT_R32G32_SFLOAT, .offset = 0 },
+        { .location = 1, .binding = 0, .format = VK_FORMAT_R32G32_SFLOAT, .offset = sizeof(float) * 2 },
+        { .location = 2, .binding = 0, .format = VK_FORMAT_R32G32B32A32_SFLOAT, .offset = sizeof(float) * 4 },
+        { .location = 3, .binding = 0, .format = VK_FORMAT_R32G32B32A32_SFLOAT, .offset = sizeof(float) * 8 },
+    };
+
+    VkPipelineVertexInputStateCreateInfo vertex_input = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+        .vertexBindingDescriptionCount = 1,
+        .pVertexBindingDescriptions = &binding,
+        .vertexAttributeDescriptionCount = ARRAY_LEN(attributes),
+        .pVertexAttributeDescriptions = attributes,
+    };
+
+    VkPipelineInputAssemblyStateCreateInfo input_assembly = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+        .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+        .primitiveRestartEnable = VK_FALSE,
+    };
+
+    VkDynamicState dynamic_states[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo dynamic_state = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+        .dynamicStateCount = ARRAY_LEN(dynamic_states),
+        .pDynamicStates = dynamic_states,
+    };
+
+    VkPipelineViewportStateCreateInfo viewport_state = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+        .viewportCount = 1,
+        .scissorCount = 1,
+    };
+
+    VkPipelineRasterizationStateCreateInfo rasterization = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+        .depthClampEnable = VK_FALSE,
+        .rasterizerDiscardEnable = VK_FALSE,
+        .polygonMode = VK_POLYGON_MODE_FILL,
+        .lineWidth = 1.0f,
+        .cullMode = VK_CULL_MODE_NONE,
+        .frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE,
+        .depthBiasEnable = VK_FALSE,
+    };
+
+    VkPipelineMultisampleStateCreateInfo multisampling = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+        .sampleShadingEnable = VK_FALSE,
+        .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+    };
+
+    VkPipelineColorBlendAttachmentState blend_attachment = {
+        .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+                          VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
+        .blendEnable = VK_TRUE,
+        .srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA,
+        .dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+        .colorBlendOp = VK_BLEND_OP_ADD,
+        .srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
+        .dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
+        .alphaBlendOp = VK_BLEND_OP_ADD,
+    };
+
+    VkPipelineColorBlendStateCreateInfo color_blending = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+        .logicOpEnable = VK_FALSE,
+        .attachmentCount = 1,
+        .pAttachments = &blend_attachment,
+    };
+
+    VkGraphicsPipelineCreateInfo pipeline_info = {
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        .stageCount = ARRAY_LEN(shader_stages),
+        .pStages = shader_stages,
+        .pVertexInputState = &vertex_input,
+        .pInputAssemblyState = &input_assembly,
+        .pViewportState = &viewport_state,
+        .pRasterizationState = &rasterization,
+        .pMultisampleState = &multisampling,
+        .pColorBlendState = &color_blending,
+        .pDynamicState = &dynamic_state,
+        .layout = vk->text_pipeline.layout,
+        .renderPass = vk->render_pass,
+        .subpass = 0,
+    };
+
+    VkResult result = vkCreateGraphicsPipelines(vk->device, vk->pipeline_cache, 1, &pipeline_info,
+                                                 NULL, &vk->text_pipeline.pipeline);
+    if (result != VK_SUCCESS) {
+        vk_log(LOG_ERROR, "failed to create text pipeline: %d", result);
+        return false;
+    }
+
+    vk_log(LOG_INFO, "created text pipeline");
+    return true;
+}
+
+static bool
+create_blit_pipeline(struct server_vk *vk) {
+    // Create shader modules for simple blit
+    vk->blit_pipeline.vert = create_shader_module(vk->device, blit_vert_spv, blit_vert_spv_size);
+    vk->blit_pipeline.frag = create_shader_module(vk->device, blit_frag_spv, blit_frag_spv_size);
+
+    if (!vk->blit_pipeline.vert || !vk->blit_pipeline.frag) {
+        vk_log(LOG_ERROR, "failed to create blit shader modules");
+        return false;
+    }
+
+    // Create descriptor set layout (same as texcopy - just a sampler)
+    if (!create_descriptor_set_layout(vk, &vk->blit_pipeline.descriptor_layout)) {
+        vk_log(LOG_ERROR, "failed to create blit descriptor set layout");
+        return false;
+    }
+
+    // Push constant for dual-GPU color swap
+    VkPushConstantRange push_range = {
+        .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+        .offset = 0,
+        .size = sizeof(int32_t),  // swap_colors flag
+    };
+
+    VkPipelineLayoutCreateInfo layout_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = 1,
+        .pSetLayouts = &vk->blit_pipeline.descriptor_layout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &push_range,
+    };
+
+    if (vkCreatePipelineLayout(vk->device, &layout_info, NULL, &vk->blit_pipeline.layout) != VK_SUCCESS) {
+        vk_log(LOG_ERROR, "failed to create blit pipeline layout");
+        return false;
+    }
+
+    // Shader stages
+    VkPipelineShaderStageCreateInfo shader_stages[] = {
+        {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_VERTEX_BIT,
+            .module = vk->blit_pipeline.vert,
+            .pName = "main",
+        },
+        {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+            .module = vk->blit_pipeline.frag,
+            .pName = "main",
+        },
+    };
+
+    // Vertex input - simple pos + uv
+    VkVertexInputBindingDescription binding = {
+        .binding = 0,
+        .stride = sizeof(struct quad_vertex),  // pos(2) + uv(2)
+        .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
+    };
+
+    VkVertexInputAttributeDescription attributes[] = {
+        { .location = 0, .binding = 0, .format = VK_FORMAT_R32G32_SFLOAT, .offset = 0 },                    // a_pos
+        { .location = 1, .binding = 0, .format = VK_FORMAT_R32G32_SFLOAT, .offset = sizeof(float) * 2 },    // a_uv
+    };
+
+    VkPipelineVertexInputStateCreateInfo vertex_input = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+        .vertexBindingDescriptionCount = 1,
+        .pVertexBindingDescriptions = &binding,
+        .vertexAttributeDescriptionCount = ARRAY_LEN(attributes),
+        .pVertexAttributeDescriptions = attributes,
+    };
+
+    VkPipelineInputAssemblyStateCreateInfo input_assembly = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+        .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+        .primitiveRestartEnable = VK_FALSE,
+    };
+
+    VkDynamicState dynamic_states[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo dynamic_state = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+        .dynamicStateCount = ARRAY_LEN(dynamic_states),
+        .pDynamicStates = dynamic_states,
+    };
+
+    VkPipelineViewportStateCreateInfo viewport_state = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+        .viewportCount = 1,
+        .scissorCount = 1,
+    };
+
+    VkPipelineRasterizationStateCreateInfo rasterization = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+        .depthClampEnable = VK_FALSE,
+        .rasterizerDiscardEnable = VK_FALSE,
+        .polygonMode = VK_POLYGON_MODE_FILL,
+        .lineWidth = 1.0f,
+        .cullMode = VK_CULL_MODE_NONE,
+        .frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE,
+        .depthBiasEnable = VK_FALSE,
+    };
+
+    VkPipelineMultisampleStateCreateInfo multisampling = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+        .sampleShadingEnable = VK_FALSE,
+        .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+    };
+
+    // No blending - opaque copy
+    VkPipelineColorBlendAttachmentState blend_attachment = {
+        .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+                          VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
+        .blendEnable = VK_FALSE,
+    };
+
+    VkPipelineColorBlendStateCreateInfo color_blending = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+        .logicOpEnable = VK_FALSE,
+        .attachmentCount = 1,
+        .pAttachments = &blend_attachment,
+    };
+
+    VkGraphicsPipelineCreateInfo pipeline_info = {
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        .stageCount = ARRAY_LEN(shader_stages),
+        .pStages = shader_stages,
+        .pVertexInputState = &vertex_input,
+        .pInputAssemblyState = &input_assembly,
+        .pViewportState = &viewport_state,
+        .pRasterizationState = &rasterization,
+        .pMultisampleState = &multisampling,
+        .pColorBlendState = &color_blending,
+        .pDynamicState = &dynamic_state,
+        .layout = vk->blit_pipeline.layout,
+        .renderPass = vk->render_pass,
+        .subpass = 0,
+    };
+
+    VkResult result = vkCreateGraphicsPipelines(vk->device, vk->pipeline_cache, 1, &pipeline_info,
+                                                 NULL, &vk->blit_pipeline.pipeline);
+    if (result != VK_SUCCESS) {
+        vk_log(LOG_ERROR, "failed to create blit pipeline: %d", result);
         return false;
     }
 
-    // Share descriptor layout with texcopy
-    vk->text_pipeline.descriptor_layout = vk->texcopy_pipeline.descriptor_layout;
+    vk_log(LOG_INFO, "created blit pipeline");
+    return true;
+}
 
-    // Push constant range - same as texcopy but also used in fragment
-    VkPushConstantRange push_constant = {
+// Create buffer-based blit pipeline for NATIVE cross-GPU rendering
+// Uses storage buffer instead of sampled image to handle stride mismatch
+static bool
+create_buffer_blit_pipeline(struct server_vk *vk) {
+    // Create shader module for buffer-based fragment shader
+    vk->buffer_blit.frag = create_shader_module(vk->device, blit_buffer_frag_spv, blit_buffer_frag_spv_size);
+    if (!vk->buffer_blit.frag) {
+        vk_log(LOG_ERROR, "failed to create buffer blit shader module");
+        return false;
+    }
+
+    // Create descriptor set layout for storage buffer
+    VkDescriptorSetLayoutBinding buffer_binding = {
+        .binding = 0,
+        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        .descriptorCount = 1,
+        .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+    };
+
+    VkDescriptorSetLayoutCreateInfo layout_ci = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .bindingCount = 1,
+        .pBindings = &buffer_binding,
+    };
+
+    if (vkCreateDescriptorSetLayout(vk->device, &layout_ci, NULL, &vk->buffer_blit.descriptor_layout) != VK_SUCCESS) {
+        vk_log(LOG_ERROR, "failed to create buffer blit descriptor layout");
+        return false;
+    }
+
+    // Push constants: width, height, stride, swap_colors, src_x, src_y, src_w, src_h
+    VkPushConstantRange push_range = {
+        .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+        .offset = 0,
+        .size = sizeof(int32_t) * 8,  // 8 ints for source cropping
+    };
+
+    VkPipelineLayoutCreateInfo pipeline_layout_ci = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = 1,
+        .pSetLayouts = &vk->buffer_blit.descriptor_layout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &push_range,
+    };
+
+    if (vkCreatePipelineLayout(vk->device, &pipeline_layout_ci, NULL, &vk->buffer_blit.layout) != VK_SUCCESS) {
+        vk_log(LOG_ERROR, "failed to create buffer blit pipeline layout");
+        return false;
+    }
+
+    // Create graphics pipeline (reuse vertex shader from blit)
+    VkPipelineShaderStageCreateInfo shader_stages[] = {
+        {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_VERTEX_BIT,
+            .module = vk->blit_pipeline.vert,  // Reuse vertex shader
+            .pName = "main",
+        },
+        {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+            .module = vk->buffer_blit.frag,
+            .pName = "main",
+        },
+    };
+
+    VkVertexInputBindingDescription binding = {
+        .binding = 0,
+        .stride = sizeof(struct quad_vertex),
+        .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
+    };
+
+    VkVertexInputAttributeDescription attributes[] = {
+        { .location = 0, .binding = 0, .format = VK_FORMAT_R32G32_SFLOAT, .offset = 0 },
+        { .location = 1, .binding = 0, .format = VK_FORMAT_R32G32_SFLOAT, .offset = sizeof(float) * 2 },
+    };
+
+    VkPipelineVertexInputStateCreateInfo vertex_input = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+        .vertexBindingDescriptionCount = 1,
+        .pVertexBindingDescriptions = &binding,
+        .vertexAttributeDescriptionCount = ARRAY_LEN(attributes),
+        .pVertexAttributeDescriptions = attributes,
+    };
+
+    VkPipelineInputAssemblyStateCreateInfo input_assembly = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+        .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+    };
+
+    VkDynamicState dynamic_states[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo dynamic_state = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+        .dynamicStateCount = ARRAY_LEN(dynamic_states),
+        .pDynamicStates = dynamic_states,
+    };
+
+    VkPipelineViewportStateCreateInfo viewport_state = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+        .viewportCount = 1,
+        .scissorCount = 1,
+    };
+
+    VkPipelineRasterizationStateCreateInfo rasterization = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+        .polygonMode = VK_POLYGON_MODE_FILL,
+        .lineWidth = 1.0f,
+        .cullMode = VK_CULL_MODE_NONE,
+        .frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE,
+    };
+
+    VkPipelineMultisampleStateCreateInfo multisampling = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+        .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+    };
+
+    VkPipelineColorBlendAttachmentState blend_attachment = {
+        .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+                          VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
+        .blendEnable = VK_FALSE,
+    };
+
+    VkPipelineColorBlendStateCreateInfo color_blending = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+        .attachmentCount = 1,
+        .pAttachments = &blend_attachment,
+    };
+
+    VkGraphicsPipelineCreateInfo pipeline_ci = {
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        .stageCount = ARRAY_LEN(shader_stages),
+        .pStages = shader_stages,
+        .pVertexInputState = &vertex_input,
+        .pInputAssemblyState = &input_assembly,
+        .pViewportState = &viewport_state,
+        .pRasterizationState = &rasterization,
+        .pMultisampleState = &multisampling,
+        .pColorBlendState = &color_blending,
+        .pDynamicState = &dynamic_state,
+        .layout = vk->buffer_blit.layout,
+        .renderPass = vk->render_pass,
+        .subpass = 0,
+    };
+
+    if (vkCreateGraphicsPipelines(vk->device, vk->pipeline_cache, 1, &pipeline_ci, NULL, &vk->buffer_blit.pipeline) != VK_SUCCESS) {
+        vk_log(LOG_ERROR, "failed to create buffer blit pipeline");
+        return false;
+    }
+
+    vk_log(LOG_INFO, "created buffer blit pipeline (NATIVE cross-GPU)");
+    return true;
+}
+
+// Per-instance data for batched mirror/image quads (must match overlay.vert)
+struct overlay_instance {
+    float dst[4];      // Destination rect on screen (pixels)
+    float src[4];      // Image: normalized UV rect, mirror: game pixels
+    float key_in[4];   // Color key input rgb + tolerance
+    float key_out[4];  // Color key output rgb + enabled (0 or 1)
+    float layer;       // Image: texture array layer
+    uint32_t texture;  // Image: slot in the texture table
+};
+
+// Push constants shared by overlay.vert and mirror.frag
+struct overlay_push_constants {
+    float screen_size[2];
+    int32_t game_width;
+    int32_t game_height;
+    int32_t game_stride;
+};
+
+#define OVERLAY_MIN_INSTANCES 64
+
+static const VkVertexInputBindingDescription OVERLAY_BINDINGS[] = {
+    { .binding = 0, .stride = sizeof(struct quad_vertex), .inputRate = VK_VERTEX_INPUT_RATE_VERTEX },
+    { .binding = 1, .stride = sizeof(struct overlay_instance), .inputRate = VK_VERTEX_INPUT_RATE_INSTANCE },
+};
+
+static const VkVertexInputAttributeDescription OVERLAY_ATTRIBUTES[] = {
+    { .location = 0, .binding = 0, .format = VK_FORMAT_R32G32_SFLOAT, .offset = offsetof(struct quad_vertex, pos) },
+    { .location = 1, .binding = 0, .format = VK_FORMAT_R32G32_SFLOAT, .offset = offsetof(struct quad_vertex, uv) },
+    { .location = 2, .binding = 1, .format = VK_FORMAT_R32G32B32A32_SFLOAT, .offset = offsetof(struct overlay_instance, dst) },
+    { .location = 3, .binding = 1, .format = VK_FORMAT_R32G32B32A32_SFLOAT, .offset = offsetof(struct overlay_instance, src) },
+    { .location = 4, .binding = 1, .format = VK_FORMAT_R32G32B32A32_SFLOAT, .offset = offsetof(struct overlay_instance, key_in) },
+    { .location = 5, .binding = 1, .format = VK_FORMAT_R32G32B32A32_SFLOAT, .offset = offsetof(struct overlay_instance, key_out) },
+    { .location = 6, .binding = 1, .format = VK_FORMAT_R32_SFLOAT, .offset = offsetof(struct overlay_instance, layer) },
+    { .location = 7, .binding = 1, .format = VK_FORMAT_R32_UINT, .offset = offsetof(struct overlay_instance, texture) },
+};
+
+static bool
+create_mirror_pipeline(struct server_vk *vk) {
+    // Instanced overlay vertex shader (shared with the image pipeline)
+    vk->overlay.vert = create_shader_module(vk->device, overlay_vert_spv, overlay_vert_spv_size);
+    if (!vk->overlay.vert) {
+        vk_log(LOG_ERROR, "failed to create overlay vertex shader module");
+        return false;
+    }
+
+    // Create shader module for mirror fragment shader
+    vk->mirror_pipeline.frag = create_shader_module(vk->device, mirror_frag_spv, mirror_frag_spv_size);
+    if (!vk->mirror_pipeline.frag) {
+        vk_log(LOG_ERROR, "failed to create mirror shader module");
+        return false;
+    }
+
+    vk->mirror_pipeline.resident_frag =
+        create_shader_module(vk->device, mirror_resident_frag_spv, mirror_resident_frag_spv_size);
+    if (!vk->mirror_pipeline.resident_frag) {
+        vk_log(LOG_ERROR, "failed to create resident mirror shader module");
+        return false;
+    }
+
+    // Push constants for screen and game buffer dimensions. Per-mirror
+    // parameters come from the instance buffer.
+    VkPushConstantRange push_range = {
         .stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
         .offset = 0,
-        .size = sizeof(struct vk_push_constants),
+        .size = sizeof(struct overlay_push_constants),
     };
 
-    // Pipeline layout
-    VkPipelineLayoutCreateInfo layout_info = {
+    VkPipelineLayoutCreateInfo pipeline_layout_ci = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
         .setLayoutCount = 1,
-        .pSetLayouts = &vk->text_pipeline.descriptor_layout,
+        .pSetLayouts = &vk->buffer_blit.descriptor_layout,  // Reuse storage buffer layout
         .pushConstantRangeCount = 1,
-        .pPushConstantRanges = &push_constant,
+        .pPushConstantRanges = &push_range,
     };
 
-    if (vkCreatePipelineLayout(vk->device, &layout_info, NULL, &vk->text_pipeline.layout) != VK_SUCCESS) {
-        vk_log(LOG_ERROR, "failed to create text pipeline layout");
+    if (vkCreatePipelineLayout(vk->device, &pipeline_layout_ci, NULL, &vk->mirror_pipeline.layout) != VK_SUCCESS) {
+        vk_log(LOG_ERROR, "failed to create mirror pipeline layout");
         return false;
     }
 
-    // Shader stages
+    pipeline_layout_ci.pSetLayouts = &vk->blit_pipeline.descriptor_layout;  // Combined image sampler
+    if (vkCreatePipelineLayout(vk->device, &pipeline_layout_ci, NULL, &vk->mirror_pipeline.resident_layout) != VK_SUCCESS) {
+        vk_log(LOG_ERROR, "failed to create resident mirror pipeline layout");
+        return false;
+    }
+
+    // Create graphics pipeline (instanced overlay quads)
     VkPipelineShaderStageCreateInfo shader_stages[] = {
         {
             .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
             .stage = VK_SHADER_STAGE_VERTEX_BIT,
-            .module = vk->text_pipeline.vert,
+            .module = vk->overlay.vert,
             .pName = "main",
         },
         {
             .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
             .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
-            .module = vk->text_pipeline.frag,
+            .module = vk->mirror_pipeline.frag,
             .pName = "main",
         },
     };
 
-    // Same vertex input as texcopy
-    VkVertexInputBindingDescription binding = {
-        .binding = 0,
-        .stride = sizeof(float) * 12,
-        .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
-    };
-
-    VkVertexInputAttributeDescription attributes[] = {
-        { .location = 0, .binding = 0, .format = VK_FORMAT_R32G32_SFLOAT, .offset = 0 },
-        { .location = 1, .binding = 0, .format = VK_FORMAT_R32G32_SFLOAT, .offset = sizeof(float) * 2 },
-        { .location = 2, .binding = 0, .format = VK_FORMAT_R32G32B32A32_SFLOAT, .offset = sizeof(float) * 4 },
-        { .location = 3, .binding = 0, .format = VK_FORMAT_R32G32B32A32_SFLOAT, .offset = sizeof(float) * 8 },
-    };
-
     VkPipelineVertexInputStateCreateInfo vertex_input = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
-        .vertexBindingDescriptionCount = 1,
-        .pVertexBindingDescriptions = &binding,
-        .vertexAttributeDescriptionCount = ARRAY_LEN(attributes),
-        .pVertexAttributeDescriptions = attributes,
+        .vertexBindingDescriptionCount = ARRAY_LEN(OVERLAY_BINDINGS),
+        .pVertexBindingDescriptions = OVERLAY_BINDINGS,
+        .vertexAttributeDescriptionCount = ARRAY_LEN(OVERLAY_ATTRIBUTES),
+        .pVertexAttributeDescriptions = OVERLAY_ATTRIBUTES,
     };
 
     VkPipelineInputAssemblyStateCreateInfo input_assembly = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
         .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
-        .primitiveRestartEnable = VK_FALSE,
     };
 
     VkDynamicState dynamic_states[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
@@ -1972,41 +4019,38 @@ create_text_pipeline(struct server_vk *vk) {
 
     VkPipelineRasterizationStateCreateInfo rasterization = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
-        .depthClampEnable = VK_FALSE,
-        .rasterizerDiscardEnable = VK_FALSE,
         .polygonMode = VK_POLYGON_MODE_FILL,
         .lineWidth = 1.0f,
         .cullMode = VK_CULL_MODE_NONE,
         .frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE,
-        .depthBiasEnable = VK_FALSE,
     };
 
     VkPipelineMultisampleStateCreateInfo multisampling = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
-        .sampleShadingEnable = VK_FALSE,
         .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
     };
 
+    // Pre-multiplied alpha blending for mirrors
+    // Mirror outputs either opaque (alpha=1) or fully transparent (alpha=0), both are pre-multiplied
     VkPipelineColorBlendAttachmentState blend_attachment = {
         .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
                           VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
         .blendEnable = VK_TRUE,
-        .srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA,
+        .srcColorBlendFactor = VK_BLEND_FACTOR_ONE,  // Pre-multiplied alpha
         .dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
         .colorBlendOp = VK_BLEND_OP_ADD,
         .srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
-        .dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
+        .dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
         .alphaBlendOp = VK_BLEND_OP_ADD,
     };
 
     VkPipelineColorBlendStateCreateInfo color_blending = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
-        .logicOpEnable = VK_FALSE,
         .attachmentCount = 1,
         .pAttachments = &blend_attachment,
     };
 
-    VkGraphicsPipelineCreateInfo pipeline_info = {
+    VkGraphicsPipelineCreateInfo pipeline_ci = {
         .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
         .stageCount = ARRAY_LEN(shader_stages),
         .pStages = shader_stages,
@@ -2017,99 +4061,84 @@ create_text_pipeline(struct server_vk *vk) {
         .pMultisampleState = &multisampling,
         .pColorBlendState = &color_blending,
         .pDynamicState = &dynamic_state,
-        .layout = vk->text_pipeline.layout,
+        .layout = vk->mirror_pipeline.layout,
         .renderPass = vk->render_pass,
         .subpass = 0,
     };
 
-    VkResult result = vkCreateGraphicsPipelines(vk->device, VK_NULL_HANDLE, 1, &pipeline_info,
-                                                 NULL, &vk->text_pipeline.pipeline);
-    if (result != VK_SUCCESS) {
-        vk_log(LOG_ERROR, "failed to create text pipeline: %d", result);
+    if (vkCreateGraphicsPipelines(vk->device, vk->pipeline_cache, 1, &pipeline_ci, NULL, &vk->mirror_pipeline.pipeline) != VK_SUCCESS) {
+        vk_log(LOG_ERROR, "failed to create mirror pipeline");
         return false;
     }
 
-    vk_log(LOG_INFO, "created text pipeline");
-    return true;
-}
-
-static bool
-create_blit_pipeline(struct server_vk *vk) {
-    // Create shader modules for simple blit
-    vk->blit_pipeline.vert = create_shader_module(vk->device, blit_vert_spv, blit_vert_spv_size);
-    vk->blit_pipeline.frag = create_shader_module(vk->device, blit_frag_spv, blit_frag_spv_size);
-
-    if (!vk->blit_pipeline.vert || !vk->blit_pipeline.frag) {
-        vk_log(LOG_ERROR, "failed to create blit shader modules");
+    // The resident variant differs only in where it reads the game from.
+    shader_stages[1].module = vk->mirror_pipeline.resident_frag;
+    pipeline_ci.layout = vk->mirror_pipeline.resident_layout;
+    if (vkCreateGraphicsPipelines(vk->device, vk->pipeline_cache, 1, &pipeline_ci, NULL, &vk->mirror_pipeline.resident_pipeline) != VK_SUCCESS) {
+        vk_log(LOG_ERROR, "failed to create resident mirror pipeline");
         return false;
     }
 
-    // Create descriptor set layout (same as texcopy - just a sampler)
-    if (!create_descriptor_set_layout(vk, &vk->blit_pipeline.descriptor_layout)) {
-        vk_log(LOG_ERROR, "failed to create blit descriptor set layout");
-        return false;
-    }
+    vk_log(LOG_INFO, "created mirror pipeline");
+    return true;
+}
 
-    // Push constant for dual-GPU color swap
+static bool
+create_image_pipeline(struct server_vk *vk) {
+    // Pipeline layout (push constants shared with the mirror pipeline)
     VkPushConstantRange push_range = {
-        .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
         .offset = 0,
-        .size = sizeof(int32_t),  // swap_colors flag
+        .size = sizeof(struct overlay_push_constants),
     };
 
     VkPipelineLayoutCreateInfo layout_info = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
         .setLayoutCount = 1,
-        .pSetLayouts = &vk->blit_pipeline.descriptor_layout,
+        .pSetLayouts = &vk->textures.layout,
         .pushConstantRangeCount = 1,
         .pPushConstantRanges = &push_range,
     };
 
-    if (vkCreatePipelineLayout(vk->device, &layout_info, NULL, &vk->blit_pipeline.layout) != VK_SUCCESS) {
-        vk_log(LOG_ERROR, "failed to create blit pipeline layout");
+    if (vkCreatePipelineLayout(vk->device, &layout_info, NULL, &vk->image_pipeline.layout) != VK_SUCCESS) {
+        vk_log(LOG_ERROR, "failed to create image pipeline layout");
         return false;
     }
 
-    // Shader stages
+    // Create shader module for image fragment shader
+    VkShaderModule image_frag = create_shader_module(vk->device, image_frag_spv, image_frag_spv_size);
+    if (!image_frag) {
+        vk_log(LOG_ERROR, "failed to create image shader module");
+        return false;
+    }
+
+    // Shader stages (instanced overlay vertex shader from the mirror pipeline)
     VkPipelineShaderStageCreateInfo shader_stages[] = {
         {
             .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
             .stage = VK_SHADER_STAGE_VERTEX_BIT,
-            .module = vk->blit_pipeline.vert,
+            .module = vk->overlay.vert,
             .pName = "main",
         },
         {
             .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
             .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
-            .module = vk->blit_pipeline.frag,
+            .module = image_frag,
             .pName = "main",
         },
     };
 
-    // Vertex input - simple pos + uv
-    VkVertexInputBindingDescription binding = {
-        .binding = 0,
-        .stride = sizeof(struct quad_vertex),  // pos(2) + uv(2)
-        .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
-    };
-
-    VkVertexInputAttributeDescription attributes[] = {
-        { .location = 0, .binding = 0, .format = VK_FORMAT_R32G32_SFLOAT, .offset = 0 },                    // a_pos
-        { .location = 1, .binding = 0, .format = VK_FORMAT_R32G32_SFLOAT, .offset = sizeof(float) * 2 },    // a_uv
-    };
-
     VkPipelineVertexInputStateCreateInfo vertex_input = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
-        .vertexBindingDescriptionCount = 1,
-        .pVertexBindingDescriptions = &binding,
-        .vertexAttributeDescriptionCount = ARRAY_LEN(attributes),
-        .pVertexAttributeDescriptions = attributes,
+        .vertexBindingDescriptionCount = ARRAY_LEN(OVERLAY_BINDINGS),
+        .pVertexBindingDescriptions = OVERLAY_BINDINGS,
+        .vertexAttributeDescriptionCount = ARRAY_LEN(OVERLAY_ATTRIBUTES),
+        .pVertexAttributeDescriptions = OVERLAY_ATTRIBUTES,
     };
 
     VkPipelineInputAssemblyStateCreateInfo input_assembly = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
         .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
-        .primitiveRestartEnable = VK_FALSE,
     };
 
     VkDynamicState dynamic_states[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
@@ -2127,36 +4156,38 @@ create_blit_pipeline(struct server_vk *vk) {
 
     VkPipelineRasterizationStateCreateInfo rasterization = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
-        .depthClampEnable = VK_FALSE,
-        .rasterizerDiscardEnable = VK_FALSE,
         .polygonMode = VK_POLYGON_MODE_FILL,
         .lineWidth = 1.0f,
         .cullMode = VK_CULL_MODE_NONE,
         .frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE,
-        .depthBiasEnable = VK_FALSE,
     };
 
     VkPipelineMultisampleStateCreateInfo multisampling = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
-        .sampleShadingEnable = VK_FALSE,
         .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
     };
 
-    // No blending - opaque copy
+    // Pre-multiplied alpha blending for images with transparency
+    // Shader outputs pre-multiplied colors (rgb * a, a), so use ONE for srcColor
     VkPipelineColorBlendAttachmentState blend_attachment = {
         .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
                           VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
-        .blendEnable = VK_FALSE,
+        .blendEnable = VK_TRUE,
+        .srcColorBlendFactor = VK_BLEND_FACTOR_ONE,  // Pre-multiplied: colors already include alpha
+        .dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+        .colorBlendOp = VK_BLEND_OP_ADD,
+        .srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
+        .dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+        .alphaBlendOp = VK_BLEND_OP_ADD,
     };
 
     VkPipelineColorBlendStateCreateInfo color_blending = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
-        .logicOpEnable = VK_FALSE,
         .attachmentCount = 1,
         .pAttachments = &blend_attachment,
     };
 
-    VkGraphicsPipelineCreateInfo pipeline_info = {
+    VkGraphicsPipelineCreateInfo pipeline_ci = {
         .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
         .stageCount = ARRAY_LEN(shader_stages),
         .pStages = shader_stages,
@@ -2167,1008 +4198,1658 @@ create_blit_pipeline(struct server_vk *vk) {
         .pMultisampleState = &multisampling,
         .pColorBlendState = &color_blending,
         .pDynamicState = &dynamic_state,
-        .layout = vk->blit_pipeline.layout,
+        .layout = vk->image_pipeline.layout,
         .renderPass = vk->render_pass,
         .subpass = 0,
     };
 
-    VkResult result = vkCreateGraphicsPipelines(vk->device, VK_NULL_HANDLE, 1, &pipeline_info,
-                                                 NULL, &vk->blit_pipeline.pipeline);
-    if (result != VK_SUCCESS) {
-        vk_log(LOG_ERROR, "failed to create blit pipeline: %d", result);
-        return false;
+    VkResult result = vkCreateGraphicsPipelines(vk->device, vk->pipeline_cache, 1, &pipeline_ci, NULL, &vk->image_pipeline.pipeline);
+
+    // Clean up shader module (don't need to keep it)
+    vkDestroyShaderModule(vk->device, image_frag, NULL);
+
+    if (result != VK_SUCCESS) {
+        vk_log(LOG_ERROR, "failed to create image pipeline: %d", result);
+        return false;
+    }
+
+    vk_log(LOG_INFO, "created image pipeline");
+    return true;
+}
+
+static void
+destroy_pipeline(struct server_vk *vk, struct vk_pipeline *pipeline) {
+    if (pipeline->pipeline) {
+        vkDestroyPipeline(vk->device, pipeline->pipeline, NULL);
+    }
+    if (pipeline->layout) {
+        vkDestroyPipelineLayout(vk->device, pipeline->layout, NULL);
+    }
+    // Don't destroy shared descriptor layout here
+    if (pipeline->frag && pipeline->frag != vk->texcopy_pipeline.frag) {
+        vkDestroyShaderModule(vk->device, pipeline->frag, NULL);
+    }
+    // Vert shader is shared
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+struct server_vk *
+server_vk_create(struct server *server, struct config *cfg) {
+    struct server_vk *vk = zalloc(1, sizeof(*vk));
+    vk->server = server;
+    vk->drm_fd = -1;
+    vk->fps_last_time_ms = now_ms();
+    vk->fps_frame_count = 0;
+    vk->disable_capture_sync_wait = getenv("WAYWALL_DISABLE_CAPTURE_SYNC_WAIT") != NULL;
+    vk->damage.disabled = getenv("WAYWALL_VK_NO_DAMAGE") != NULL;
+    vk->capture.resident_disabled = getenv("WAYWALL_VK_NO_RESIDENT") != NULL;
+    vk->passthrough.disabled = getenv("WAYWALL_VK_NO_PASSTHROUGH") != NULL;
+    vk->transfer_present.disabled = getenv("WAYWALL_VK_NO_TRANSFER_PRESENT") != NULL;
+    // Prefer modifier-based dma-buf imports when we know we're doing cross-GPU (subprocess offload)
+    // to avoid ReBAR-limited linear paths. Env can still force it.
+    bool env_allow_mods = getenv("WAYWALL_DMABUF_ALLOW_MODIFIERS") != NULL;
+    vk->allow_modifiers =
+        env_allow_mods || (server->linux_dmabuf && server->linux_dmabuf->allow_modifiers);
+    vk->proxy_game = getenv("WAYWALL_VK_PROXY_GAME") != NULL;
+    vk->overlay_tick = NULL;
+    vk->overlay_tick_ms = refresh_mhz_to_ms(server->ui ? server->ui->refresh_mhz : 0);
+    vk->pacing.enabled = !vk->proxy_game && getenv("WAYWALL_VK_PACING") != NULL;
+    vk->pacing.timer_fd = -1;
+
+    vk_log(LOG_INFO, "creating Vulkan backend");
+
+    wl_list_init(&vk->capture.buffers);
+    wl_list_init(&vk->mirrors);
+    wl_list_init(&vk->images);
+    wl_list_init(&vk->pending_images);
+    wl_list_init(&vk->upload.batches);
+    wl_list_init(&vk->memory.blocks);
+    wl_list_init(&vk->atlases);
+    wl_list_init(&vk->texts);
+    wl_list_init(&vk->views);
+    wl_signal_init(&vk->events.frame);
+    wl_list_init(&vk->on_ui_resize.link);
+    wl_list_init(&vk->on_ui_refresh.link);
+    wl_list_init(&vk->pacing.feedbacks);
+
+    // Create Vulkan instance
+    if (!create_instance(vk)) {
+        goto fail;
+    }
+
+    // Create Wayland surface as subsurface of UI (need this before selecting physical device)
+    vk->swapchain.wl_surface = wl_compositor_create_surface(server->backend->compositor);
+    if (!vk->swapchain.wl_surface) {
+        vk_log(LOG_ERROR, "failed to create Wayland surface");
+        goto fail;
+    }
+
+    // Set empty input region (we don't want input events)
+    wl_surface_set_input_region(vk->swapchain.wl_surface, server->ui->empty_region);
+
+    // Create subsurface of main UI surface
+    vk->swapchain.subsurface = wl_subcompositor_get_subsurface(
+        server->backend->subcompositor, vk->swapchain.wl_surface, server->ui->tree.surface);
+    if (!vk->swapchain.subsurface) {
+        vk_log(LOG_ERROR, "failed to create subsurface");
+        goto fail;
+    }
+    wl_subsurface_set_desync(vk->swapchain.subsurface);
+    wl_subsurface_set_position(vk->swapchain.subsurface, 0, 0);
+    // Match GL behavior - don't call place_below, let subsurface stack naturally
+
+    VkWaylandSurfaceCreateInfoKHR surface_info = {
+        .sType = VK_STRUCTURE_TYPE_WAYLAND_SURFACE_CREATE_INFO_KHR,
+        .display = server->backend->display,
+        .surface = vk->swapchain.wl_surface,
+    };
+
+    if (vkCreateWaylandSurfaceKHR(vk->instance, &surface_info, NULL,
+                                   &vk->swapchain.surface) != VK_SUCCESS) {
+        vk_log(LOG_ERROR, "failed to create Vulkan Wayland surface");
+        goto fail;
+    }
+
+    // Select physical device and create logical device
+    if (!select_physical_device(vk) || !create_device(vk)) {
+        goto fail;
+    }
+
+    if (!create_uploader(vk)) {
+        goto fail;
+    }
+
+    // Create swapchain with initial size
+    uint32_t width = server->ui ? server->ui->width : 640;
+    uint32_t height = server->ui ? server->ui->height : 480;
+    if (!create_swapchain(vk, width, height, VK_NULL_HANDLE)) {
+        goto fail;
+    }
+
+    // Create render pass and framebuffers
+    if (!create_render_pass(vk) || !create_framebuffers(vk)) {
+        goto fail;
+    }
+
+    // Create command pool and sync objects
+    if (!create_command_pool(vk) || !create_sync_objects(vk)) {
+        goto fail;
+    }
+
+    if (!create_frame_timing(vk) || !create_capture_copy(vk)) {
+        goto fail;
     }
+    create_import_tune(vk);
 
-    vk_log(LOG_INFO, "created blit pipeline");
-    return true;
-}
+    if (vk->pacing.enabled && !create_frame_pacing(vk)) {
+        goto fail;
+    }
 
-// Create buffer-based blit pipeline for NATIVE cross-GPU rendering
-// Uses storage buffer instead of sampled image to handle stride mismatch
-static bool
-create_buffer_blit_pipeline(struct server_vk *vk) {
-    // Create shader module for buffer-based fragment shader
-    vk->buffer_blit.frag = create_shader_module(vk->device, blit_buffer_frag_spv, blit_buffer_frag_spv_size);
-    if (!vk->buffer_blit.frag) {
-        vk_log(LOG_ERROR, "failed to create buffer blit shader module");
-        return false;
+    // Decode images off the main thread. Leave most cores to the game.
+    long decode_threads = sysconf(_SC_NPROCESSORS_ONLN) / 4;
+    const char *env_decode_threads = getenv("WAYWALL_DECODE_THREADS");
+    if (env_decode_threads) {
+        decode_threads = strtol(env_decode_threads, NULL, 10);
     }
+    if (decode_threads < 1) decode_threads = 1;
+    if (decode_threads > 8) decode_threads = 8;
 
-    // Create descriptor set layout for storage buffer
-    VkDescriptorSetLayoutBinding buffer_binding = {
-        .binding = 0,
-        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-        .descriptorCount = 1,
-        .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
-    };
+    vk->decode_pool = ww_decode_pool_create(wl_display_get_event_loop(server->display), (size_t)decode_threads);
+    if (!vk->decode_pool) {
+        vk_log(LOG_ERROR, "failed to create image decode pool");
+        goto fail;
+    }
 
-    VkDescriptorSetLayoutCreateInfo layout_ci = {
-        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-        .bindingCount = 1,
-        .pBindings = &buffer_binding,
-    };
+    // Create sampler and descriptor pool
+    if (!create_sampler(vk) || !create_descriptor_pool(vk) || !create_texture_table(vk)) {
+        goto fail;
+    }
 
-    if (vkCreateDescriptorSetLayout(vk->device, &layout_ci, NULL, &vk->buffer_blit.descriptor_layout) != VK_SUCCESS) {
-        vk_log(LOG_ERROR, "failed to create buffer blit descriptor layout");
-        return false;
+    // Create pipelines
+    create_pipeline_cache(vk);
+    if (!create_texcopy_pipeline(vk) || !create_text_pipeline(vk) || !create_blit_pipeline(vk) || !create_buffer_blit_pipeline(vk) || !create_mirror_pipeline(vk) || !create_image_pipeline(vk) || !create_text_vk_pipeline(vk)) {
+        goto fail;
     }
+    save_pipeline_cache(vk);
 
-    // Push constants: width, height, stride, swap_colors, src_x, src_y, src_w, src_h
-    VkPushConstantRange push_range = {
-        .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
-        .offset = 0,
-        .size = sizeof(int32_t) * 8,  // 8 ints for source cropping
-    };
+    // Initialize font system for text rendering
+    const char *font_path = cfg ? cfg->theme.font_path : NULL;
+    if (font_path && font_path[0]) {
+        if (!init_font_system(vk, font_path, cfg->theme.font_prewarm)) {
+            vk_log(LOG_WARN, "font system initialization failed, text rendering disabled");
+        }
+    } else {
+        vk_log(LOG_INFO, "no font path configured, text rendering disabled");
+    }
 
-    VkPipelineLayoutCreateInfo pipeline_layout_ci = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-        .setLayoutCount = 1,
-        .pSetLayouts = &vk->buffer_blit.descriptor_layout,
-        .pushConstantRangeCount = 1,
-        .pPushConstantRanges = &push_range,
-    };
+    // Create fullscreen quad vertex buffer
+    if (!create_quad_vertex_buffer(vk)) {
+        goto fail;
+    }
 
-    if (vkCreatePipelineLayout(vk->device, &pipeline_layout_ci, NULL, &vk->buffer_blit.layout) != VK_SUCCESS) {
-        vk_log(LOG_ERROR, "failed to create buffer blit pipeline layout");
-        return false;
+    // Open DRM device for dma-buf operations
+    vk->drm_fd = open("/dev/dri/renderD128", O_RDWR | O_CLOEXEC);
+    if (vk->drm_fd >= 0) {
+        vk->gbm = gbm_create_device(vk->drm_fd);
+        if (!vk->gbm) {
+            vk_log(LOG_WARN, "failed to create GBM device");
+        }
     }
 
-    // Create graphics pipeline (reuse vertex shader from blit)
-    VkPipelineShaderStageCreateInfo shader_stages[] = {
-        {
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-            .stage = VK_SHADER_STAGE_VERTEX_BIT,
-            .module = vk->blit_pipeline.vert,  // Reuse vertex shader
-            .pName = "main",
-        },
-        {
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-            .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
-            .module = vk->buffer_blit.frag,
-            .pName = "main",
-        },
-    };
+    // Hook up resize listener
+    vk->on_ui_resize.notify = on_ui_resize;
+    wl_signal_add(&server->ui->events.resize, &vk->on_ui_resize);
 
-    VkVertexInputBindingDescription binding = {
-        .binding = 0,
-        .stride = sizeof(struct quad_vertex),
-        .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
-    };
+    if (vk->proxy_game) {
+        VkCommandBufferAllocateInfo alloc_info = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .commandPool = vk->command_pool,
+            .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            .commandBufferCount = DMABUF_EXPORT_MAX,
+        };
+        VkResult result =
+            vkAllocateCommandBuffers(vk->device, &alloc_info, vk->proxy_copy.command_buffers);
+        if (result != VK_SUCCESS) {
+            vk_log(LOG_ERROR, "failed to allocate proxy copy command buffers: %d", result);
+            goto fail;
+        }
 
-    VkVertexInputAttributeDescription attributes[] = {
-        { .location = 0, .binding = 0, .format = VK_FORMAT_R32G32_SFLOAT, .offset = 0 },
-        { .location = 1, .binding = 0, .format = VK_FORMAT_R32G32_SFLOAT, .offset = sizeof(float) * 2 },
-    };
+        VkFenceCreateInfo fence_info = {
+            .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+            .flags = VK_FENCE_CREATE_SIGNALED_BIT,
+        };
+        for (uint32_t i = 0; i < DMABUF_EXPORT_MAX; i++) {
+            result = vkCreateFence(vk->device, &fence_info, NULL, &vk->proxy_copy.fences[i]);
+            if (result != VK_SUCCESS) {
+                vk_log(LOG_ERROR, "failed to create proxy copy fence: %d", result);
+                goto fail;
+            }
+        }
+        vk->proxy_copy.index = 0;
 
-    VkPipelineVertexInputStateCreateInfo vertex_input = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
-        .vertexBindingDescriptionCount = 1,
-        .pVertexBindingDescriptions = &binding,
-        .vertexAttributeDescriptionCount = ARRAY_LEN(attributes),
-        .pVertexAttributeDescriptions = attributes,
-    };
+        // Drive overlay rendering independently of the game’s surface commits.
+        vk->on_ui_refresh.notify = on_ui_refresh;
+        wl_signal_add(&server->ui->events.refresh, &vk->on_ui_refresh);
 
-    VkPipelineInputAssemblyStateCreateInfo input_assembly = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
-        .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
-    };
+        struct wl_event_loop *loop = wl_display_get_event_loop(server->display);
+        vk->overlay_tick = wl_event_loop_add_timer(loop, handle_overlay_tick, vk);
+        check_alloc(vk->overlay_tick);
+        wl_event_source_timer_update(vk->overlay_tick, vk->overlay_tick_ms);
+    }
 
-    VkDynamicState dynamic_states[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
-    VkPipelineDynamicStateCreateInfo dynamic_state = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
-        .dynamicStateCount = ARRAY_LEN(dynamic_states),
-        .pDynamicStates = dynamic_states,
-    };
+    vk_log(LOG_INFO, "Vulkan backend initialized successfully");
+    return vk;
 
-    VkPipelineViewportStateCreateInfo viewport_state = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
-        .viewportCount = 1,
-        .scissorCount = 1,
-    };
+fail:
+    server_vk_destroy(vk);
+    return NULL;
+}
 
-    VkPipelineRasterizationStateCreateInfo rasterization = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
-        .polygonMode = VK_POLYGON_MODE_FILL,
-        .lineWidth = 1.0f,
-        .cullMode = VK_CULL_MODE_NONE,
-        .frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE,
-    };
+void
+server_vk_destroy(struct server_vk *vk) {
+    if (!vk) return;
 
-    VkPipelineMultisampleStateCreateInfo multisampling = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
-        .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
-    };
+    // Remove UI resize listener
+    wl_list_remove(&vk->on_ui_resize.link);
+    wl_list_remove(&vk->on_ui_refresh.link);
 
-    VkPipelineColorBlendAttachmentState blend_attachment = {
-        .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
-                          VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
-        .blendEnable = VK_FALSE,
-    };
+    if (vk->overlay_tick) {
+        wl_event_source_remove(vk->overlay_tick);
+        vk->overlay_tick = NULL;
+    }
 
-    VkPipelineColorBlendStateCreateInfo color_blending = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
-        .attachmentCount = 1,
-        .pAttachments = &blend_attachment,
-    };
+    destroy_frame_pacing(vk);
 
-    VkGraphicsPipelineCreateInfo pipeline_ci = {
-        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
-        .stageCount = ARRAY_LEN(shader_stages),
-        .pStages = shader_stages,
-        .pVertexInputState = &vertex_input,
-        .pInputAssemblyState = &input_assembly,
-        .pViewportState = &viewport_state,
-        .pRasterizationState = &rasterization,
-        .pMultisampleState = &multisampling,
-        .pColorBlendState = &color_blending,
-        .pDynamicState = &dynamic_state,
-        .layout = vk->buffer_blit.layout,
-        .renderPass = vk->render_pass,
-        .subpass = 0,
-    };
+    if (vk->decode_pool) {
+        ww_decode_pool_destroy(vk->decode_pool);
+        vk->decode_pool = NULL;
+
+        struct vk_image *image;
+        wl_list_for_each(image, &vk->pending_images, link) {
+            image->decode = NULL;
+        }
+    }
+
+    if (vk->device) {
+        for (uint32_t i = 0; i < DMABUF_EXPORT_MAX; i++) {
+            if (vk->proxy_copy.fences[i]) {
+                vkDestroyFence(vk->device, vk->proxy_copy.fences[i], NULL);
+                vk->proxy_copy.fences[i] = VK_NULL_HANDLE;
+            }
+        }
+
+        vkDeviceWaitIdle(vk->device);
+    }
+
+    // Destroy capture buffers
+    struct vk_buffer *buf, *tmp;
+    wl_list_for_each_safe(buf, tmp, &vk->capture.buffers, link) {
+        vk_buffer_destroy(buf);
+    }
+
+    // Destroy text objects
+    struct vk_text *text, *text_tmp;
+    wl_list_for_each_safe(text, text_tmp, &vk->texts, link) {
+        if (text->vertex_buffer) {
+            vkDestroyBuffer(vk->device, text->vertex_buffer, NULL);
+            vk_free(vk, &text->vertex_memory);
+        }
+        wl_list_remove(&text->link);
+        free(text->vertices);
+        free(text->text);
+        free(text);
+    }
+    destroy_text_stream(vk);
+
+    for (uint32_t i = 0; i < VK_MAX_FRAMES_IN_FLIGHT; i++) {
+        destroy_resident_capture(vk, &vk->capture.resident[i]);
+    }
+    if (vk->device) {
+        destroy_capture_copy(vk);
+    }
+
+    // Destroy font system
+    destroy_font_system(vk);
+    destroy_layout_cache(vk);
+
+    destroy_import_tune(vk);
+    destroy_frame_timing(vk);
+
+    if (vk->device) {
+        destroy_uploader(vk);
+        destroy_memory_blocks(vk);
+    }
 
-    if (vkCreateGraphicsPipelines(vk->device, VK_NULL_HANDLE, 1, &pipeline_ci, NULL, &vk->buffer_blit.pipeline) != VK_SUCCESS) {
-        vk_log(LOG_ERROR, "failed to create buffer blit pipeline");
-        return false;
+    // Destroy sync objects
+    for (int i = 0; i < VK_MAX_FRAMES_IN_FLIGHT; i++) {
+        if (vk->image_available[i]) {
+            vkDestroySemaphore(vk->device, vk->image_available[i], NULL);
+        }
+        if (vk->render_finished[i]) {
+            vkDestroySemaphore(vk->device, vk->render_finished[i], NULL);
+        }
+        if (vk->in_flight[i]) {
+            vkDestroyFence(vk->device, vk->in_flight[i], NULL);
+        }
+        release_watch_destroy(vk, &vk->capture.release[i]);
     }
 
-    vk_log(LOG_INFO, "created buffer blit pipeline (NATIVE cross-GPU)");
-    return true;
-}
+    if (vk->command_pool) {
+        vkDestroyCommandPool(vk->device, vk->command_pool, NULL);
+    }
 
-// Mirror push constants structure (must match shader)
-struct mirror_push_constants {
-    int32_t game_width;
-    int32_t game_height;
-    int32_t game_stride;
-    int32_t src_x;
-    int32_t src_y;
-    int32_t src_w;
-    int32_t src_h;
-    int32_t color_key_enabled;
-    float key_r, key_g, key_b;
-    float out_r, out_g, out_b;
-    float tolerance;
-};
+    if (vk->descriptor_pool) {
+        vkDestroyDescriptorPool(vk->device, vk->descriptor_pool, NULL);
+    }
+    destroy_texture_table(vk);
 
-static bool
-create_mirror_pipeline(struct server_vk *vk) {
-    // Create shader module for mirror fragment shader
-    vk->mirror_pipeline.frag = create_shader_module(vk->device, mirror_frag_spv, mirror_frag_spv_size);
-    if (!vk->mirror_pipeline.frag) {
-        vk_log(LOG_ERROR, "failed to create mirror shader module");
-        return false;
+    if (vk->sampler) {
+        vkDestroySampler(vk->device, vk->sampler, NULL);
+    }
+    if (vk->linear_sampler) {
+        vkDestroySampler(vk->device, vk->linear_sampler, NULL);
     }
 
-    // Push constants for mirror parameters
-    VkPushConstantRange push_range = {
-        .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
-        .offset = 0,
-        .size = sizeof(struct mirror_push_constants),
-    };
+    // Destroy quad vertex buffer
+    if (vk->quad_vertex_buffer) {
+        vkDestroyBuffer(vk->device, vk->quad_vertex_buffer, NULL);
+    }
+    if (vk->quad_vertex_memory) {
+        vkFreeMemory(vk->device, vk->quad_vertex_memory, NULL);
+    }
 
-    VkPipelineLayoutCreateInfo pipeline_layout_ci = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-        .setLayoutCount = 1,
-        .pSetLayouts = &vk->buffer_blit.descriptor_layout,  // Reuse storage buffer layout
-        .pushConstantRangeCount = 1,
-        .pPushConstantRanges = &push_range,
-    };
+    // Destroy pipelines
+    destroy_pipeline_cache(vk);
+    destroy_pipeline(vk, &vk->text_pipeline);
+    destroy_pipeline(vk, &vk->texcopy_pipeline);
+    destroy_pipeline(vk, &vk->blit_pipeline);
 
-    if (vkCreatePipelineLayout(vk->device, &pipeline_layout_ci, NULL, &vk->mirror_pipeline.layout) != VK_SUCCESS) {
-        vk_log(LOG_ERROR, "failed to create mirror pipeline layout");
-        return false;
+    // Destroy buffer blit pipeline resources
+    if (vk->buffer_blit.pipeline) {
+        vkDestroyPipeline(vk->device, vk->buffer_blit.pipeline, NULL);
+    }
+    if (vk->buffer_blit.layout) {
+        vkDestroyPipelineLayout(vk->device, vk->buffer_blit.layout, NULL);
+    }
+    if (vk->buffer_blit.descriptor_layout) {
+        vkDestroyDescriptorSetLayout(vk->device, vk->buffer_blit.descriptor_layout, NULL);
+    }
+    if (vk->buffer_blit.frag) {
+        vkDestroyShaderModule(vk->device, vk->buffer_blit.frag, NULL);
     }
 
-    // Create graphics pipeline (reuse vertex shader from blit)
-    VkPipelineShaderStageCreateInfo shader_stages[] = {
-        {
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-            .stage = VK_SHADER_STAGE_VERTEX_BIT,
-            .module = vk->blit_pipeline.vert,
-            .pName = "main",
-        },
-        {
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-            .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
-            .module = vk->mirror_pipeline.frag,
-            .pName = "main",
-        },
-    };
+    // Destroy mirror pipeline
+    if (vk->mirror_pipeline.pipeline) {
+        vkDestroyPipeline(vk->device, vk->mirror_pipeline.pipeline, NULL);
+    }
+    if (vk->mirror_pipeline.layout) {
+        vkDestroyPipelineLayout(vk->device, vk->mirror_pipeline.layout, NULL);
+    }
+    if (vk->mirror_pipeline.frag) {
+        vkDestroyShaderModule(vk->device, vk->mirror_pipeline.frag, NULL);
+    }
+    if (vk->mirror_pipeline.resident_pipeline) {
+        vkDestroyPipeline(vk->device, vk->mirror_pipeline.resident_pipeline, NULL);
+    }
+    if (vk->mirror_pipeline.resident_layout) {
+        vkDestroyPipelineLayout(vk->device, vk->mirror_pipeline.resident_layout, NULL);
+    }
+    if (vk->mirror_pipeline.resident_frag) {
+        vkDestroyShaderModule(vk->device, vk->mirror_pipeline.resident_frag, NULL);
+    }
+    if (vk->overlay.vert) {
+        vkDestroyShaderModule(vk->device, vk->overlay.vert, NULL);
+    }
+    for (int i = 0; i < VK_MAX_FRAMES_IN_FLIGHT; i++) {
+        if (vk->overlay.instance_buffers[i]) {
+            vkDestroyBuffer(vk->device, vk->overlay.instance_buffers[i], NULL);
+        }
+        if (vk->overlay.instance_memories[i]) {
+            vkFreeMemory(vk->device, vk->overlay.instance_memories[i], NULL);
+        }
+    }
 
-    VkVertexInputBindingDescription binding = {
-        .binding = 0,
-        .stride = sizeof(struct quad_vertex),
-        .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
-    };
+    // Destroy mirrors
+    struct vk_mirror *mirror, *tmp_mirror;
+    wl_list_for_each_safe(mirror, tmp_mirror, &vk->mirrors, link) {
+        wl_list_remove(&mirror->link);
+        free(mirror);
+    }
+    free(vk->render_list.items);
+    free(vk->damage.images);
 
-    VkVertexInputAttributeDescription attributes[] = {
-        { .location = 0, .binding = 0, .format = VK_FORMAT_R32G32_SFLOAT, .offset = 0 },
-        { .location = 1, .binding = 0, .format = VK_FORMAT_R32G32_SFLOAT, .offset = sizeof(float) * 2 },
-    };
+    // Destroy shader modules and descriptor layouts
+    if (vk->texcopy_pipeline.vert) {
+        vkDestroyShaderModule(vk->device, vk->texcopy_pipeline.vert, NULL);
+    }
+    if (vk->texcopy_pipeline.frag) {
+        vkDestroyShaderModule(vk->device, vk->texcopy_pipeline.frag, NULL);
+    }
+    if (vk->texcopy_pipeline.descriptor_layout) {
+        vkDestroyDescriptorSetLayout(vk->device, vk->texcopy_pipeline.descriptor_layout, NULL);
+    }
+    // Destroy blit pipeline's own resources
+    if (vk->blit_pipeline.vert) {
+        vkDestroyShaderModule(vk->device, vk->blit_pipeline.vert, NULL);
+    }
+    if (vk->blit_pipeline.descriptor_layout) {
+        vkDestroyDescriptorSetLayout(vk->device, vk->blit_pipeline.descriptor_layout, NULL);
+    }
 
-    VkPipelineVertexInputStateCreateInfo vertex_input = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
-        .vertexBindingDescriptionCount = 1,
-        .pVertexBindingDescriptions = &binding,
-        .vertexAttributeDescriptionCount = ARRAY_LEN(attributes),
-        .pVertexAttributeDescriptions = attributes,
-    };
+    // Destroy framebuffers
+    if (vk->swapchain.framebuffers) {
+        for (uint32_t i = 0; i < vk->swapchain.image_count; i++) {
+            if (vk->swapchain.framebuffers[i]) {
+                vkDestroyFramebuffer(vk->device, vk->swapchain.framebuffers[i], NULL);
+            }
+        }
+        free(vk->swapchain.framebuffers);
+    }
 
-    VkPipelineInputAssemblyStateCreateInfo input_assembly = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
-        .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
-    };
+    if (vk->render_pass) {
+        vkDestroyRenderPass(vk->device, vk->render_pass, NULL);
+    }
+    if (vk->render_pass_load) {
+        vkDestroyRenderPass(vk->device, vk->render_pass_load, NULL);
+    }
 
-    VkDynamicState dynamic_states[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
-    VkPipelineDynamicStateCreateInfo dynamic_state = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
-        .dynamicStateCount = ARRAY_LEN(dynamic_states),
-        .pDynamicStates = dynamic_states,
-    };
+    // Destroy swapchain views
+    if (vk->swapchain.views) {
+        for (uint32_t i = 0; i < vk->swapchain.image_count; i++) {
+            if (vk->swapchain.views[i]) {
+                vkDestroyImageView(vk->device, vk->swapchain.views[i], NULL);
+            }
+        }
+        free(vk->swapchain.views);
+    }
+    free(vk->swapchain.images);
 
-    VkPipelineViewportStateCreateInfo viewport_state = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
-        .viewportCount = 1,
-        .scissorCount = 1,
-    };
+    if (vk->swapchain.swapchain) {
+        vkDestroySwapchainKHR(vk->device, vk->swapchain.swapchain, NULL);
+    }
 
-    VkPipelineRasterizationStateCreateInfo rasterization = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
-        .polygonMode = VK_POLYGON_MODE_FILL,
-        .lineWidth = 1.0f,
-        .cullMode = VK_CULL_MODE_NONE,
-        .frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE,
-    };
+    if (vk->swapchain.surface) {
+        vkDestroySurfaceKHR(vk->instance, vk->swapchain.surface, NULL);
+    }
 
-    VkPipelineMultisampleStateCreateInfo multisampling = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
-        .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
-    };
+    if (vk->passthrough.subsurface) {
+        wl_subsurface_destroy(vk->passthrough.subsurface);
+    }
 
-    // Pre-multiplied alpha blending for mirrors
-    // Mirror outputs either opaque (alpha=1) or fully transparent (alpha=0), both are pre-multiplied
-    VkPipelineColorBlendAttachmentState blend_attachment = {
-        .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
-                          VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
-        .blendEnable = VK_TRUE,
-        .srcColorBlendFactor = VK_BLEND_FACTOR_ONE,  // Pre-multiplied alpha
-        .dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
-        .colorBlendOp = VK_BLEND_OP_ADD,
-        .srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
-        .dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
-        .alphaBlendOp = VK_BLEND_OP_ADD,
-    };
+    if (vk->swapchain.subsurface) {
+        wl_subsurface_destroy(vk->swapchain.subsurface);
+    }
 
-    VkPipelineColorBlendStateCreateInfo color_blending = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
-        .attachmentCount = 1,
-        .pAttachments = &blend_attachment,
-    };
+    if (vk->swapchain.wl_surface) {
+        wl_surface_destroy(vk->swapchain.wl_surface);
+    }
 
-    VkGraphicsPipelineCreateInfo pipeline_ci = {
-        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
-        .stageCount = ARRAY_LEN(shader_stages),
-        .pStages = shader_stages,
-        .pVertexInputState = &vertex_input,
-        .pInputAssemblyState = &input_assembly,
-        .pViewportState = &viewport_state,
-        .pRasterizationState = &rasterization,
-        .pMultisampleState = &multisampling,
-        .pColorBlendState = &color_blending,
-        .pDynamicState = &dynamic_state,
-        .layout = vk->mirror_pipeline.layout,
-        .renderPass = vk->render_pass,
-        .subpass = 0,
-    };
+    if (vk->device) {
+        vkDestroyDevice(vk->device, NULL);
+    }
 
-    if (vkCreateGraphicsPipelines(vk->device, VK_NULL_HANDLE, 1, &pipeline_ci, NULL, &vk->mirror_pipeline.pipeline) != VK_SUCCESS) {
-        vk_log(LOG_ERROR, "failed to create mirror pipeline");
-        return false;
+    if (vk->instance) {
+        vkDestroyInstance(vk->instance, NULL);
+    }
+
+    if (vk->gbm) {
+        gbm_device_destroy(vk->gbm);
+    }
+
+    if (vk->drm_fd >= 0) {
+        close(vk->drm_fd);
     }
 
-    vk_log(LOG_INFO, "created mirror pipeline");
-    return true;
+    free(vk);
 }
 
-static bool
-create_image_pipeline(struct server_vk *vk) {
-    // Create descriptor set layout for images (same as blit - combined image sampler)
-    if (!create_descriptor_set_layout(vk, &vk->image_pipeline.descriptor_layout)) {
-        vk_log(LOG_ERROR, "failed to create image descriptor set layout");
-        return false;
+void
+server_vk_set_capture(struct server_vk *vk, struct server_surface *surface) {
+    if (vk->capture.surface) {
+        wl_list_remove(&vk->on_surface_commit.link);
+        wl_list_remove(&vk->on_surface_destroy.link);
     }
+    passthrough_unmap(vk);
+    vk->passthrough.streak = 0;
 
-    // Pipeline layout (no push constants needed - viewport controls position)
-    VkPipelineLayoutCreateInfo layout_info = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-        .setLayoutCount = 1,
-        .pSetLayouts = &vk->image_pipeline.descriptor_layout,
-    };
+    vk->capture.surface = surface;
+    vk->capture.current = NULL;
+    damage_full(vk);
 
-    if (vkCreatePipelineLayout(vk->device, &layout_info, NULL, &vk->image_pipeline.layout) != VK_SUCCESS) {
-        vk_log(LOG_ERROR, "failed to create image pipeline layout");
-        return false;
+    if (!surface) {
+        return;
     }
 
-    // Create shader module for image fragment shader
-    VkShaderModule image_frag = create_shader_module(vk->device, image_frag_spv, image_frag_spv_size);
-    if (!image_frag) {
-        vk_log(LOG_ERROR, "failed to create image shader module");
-        return false;
+    vk->on_surface_commit.notify = on_surface_commit;
+    wl_signal_add(&surface->events.commit, &vk->on_surface_commit);
+
+    vk->on_surface_destroy.notify = on_surface_destroy;
+    wl_signal_add(&surface->events.destroy, &vk->on_surface_destroy);
+}
+
+VkImageView
+server_vk_get_capture(struct server_vk *vk) {
+    if (!vk->capture.current) {
+        return VK_NULL_HANDLE;
     }
+    return vk->capture.current->view;
+}
 
-    // Shader stages (reuse vertex shader from blit)
-    VkPipelineShaderStageCreateInfo shader_stages[] = {
-        {
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-            .stage = VK_SHADER_STAGE_VERTEX_BIT,
-            .module = vk->blit_pipeline.vert,
-            .pName = "main",
-        },
-        {
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-            .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
-            .module = image_frag,
-            .pName = "main",
+void
+server_vk_get_capture_size(struct server_vk *vk, int32_t *width, int32_t *height) {
+    if (!vk->capture.current || !vk->capture.current->parent) {
+        *width = 0;
+        *height = 0;
+        return;
+    }
+
+    struct server_dmabuf_data *data = vk->capture.current->parent->data;
+    *width = data->width;
+    *height = data->height;
+}
+
+// ============================================================================
+// Cross-GPU DMA-BUF Synchronization
+// ============================================================================
+
+// Transition imported image to shader-read layout with proper cross-GPU barrier
+static void
+transition_imported_image(struct server_vk *vk, VkImage image, VkCommandBuffer cmd) {
+    VkImageMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask = 0,  // External GPU writes
+        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+        .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_FOREIGN_EXT,  // From external GPU
+        .dstQueueFamilyIndex = vk->graphics_family,
+        .image = image,
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
         },
     };
 
-    VkVertexInputBindingDescription binding = {
-        .binding = 0,
-        .stride = sizeof(struct quad_vertex),
-        .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
-    };
+    vkCmdPipelineBarrier(cmd,
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0,
+        0, NULL,
+        0, NULL,
+        1, &barrier);
+}
 
-    VkVertexInputAttributeDescription attributes[] = {
-        { .location = 0, .binding = 0, .format = VK_FORMAT_R32G32_SFLOAT, .offset = 0 },
-        { .location = 1, .binding = 0, .format = VK_FORMAT_R32G32_SFLOAT, .offset = sizeof(float) * 2 },
+// Release imported image back to external GPU
+static void
+release_imported_image(struct server_vk *vk, VkImage image, VkCommandBuffer cmd) {
+    VkImageMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_SHADER_READ_BIT,
+        .dstAccessMask = 0,
+        .oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        .newLayout = VK_IMAGE_LAYOUT_GENERAL,
+        .srcQueueFamilyIndex = vk->graphics_family,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_FOREIGN_EXT,  // Back to external GPU
+        .image = image,
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        },
     };
 
-    VkPipelineVertexInputStateCreateInfo vertex_input = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
-        .vertexBindingDescriptionCount = 1,
-        .pVertexBindingDescriptions = &binding,
-        .vertexAttributeDescriptionCount = ARRAY_LEN(attributes),
-        .pVertexAttributeDescriptions = attributes,
-    };
+    vkCmdPipelineBarrier(cmd,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+        0,
+        0, NULL,
+        0, NULL,
+        1, &barrier);
+}
 
-    VkPipelineInputAssemblyStateCreateInfo input_assembly = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
-        .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+// Acquire imported buffer (queue family transfer skipped, relying on dma-buf sync)
+static void
+acquire_imported_buffer(struct server_vk *vk, VkBuffer buffer, VkCommandBuffer cmd) {
+    VkBufferMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .buffer = buffer,
+        .offset = 0,
+        .size = VK_WHOLE_SIZE,
     };
 
-    VkDynamicState dynamic_states[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
-    VkPipelineDynamicStateCreateInfo dynamic_state = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
-        .dynamicStateCount = ARRAY_LEN(dynamic_states),
-        .pDynamicStates = dynamic_states,
-    };
+    // Read either by shaders directly or by the resident capture copy
+    vkCmdPipelineBarrier(cmd,
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0, NULL,
+        1, &barrier,
+        0, NULL);
+}
 
-    VkPipelineViewportStateCreateInfo viewport_state = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
-        .viewportCount = 1,
-        .scissorCount = 1,
+// Release imported buffer
+static void
+release_imported_buffer(struct server_vk *vk, VkBuffer buffer, VkCommandBuffer cmd) {
+    VkBufferMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT,
+        .dstAccessMask = 0,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .buffer = buffer,
+        .offset = 0,
+        .size = VK_WHOLE_SIZE,
     };
 
-    VkPipelineRasterizationStateCreateInfo rasterization = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
-        .polygonMode = VK_POLYGON_MODE_FILL,
-        .lineWidth = 1.0f,
-        .cullMode = VK_CULL_MODE_NONE,
-        .frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE,
-    };
+    vkCmdPipelineBarrier(cmd,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+        0,
+        0, NULL,
+        1, &barrier,
+        0, NULL);
+}
 
-    VkPipelineMultisampleStateCreateInfo multisampling = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
-        .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
-    };
+// Imports the capture surface's acquire point for a submission to wait on. The import is
+// temporary and the wait consumes it, so the next submission imports it again.
+static bool
+capture_sync_acquire(struct server_vk *vk, VkSemaphore *semaphore, uint64_t *value) {
+    if (vk->disable_capture_sync_wait || !pfn_vkImportSemaphoreFdKHR || !vk->capture.surface ||
+        !vk->capture.surface->syncobj) {
+        return false;
+    }
 
-    // Pre-multiplied alpha blending for images with transparency
-    // Shader outputs pre-multiplied colors (rgb * a, a), so use ONE for srcColor
-    VkPipelineColorBlendAttachmentState blend_attachment = {
-        .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
-                          VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
-        .blendEnable = VK_TRUE,
-        .srcColorBlendFactor = VK_BLEND_FACTOR_ONE,  // Pre-multiplied: colors already include alpha
-        .dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
-        .colorBlendOp = VK_BLEND_OP_ADD,
-        .srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
-        .dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
-        .alphaBlendOp = VK_BLEND_OP_ADD,
-    };
+    struct server_drm_syncobj_surface *sync = vk->capture.surface->syncobj;
+    if (sync->acquire.fd == -1) {
+        return false;
+    }
 
-    VkPipelineColorBlendStateCreateInfo color_blending = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
-        .attachmentCount = 1,
-        .pAttachments = &blend_attachment,
+    if (sync->vk_sem == VK_NULL_HANDLE) {
+        VkSemaphoreTypeCreateInfo type_info = {
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+            .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+            .initialValue = 0,
+        };
+        VkSemaphoreCreateInfo info = {
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+            .pNext = &type_info,
+        };
+        vkCreateSemaphore(vk->device, &info, NULL, &sync->vk_sem);
+    }
+
+    int fd_dup = dup(sync->acquire.fd);
+    VkImportSemaphoreFdInfoKHR import = {
+        .sType = VK_STRUCTURE_TYPE_IMPORT_SEMAPHORE_FD_INFO_KHR,
+        .semaphore = sync->vk_sem,
+        .flags = VK_SEMAPHORE_IMPORT_TEMPORARY_BIT,
+        .handleType = VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_OPAQUE_FD_BIT,
+        .fd = fd_dup,
     };
+    if (pfn_vkImportSemaphoreFdKHR(vk->device, &import) != VK_SUCCESS) {
+        close(fd_dup);
+        return false;
+    }
 
-    VkGraphicsPipelineCreateInfo pipeline_ci = {
-        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
-        .stageCount = ARRAY_LEN(shader_stages),
-        .pStages = shader_stages,
-        .pVertexInputState = &vertex_input,
-        .pInputAssemblyState = &input_assembly,
-        .pViewportState = &viewport_state,
-        .pRasterizationState = &rasterization,
-        .pMultisampleState = &multisampling,
-        .pColorBlendState = &color_blending,
-        .pDynamicState = &dynamic_state,
-        .layout = vk->image_pipeline.layout,
-        .renderPass = vk->render_pass,
-        .subpass = 0,
+    *semaphore = sync->vk_sem;
+    *value = ((uint64_t)sync->acquire.point_hi << 32) | sync->acquire.point_lo;
+    return true;
+}
+
+// ============================================================================
+// Resident Capture
+// ============================================================================
+
+// Computes which part of the game is visible (src, in game pixels) and where it is drawn (dst,
+// in window pixels). The game is centered in the window, and cropped from its center when it is
+// larger than the window (same as layout_centered in ui.c).
+static void
+capture_layout(struct server_vk *vk, struct vk_buffer *capture, struct box *src, struct box *dst) {
+    int32_t game_width = capture->width;
+    int32_t game_height = capture->height;
+    int32_t window_width = (int32_t)vk->swapchain.extent.width;
+    int32_t window_height = (int32_t)vk->swapchain.extent.height;
+
+    int32_t x = (window_width / 2) - (game_width / 2);
+    int32_t y = (window_height / 2) - (game_height / 2);
+
+    int32_t crop_width = (x >= 0) ? game_width : window_width;
+    int32_t crop_height = (y >= 0) ? game_height : window_height;
+
+    *src = (struct box){
+        .x = (game_width / 2) - (crop_width / 2),
+        .y = (game_height / 2) - (crop_height / 2),
+        .width = crop_width,
+        .height = crop_height,
+    };
+    *dst = (struct box){
+        .x = (x >= 0) ? x : 0,
+        .y = (y >= 0) ? y : 0,
+        .width = crop_width,
+        .height = crop_height,
     };
+}
 
-    VkResult result = vkCreateGraphicsPipelines(vk->device, VK_NULL_HANDLE, 1, &pipeline_ci, NULL, &vk->image_pipeline.pipeline);
+// Returns the region of the capture which is read this frame: the visible part of the game and
+// the source of every enabled mirror, clamped to the game bounds.
+static struct box
+resident_capture_box(struct server_vk *vk, struct vk_buffer *capture) {
+    struct box src, dst;
+    capture_layout(vk, capture, &src, &dst);
 
-    // Clean up shader module (don't need to keep it)
-    vkDestroyShaderModule(vk->device, image_frag, NULL);
+    int32_t x1 = src.x, y1 = src.y;
+    int32_t x2 = src.x + src.width, y2 = src.y + src.height;
 
-    if (result != VK_SUCCESS) {
-        vk_log(LOG_ERROR, "failed to create image pipeline: %d", result);
-        return false;
+    struct vk_mirror *mirror;
+    wl_list_for_each(mirror, &vk->mirrors, link) {
+        if (!mirror->enabled || mirror->src.width <= 0 || mirror->src.height <= 0) {
+            continue;
+        }
+        int32_t mx2 = mirror->src.x + mirror->src.width;
+        int32_t my2 = mirror->src.y + mirror->src.height;
+        x1 = (mirror->src.x < x1) ? mirror->src.x : x1;
+        y1 = (mirror->src.y < y1) ? mirror->src.y : y1;
+        x2 = (mx2 > x2) ? mx2 : x2;
+        y2 = (my2 > y2) ? my2 : y2;
     }
 
-    vk_log(LOG_INFO, "created image pipeline");
-    return true;
+    x1 = (x1 > 0) ? x1 : 0;
+    y1 = (y1 > 0) ? y1 : 0;
+    x2 = (x2 < capture->width) ? x2 : capture->width;
+    y2 = (y2 < capture->height) ? y2 : capture->height;
+
+    return (struct box){ .x = x1, .y = y1, .width = x2 - x1, .height = y2 - y1 };
 }
 
 static void
-destroy_pipeline(struct server_vk *vk, struct vk_pipeline *pipeline) {
-    if (pipeline->pipeline) {
-        vkDestroyPipeline(vk->device, pipeline->pipeline, NULL);
+destroy_resident_capture(struct server_vk *vk, struct vk_resident_capture *resident) {
+    if (resident->descriptor_set) {
+        vkFreeDescriptorSets(vk->device, vk->descriptor_pool, 1, &resident->descriptor_set);
     }
-    if (pipeline->layout) {
-        vkDestroyPipelineLayout(vk->device, pipeline->layout, NULL);
+    if (resident->view) {
+        vkDestroyImageView(vk->device, resident->view, NULL);
     }
-    // Don't destroy shared descriptor layout here
-    if (pipeline->frag && pipeline->frag != vk->texcopy_pipeline.frag) {
-        vkDestroyShaderModule(vk->device, pipeline->frag, NULL);
+    if (resident->image) {
+        vkDestroyImage(vk->device, resident->image, NULL);
     }
-    // Vert shader is shared
-}
-
-// ============================================================================
-// Public API
-// ============================================================================
+    vk_free(vk, &resident->memory);
 
-struct server_vk *
-server_vk_create(struct server *server, struct config *cfg) {
-    struct server_vk *vk = zalloc(1, sizeof(*vk));
-    vk->server = server;
-    vk->drm_fd = -1;
-    vk->fps_last_time_ms = now_ms();
-    vk->fps_frame_count = 0;
-    vk->disable_capture_sync_wait = getenv("WAYWALL_DISABLE_CAPTURE_SYNC_WAIT") != NULL;
-    // Prefer modifier-based dma-buf imports when we know we're doing cross-GPU (subprocess offload)
-    // to avoid ReBAR-limited linear paths. Env can still force it.
-    bool env_allow_mods = getenv("WAYWALL_DMABUF_ALLOW_MODIFIERS") != NULL;
-    vk->allow_modifiers =
-        env_allow_mods || (server->linux_dmabuf && server->linux_dmabuf->allow_modifiers);
-    vk->proxy_game = getenv("WAYWALL_VK_PROXY_GAME") != NULL;
-    vk->overlay_tick = NULL;
-    vk->overlay_tick_ms = refresh_mhz_to_ms(server->ui ? server->ui->refresh_mhz : 0);
+    *resident = (struct vk_resident_capture){0};
+}
 
-    vk_log(LOG_INFO, "creating Vulkan backend");
+// Images written by the capture copy pipeline are shared with the transfer queue.
+static bool
+create_resident_capture(struct server_vk *vk, struct vk_resident_capture *resident, int32_t width,
+                        int32_t height, bool shared) {
+    bool concurrent = shared && vk->upload.concurrent;
+    uint32_t families[2] = { vk->graphics_family, vk->transfer_family };
 
-    wl_list_init(&vk->capture.buffers);
-    wl_list_init(&vk->mirrors);
-    wl_list_init(&vk->images);
-    wl_list_init(&vk->atlases);
-    wl_list_init(&vk->texts);
-    wl_list_init(&vk->views);
-    wl_signal_init(&vk->events.frame);
-    wl_list_init(&vk->on_ui_resize.link);
-    wl_list_init(&vk->on_ui_refresh.link);
+    // XRGB8888 and ARGB8888 buffers are laid out as B, G, R, X in memory.
+    VkImageCreateInfo image_info = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format = VK_FORMAT_B8G8R8A8_UNORM,
+        .extent = { (uint32_t)width, (uint32_t)height, 1 },
+        .mipLevels = 1,
+        .arrayLayers = 1,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        .sharingMode = concurrent ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = concurrent ? 2 : 0,
+        .pQueueFamilyIndices = families,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+    };
 
-    // Create Vulkan instance
-    if (!create_instance(vk)) {
-        goto fail;
+    if (vkCreateImage(vk->device, &image_info, NULL, &resident->image) != VK_SUCCESS) {
+        vk_log(LOG_ERROR, "failed to create resident capture image");
+        return false;
     }
 
-    // Create Wayland surface as subsurface of UI (need this before selecting physical device)
-    vk->swapchain.wl_surface = wl_compositor_create_surface(server->backend->compositor);
-    if (!vk->swapchain.wl_surface) {
-        vk_log(LOG_ERROR, "failed to create Wayland surface");
+    if (!vk_alloc_image(vk, resident->image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, false,
+                        &resident->memory)) {
+        vk_log(LOG_ERROR, "failed to allocate resident capture memory");
         goto fail;
     }
 
-    // Set empty input region (we don't want input events)
-    wl_surface_set_input_region(vk->swapchain.wl_surface, server->ui->empty_region);
+    VkImageViewCreateInfo view_info = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .image = resident->image,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .format = image_info.format,
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .levelCount = 1,
+            .layerCount = 1,
+        },
+    };
 
-    // Create subsurface of main UI surface
-    vk->swapchain.subsurface = wl_subcompositor_get_subsurface(
-        server->backend->subcompositor, vk->swapchain.wl_surface, server->ui->tree.surface);
-    if (!vk->swapchain.subsurface) {
-        vk_log(LOG_ERROR, "failed to create subsurface");
+    if (vkCreateImageView(vk->device, &view_info, NULL, &resident->view) != VK_SUCCESS) {
+        vk_log(LOG_ERROR, "failed to create resident capture image view");
         goto fail;
     }
-    wl_subsurface_set_desync(vk->swapchain.subsurface);
-    wl_subsurface_set_position(vk->swapchain.subsurface, 0, 0);
-    // Match GL behavior - don't call place_below, let subsurface stack naturally
 
-    VkWaylandSurfaceCreateInfoKHR surface_info = {
-        .sType = VK_STRUCTURE_TYPE_WAYLAND_SURFACE_CREATE_INFO_KHR,
-        .display = server->backend->display,
-        .surface = vk->swapchain.wl_surface,
+    VkDescriptorSetAllocateInfo desc_alloc = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = vk->descriptor_pool,
+        .descriptorSetCount = 1,
+        .pSetLayouts = &vk->blit_pipeline.descriptor_layout,
     };
 
-    if (vkCreateWaylandSurfaceKHR(vk->instance, &surface_info, NULL,
-                                   &vk->swapchain.surface) != VK_SUCCESS) {
-        vk_log(LOG_ERROR, "failed to create Vulkan Wayland surface");
-        goto fail;
-    }
-
-    // Select physical device and create logical device
-    if (!select_physical_device(vk) || !create_device(vk)) {
+    if (vkAllocateDescriptorSets(vk->device, &desc_alloc, &resident->descriptor_set) != VK_SUCCESS) {
+        vk_log(LOG_ERROR, "failed to allocate resident capture descriptor set");
         goto fail;
     }
 
-    // Create swapchain with initial size
-    uint32_t width = server->ui ? server->ui->width : 640;
-    uint32_t height = server->ui ? server->ui->height : 480;
-    if (!create_swapchain(vk, width, height, VK_NULL_HANDLE)) {
-        goto fail;
-    }
+    VkDescriptorImageInfo image_desc = {
+        .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        .imageView = resident->view,
+        .sampler = vk->sampler,
+    };
 
-    // Create render pass and framebuffers
-    if (!create_render_pass(vk) || !create_framebuffers(vk)) {
-        goto fail;
-    }
+    VkWriteDescriptorSet desc_write = {
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = resident->descriptor_set,
+        .dstBinding = 0,
+        .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        .descriptorCount = 1,
+        .pImageInfo = &image_desc,
+    };
+    vkUpdateDescriptorSets(vk->device, 1, &desc_write, 0, NULL);
 
-    // Create command pool and sync objects
-    if (!create_command_pool(vk) || !create_sync_objects(vk)) {
-        goto fail;
-    }
+    resident->width = width;
+    resident->height = height;
+    return true;
 
-    // Create sampler and descriptor pool
-    if (!create_sampler(vk) || !create_descriptor_pool(vk)) {
-        goto fail;
-    }
+fail:
+    destroy_resident_capture(vk, resident);
+    return false;
+}
 
-    // Create pipelines
-    if (!create_texcopy_pipeline(vk) || !create_text_pipeline(vk) || !create_blit_pipeline(vk) || !create_buffer_blit_pipeline(vk) || !create_mirror_pipeline(vk) || !create_image_pipeline(vk) || !create_text_vk_pipeline(vk)) {
-        goto fail;
-    }
+// Copies the region of a NATIVE capture which is read this frame into the frame's resident
+// capture, so that the foreign dma-buf is read across the bus once rather than once per draw.
+// Must be recorded outside of the render pass, after the capture buffer has been acquired.
+static void
+update_resident_capture(struct server_vk *vk, VkCommandBuffer cmd, struct vk_buffer *capture) {
+    struct vk_resident_capture *resident = &vk->capture.resident[vk->current_frame];
+    resident->valid = false;
 
-    // Initialize font system for text rendering
-    const char *font_path = cfg ? cfg->theme.font_path : NULL;
-    uint32_t font_size = 1;  // Size is specified per-text (pixels)
-    if (font_path && font_path[0]) {
-        if (!init_font_system(vk, font_path, font_size)) {
-            vk_log(LOG_WARN, "font system initialization failed, text rendering disabled");
-        }
-    } else {
-        vk_log(LOG_INFO, "no font path configured, text rendering disabled");
+    if (vk->capture.resident_disabled || !capture || !capture->storage_buffer ||
+        !capture->buffer_descriptor_set || capture->stride % 4 != 0) {
+        return;
     }
 
-    // Create fullscreen quad vertex buffer
-    if (!create_quad_vertex_buffer(vk)) {
-        goto fail;
+    struct box box = resident_capture_box(vk, capture);
+    if (box.width <= 0 || box.height <= 0) {
+        return;
     }
 
-    // Open DRM device for dma-buf operations
-    vk->drm_fd = open("/dev/dri/renderD128", O_RDWR | O_CLOEXEC);
-    if (vk->drm_fd >= 0) {
-        vk->gbm = gbm_create_device(vk->drm_fd);
-        if (!vk->gbm) {
-            vk_log(LOG_WARN, "failed to create GBM device");
+    // The previous frame on this slot has finished, so the image can be replaced right away. It
+    // is shrunk again once most of it goes unused (e.g. after leaving a tall resolution).
+    bool fits = box.width <= resident->width && box.height <= resident->height;
+    bool oversized = (int64_t)resident->width * resident->height >
+                     4 * (int64_t)box.width * box.height;
+    if (!fits || oversized) {
+        destroy_resident_capture(vk, resident);
+        if (!create_resident_capture(vk, resident, box.width, box.height, false)) {
+            return;
         }
     }
 
-    // Hook up resize listener
-    vk->on_ui_resize.notify = on_ui_resize;
-    wl_signal_add(&server->ui->events.resize, &vk->on_ui_resize);
-
-    if (vk->proxy_game) {
-        VkCommandBufferAllocateInfo alloc_info = {
-            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-            .commandPool = vk->command_pool,
-            .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-            .commandBufferCount = DMABUF_EXPORT_MAX,
-        };
-        VkResult result =
-            vkAllocateCommandBuffers(vk->device, &alloc_info, vk->proxy_copy.command_buffers);
-        if (result != VK_SUCCESS) {
-            vk_log(LOG_ERROR, "failed to allocate proxy copy command buffers: %d", result);
-            goto fail;
-        }
-
-        VkFenceCreateInfo fence_info = {
-            .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
-            .flags = VK_FENCE_CREATE_SIGNALED_BIT,
-        };
-        for (uint32_t i = 0; i < DMABUF_EXPORT_MAX; i++) {
-            result = vkCreateFence(vk->device, &fence_info, NULL, &vk->proxy_copy.fences[i]);
-            if (result != VK_SUCCESS) {
-                vk_log(LOG_ERROR, "failed to create proxy copy fence: %d", result);
-                goto fail;
-            }
-        }
-        vk->proxy_copy.index = 0;
-
-        // Drive overlay rendering independently of the game’s surface commits.
-        vk->on_ui_refresh.notify = on_ui_refresh;
-        wl_signal_add(&server->ui->events.refresh, &vk->on_ui_refresh);
+    // Nothing outside of the copied region is ever sampled, so the old contents are discarded.
+    VkImageMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask = 0,
+        .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = resident->image,
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .levelCount = 1,
+            .layerCount = 1,
+        },
+    };
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                         0, NULL, 0, NULL, 1, &barrier);
 
-        struct wl_event_loop *loop = wl_display_get_event_loop(server->display);
-        vk->overlay_tick = wl_event_loop_add_timer(loop, handle_overlay_tick, vk);
-        check_alloc(vk->overlay_tick);
-        wl_event_source_timer_update(vk->overlay_tick, vk->overlay_tick_ms);
-    }
+    VkBufferImageCopy region = {
+        .bufferOffset = (VkDeviceSize)box.y * capture->stride + (VkDeviceSize)box.x * 4,
+        .bufferRowLength = capture->stride / 4,
+        .imageSubresource = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .layerCount = 1,
+        },
+        .imageExtent = { (uint32_t)box.width, (uint32_t)box.height, 1 },
+    };
+    vkCmdCopyBufferToImage(cmd, capture->storage_buffer, resident->image,
+                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
 
-    vk_log(LOG_INFO, "Vulkan backend initialized successfully");
-    return vk;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                         0, 0, NULL, 0, NULL, 1, &barrier);
 
-fail:
-    server_vk_destroy(vk);
-    return NULL;
+    resident->box = box;
+    resident->valid = true;
 }
 
-void
-server_vk_destroy(struct server_vk *vk) {
-    if (!vk) return;
-
-    // Remove UI resize listener
-    wl_list_remove(&vk->on_ui_resize.link);
-    wl_list_remove(&vk->on_ui_refresh.link);
-
-    if (vk->overlay_tick) {
-        wl_event_source_remove(vk->overlay_tick);
-        vk->overlay_tick = NULL;
-    }
-
-    if (vk->device) {
-        for (uint32_t i = 0; i < DMABUF_EXPORT_MAX; i++) {
-            if (vk->proxy_copy.fences[i]) {
-                vkDestroyFence(vk->device, vk->proxy_copy.fences[i], NULL);
-                vk->proxy_copy.fences[i] = VK_NULL_HANDLE;
-            }
-        }
-
-        vkDeviceWaitIdle(vk->device);
-    }
-
-    // Destroy capture buffers
-    struct vk_buffer *buf, *tmp;
-    wl_list_for_each_safe(buf, tmp, &vk->capture.buffers, link) {
-        vk_buffer_destroy(buf);
-    }
-
-    // Destroy text objects
-    struct vk_text *text, *text_tmp;
-    wl_list_for_each_safe(text, text_tmp, &vk->texts, link) {
-        if (text->vertex_buffer) {
-            vkFreeMemory(vk->device, text->vertex_memory, NULL);
-            vkDestroyBuffer(vk->device, text->vertex_buffer, NULL);
+// ============================================================================
+// Capture Copy
+// ============================================================================
+
+#define VK_CAPTURE_COPY_DEFAULT_DEPTH 2
+
+static bool
+create_capture_copy(struct server_vk *vk) {
+    vk->capture_copy.latest = -1;
+    vk->capture_copy.sampled = -1;
+    vk->capture_copy.depth = VK_CAPTURE_COPY_DEFAULT_DEPTH;
+
+    const char *env_depth = getenv("WAYWALL_VK_COPY_DEPTH");
+    if (env_depth && env_depth[0]) {
+        char *end = NULL;
+        long depth = strtol(env_depth, &end, 10);
+        if (*end != '\0' || depth < 0 || depth > VK_CAPTURE_COPY_MAX_DEPTH) {
+            vk_log(LOG_WARN, "ignoring invalid WAYWALL_VK_COPY_DEPTH '%s' (expected 0-%d)", env_depth,
+                   VK_CAPTURE_COPY_MAX_DEPTH);
+        } else {
+            vk->capture_copy.depth = (uint32_t)depth;
         }
-        wl_list_remove(&text->link);
-        free(text->text);
-        free(text);
+    }
+    if (vk->capture.resident_disabled) {
+        vk->capture_copy.depth = 0;
+    }
+    if (vk->capture_copy.depth == 0) {
+        vk_log(LOG_INFO, "capture copy pipeline disabled, copying captures inside each frame");
+        return true;
     }
 
-    // Destroy font system
-    destroy_font_system(vk);
+    VkSemaphoreTypeCreateInfo type_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+        .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+        .initialValue = 0,
+    };
+    VkSemaphoreCreateInfo sem_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        .pNext = &type_info,
+    };
+    VkResult result = vkCreateSemaphore(vk->device, &sem_info, NULL, &vk->capture_copy.timeline);
+    vk_check(result, "failed to create capture copy timeline semaphore");
 
-    // Destroy sync objects
-    for (int i = 0; i < VK_MAX_FRAMES_IN_FLIGHT; i++) {
-        if (vk->image_available[i]) {
-            vkDestroySemaphore(vk->device, vk->image_available[i], NULL);
-        }
-        if (vk->render_finished[i]) {
-            vkDestroySemaphore(vk->device, vk->render_finished[i], NULL);
-        }
-        if (vk->in_flight[i]) {
-            vkDestroyFence(vk->device, vk->in_flight[i], NULL);
+    VkCommandBufferAllocateInfo cmd_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .commandPool = vk->transfer_pool,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = 1,
+    };
+    for (uint32_t i = 0; i < vk->capture_copy.depth; i++) {
+        result = vkAllocateCommandBuffers(vk->device, &cmd_info, &vk->capture_copy.copies[i].cmd);
+        vk_check(result, "failed to allocate capture copy command buffer");
+        if (!release_watch_create(vk, &vk->capture_copy.copies[i].release)) {
+            return false;
         }
     }
 
-    if (vk->command_pool) {
-        vkDestroyCommandPool(vk->device, vk->command_pool, NULL);
-    }
+    // Timestamps are optional. Transfer queues can't reset queries, so they are reset from the host.
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(vk->physical_device, &props);
+
+    uint32_t family_count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(vk->physical_device, &family_count, NULL);
+    VkQueueFamilyProperties *families = zalloc(family_count, sizeof(*families));
+    vkGetPhysicalDeviceQueueFamilyProperties(vk->physical_device, &family_count, families);
+    uint32_t valid_bits =
+        vk->transfer_family < family_count ? families[vk->transfer_family].timestampValidBits : 0;
+    free(families);
+
+    if (valid_bits > 0 && props.limits.timestampPeriod > 0.0f && vk->host_query_reset) {
+        VkQueryPoolCreateInfo pool_info = {
+            .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+            .queryType = VK_QUERY_TYPE_TIMESTAMP,
+            .queryCount = 2 * VK_CAPTURE_COPY_MAX_DEPTH,
+        };
+        result = vkCreateQueryPool(vk->device, &pool_info, NULL, &vk->capture_copy.query_pool);
+        vk_check(result, "failed to create capture copy query pool");
 
-    if (vk->descriptor_pool) {
-        vkDestroyDescriptorPool(vk->device, vk->descriptor_pool, NULL);
+        vk->capture_copy.timestamp_period = props.limits.timestampPeriod;
+        vk->capture_copy.timestamp_mask =
+            valid_bits >= 64 ? UINT64_MAX : ((uint64_t)1 << valid_bits) - 1;
     }
 
-    if (vk->sampler) {
-        vkDestroySampler(vk->device, vk->sampler, NULL);
+    vk_log(LOG_INFO, "created capture copy pipeline (depth %u, %s transfer queue, timestamps=%s)",
+           vk->capture_copy.depth, vk->upload.concurrent ? "dedicated" : "shared",
+           vk->capture_copy.query_pool ? "true" : "false");
+    return true;
+}
+
+// Drops the copy's hold on its source buffer. The copy must have finished.
+static void
+capture_copy_release(struct server_vk *vk, struct vk_capture_copy *copy) {
+    if (!copy->held) {
+        return;
     }
 
-    // Destroy quad vertex buffer
-    if (vk->quad_vertex_buffer) {
-        vkDestroyBuffer(vk->device, vk->quad_vertex_buffer, NULL);
+    copy->held = false;
+    if (copy->source && copy->source->parent) {
+        server_buffer_unlock(copy->source->parent);
     }
-    if (vk->quad_vertex_memory) {
-        vkFreeMemory(vk->device, vk->quad_vertex_memory, NULL);
+}
+
+// Waits for the copy to finish, and also for the last frame which sampled its image if idle is
+// set. Returns false if waiting failed.
+static bool
+capture_copy_wait(struct server_vk *vk, struct vk_capture_copy *copy, bool idle) {
+    VkSemaphore semaphores[2] = { vk->capture_copy.timeline, vk->upload.frame_timeline };
+    uint64_t values[2] = { copy->value, copy->read_frame };
+
+    VkSemaphoreWaitInfo wait_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+        .semaphoreCount = idle ? 2 : 1,
+        .pSemaphores = semaphores,
+        .pValues = values,
+    };
+    if (vkWaitSemaphores(vk->device, &wait_info, UINT64_MAX) != VK_SUCCESS) {
+        vk_log(LOG_ERROR, "failed to wait for capture copy");
+        return false;
     }
 
-    // Destroy pipelines
-    destroy_pipeline(vk, &vk->text_pipeline);
-    destroy_pipeline(vk, &vk->texcopy_pipeline);
-    destroy_pipeline(vk, &vk->blit_pipeline);
+    capture_copy_release(vk, copy);
+    return true;
+}
 
-    // Destroy buffer blit pipeline resources
-    if (vk->buffer_blit.pipeline) {
-        vkDestroyPipeline(vk->device, vk->buffer_blit.pipeline, NULL);
-    }
-    if (vk->buffer_blit.layout) {
-        vkDestroyPipelineLayout(vk->device, vk->buffer_blit.layout, NULL);
-    }
-    if (vk->buffer_blit.descriptor_layout) {
-        vkDestroyDescriptorSetLayout(vk->device, vk->buffer_blit.descriptor_layout, NULL);
-    }
-    if (vk->buffer_blit.frag) {
-        vkDestroyShaderModule(vk->device, vk->buffer_blit.frag, NULL);
+// Returns the buffers of every finished copy to their clients.
+static void
+capture_copy_release_completed(struct server_vk *vk) {
+    if (vk->capture_copy.depth == 0) {
+        return;
     }
 
-    // Destroy mirror pipeline
-    if (vk->mirror_pipeline.pipeline) {
-        vkDestroyPipeline(vk->device, vk->mirror_pipeline.pipeline, NULL);
-    }
-    if (vk->mirror_pipeline.layout) {
-        vkDestroyPipelineLayout(vk->device, vk->mirror_pipeline.layout, NULL);
+    uint64_t completed = 0;
+    vkGetSemaphoreCounterValue(vk->device, vk->capture_copy.timeline, &completed);
+
+    for (uint32_t i = 0; i < vk->capture_copy.depth; i++) {
+        struct vk_capture_copy *copy = &vk->capture_copy.copies[i];
+        if (copy->held && copy->value <= completed) {
+            capture_copy_release(vk, copy);
+        }
     }
-    if (vk->mirror_pipeline.frag) {
-        vkDestroyShaderModule(vk->device, vk->mirror_pipeline.frag, NULL);
+}
+
+// Forgets every copy of a buffer which is being destroyed.
+static void
+capture_copy_forget(struct server_vk *vk, struct vk_buffer *buffer) {
+    for (uint32_t i = 0; i < vk->capture_copy.depth; i++) {
+        struct vk_capture_copy *copy = &vk->capture_copy.copies[i];
+        if (copy->source != buffer) {
+            continue;
+        }
+        capture_copy_wait(vk, copy, false);
+        copy->source = NULL;
     }
+}
 
-    // Destroy mirrors
-    struct vk_mirror *mirror, *tmp_mirror;
-    wl_list_for_each_safe(mirror, tmp_mirror, &vk->mirrors, link) {
-        wl_list_remove(&mirror->link);
-        free(mirror);
+static void
+destroy_capture_copy(struct server_vk *vk) {
+    for (uint32_t i = 0; i < VK_CAPTURE_COPY_MAX_DEPTH; i++) {
+        struct vk_capture_copy *copy = &vk->capture_copy.copies[i];
+        capture_copy_release(vk, copy);
+        destroy_resident_capture(vk, &copy->resident);
+        if (copy->cmd) {
+            vkFreeCommandBuffers(vk->device, vk->transfer_pool, 1, &copy->cmd);
+        }
+        release_watch_destroy(vk, &copy->release);
+        *copy = (struct vk_capture_copy){0};
     }
 
-    // Destroy shader modules and descriptor layouts
-    if (vk->texcopy_pipeline.vert) {
-        vkDestroyShaderModule(vk->device, vk->texcopy_pipeline.vert, NULL);
+    if (vk->capture_copy.query_pool) {
+        vkDestroyQueryPool(vk->device, vk->capture_copy.query_pool, NULL);
+        vk->capture_copy.query_pool = VK_NULL_HANDLE;
     }
-    if (vk->texcopy_pipeline.frag) {
-        vkDestroyShaderModule(vk->device, vk->texcopy_pipeline.frag, NULL);
+    if (vk->capture_copy.timeline) {
+        vkDestroySemaphore(vk->device, vk->capture_copy.timeline, NULL);
+        vk->capture_copy.timeline = VK_NULL_HANDLE;
     }
-    if (vk->texcopy_pipeline.descriptor_layout) {
-        vkDestroyDescriptorSetLayout(vk->device, vk->texcopy_pipeline.descriptor_layout, NULL);
+}
+
+// Copies the region of a NATIVE capture which will be read into the next resident image of the
+// pipeline, on the transfer queue. Called when the capture is committed, so the copy usually
+// finishes before the frame which samples it starts.
+static void
+capture_copy_submit(struct server_vk *vk, struct vk_buffer *capture) {
+    if (vk->capture_copy.depth == 0 || !capture->storage_buffer ||
+        !capture->buffer_descriptor_set || capture->stride % 4 != 0) {
+        return;
     }
-    // Destroy blit pipeline's own resources
-    if (vk->blit_pipeline.vert) {
-        vkDestroyShaderModule(vk->device, vk->blit_pipeline.vert, NULL);
+
+    struct box box = resident_capture_box(vk, capture);
+    if (box.width <= 0 || box.height <= 0) {
+        return;
     }
-    if (vk->blit_pipeline.descriptor_layout) {
-        vkDestroyDescriptorSetLayout(vk->device, vk->blit_pipeline.descriptor_layout, NULL);
+
+    uint32_t index = (uint32_t)(vk->capture_copy.latest + 1) % vk->capture_copy.depth;
+    struct vk_capture_copy *copy = &vk->capture_copy.copies[index];
+    struct vk_resident_capture *resident = &copy->resident;
+
+    // The previous copy into this image was submitted depth commits ago and has normally long
+    // finished. If the transfer queue has fallen that far behind, wait rather than queue more.
+    if (!capture_copy_wait(vk, copy, false)) {
+        return;
     }
+    copy->source = NULL;
 
-    // Destroy framebuffers
-    if (vk->swapchain.framebuffers) {
-        for (uint32_t i = 0; i < vk->swapchain.image_count; i++) {
-            if (vk->swapchain.framebuffers[i]) {
-                vkDestroyFramebuffer(vk->device, vk->swapchain.framebuffers[i], NULL);
-            }
+    bool fits = box.width <= resident->width && box.height <= resident->height;
+    bool oversized = (int64_t)resident->width * resident->height >
+                     4 * (int64_t)box.width * box.height;
+    if (!fits || oversized) {
+        // A frame may still be sampling the old image. Resizes are rare, so just wait for it.
+        if (!capture_copy_wait(vk, copy, true)) {
+            return;
+        }
+        destroy_resident_capture(vk, resident);
+        if (!create_resident_capture(vk, resident, box.width, box.height, true)) {
+            return;
         }
-        free(vk->swapchain.framebuffers);
     }
+    resident->valid = false;
 
-    if (vk->render_pass) {
-        vkDestroyRenderPass(vk->device, vk->render_pass, NULL);
-    }
+    VkCommandBuffer cmd = copy->cmd;
+    VkCommandBufferBeginInfo begin_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+    };
+    vkBeginCommandBuffer(cmd, &begin_info);
 
-    // Destroy swapchain views
-    if (vk->swapchain.views) {
-        for (uint32_t i = 0; i < vk->swapchain.image_count; i++) {
-            if (vk->swapchain.views[i]) {
-                vkDestroyImageView(vk->device, vk->swapchain.views[i], NULL);
-            }
-        }
-        free(vk->swapchain.views);
+    // The previous copy's timestamps are lost if no frame has read them by now.
+    copy->timed = vk->capture_copy.query_pool != VK_NULL_HANDLE;
+    if (copy->timed) {
+        vkResetQueryPool(vk->device, vk->capture_copy.query_pool, index * 2, 2);
+        vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, vk->capture_copy.query_pool,
+                            index * 2);
     }
-    free(vk->swapchain.images);
 
-    if (vk->swapchain.swapchain) {
-        vkDestroySwapchainKHR(vk->device, vk->swapchain.swapchain, NULL);
+    // Same as acquire_imported_buffer, but only for the transfer stage.
+    VkBufferMemoryBarrier buffer_barrier = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .buffer = capture->storage_buffer,
+        .offset = 0,
+        .size = VK_WHOLE_SIZE,
+    };
+
+    // Nothing outside of the copied region is ever sampled, so the old contents are discarded.
+    VkImageMemoryBarrier image_barrier = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask = 0,
+        .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = resident->image,
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .levelCount = 1,
+            .layerCount = 1,
+        },
+    };
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 1, &buffer_barrier, 1,
+                         &image_barrier);
+
+    VkBufferImageCopy region = {
+        .bufferOffset = (VkDeviceSize)box.y * capture->stride + (VkDeviceSize)box.x * 4,
+        .bufferRowLength = capture->stride / 4,
+        .imageSubresource = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .layerCount = 1,
+        },
+        .imageExtent = { (uint32_t)box.width, (uint32_t)box.height, 1 },
+    };
+    vkCmdCopyBufferToImage(cmd, capture->storage_buffer, resident->image,
+                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+    // Frames wait on the timeline before sampling, which makes the copy visible to them.
+    image_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    image_barrier.dstAccessMask = 0;
+    image_barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    image_barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                         0, 0, NULL, 0, NULL, 1, &image_barrier);
+
+    if (copy->timed) {
+        vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, vk->capture_copy.query_pool,
+                            index * 2 + 1);
     }
+    vkEndCommandBuffer(cmd);
 
-    if (vk->swapchain.surface) {
-        vkDestroySurfaceKHR(vk->instance, vk->swapchain.surface, NULL);
+    // Wait for the last frame which sampled this image, and for the client to finish rendering
+    // into the buffer. Frames which sample the copy then no longer wait on the client themselves.
+    VkSemaphore wait_semaphores[2];
+    uint64_t wait_values[2];
+    VkPipelineStageFlags wait_stages[2] = { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT };
+    uint32_t wait_count = 0;
+
+    if (copy->read_frame > 0) {
+        wait_semaphores[wait_count] = vk->upload.frame_timeline;
+        wait_values[wait_count] = copy->read_frame;
+        wait_count++;
+    }
+    if (capture_sync_acquire(vk, &wait_semaphores[wait_count], &wait_values[wait_count])) {
+        wait_count++;
     }
 
-    if (vk->swapchain.subsurface) {
-        wl_subsurface_destroy(vk->swapchain.subsurface);
+    // The release semaphore is binary, so its value is ignored.
+    uint64_t value = vk->capture_copy.submitted + 1;
+    VkSemaphore signal_semaphores[2] = { vk->capture_copy.timeline, copy->release.semaphore };
+    uint64_t signal_values[2] = { value, 0 };
+    uint32_t signal_count = (vk->capture.release_signals && copy->release.semaphore) ? 2 : 1;
+
+    VkTimelineSemaphoreSubmitInfo timeline_info = {
+        .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+        .waitSemaphoreValueCount = wait_count,
+        .pWaitSemaphoreValues = wait_values,
+        .signalSemaphoreValueCount = signal_count,
+        .pSignalSemaphoreValues = signal_values,
+    };
+    VkSubmitInfo submit_info = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = &timeline_info,
+        .waitSemaphoreCount = wait_count,
+        .pWaitSemaphores = wait_semaphores,
+        .pWaitDstStageMask = wait_stages,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &cmd,
+        .signalSemaphoreCount = signal_count,
+        .pSignalSemaphores = signal_semaphores,
+    };
+
+    if (vkQueueSubmit(vk->transfer_queue, 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS) {
+        vk_log(LOG_ERROR, "failed to submit capture copy");
+        return;
     }
+    vk->capture_copy.submitted = value;
 
-    if (vk->swapchain.wl_surface) {
-        wl_surface_destroy(vk->swapchain.wl_surface);
+    // The client may reuse the buffer as soon as a newer one replaces it, so it is held until the
+    // copy is done rather than until a frame has sampled the copy.
+    if (capture->parent) {
+        server_buffer_lock(capture->parent);
+        copy->held = true;
     }
+    copy->source = capture;
+    copy->value = value;
+    copy->submit_ns = now_ns();
+    resident->box = box;
+    resident->valid = true;
+    vk->capture_copy.latest = (int32_t)index;
 
-    if (vk->device) {
-        vkDestroyDevice(vk->device, NULL);
+    release_watch_arm(vk, &copy->release);
+}
+
+// Returns the index of the copy which the frame being recorded should sample, or -1 if the
+// frame has to copy the capture itself (e.g. a mirror was enabled since the copy was made).
+static int32_t
+capture_copy_find(struct server_vk *vk, struct vk_buffer *capture) {
+    if (vk->capture_copy.latest < 0) {
+        return -1;
     }
 
-    if (vk->instance) {
-        vkDestroyInstance(vk->instance, NULL);
+    struct vk_capture_copy *copy = &vk->capture_copy.copies[vk->capture_copy.latest];
+    if (copy->source != capture || !copy->resident.valid) {
+        return -1;
     }
 
-    if (vk->gbm) {
-        gbm_device_destroy(vk->gbm);
+    struct box box = resident_capture_box(vk, capture);
+    struct box *copied = &copy->resident.box;
+    bool contains = box.x >= copied->x && box.y >= copied->y &&
+                    box.x + box.width <= copied->x + copied->width &&
+                    box.y + box.height <= copied->y + copied->height;
+    return contains ? vk->capture_copy.latest : -1;
+}
+
+// Returns the resident capture read by the frame being recorded: the capture copy picked by
+// begin_frame, or the copy recorded into the frame itself.
+static struct vk_resident_capture *
+frame_resident_capture(struct server_vk *vk) {
+    if (vk->capture_copy.sampled >= 0) {
+        return &vk->capture_copy.copies[vk->capture_copy.sampled].resident;
     }
+    return &vk->capture.resident[vk->current_frame];
+}
 
-    if (vk->drm_fd >= 0) {
-        close(vk->drm_fd);
+// ============================================================================
+// Passthrough
+// ============================================================================
+
+static bool
+window_box_visible(struct server_vk *vk, const struct box *box) {
+    return box->width > 0 && box->height > 0 && box->x < (int32_t)vk->swapchain.extent.width &&
+           box->y < (int32_t)vk->swapchain.extent.height && box->x + box->width > 0 &&
+           box->y + box->height > 0;
+}
+
+// Returns whether anything besides the game would be drawn this frame.
+static bool
+overlays_visible(struct server_vk *vk) {
+    struct vk_mirror *mirror;
+    wl_list_for_each(mirror, &vk->mirrors, link) {
+        if (mirror->enabled && window_box_visible(vk, &mirror->dst)) {
+            return true;
+        }
+    }
+    struct vk_image *image;
+    wl_list_for_each(image, &vk->images, link) {
+        if (image->enabled && window_box_visible(vk, &image->dst)) {
+            return true;
+        }
+    }
+    struct vk_text *text;
+    wl_list_for_each(text, &vk->texts, link) {
+        // The bounds of a text are only known once it has been rebuilt.
+        if (text->enabled && (text->dirty || window_box_visible(vk, &text->bounds))) {
+            return true;
+        }
     }
+    struct vk_view *view;
+    wl_list_for_each(view, &vk->views, link) {
+        if (view->enabled && view->current_buffer && window_box_visible(vk, &view->dst)) {
+            return true;
+        }
+    }
+    return false;
+}
 
-    free(vk);
+static bool
+passthrough_active(struct server_vk *vk) {
+    return vk->passthrough.subsurface && !vk->passthrough.leaving;
 }
 
-void
-server_vk_set_capture(struct server_vk *vk, struct server_surface *surface) {
-    if (vk->capture.surface) {
-        wl_list_remove(&vk->on_surface_commit.link);
-        wl_list_remove(&vk->on_surface_destroy.link);
+// Returns whether the parent compositor can show the capture on its own: it is drawn uncropped
+// and unmodified, and nothing is drawn over it.
+static bool
+passthrough_possible(struct server_vk *vk, struct vk_buffer *capture) {
+    // The game surface has no role of its own unless composition is forced, and dual-GPU setups
+    // swap the color channels of the capture when drawing it. An opaque swapchain would cover
+    // the game with its cleared image.
+    if (vk->passthrough.disabled || vk->proxy_game || vk->dual_gpu || vk->swapchain.opaque ||
+        !vk->server->force_composition) {
+        return false;
+    }
+    if (!capture || !capture->parent || !capture->parent->remote || !vk->capture.surface) {
+        return false;
+    }
+
+    struct box src, dst;
+    capture_layout(vk, capture, &src, &dst);
+    if (src.width != capture->width || src.height != capture->height) {
+        return false;
     }
 
-    vk->capture.surface = surface;
-    vk->capture.current = NULL;
+    return !overlays_visible(vk);
+}
 
-    if (!surface) {
-        return;
+static void
+passthrough_enter(struct server_vk *vk, struct vk_buffer *capture) {
+    struct server_ui *ui = vk->server->ui;
+
+    struct box src, dst;
+    capture_layout(vk, capture, &src, &dst);
+
+    if (!vk->passthrough.subsurface) {
+        vk->passthrough.subsurface = wl_subcompositor_get_subsurface(
+            vk->server->backend->subcompositor, vk->capture.surface->remote, ui->tree.surface);
+        if (!vk->passthrough.subsurface) {
+            vk_log(LOG_ERROR, "failed to create passthrough subsurface");
+            return;
+        }
+        wl_subsurface_set_desync(vk->passthrough.subsurface);
     }
+    wl_subsurface_set_position(vk->passthrough.subsurface, dst.x, dst.y);
+    wl_subsurface_place_below(vk->passthrough.subsurface, vk->swapchain.wl_surface);
+    wl_surface_commit(ui->tree.surface);
+    vk->passthrough.x = dst.x;
+    vk->passthrough.y = dst.y;
 
-    vk->on_surface_commit.notify = on_surface_commit;
-    wl_signal_add(&surface->events.commit, &vk->on_surface_commit);
+    // The game stays visible in the swapchain until the next frame clears it.
+    vk->passthrough.leaving = false;
+    vk->passthrough.clear = true;
+    damage_full(vk);
 
-    vk->on_surface_destroy.notify = on_surface_destroy;
-    wl_signal_add(&surface->events.destroy, &vk->on_surface_destroy);
+    vk_log(LOG_INFO, "passing the capture through (%dx%d at %d,%d)", capture->width,
+           capture->height, dst.x, dst.y);
 }
 
-VkImageView
-server_vk_get_capture(struct server_vk *vk) {
-    if (!vk->capture.current) {
-        return VK_NULL_HANDLE;
+// Destroys the passthrough subsurface. The capture surface goes back to being an unmapped
+// surface which is only read by the Vulkan backend.
+static void
+passthrough_unmap(struct server_vk *vk) {
+    if (!vk->passthrough.subsurface) {
+        return;
     }
-    return vk->capture.current->view;
+
+    wl_subsurface_destroy(vk->passthrough.subsurface);
+    wl_surface_commit(vk->server->ui->tree.surface);
+    vk->passthrough.subsurface = NULL;
+    vk->passthrough.leaving = false;
 }
 
-void
-server_vk_get_capture_size(struct server_vk *vk, int32_t *width, int32_t *height) {
-    if (!vk->capture.current || !vk->capture.current->parent) {
-        *width = 0;
-        *height = 0;
-        return;
+// Decides whether the capture is passed through. Entering takes VK_PASSTHROUGH_ENTER_COMMITS
+// qualifying commits in a row, so that briefly hidden overlays don't cause flapping. Leaving is
+// immediate: the next frame draws the game again and the subsurface is unmapped once it has been
+// presented. Returns true if the capture is passed through.
+static bool
+passthrough_update(struct server_vk *vk, struct vk_buffer *capture, bool commit) {
+    if (!passthrough_possible(vk, capture)) {
+        vk->passthrough.streak = 0;
+        if (passthrough_active(vk)) {
+            vk->passthrough.leaving = true;
+            damage_full(vk);
+            vk_log(LOG_INFO, "compositing the capture");
+        }
+        return false;
     }
 
-    struct server_dmabuf_data *data = vk->capture.current->parent->data;
-    *width = data->width;
-    *height = data->height;
+    if (passthrough_active(vk)) {
+        // The game was resized, so it is centered elsewhere.
+        struct box src, dst;
+        capture_layout(vk, capture, &src, &dst);
+        if (dst.x != vk->passthrough.x || dst.y != vk->passthrough.y) {
+            passthrough_enter(vk, capture);
+        }
+        return true;
+    }
+
+    if (commit && ++vk->passthrough.streak >= VK_PASSTHROUGH_ENTER_COMMITS) {
+        passthrough_enter(vk, capture);
+    }
+    return passthrough_active(vk);
 }
 
 // ============================================================================
-// Cross-GPU DMA-BUF Synchronization
+// Transfer Present
 // ============================================================================
 
-// Transition imported image to shader-read layout with proper cross-GPU barrier
-static void
-transition_imported_image(struct server_vk *vk, VkImage image, VkCommandBuffer cmd) {
-    VkImageMemoryBarrier barrier = {
-        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-        .srcAccessMask = 0,  // External GPU writes
-        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
-        .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-        .newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_FOREIGN_EXT,  // From external GPU
-        .dstQueueFamilyIndex = vk->graphics_family,
-        .image = image,
-        .subresourceRange = {
-            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-            .baseMipLevel = 0,
-            .levelCount = 1,
-            .baseArrayLayer = 0,
-            .layerCount = 1,
-        },
-    };
+// Returns whether a frame showing only the capture can copy it into the swapchain image. The copy
+// has to produce exactly what draw_captured_frame would: the same channel order, and no alpha,
+// since the X channel of the capture is copied as is.
+static bool
+transfer_present_possible(struct server_vk *vk, struct vk_buffer *capture) {
+    if (vk->transfer_present.disabled || !vk->swapchain.transfer_dst || !vk->swapchain.opaque ||
+        vk->swapchain.format != VK_FORMAT_B8G8R8A8_UNORM) {
+        return false;
+    }
+    if (!capture || !capture->parent || vk->proxy_game) {
+        return false;
+    }
 
-    vkCmdPipelineBarrier(cmd,
-        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-        0,
-        0, NULL,
-        0, NULL,
-        1, &barrier);
-}
+    struct server_dmabuf_data *data = capture->parent->data;
+    if (!data || drm_format_to_vk(data->format) != VK_FORMAT_B8G8R8A8_UNORM) {
+        return false;
+    }
 
-// Release imported image back to external GPU
-static void
-release_imported_image(struct server_vk *vk, VkImage image, VkCommandBuffer cmd) {
-    VkImageMemoryBarrier barrier = {
-        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-        .srcAccessMask = VK_ACCESS_SHADER_READ_BIT,
-        .dstAccessMask = 0,
-        .oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-        .newLayout = VK_IMAGE_LAYOUT_GENERAL,
-        .srcQueueFamilyIndex = vk->graphics_family,
-        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_FOREIGN_EXT,  // Back to external GPU
-        .image = image,
-        .subresourceRange = {
-            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-            .baseMipLevel = 0,
-            .levelCount = 1,
-            .baseArrayLayer = 0,
-            .layerCount = 1,
-        },
-    };
+    bool has_buffer_path = capture->storage_buffer && capture->buffer_descriptor_set;
+    if (has_buffer_path) {
+        if (capture->stride % 4 != 0) {
+            return false;
+        }
+    } else if (!capture->image || !capture->descriptor_set || vk->dual_gpu) {
+        return false;
+    }
 
-    vkCmdPipelineBarrier(cmd,
-        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-        VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-        0,
-        0, NULL,
-        0, NULL,
-        1, &barrier);
+    return !overlays_visible(vk);
 }
 
-// Acquire imported buffer (queue family transfer skipped, relying on dma-buf sync)
 static void
-acquire_imported_buffer(struct server_vk *vk, VkBuffer buffer, VkCommandBuffer cmd) {
-    VkBufferMemoryBarrier barrier = {
-        .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
-        .srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT,
-        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
-        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-        .buffer = buffer,
-        .offset = 0,
-        .size = VK_WHOLE_SIZE,
+transfer_present_copy(struct server_vk *vk, VkCommandBuffer cmd, struct vk_buffer *capture,
+                      VkImage image, const struct box *src, const struct box *dst,
+                      const VkRect2D *rect) {
+    int32_t x1 = (rect->offset.x > dst->x) ? rect->offset.x : dst->x;
+    int32_t y1 = (rect->offset.y > dst->y) ? rect->offset.y : dst->y;
+    int32_t x2 = rect->offset.x + (int32_t)rect->extent.width;
+    int32_t y2 = rect->offset.y + (int32_t)rect->extent.height;
+    x2 = (x2 < dst->x + dst->width) ? x2 : dst->x + dst->width;
+    y2 = (y2 < dst->y + dst->height) ? y2 : dst->y + dst->height;
+    if (x2 <= x1 || y2 <= y1) {
+        return;
+    }
+
+    // Window pixels map to game pixels by a constant offset (see capture_layout).
+    int32_t game_x = src->x + (x1 - dst->x);
+    int32_t game_y = src->y + (y1 - dst->y);
+    VkImageSubresourceLayers subresource = {
+        .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+        .layerCount = 1,
     };
+    VkExtent3D extent = { (uint32_t)(x2 - x1), (uint32_t)(y2 - y1), 1 };
 
-    vkCmdPipelineBarrier(cmd,
-        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT | VK_PIPELINE_STAGE_HOST_BIT,
-        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-        0,
-        0, NULL,
-        1, &barrier,
-        0, NULL);
+    if (capture->storage_buffer && capture->buffer_descriptor_set) {
+        VkBufferImageCopy region = {
+            .bufferOffset = (VkDeviceSize)game_y * capture->stride + (VkDeviceSize)game_x * 4,
+            .bufferRowLength = capture->stride / 4,
+            .imageSubresource = subresource,
+            .imageOffset = { x1, y1, 0 },
+            .imageExtent = extent,
+        };
+        vkCmdCopyBufferToImage(cmd, capture->storage_buffer, image,
+                               VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+        return;
+    }
+
+    VkImageCopy region = {
+        .srcSubresource = subresource,
+        .srcOffset = { game_x, game_y, 0 },
+        .dstSubresource = subresource,
+        .dstOffset = { x1, y1, 0 },
+        .extent = extent,
+    };
+    vkCmdCopyImage(cmd, capture->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image,
+                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
 }
 
-// Release imported buffer
+// Records a frame which copies the visible part of the capture into the acquired swapchain image.
+// Images with unknown contents, or damage outside of the game, are cleared first. The capture has
+// already been acquired by begin_frame, and imported images are left in the layout end_frame
+// releases them from.
 static void
-release_imported_buffer(struct server_vk *vk, VkBuffer buffer, VkCommandBuffer cmd) {
-    VkBufferMemoryBarrier barrier = {
-        .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
-        .srcAccessMask = VK_ACCESS_SHADER_READ_BIT,
-        .dstAccessMask = 0,
-        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-        .buffer = buffer,
-        .offset = 0,
-        .size = VK_WHOLE_SIZE,
+record_transfer_present(struct server_vk *vk, VkCommandBuffer cmd, struct vk_buffer *capture,
+                        bool partial) {
+    VkImage image = vk->swapchain.images[vk->current_image_index];
+
+    struct box src, dst;
+    capture_layout(vk, capture, &src, &dst);
+
+    VkRect2D rect = vk->damage.scissor;
+    bool inside = rect.offset.x >= dst.x && rect.offset.y >= dst.y &&
+                  rect.offset.x + (int32_t)rect.extent.width <= dst.x + dst.width &&
+                  rect.offset.y + (int32_t)rect.extent.height <= dst.y + dst.height;
+    bool covers = dst.width == (int32_t)vk->swapchain.extent.width &&
+                  dst.height == (int32_t)vk->swapchain.extent.height;
+    bool clear = !covers && !(partial && inside);
+    // The previous contents are only kept if the copy doesn't replace all of them.
+    bool discard = !partial || clear;
+    if (discard) {
+        rect = (VkRect2D){ .offset = { 0, 0 }, .extent = vk->swapchain.extent };
+    }
+
+    VkImageSubresourceRange range = {
+        .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+        .levelCount = 1,
+        .layerCount = 1,
     };
-
-    vkCmdPipelineBarrier(cmd,
-        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-        VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-        0,
-        0, NULL,
-        1, &barrier,
-        0, NULL);
+    VkImageMemoryBarrier barriers[2] = {
+        {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcAccessMask = 0,
+            .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .oldLayout = discard ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+            .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = image,
+            .subresourceRange = range,
+        },
+        {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_SHADER_READ_BIT,
+            .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+            .oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            .newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = capture->image,
+            .subresourceRange = range,
+        },
+    };
+    bool image_path = !(capture->storage_buffer && capture->buffer_descriptor_set);
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL,
+                         image_path ? 2 : 1, barriers);
+
+    frame_timing_write_ts(vk, cmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_TS_ACQUIRE);
+
+    if (clear) {
+        VkClearColorValue clear_color = {{ 0.0f, 0.0f, 0.0f, 0.0f }};
+        vkCmdClearColorImage(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clear_color, 1,
+                             &range);
+        barriers[0].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             0, 0, NULL, 0, NULL, 1, barriers);
+    }
+
+    transfer_present_copy(vk, cmd, capture, image, &src, &dst, &rect);
+    frame_timing_write_ts(vk, cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_TS_CAPTURE);
+
+    barriers[0].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barriers[0].dstAccessMask = 0;
+    barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barriers[0].newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    barriers[1].srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barriers[1].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barriers[1].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                         0, 0, NULL, 0, NULL, image_path ? 2 : 1, barriers);
+    frame_timing_write_ts(vk, cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_TS_OVERLAYS);
 }
 
 // ============================================================================
@@ -3185,64 +5866,75 @@ draw_captured_frame(struct server_vk *vk, VkCommandBuffer cmd) {
 
     int32_t game_width = capture->width;
     int32_t game_height = capture->height;
-    int32_t window_width = (int32_t)vk->swapchain.extent.width;
-    int32_t window_height = (int32_t)vk->swapchain.extent.height;
 
-    // Calculate centered position (same logic as layout_centered in ui.c)
-    int32_t x = (window_width / 2) - (game_width / 2);
-    int32_t y = (window_height / 2) - (game_height / 2);
+    // Source crop region and the visible area it is drawn to
+    struct box src, dst;
+    capture_layout(vk, capture, &src, &dst);
 
-    // Calculate viewport position and source crop region for oversized games
-    int32_t vp_x, vp_y, vp_width, vp_height;
-    int32_t src_x = 0, src_y = 0, src_w = game_width, src_h = game_height;
-
-    if (x >= 0 && y >= 0) {
-        // Game fits entirely within window - center it
-        vp_x = x;
-        vp_y = y;
-        vp_width = game_width;
-        vp_height = game_height;
-        // No source cropping needed - show entire game
-    } else {
-        // Game is larger than window in one or both dimensions
-        // Match layout_centered from ui.c: crop from CENTER of game
-        int32_t crop_width = (x >= 0) ? game_width : window_width;
-        int32_t crop_height = (y >= 0) ? game_height : window_height;
+    // Bind the quad vertex buffer
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(cmd, 0, 1, &vk->quad_vertex_buffer, &offset);
+
+    struct vk_resident_capture *resident = frame_resident_capture(vk);
+    if (resident->valid) {
+        // The resident image holds resident->box of the game at its top-left corner. The whole
+        // image is mapped so that the visible part lands on dst, and the rest is scissored away.
+        VkViewport viewport = {
+            .x = (float)(dst.x - (src.x - resident->box.x)),
+            .y = (float)(dst.y - (src.y - resident->box.y)),
+            .width = (float)resident->width,
+            .height = (float)resident->height,
+            .minDepth = 0.0f,
+            .maxDepth = 1.0f,
+        };
+        vkCmdSetViewport(cmd, 0, 1, &viewport);
+
+        VkRect2D damage = vk->damage.scissor;
+        int32_t x1 = (dst.x > damage.offset.x) ? dst.x : damage.offset.x;
+        int32_t y1 = (dst.y > damage.offset.y) ? dst.y : damage.offset.y;
+        int32_t x2 = dst.x + dst.width;
+        int32_t y2 = dst.y + dst.height;
+        if (x2 > damage.offset.x + (int32_t)damage.extent.width) {
+            x2 = damage.offset.x + (int32_t)damage.extent.width;
+        }
+        if (y2 > damage.offset.y + (int32_t)damage.extent.height) {
+            y2 = damage.offset.y + (int32_t)damage.extent.height;
+        }
+        if (x2 <= x1 || y2 <= y1) {
+            return;
+        }
 
-        // Source crop from center of game (same as OpenGL viewporter)
-        src_x = (game_width / 2) - (crop_width / 2);
-        src_y = (game_height / 2) - (crop_height / 2);
-        src_w = crop_width;
-        src_h = crop_height;
+        VkRect2D scissor = {
+            .offset = { x1, y1 },
+            .extent = { (uint32_t)(x2 - x1), (uint32_t)(y2 - y1) },
+        };
+        vkCmdSetScissor(cmd, 0, 1, &scissor);
 
-        // Viewport position (clamp to window bounds)
-        vp_x = (x >= 0) ? x : 0;
-        vp_y = (y >= 0) ? y : 0;
-        vp_width = crop_width;
-        vp_height = crop_height;
+        // The copy is already in RGB order, so no channel swap is needed.
+        int32_t swap_colors = 0;
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, vk->blit_pipeline.pipeline);
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                vk->blit_pipeline.layout, 0, 1,
+                                &resident->descriptor_set, 0, NULL);
+        vkCmdPushConstants(cmd, vk->blit_pipeline.layout, VK_SHADER_STAGE_FRAGMENT_BIT,
+                           0, sizeof(int32_t), &swap_colors);
+        vkCmdDraw(cmd, 6, 1, 0, 0);
+        return;
     }
 
     // Set viewport to the visible area
     VkViewport viewport = {
-        .x = (float)vp_x,
-        .y = (float)vp_y,
-        .width = (float)vp_width,
-        .height = (float)vp_height,
+        .x = (float)dst.x,
+        .y = (float)dst.y,
+        .width = (float)dst.width,
+        .height = (float)dst.height,
         .minDepth = 0.0f,
         .maxDepth = 1.0f,
     };
     vkCmdSetViewport(cmd, 0, 1, &viewport);
 
-    // Scissor clips to window bounds
-    VkRect2D scissor = {
-        .offset = { 0, 0 },
-        .extent = vk->swapchain.extent,
-    };
-    vkCmdSetScissor(cmd, 0, 1, &scissor);
-
-    // Bind the quad vertex buffer
-    VkDeviceSize offset = 0;
-    vkCmdBindVertexBuffers(cmd, 0, 1, &vk->quad_vertex_buffer, &offset);
+    // Scissor clips to the damaged part of the window
+    vkCmdSetScissor(cmd, 0, 1, &vk->damage.scissor);
 
     // Check if we should use the storage buffer path (NATIVE cross-GPU)
     if (capture->storage_buffer && capture->buffer_descriptor_set) {
@@ -3266,154 +5958,255 @@ draw_captured_frame(struct server_vk *vk, VkCommandBuffer cmd) {
         pc.height = game_height;
         pc.stride = capture->stride;
         pc.swap_colors = 0;  // Buffer path uses consistent unpacking
-        pc.src_x = src_x;
-        pc.src_y = src_y;
-        pc.src_w = src_w;
-        pc.src_h = src_h;
+        pc.src_x = src.x;
+        pc.src_y = src.y;
+        pc.src_w = src.width;
+        pc.src_h = src.height;
+
+        vkCmdPushConstants(cmd, vk->buffer_blit.layout, VK_SHADER_STAGE_FRAGMENT_BIT,
+                           0, sizeof(pc), &pc);
+        vkCmdDraw(cmd, 6, 1, 0, 0);
+    } else if (capture->descriptor_set) {
+        // Fallback to image path (Single GPU or compatible stride)
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, vk->blit_pipeline.pipeline);
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                vk->blit_pipeline.layout, 0, 1,
+                                &capture->descriptor_set, 0, NULL);
+
+        // Push the color swap flag for dual-GPU mode
+        int32_t swap_colors = vk->dual_gpu ? 1 : 0;
+        vkCmdPushConstants(cmd, vk->blit_pipeline.layout, VK_SHADER_STAGE_FRAGMENT_BIT,
+                           0, sizeof(int32_t), &swap_colors);
+        vkCmdDraw(cmd, 6, 1, 0, 0);
+    }
+}
+
+// Sorting types
+enum render_item_type { ITEM_MIRROR, ITEM_IMAGE, ITEM_TEXT, ITEM_VIEW };
+
+struct vk_render_item {
+    int32_t depth;
+    enum render_item_type type;
+    void *obj;
+};
+
+static int compare_render_items(const void *a, const void *b) {
+    const struct vk_render_item *ia = a;
+    const struct vk_render_item *ib = b;
+    if (ia->depth != ib->depth) {
+        return ia->depth - ib->depth;
+    }
+    // Stable sort by type to minimize pipeline switches
+    if (ia->type != ib->type) {
+        return (int)ia->type - (int)ib->type;
+    }
+    return 0;
+}
+
+static void
+render_list_rebuild(struct server_vk *vk) {
+    size_t count = 0;
+    struct vk_mirror *m;
+    wl_list_for_each(m, &vk->mirrors, link) { if (m->enabled) count++; }
+    struct vk_image *i;
+    wl_list_for_each(i, &vk->images, link) { if (i->enabled) count++; }
+    struct vk_text *t;
+    wl_list_for_each(t, &vk->texts, link) { if (t->enabled) count++; }
+    struct vk_view *v;
+    wl_list_for_each(v, &vk->views, link) { if (v->enabled && v->current_buffer) count++; }
+
+    // Only grows, so steady-state frames never allocate.
+    if (count > vk->render_list.capacity) {
+        size_t capacity = vk->render_list.capacity ? vk->render_list.capacity : 32;
+        while (capacity < count) {
+            capacity *= 2;
+        }
+        struct vk_render_item *items = realloc(vk->render_list.items, capacity * sizeof(*items));
+        check_alloc(items);
+        vk->render_list.items = items;
+        vk->render_list.capacity = capacity;
+    }
+
+    struct vk_render_item *items = vk->render_list.items;
+    size_t idx = 0;
+    wl_list_for_each(m, &vk->mirrors, link) {
+        if (m->enabled) items[idx++] = (struct vk_render_item){ .depth = m->depth, .type = ITEM_MIRROR, .obj = m };
+    }
+    wl_list_for_each(i, &vk->images, link) {
+        if (i->enabled) items[idx++] = (struct vk_render_item){ .depth = i->depth, .type = ITEM_IMAGE, .obj = i };
+    }
+    size_t quad_count = idx;
+    wl_list_for_each(t, &vk->texts, link) {
+        if (t->enabled) items[idx++] = (struct vk_render_item){ .depth = t->depth, .type = ITEM_TEXT, .obj = t };
+    }
+    wl_list_for_each(v, &vk->views, link) {
+        if (v->enabled && v->current_buffer) items[idx++] = (struct vk_render_item){ .depth = v->depth, .type = ITEM_VIEW, .obj = v };
+    }
 
-        vkCmdPushConstants(cmd, vk->buffer_blit.layout, VK_SHADER_STAGE_FRAGMENT_BIT,
-                           0, sizeof(pc), &pc);
-        vkCmdDraw(cmd, 6, 1, 0, 0);
-    } else if (capture->descriptor_set) {
-        // Fallback to image path (Single GPU or compatible stride)
-        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, vk->blit_pipeline.pipeline);
-        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                vk->blit_pipeline.layout, 0, 1,
-                                &capture->descriptor_set, 0, NULL);
+    if (count > 1) {
+        qsort(items, count, sizeof(*items), compare_render_items);
+    }
 
-        // Push the color swap flag for dual-GPU mode
-        int32_t swap_colors = vk->dual_gpu ? 1 : 0;
-        vkCmdPushConstants(cmd, vk->blit_pipeline.layout, VK_SHADER_STAGE_FRAGMENT_BIT,
-                           0, sizeof(int32_t), &swap_colors);
-        vkCmdDraw(cmd, 6, 1, 0, 0);
+    vk->render_list.count = count;
+    vk->render_list.quad_count = quad_count;
+    vk->render_list.dirty = false;
+}
+
+static inline void
+render_list_update(struct server_vk *vk) {
+    if (vk->render_list.dirty) {
+        render_list_rebuild(vk);
     }
 }
 
-// Sorting types
-enum render_item_type { ITEM_MIRROR, ITEM_IMAGE, ITEM_TEXT, ITEM_VIEW };
+static bool
+ensure_overlay_instances(struct server_vk *vk, uint32_t slot, size_t count) {
+    if (count <= vk->overlay.instance_capacity[slot]) {
+        return true;
+    }
 
-struct render_item {
-    int32_t depth;
-    enum render_item_type type;
-    void *obj;
-};
+    size_t capacity = vk->overlay.instance_capacity[slot] ? vk->overlay.instance_capacity[slot]
+                                                          : OVERLAY_MIN_INSTANCES;
+    while (capacity < count) {
+        capacity *= 2;
+    }
 
-static int compare_render_items(const void *a, const void *b) {
-    const struct render_item *ia = a;
-    const struct render_item *ib = b;
-    if (ia->depth != ib->depth) {
-        return ia->depth - ib->depth;
+    // The slot's previous submission has completed (see server_vk_begin_frame), so the
+    // old buffer can be released immediately.
+    if (vk->overlay.instance_buffers[slot]) {
+        vkDestroyBuffer(vk->device, vk->overlay.instance_buffers[slot], NULL);
+        vk->overlay.instance_buffers[slot] = VK_NULL_HANDLE;
     }
-    // Stable sort by type to minimize pipeline switches
-    return (int)ia->type - (int)ib->type;
-}
+    if (vk->overlay.instance_memories[slot]) {
+        vkFreeMemory(vk->device, vk->overlay.instance_memories[slot], NULL);
+        vk->overlay.instance_memories[slot] = VK_NULL_HANDLE;
+    }
+    vk->overlay.instance_mapped[slot] = NULL;
+    vk->overlay.instance_capacity[slot] = 0;
 
-static void
-draw_mirror_single(struct server_vk *vk, VkCommandBuffer cmd, struct vk_mirror *mirror) {
-    struct vk_buffer *capture = vk->capture.current;
-    if (!capture || !capture->storage_buffer || !capture->buffer_descriptor_set) {
-        return;
+    VkBufferCreateInfo buffer_info = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = capacity * sizeof(struct overlay_instance),
+        .usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+    };
+    if (vkCreateBuffer(vk->device, &buffer_info, NULL, &vk->overlay.instance_buffers[slot]) != VK_SUCCESS) {
+        vk_log(LOG_ERROR, "failed to create overlay instance buffer");
+        return false;
     }
 
-    // Set viewport for this mirror's destination
-    VkViewport viewport = {
-        .x = (float)mirror->dst.x,
-        .y = (float)mirror->dst.y,
-        .width = (float)mirror->dst.width,
-        .height = (float)mirror->dst.height,
-        .minDepth = 0.0f,
-        .maxDepth = 1.0f,
+    VkMemoryRequirements mem_reqs;
+    vkGetBufferMemoryRequirements(vk->device, vk->overlay.instance_buffers[slot], &mem_reqs);
+    uint32_t mem_type = find_memory_type(vk, mem_reqs.memoryTypeBits,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    if (mem_type == UINT32_MAX) {
+        vk_log(LOG_ERROR, "no suitable memory type for overlay instance buffer");
+        return false;
+    }
+
+    VkMemoryAllocateInfo alloc_info = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .allocationSize = mem_reqs.size,
+        .memoryTypeIndex = mem_type,
     };
-    vkCmdSetViewport(cmd, 0, 1, &viewport);
+    if (vkAllocateMemory(vk->device, &alloc_info, NULL, &vk->overlay.instance_memories[slot]) != VK_SUCCESS) {
+        vk_log(LOG_ERROR, "failed to allocate overlay instance memory");
+        return false;
+    }
 
-    // Scissor to window bounds
-    VkRect2D scissor = {
-        .offset = { 0, 0 },
-        .extent = vk->swapchain.extent,
-    };
-    vkCmdSetScissor(cmd, 0, 1, &scissor);
-
-    // Prepare push constants
-    struct mirror_push_constants pc = {
-        .game_width = capture->width,
-        .game_height = capture->height,
-        .game_stride = capture->stride,
-        .src_x = mirror->src.x,
-        .src_y = mirror->src.y,
-        .src_w = mirror->src.width,
-        .src_h = mirror->src.height,
-        .color_key_enabled = mirror->color_key_enabled ? 1 : 0,
-        .key_r = ((mirror->color_key_input >> 16) & 0xFF) / 255.0f,
-        .key_g = ((mirror->color_key_input >> 8) & 0xFF) / 255.0f,
-        .key_b = (mirror->color_key_input & 0xFF) / 255.0f,
-        .out_r = ((mirror->color_key_output >> 16) & 0xFF) / 255.0f,
-        .out_g = ((mirror->color_key_output >> 8) & 0xFF) / 255.0f,
-        .out_b = (mirror->color_key_output & 0xFF) / 255.0f,
-        .tolerance = mirror->color_key_tolerance,
-    };
-
-    vkCmdPushConstants(cmd, vk->mirror_pipeline.layout, VK_SHADER_STAGE_FRAGMENT_BIT,
-                       0, sizeof(pc), &pc);
-    vkCmdDraw(cmd, 6, 1, 0, 0);
+    vkBindBufferMemory(vk->device, vk->overlay.instance_buffers[slot], vk->overlay.instance_memories[slot], 0);
+    if (vkMapMemory(vk->device, vk->overlay.instance_memories[slot], 0, buffer_info.size, 0,
+                    &vk->overlay.instance_mapped[slot]) != VK_SUCCESS) {
+        vk_log(LOG_ERROR, "failed to map overlay instance memory");
+        return false;
+    }
+
+    vk->overlay.instance_capacity[slot] = capacity;
+    return true;
 }
 
 static void
-draw_image_single(struct server_vk *vk, VkCommandBuffer cmd, struct vk_image *image) {
-    if (!image->enabled || image->descriptor_set == VK_NULL_HANDLE) {
-        return;
-    }
+overlay_instance_from_mirror(struct overlay_instance *inst, const struct vk_mirror *mirror) {
+    *inst = (struct overlay_instance){
+        .dst = { mirror->dst.x, mirror->dst.y, mirror->dst.width, mirror->dst.height },
+        .src = { mirror->src.x, mirror->src.y, mirror->src.width, mirror->src.height },
+        .key_in = {
+            ((mirror->color_key_input >> 16) & 0xFF) / 255.0f,
+            ((mirror->color_key_input >> 8) & 0xFF) / 255.0f,
+            (mirror->color_key_input & 0xFF) / 255.0f,
+            mirror->color_key_tolerance,
+        },
+        .key_out = {
+            ((mirror->color_key_output >> 16) & 0xFF) / 255.0f,
+            ((mirror->color_key_output >> 8) & 0xFF) / 255.0f,
+            (mirror->color_key_output & 0xFF) / 255.0f,
+            mirror->color_key_enabled ? 1.0f : 0.0f,
+        },
+    };
+}
 
-    VkDeviceSize offset = 0;
-    VkBuffer vertex_buffer = image->vertex_buffer ? image->vertex_buffer : vk->quad_vertex_buffer;
-    vkCmdBindVertexBuffers(cmd, 0, 1, &vertex_buffer, &offset);
+static void
+overlay_instance_from_image(struct overlay_instance *inst, const struct vk_image *image) {
+    *inst = (struct overlay_instance){
+        .dst = { image->dst.x, image->dst.y, image->dst.width, image->dst.height },
+        .src = { image->uv[0], image->uv[1], image->uv[2], image->uv[3] },
+        .layer = (float)image->frame_index,
+        .texture = image->texture,
+    };
+}
 
-    // Bind this image's descriptor set
-    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                            vk->image_pipeline.layout, 0, 1,
-                            &image->descriptor_set, 0, NULL);
+// Binds the shared quad and instance buffers and the full-screen viewport for a batch
+// of instanced overlay quads.
+static void
+begin_overlay_batch(struct server_vk *vk, VkCommandBuffer cmd, VkPipelineLayout layout) {
+    VkBuffer buffers[2] = { vk->quad_vertex_buffer, vk->overlay.instance_buffers[vk->current_frame] };
+    VkDeviceSize offsets[2] = { 0, 0 };
+    vkCmdBindVertexBuffers(cmd, 0, 2, buffers, offsets);
 
-    // Set viewport for this image's destination
     VkViewport viewport = {
-        .x = (float)image->dst.x,
-        .y = (float)image->dst.y,
-        .width = (float)image->dst.width,
-        .height = (float)image->dst.height,
-        .minDepth = 0.0f,
-        .maxDepth = 1.0f,
+        .x = 0, .y = 0,
+        .width = (float)vk->swapchain.extent.width,
+        .height = (float)vk->swapchain.extent.height,
+        .minDepth = 0.0f, .maxDepth = 1.0f,
     };
     vkCmdSetViewport(cmd, 0, 1, &viewport);
 
-    // Scissor to window bounds
-    VkRect2D scissor = {
-        .offset = { 0, 0 },
-        .extent = vk->swapchain.extent,
-    };
-    vkCmdSetScissor(cmd, 0, 1, &scissor);
+    vkCmdSetScissor(cmd, 0, 1, &vk->damage.scissor);
 
-    vkCmdDraw(cmd, 6, 1, 0, 0);
+    struct vk_buffer *capture = vk->capture.current;
+    struct overlay_push_constants pc = {
+        .screen_size = { (float)vk->swapchain.extent.width, (float)vk->swapchain.extent.height },
+        .game_width = capture ? capture->width : 0,
+        .game_height = capture ? capture->height : 0,
+        .game_stride = capture ? (int32_t)capture->stride : 0,
+    };
+    vkCmdPushConstants(cmd, layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                       0, sizeof(pc), &pc);
 }
 
 static void
-draw_text_single(struct server_vk *vk, VkCommandBuffer cmd, struct vk_text *text) {
-    if (!text->enabled || !text->font || text->vertex_count == 0) {
-        return;
+draw_text_range(VkCommandBuffer cmd, VkBuffer *bound, VkBuffer buffer, uint32_t first, uint32_t count) {
+    if (*bound != buffer) {
+        VkDeviceSize offset = 0;
+        vkCmdBindVertexBuffers(cmd, 0, 1, &buffer, &offset);
+        *bound = buffer;
     }
+    vkCmdDraw(cmd, count, 1, first, 0);
+}
 
-    struct vk_push_constants pc = {
-        .src_size = { (float)text->font->atlas_width, (float)text->font->atlas_height },
+// Draws a run of texts which are adjacent in depth order. Every glyph samples the same atlas and
+// carries its own color, so the texts only differ in where their vertices live. Text which is
+// still changing is written to the stream in render order, which makes each stretch of it one
+// contiguous range and one draw. Promoted text is drawn from its own buffer in between.
+static void
+draw_text_run(struct server_vk *vk, VkCommandBuffer cmd, struct vk_render_item *items, size_t count) {
+    struct text_push_constants pc = {
+        .src_size = { (float)vk->font.atlas_width, (float)vk->font.atlas_height },
         .dst_size = { (float)vk->swapchain.extent.width, (float)vk->swapchain.extent.height },
+        .texture = vk->font.atlas_texture,
     };
-    vkCmdPushConstants(cmd, vk->text_vk_pipeline.layout, VK_SHADER_STAGE_VERTEX_BIT, 0,
-                       sizeof(pc), &pc);
-
-    // Bind font atlas descriptor
-    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                            vk->text_vk_pipeline.layout, 0, 1,
-                            &text->font->atlas_descriptor, 0, NULL);
-
-    // Bind vertex buffer
-    VkDeviceSize offset = 0;
-    vkCmdBindVertexBuffers(cmd, 0, 1, &text->vertex_buffer, &offset);
+    vkCmdPushConstants(cmd, vk->text_vk_pipeline.layout,
+                       VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(pc), &pc);
 
     // Set viewport to cover entire screen
     VkViewport viewport = {
@@ -3424,13 +6217,44 @@ draw_text_single(struct server_vk *vk, VkCommandBuffer cmd, struct vk_text *text
     };
     vkCmdSetViewport(cmd, 0, 1, &viewport);
 
-    VkRect2D scissor = {
-        .offset = { 0, 0 },
-        .extent = vk->swapchain.extent,
-    };
-    vkCmdSetScissor(cmd, 0, 1, &scissor);
+    vkCmdSetScissor(cmd, 0, 1, &vk->damage.scissor);
+
+    VkBuffer stream = vk->text_stream.buffers[vk->current_frame];
+    VkBuffer bound = VK_NULL_HANDLE;
+    uint32_t first = 0, pending = 0;
+
+    for (size_t n = 0; n < count; n++) {
+        struct vk_text *text = items[n].obj;
+        if (text->vertex_count == 0) {
+            continue;
+        }
 
-    vkCmdDraw(cmd, text->vertex_count, 1, 0, 0);
+        if (!text->vertex_buffer) {
+            if (text->stream_first + text->vertex_count > vk->text_stream.used) {
+                continue;
+            }
+            if (pending > 0 && first + pending == text->stream_first) {
+                pending += text->vertex_count;
+                continue;
+            }
+            if (pending > 0) {
+                draw_text_range(cmd, &bound, stream, first, pending);
+            }
+            first = text->stream_first;
+            pending = text->vertex_count;
+            continue;
+        }
+
+        if (pending > 0) {
+            draw_text_range(cmd, &bound, stream, first, pending);
+            pending = 0;
+        }
+        draw_text_range(cmd, &bound, text->vertex_buffer, 0, text->vertex_count);
+    }
+
+    if (pending > 0) {
+        draw_text_range(cmd, &bound, stream, first, pending);
+    }
 }
 
 static void
@@ -3457,11 +6281,7 @@ draw_view_single(struct server_vk *vk, VkCommandBuffer cmd, struct vk_view *view
     };
     vkCmdSetViewport(cmd, 0, 1, &viewport);
 
-    VkRect2D scissor = {
-        .offset = { 0, 0 },
-        .extent = vk->swapchain.extent,
-    };
-    vkCmdSetScissor(cmd, 0, 1, &scissor);
+    vkCmdSetScissor(cmd, 0, 1, &vk->damage.scissor);
 
     // Use buffer_blit path for cross-GPU with stride mismatch (NATIVE path)
     if (buf->storage_buffer && buf->buffer_descriptor_set) {
@@ -3515,77 +6335,124 @@ draw_view_single(struct server_vk *vk, VkCommandBuffer cmd, struct vk_view *view
 
 static void
 draw_sorted_objects(struct server_vk *vk, VkCommandBuffer cmd) {
-    // Collect all enabled objects
-    size_t count = 0;
-    struct vk_mirror *m;
-    wl_list_for_each(m, &vk->mirrors, link) { if (m->enabled) count++; }
-    struct vk_image *i;
-    wl_list_for_each(i, &vk->images, link) { if (i->enabled) count++; }
-    struct vk_text *t;
-    wl_list_for_each(t, &vk->texts, link) { if (t->enabled) count++; }
-    struct vk_view *v;
-    wl_list_for_each(v, &vk->views, link) { if (v->enabled && v->current_buffer) count++; }
+    render_list_update(vk);
+    stream_texts(vk, vk->current_frame);
 
+    struct vk_render_item *items = vk->render_list.items;
+    size_t count = vk->render_list.count;
     if (count == 0) return;
 
-    struct render_item *items = malloc(count * sizeof(*items));
-    if (!items) return;
-
-    size_t idx = 0;
-    wl_list_for_each(m, &vk->mirrors, link) {
-        if (m->enabled) items[idx++] = (struct render_item){ .depth = m->depth, .type = ITEM_MIRROR, .obj = m };
-    }
-    wl_list_for_each(i, &vk->images, link) {
-        if (i->enabled) items[idx++] = (struct render_item){ .depth = i->depth, .type = ITEM_IMAGE, .obj = i };
-    }
-    wl_list_for_each(t, &vk->texts, link) {
-        if (t->enabled) items[idx++] = (struct render_item){ .depth = t->depth, .type = ITEM_TEXT, .obj = t };
-    }
-    wl_list_for_each(v, &vk->views, link) {
-        if (v->enabled && v->current_buffer) items[idx++] = (struct render_item){ .depth = v->depth, .type = ITEM_VIEW, .obj = v };
-    }
-
-    qsort(items, count, sizeof(*items), compare_render_items);
+    // Mirrors and images are drawn as instanced quads. Consecutive items which can share
+    // a pipeline are merged into a single draw, so depth order is kept. Images select their
+    // texture from the texture table per instance, so any run of images is one draw.
+    size_t quad_count = vk->render_list.quad_count;
+    bool can_batch = quad_count > 0 && ensure_overlay_instances(vk, vk->current_frame, quad_count);
+    struct overlay_instance *instances = vk->overlay.instance_mapped[vk->current_frame];
+    uint32_t next_instance = 0;
 
     // Draw sorted items
     VkPipeline last_pipeline = VK_NULL_HANDLE;
     struct vk_buffer *capture = vk->capture.current;
 
     for (size_t k = 0; k < count; k++) {
-        struct render_item *item = &items[k];
+        struct vk_render_item *item = &items[k];
         switch (item->type) {
-        case ITEM_MIRROR:
-            if (last_pipeline != vk->mirror_pipeline.pipeline) {
-                vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, vk->mirror_pipeline.pipeline);
-                // Mirrors rely on capture buffer descriptor
-                if (capture && capture->storage_buffer && capture->buffer_descriptor_set) {
-                    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                            vk->mirror_pipeline.layout, 0, 1,
-                                            &capture->buffer_descriptor_set, 0, NULL);
+        case ITEM_MIRROR: {
+            size_t end = k + 1;
+            while (end < count && items[end].type == ITEM_MIRROR) end++;
+
+            // Mirrors read the resident capture when there is one, and otherwise the capture
+            // buffer descriptor.
+            struct vk_resident_capture *resident = frame_resident_capture(vk);
+            if (can_batch && capture && resident->valid) {
+                uint32_t first = next_instance;
+                for (size_t n = k; n < end; n++) {
+                    struct overlay_instance *inst = &instances[next_instance++];
+                    overlay_instance_from_mirror(inst, items[n].obj);
+                    inst->src[0] -= (float)resident->box.x;
+                    inst->src[1] -= (float)resident->box.y;
+                }
+
+                VkPipeline pipeline = vk->mirror_pipeline.resident_pipeline;
+                VkPipelineLayout layout = vk->mirror_pipeline.resident_layout;
+                if (last_pipeline != pipeline) {
+                    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+                    last_pipeline = pipeline;
                 }
-                // Bind quad vertex buffer (mirrors use shared quad)
-                VkDeviceSize offset = 0;
-                vkCmdBindVertexBuffers(cmd, 0, 1, &vk->quad_vertex_buffer, &offset);
-                last_pipeline = vk->mirror_pipeline.pipeline;
+                vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1,
+                                        &resident->descriptor_set, 0, NULL);
+                begin_overlay_batch(vk, cmd, layout);
+
+                // The shader clamps to the copied region rather than to the whole game.
+                int32_t region[2] = { resident->box.width, resident->box.height };
+                vkCmdPushConstants(cmd, layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                                   offsetof(struct overlay_push_constants, game_width),
+                                   sizeof(region), region);
+                vkCmdDraw(cmd, 6, next_instance - first, 0, first);
+            } else if (can_batch && capture && capture->storage_buffer && capture->buffer_descriptor_set) {
+                uint32_t first = next_instance;
+                for (size_t n = k; n < end; n++) {
+                    overlay_instance_from_mirror(&instances[next_instance++], items[n].obj);
+                }
+
+                if (last_pipeline != vk->mirror_pipeline.pipeline) {
+                    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, vk->mirror_pipeline.pipeline);
+                    last_pipeline = vk->mirror_pipeline.pipeline;
+                }
+                vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                        vk->mirror_pipeline.layout, 0, 1,
+                                        &capture->buffer_descriptor_set, 0, NULL);
+                begin_overlay_batch(vk, cmd, vk->mirror_pipeline.layout);
+                vkCmdDraw(cmd, 6, next_instance - first, 0, first);
             }
-            draw_mirror_single(vk, cmd, item->obj);
+            k = end - 1;
             break;
+        }
 
-        case ITEM_IMAGE:
-            if (last_pipeline != vk->image_pipeline.pipeline) {
-                vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, vk->image_pipeline.pipeline);
-                last_pipeline = vk->image_pipeline.pipeline;
+        case ITEM_IMAGE: {
+            size_t end = k + 1;
+            while (end < count && items[end].type == ITEM_IMAGE) end++;
+
+            if (can_batch) {
+                uint32_t first = next_instance;
+                for (size_t n = k; n < end; n++) {
+                    struct vk_image *image = items[n].obj;
+                    if (image->texture != VK_TEXTURE_NONE) {
+                        overlay_instance_from_image(&instances[next_instance++], image);
+                    }
+                }
+
+                if (next_instance > first) {
+                    if (last_pipeline != vk->image_pipeline.pipeline) {
+                        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, vk->image_pipeline.pipeline);
+                        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                                vk->image_pipeline.layout, 0, 1, &vk->textures.set, 0, NULL);
+                        last_pipeline = vk->image_pipeline.pipeline;
+                    }
+                    begin_overlay_batch(vk, cmd, vk->image_pipeline.layout);
+                    vkCmdDraw(cmd, 6, next_instance - first, 0, first);
+                }
             }
-            draw_image_single(vk, cmd, item->obj);
+            k = end - 1;
             break;
+        }
+
+        case ITEM_TEXT: {
+            size_t end = k + 1;
+            while (end < count && items[end].type == ITEM_TEXT) end++;
 
-        case ITEM_TEXT:
-            if (last_pipeline != vk->text_vk_pipeline.pipeline) {
-                vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, vk->text_vk_pipeline.pipeline);
-                last_pipeline = vk->text_vk_pipeline.pipeline;
+            if (vk->font.atlas_view) {
+                if (last_pipeline != vk->text_vk_pipeline.pipeline) {
+                    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, vk->text_vk_pipeline.pipeline);
+                    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                            vk->text_vk_pipeline.layout, 0, 1, &vk->textures.set, 0, NULL);
+                    last_pipeline = vk->text_vk_pipeline.pipeline;
+                }
+                draw_text_run(vk, cmd, &items[k], end - k);
             }
-            draw_text_single(vk, cmd, item->obj);
+            k = end - 1;
             break;
+        }
 
         case ITEM_VIEW:
             draw_view_single(vk, cmd, item->obj);
@@ -3594,7 +6461,42 @@ draw_sorted_objects(struct server_vk *vk, VkCommandBuffer cmd) {
         }
     }
 
-    free(items);
+}
+
+// Drops the hold a frame slot has on its capture buffer. The client gets the buffer
+// back once the surface no longer uses it either.
+static void
+capture_release_slot(struct server_vk *vk, uint32_t slot) {
+    struct vk_buffer *buf = vk->capture.in_flight[slot];
+    if (!buf) {
+        return;
+    }
+
+    vk->capture.in_flight[slot] = NULL;
+    if (buf->parent) {
+        server_buffer_unlock(buf->parent);
+    }
+}
+
+static void
+capture_hold_slot(struct server_vk *vk, uint32_t slot, struct vk_buffer *buf) {
+    ww_assert(!vk->capture.in_flight[slot]);
+
+    if (vk->proxy_game || !buf->parent) {
+        return;
+    }
+    server_buffer_lock(buf->parent);
+    vk->capture.in_flight[slot] = buf;
+}
+
+// Releases the capture buffers of every frame that has finished on the GPU.
+static void
+capture_release_completed(struct server_vk *vk) {
+    for (uint32_t i = 0; i < VK_MAX_FRAMES_IN_FLIGHT; i++) {
+        if (vk->capture.in_flight[i] && vkGetFenceStatus(vk->device, vk->in_flight[i]) == VK_SUCCESS) {
+            capture_release_slot(vk, i);
+        }
+    }
 }
 
 bool
@@ -3605,60 +6507,71 @@ server_vk_begin_frame(struct server_vk *vk) {
         bool has_buffer_path = capture->storage_buffer && capture->buffer_descriptor_set;
         bool has_image_path = capture->descriptor_set != VK_NULL_HANDLE;
         has_capture = has_buffer_path || has_image_path;
+    }
 
-        // Try to swap optimal buffers if async copy is ready.
-        if (vk->async_pipelining_enabled && capture->async_optimal_valid) {
-            try_swap_optimal_buffers(vk, capture);
-        }
+    // A capture which is passed through is shown by the parent compositor. The swapchain only
+    // has to be cleared once after entering passthrough.
+    if (passthrough_update(vk, capture, false)) {
+        has_capture = false;
     }
 
     // If there is no capture buffer, we can still render overlays (proxy_game mode).
-    bool has_anything = has_capture;
-    if (!has_anything) {
-        struct vk_image *img;
-        wl_list_for_each(img, &vk->images, link) {
-            if (img->enabled) {
-                has_anything = true;
-                break;
-            }
-        }
+    // Mirrors sample the capture, so they don't count on their own.
+    render_list_update(vk);
+    bool has_anything = has_capture || vk->passthrough.clear;
+    for (size_t k = 0; !has_anything && k < vk->render_list.count; k++) {
+        has_anything = vk->render_list.items[k].type != ITEM_MIRROR;
     }
     if (!has_anything) {
-        struct vk_text *txt;
-        wl_list_for_each(txt, &vk->texts, link) {
-            if (txt->enabled) {
-                has_anything = true;
-                break;
-            }
-        }
+        return false;
     }
-    if (!has_anything) {
-        struct vk_view *v;
-        wl_list_for_each(v, &vk->views, link) {
-            if (v->enabled && v->current_buffer) {
-                has_anything = true;
-                break;
-            }
-        }
+
+    // Nothing changed since the last present, so the previous image is still correct.
+    if (vk->damage.disabled) {
+        damage_full(vk);
     }
-    if (!has_anything) {
+    if (damage_empty(&vk->damage.frame)) {
         return false;
     }
 
+    vk->timing.begin_ns = now_ns();
+
     // Wait for the previous frame on this slot to finish (avoid dropping frames)
     vkWaitForFences(vk->device, 1, &vk->in_flight[vk->current_frame], VK_TRUE, UINT64_MAX);
     // vkResetFences moved to after acquire
 
+    // The slot's previous submission is done, so its timestamps are available and its
+    // capture buffer can go back to the client.
+    frame_timing_resolve(vk, vk->current_frame);
+    capture_release_slot(vk, vk->current_frame);
+    if (!vk->capture.release_signals) {
+        capture_copy_release_completed(vk);
+    }
+
     // Acquire next swapchain image (non-blocking)
     VkResult result = vkAcquireNextImageKHR(vk->device, vk->swapchain.swapchain, 0,
                           vk->image_available[vk->current_frame], VK_NULL_HANDLE,
                           &vk->current_image_index);
     if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+        vk->pacing.dropped = true;
         return false;
     }
 
     vkResetFences(vk->device, 1, &vk->in_flight[vk->current_frame]);
 
+    // A frame which only shows the game copies it straight from the capture.
+    bool transfer = has_capture && transfer_present_possible(vk, capture);
+    vk->transfer_present.active = transfer;
+
+    // A frame which samples a capture copy never touches the capture buffer, so it doesn't have
+    // to hold on to it either.
+    vk->capture_copy.sampled = (has_capture && !transfer) ? capture_copy_find(vk, capture) : -1;
+    bool reads_capture = has_capture && vk->capture_copy.sampled < 0;
+    if (reads_capture) {
+        capture_hold_slot(vk, vk->current_frame, capture);
+    }
+    import_tune_frame(vk, (has_capture && !transfer) ? capture : NULL);
+
     // Reset and begin command buffer
     VkCommandBuffer cmd = vk->command_buffers[vk->current_frame];
     vkResetCommandBuffer(cmd, 0);
@@ -3668,8 +6581,13 @@ server_vk_begin_frame(struct server_vk *vk) {
     };
     vkBeginCommandBuffer(cmd, &begin_info);
 
+    if (vk->timing.query_pool) {
+        vkCmdResetQueryPool(cmd, vk->timing.query_pool, vk->current_frame * VK_TS_COUNT, VK_TS_COUNT);
+    }
+    frame_timing_write_ts(vk, cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_TS_BEGIN);
+
     // Perform dma-buf sync and image/buffer transition for captured buffer
-    if (has_capture && vk->capture.current && vk->capture.current->dmabuf_fd >= 0) {
+    if (reads_capture && vk->capture.current->dmabuf_fd >= 0) {
         // Kernel-level sync: wait for Intel GPU to finish writing
         // dmabuf_sync_start_read(vk->capture.current->dmabuf_fd);
 
@@ -3681,31 +6599,70 @@ server_vk_begin_frame(struct server_vk *vk) {
         }
     }
 
+    // NATIVE captures are drawn from a device-local copy of the region read this frame.
+    update_resident_capture(vk, cmd, (reads_capture && !transfer) ? capture : NULL);
+
+    // Only redraw what changed since this image was last drawn. Images with unknown
+    // contents are cleared and redrawn in full.
+    struct vk_damage *image_damage = &vk->damage.images[vk->current_image_index];
+    bool partial = !image_damage->full;
+    if (partial) {
+        vk->damage.scissor = (VkRect2D){
+            .offset = { image_damage->x1, image_damage->y1 },
+            .extent = { (uint32_t)(image_damage->x2 - image_damage->x1),
+                        (uint32_t)(image_damage->y2 - image_damage->y1) },
+        };
+    } else {
+        vk->damage.scissor = (VkRect2D){ .offset = { 0, 0 }, .extent = vk->swapchain.extent };
+    }
+    *image_damage = (struct vk_damage){0};
+
+    if (transfer) {
+        record_transfer_present(vk, cmd, capture, partial);
+        return true;
+    }
+
     // Begin render pass with transparent clear color (for background visibility)
     VkClearValue clear_value = { .color = {{ 0.0f, 0.0f, 0.0f, 0.0f }} };
 
     VkRenderPassBeginInfo rp_info = {
         .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
-        .renderPass = vk->render_pass,
+        .renderPass = partial ? vk->render_pass_load : vk->render_pass,
         .framebuffer = vk->swapchain.framebuffers[vk->current_image_index],
-        .renderArea = {
-            .offset = { 0, 0 },
-            .extent = vk->swapchain.extent,
-        },
-        .clearValueCount = 1,
-        .pClearValues = &clear_value,
+        .renderArea = vk->damage.scissor,
+        .clearValueCount = partial ? 0 : 1,
+        .pClearValues = partial ? NULL : &clear_value,
     };
 
+    frame_timing_write_ts(vk, cmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_TS_ACQUIRE);
+
     vkCmdBeginRenderPass(cmd, &rp_info, VK_SUBPASS_CONTENTS_INLINE);
 
+    if (partial) {
+        VkClearAttachment clear_attachment = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .colorAttachment = 0,
+            .clearValue = clear_value,
+        };
+        VkClearRect clear_rect = {
+            .rect = vk->damage.scissor,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        };
+        vkCmdClearAttachments(cmd, 1, &clear_attachment, 1, &clear_rect);
+    }
+
     // Draw the captured frame centered in window (Game Background)
     if (has_capture) {
         draw_captured_frame(vk, cmd);
     }
+    frame_timing_write_ts(vk, cmd, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_TS_CAPTURE);
 
     // Draw all overlays sorted by depth (Mirrors, Images, Text)
     draw_sorted_objects(vk, cmd);
+    frame_timing_write_ts(vk, cmd, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_TS_OVERLAYS);
 
+    vk->passthrough.clear = false;
     return true;
 }
 
@@ -3713,10 +6670,13 @@ void
 server_vk_end_frame(struct server_vk *vk) {
     VkCommandBuffer cmd = vk->command_buffers[vk->current_frame];
 
-    vkCmdEndRenderPass(cmd);
+    if (!vk->transfer_present.active) {
+        vkCmdEndRenderPass(cmd);
+    }
 
     // Release imported image/buffer back to external GPU for next frame
-    if (vk->capture.current) {
+    bool passthrough = passthrough_active(vk);
+    if (vk->capture.current && vk->capture_copy.sampled < 0 && !passthrough) {
         if (vk->capture.current->storage_buffer && vk->capture.current->buffer_descriptor_set) {
             release_imported_buffer(vk, vk->capture.current->storage_buffer, cmd);
         } else if (vk->capture.current->image) {
@@ -3724,6 +6684,8 @@ server_vk_end_frame(struct server_vk *vk) {
         }
     }
 
+    frame_timing_write_ts(vk, cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, VK_TS_END);
+
     vkEndCommandBuffer(cmd);
 
     // End kernel-level dma-buf sync
@@ -3731,53 +6693,30 @@ server_vk_end_frame(struct server_vk *vk) {
         // dmabuf_sync_end_read(vk->capture.current->dmabuf_fd);
     }
 
+    // Texture copies recorded since the last frame are submitted ahead of it.
+    upload_flush(vk);
+
     // Explicit sync (timeline semaphore)
-    VkSemaphore wait_semaphores[2];
-    uint64_t wait_values[2] = {0, 0};
-    VkPipelineStageFlags wait_stages[2] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT };
+    VkSemaphore wait_semaphores[3];
+    uint64_t wait_values[3] = {0, 0, 0};
+    VkPipelineStageFlags wait_stages[3] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT };
     uint32_t wait_count = 1;
 
     wait_semaphores[0] = vk->image_available[vk->current_frame];
+    if (vk->transfer_present.active) {
+        wait_stages[0] = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    }
 
-    if (!vk->disable_capture_sync_wait &&
-        pfn_vkImportSemaphoreFdKHR && vk->capture.surface && vk->capture.surface->syncobj) {
-        struct server_drm_syncobj_surface *sync = vk->capture.surface->syncobj;
-        if (sync->acquire.fd != -1) {
-            if (sync->vk_sem == VK_NULL_HANDLE) {
-                VkSemaphoreTypeCreateInfo type_info = {
-                    .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
-                    .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
-                    .initialValue = 0,
-                };
-                VkSemaphoreCreateInfo info = {
-                    .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
-                    .pNext = &type_info,
-                };
-                vkCreateSemaphore(vk->device, &info, NULL, &sync->vk_sem);
-            }
-
-            if (sync->imported_fd != sync->acquire.fd) {
-                int fd_dup = dup(sync->acquire.fd);
-                VkImportSemaphoreFdInfoKHR import = {
-                    .sType = VK_STRUCTURE_TYPE_IMPORT_SEMAPHORE_FD_INFO_KHR,
-                    .semaphore = sync->vk_sem,
-                    .flags = VK_SEMAPHORE_IMPORT_TEMPORARY_BIT,
-                    .handleType = VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_OPAQUE_FD_BIT,
-                    .fd = fd_dup,
-                };
-                if (pfn_vkImportSemaphoreFdKHR(vk->device, &import) == VK_SUCCESS) {
-                    sync->imported_fd = sync->acquire.fd;
-                } else {
-                    close(fd_dup);
-                }
-            }
-
-            if (sync->imported_fd == sync->acquire.fd) {
-                wait_semaphores[wait_count] = sync->vk_sem;
-                wait_values[wait_count] = ((uint64_t)sync->acquire.point_hi << 32) | sync->acquire.point_lo;
-                wait_count++;
-            }
-        }
+    // A frame which samples a capture copy doesn't read the capture buffer, and the copy has
+    // already waited for it.
+    if (vk->capture_copy.sampled >= 0) {
+        struct vk_capture_copy *copy = &vk->capture_copy.copies[vk->capture_copy.sampled];
+        wait_semaphores[wait_count] = vk->capture_copy.timeline;
+        wait_values[wait_count] = copy->value;
+        wait_count++;
+    } else if (!passthrough &&
+               capture_sync_acquire(vk, &wait_semaphores[wait_count], &wait_values[wait_count])) {
+        wait_count++;
     }
 
     VkTimelineSemaphoreSubmitInfo timeline_info = {
@@ -3794,14 +6733,37 @@ server_vk_end_frame(struct server_vk *vk) {
         }
     }
 
-    VkSemaphore signal_semaphores[2];
-    uint64_t signal_values[2] = {0, 0};
+    // Sample uploaded textures and read promoted text vertices only once their copies have landed.
+    if (vk->upload.submitted > 0) {
+        wait_semaphores[wait_count] = vk->upload.timeline;
+        wait_values[wait_count] = vk->upload.submitted;
+        wait_stages[wait_count] = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        wait_count++;
+    }
+    timeline_info.waitSemaphoreValueCount = wait_count;
+
+    VkSemaphore signal_semaphores[4];
+    uint64_t signal_values[4] = {0, 0, 0, 0};
     uint32_t signal_count = 1;
 
     signal_semaphores[0] = vk->render_finished[vk->current_frame];
 
-    // Handle explicit release (Signal)
-    if (!vk->disable_capture_sync_wait &&
+    // Wakes the event loop once the frame is done, to release its capture buffer.
+    struct vk_release_watch *release = &vk->capture.release[vk->current_frame];
+    if (vk->capture.release_signals && release->semaphore) {
+        signal_semaphores[signal_count] = release->semaphore;
+        signal_count++;
+    }
+
+    // Later uploads wait for this frame before overwriting anything it samples.
+    uint64_t frame_value = vk->upload.frames_submitted + 1;
+    signal_semaphores[signal_count] = vk->upload.frame_timeline;
+    signal_values[signal_count] = frame_value;
+    signal_count++;
+
+    // Handle explicit release (Signal). The parent compositor releases a capture which is passed
+    // through.
+    if (!vk->disable_capture_sync_wait && !passthrough &&
         pfn_vkImportSemaphoreFdKHR && vk->capture.surface && vk->capture.surface->syncobj) {
         struct server_drm_syncobj_surface *sync = vk->capture.surface->syncobj;
         if (sync->release.fd != -1) {
@@ -3857,7 +6819,15 @@ server_vk_end_frame(struct server_vk *vk) {
         .pSignalSemaphores = signal_semaphores,
     };
 
-    vkQueueSubmit(vk->graphics_queue, 1, &submit_info, vk->in_flight[vk->current_frame]);
+    uint64_t submit_start = now_ns();
+    if (vkQueueSubmit(vk->graphics_queue, 1, &submit_info, vk->in_flight[vk->current_frame]) == VK_SUCCESS) {
+        release_watch_arm(vk, release);
+        vk->upload.frames_submitted = frame_value;
+        if (vk->capture_copy.sampled >= 0) {
+            vk->capture_copy.copies[vk->capture_copy.sampled].read_frame = frame_value;
+        }
+    }
+    uint64_t submit_end = now_ns();
 
     // Present
     VkPresentInfoKHR present_info = {
@@ -3869,9 +6839,42 @@ server_vk_end_frame(struct server_vk *vk) {
         .pImageIndices = &vk->current_image_index,
     };
 
+    // Tell the parent compositor which part of the window changed since the last present.
+    struct vk_damage *frame_damage = &vk->damage.frame;
+    VkRectLayerKHR present_rect = {
+        .offset = { frame_damage->x1, frame_damage->y1 },
+        .extent = { (uint32_t)(frame_damage->x2 - frame_damage->x1),
+                    (uint32_t)(frame_damage->y2 - frame_damage->y1) },
+        .layer = 0,
+    };
+    VkPresentRegionKHR present_region = {
+        .rectangleCount = 1,
+        .pRectangles = &present_rect,
+    };
+    VkPresentRegionsKHR present_regions = {
+        .sType = VK_STRUCTURE_TYPE_PRESENT_REGIONS_KHR,
+        .swapchainCount = 1,
+        .pRegions = &present_region,
+    };
+    if (vk->incremental_present && !frame_damage->full) {
+        present_info.pNext = &present_regions;
+    }
+
+    // Ask for presentation feedback on the commit the present is about to make.
+    frame_pacing_request_feedback(vk);
+
     vkQueuePresentKHR(vk->present_queue, &present_info);
+    uint64_t present_end = now_ns();
+    *frame_damage = (struct vk_damage){0};
+
+    // The game is drawn by the swapchain again, so it no longer has to be passed through.
+    if (vk->passthrough.leaving) {
+        passthrough_unmap(vk);
+    }
+
+    frame_timing_record(vk, submit_start, submit_end, present_end);
 
-    // FPS logging (every 100 ms)
+    // FPS logging (every 100 ms), with the latest commit-to-present latency
     vk->fps_frame_count++;
     uint64_t now = now_ms();
     uint64_t delta = now - vk->fps_last_time_ms;
@@ -3879,8 +6882,16 @@ server_vk_end_frame(struct server_vk *vk) {
         double fps = (double)vk->fps_frame_count * 1000.0 / (double)delta;
         int32_t cap_w = 0, cap_h = 0;
         server_vk_get_capture_size(vk, &cap_w, &cap_h);
-        vk_log(LOG_INFO, "FPS: %.1f (capture=%dx%d, swap=%ux%u)",
-               fps, cap_w, cap_h, vk->swapchain.extent.width, vk->swapchain.extent.height);
+
+        struct vk_frame_stats last;
+        double latency_ms = 0.0;
+        if (server_vk_get_frame_stats(vk, &last, 1) == 1 && last.commit_ns) {
+            latency_ms = (double)(last.present_ns - last.commit_ns) / 1e6;
+        }
+        vk_log(LOG_INFO,
+               "FPS: %.1f (capture=%dx%d, swap=%ux%u, commit->present=%.2fms, superseded=%" PRIu64 ")",
+               fps, cap_w, cap_h, vk->swapchain.extent.width, vk->swapchain.extent.height,
+               latency_ms, vk->capture.superseded);
         vk->fps_frame_count = 0;
         vk->fps_last_time_ms = now;
     }
@@ -3899,6 +6910,15 @@ vk_buffer_destroy(struct vk_buffer *buffer) {
 
     struct server_vk *vk = buffer->vk;
 
+    // Frames still reading this buffer have to finish before it goes away.
+    for (uint32_t i = 0; i < VK_MAX_FRAMES_IN_FLIGHT; i++) {
+        if (vk->capture.in_flight[i] == buffer) {
+            vkWaitForFences(vk->device, 1, &vk->in_flight[i], VK_TRUE, UINT64_MAX);
+            capture_release_slot(vk, i);
+        }
+    }
+    capture_copy_forget(vk, buffer);
+
     for (uint32_t i = 0; i < buffer->export_count; i++) {
         if (buffer->export_images[i]) {
             vkDestroyImage(vk->device, buffer->export_images[i], NULL);
@@ -3910,15 +6930,6 @@ vk_buffer_destroy(struct vk_buffer *buffer) {
         }
     }
 
-    // Clean up async double-buffered optimal first (if used)
-    // This must happen before freeing descriptor_set to avoid double-free
-    // since descriptor_set may point to one of optimal_descriptors[]
-    if (buffer->async_optimal_valid) {
-        destroy_double_buffered_optimal(vk, buffer);
-        // descriptor_set was pointing to optimal_descriptors, now freed
-        buffer->descriptor_set = VK_NULL_HANDLE;
-    }
-
     if (buffer->descriptor_set) {
         vkFreeDescriptorSets(vk->device, vk->descriptor_pool, 1, &buffer->descriptor_set);
     }
@@ -4160,8 +7171,82 @@ on_parent_buffer_destroy(struct wl_listener *listener, void *data) {
     vk_buffer_destroy(vk_buf);
 }
 
+// Creates a storage buffer over the memory of a LINEAR import, which the buffer blit pipeline
+// reads with the dma-buf stride.
+static bool
+create_storage_buffer(struct server_vk *vk, struct vk_buffer *vk_buffer,
+                      struct server_dmabuf_data *data, VkDeviceSize memory_size) {
+    // Calculate exact size needed for the data
+    VkDeviceSize buffer_size = (VkDeviceSize)data->planes[0].stride * data->height;
+
+    // Ensure we don't exceed allocated memory size
+    if (buffer_size > memory_size) {
+        buffer_size = memory_size;
+    }
+
+    // Read by the capture copy on the transfer queue and by shaders on the graphics queue
+    uint32_t families[2] = { vk->graphics_family, vk->transfer_family };
+    VkBufferCreateInfo buffer_info = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = buffer_size,
+        .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        .sharingMode = vk->upload.concurrent ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = vk->upload.concurrent ? 2 : 0,
+        .pQueueFamilyIndices = families,
+    };
+
+    VkResult result = vkCreateBuffer(vk->device, &buffer_info, NULL, &vk_buffer->storage_buffer);
+    if (result != VK_SUCCESS) {
+        vk_log(LOG_ERROR, "failed to create storage buffer for dma-buf: %d", result);
+        return false;
+    }
+
+    // Bind the same imported memory to the buffer
+    result = vkBindBufferMemory(vk->device, vk_buffer->storage_buffer, vk_buffer->memory, 0);
+    if (result != VK_SUCCESS) {
+        vk_log(LOG_ERROR, "failed to bind storage buffer memory: %d", result);
+        return false;
+    }
+
+    // Allocate descriptor set for buffer path
+    VkDescriptorSetAllocateInfo buf_desc_alloc_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = vk->descriptor_pool,
+        .descriptorSetCount = 1,
+        .pSetLayouts = &vk->buffer_blit.descriptor_layout,
+    };
+
+    result = vkAllocateDescriptorSets(vk->device, &buf_desc_alloc_info, &vk_buffer->buffer_descriptor_set);
+    if (result != VK_SUCCESS) {
+        vk_log(LOG_ERROR, "failed to allocate buffer descriptor set: %d", result);
+        return false;
+    }
+
+    // Update descriptor set with storage buffer
+    VkDescriptorBufferInfo buffer_desc = {
+        .buffer = vk_buffer->storage_buffer,
+        .offset = 0,
+        .range = VK_WHOLE_SIZE,
+    };
+
+    VkWriteDescriptorSet buf_desc_write = {
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = vk_buffer->buffer_descriptor_set,
+        .dstBinding = 0,
+        .dstArrayElement = 0,
+        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        .descriptorCount = 1,
+        .pBufferInfo = &buffer_desc,
+    };
+
+    vkUpdateDescriptorSets(vk->device, 1, &buf_desc_write, 0, NULL);
+    return true;
+}
+
 static struct vk_buffer *
 vk_buffer_import(struct server_vk *vk, struct server_buffer *buffer) {
+    uint64_t import_start = now_ns();
+
     if (strcmp(buffer->impl->name, SERVER_BUFFER_DMABUF) != 0) {
         vk_log(LOG_ERROR, "cannot import non-DMABUF buffer");
         return NULL;
@@ -4393,6 +7478,9 @@ vk_buffer_import(struct server_vk *vk, struct server_buffer *buffer) {
             wl_signal_add(&buffer->events.resource_destroy, &vk_buffer->on_parent_destroy);
 
             wl_list_insert(&vk->capture.buffers, &vk_buffer->link);
+
+            vk_buffer->strategy = VK_IMPORT_MODIFIER;
+            import_tune_imported(vk, vk_buffer, now_ns() - import_start);
             return vk_buffer;
         } else {
             vk_log(LOG_WARN, "modifier import failed (%d), falling back to LINEAR path", result);
@@ -4446,6 +7534,10 @@ vk_buffer_import(struct server_vk *vk, struct server_buffer *buffer) {
     vk_log(LOG_INFO, "VK layout: rowPitch=%"PRIu64" | dma-buf stride=%u",
            vk_layout.rowPitch, dmabuf_stride);
 
+    // The image can only be sampled directly if it doesn't need widening to match the stride.
+    vk_buffer->strategy = import_tune_choose_linear(vk, data->width, data->height,
+                                                    vk_layout.rowPitch == dmabuf_stride);
+
     // If strides don't match, recreate image with width adjusted to match dma-buf stride
     if (vk_layout.rowPitch != dmabuf_stride) {
         vkDestroyImage(vk->device, vk_buffer->image, NULL);
@@ -4561,67 +7653,11 @@ vk_buffer_import(struct server_vk *vk, struct server_buffer *buffer) {
     }
 
     // Also create a VkBuffer backed by the same memory for manual stride handling
-    // Calculate exact size needed for the data
-    VkDeviceSize buffer_size = (VkDeviceSize)data->planes[0].stride * data->height;
-    
-    // Ensure we don't exceed allocated memory size
-    if (buffer_size > mem_reqs.size) {
-        buffer_size = mem_reqs.size;
-    }
-
-    VkBufferCreateInfo buffer_info = {
-        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-        .size = buffer_size,
-        .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
-    };
-
-    result = vkCreateBuffer(vk->device, &buffer_info, NULL, &vk_buffer->storage_buffer);
-    if (result != VK_SUCCESS) {
-        vk_log(LOG_ERROR, "failed to create storage buffer for dma-buf: %d", result);
-        goto fail;
-    }
-
-    // Bind the same imported memory to the buffer
-    result = vkBindBufferMemory(vk->device, vk_buffer->storage_buffer, vk_buffer->memory, 0);
-    if (result != VK_SUCCESS) {
-        vk_log(LOG_ERROR, "failed to bind storage buffer memory: %d", result);
-        goto fail;
-    }
-
-    // Allocate descriptor set for buffer path
-    VkDescriptorSetAllocateInfo buf_desc_alloc_info = {
-        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-        .descriptorPool = vk->descriptor_pool,
-        .descriptorSetCount = 1,
-        .pSetLayouts = &vk->buffer_blit.descriptor_layout,
-    };
-
-    result = vkAllocateDescriptorSets(vk->device, &buf_desc_alloc_info, &vk_buffer->buffer_descriptor_set);
-    if (result != VK_SUCCESS) {
-        vk_log(LOG_ERROR, "failed to allocate buffer descriptor set: %d", result);
+    if (vk_buffer->strategy == VK_IMPORT_STORAGE_BUFFER &&
+        !create_storage_buffer(vk, vk_buffer, data, mem_reqs.size)) {
         goto fail;
     }
 
-    // Update descriptor set with storage buffer
-    VkDescriptorBufferInfo buffer_desc = {
-        .buffer = vk_buffer->storage_buffer,
-        .offset = 0,
-        .range = VK_WHOLE_SIZE,
-    };
-
-    VkWriteDescriptorSet buf_desc_write = {
-        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-        .dstSet = vk_buffer->buffer_descriptor_set,
-        .dstBinding = 0,
-        .dstArrayElement = 0,
-        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-        .descriptorCount = 1,
-        .pBufferInfo = &buffer_desc,
-    };
-
-    vkUpdateDescriptorSets(vk->device, 1, &buf_desc_write, 0, NULL);
-
     // Create image view
     VkImageViewCreateInfo view_info = {
         .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
@@ -4689,149 +7725,60 @@ vk_buffer_import(struct server_vk *vk, struct server_buffer *buffer) {
     vk_log(LOG_INFO, "imported dma-buf: %dx%d, format=0x%x, modifier=0x%llx",
            data->width, data->height, data->format, (unsigned long long)modifier);
 
-    // Attempt to create optimal-tiling copy to avoid linear peer-read throttling
-    if (!use_modifier_path && vk_buffer->view) {
+    // Attempt to create optimal-tiling copy to avoid linear peer-read throttling. A LINEAR image
+    // which is sampled directly must keep its own descriptor set.
+    if (vk_buffer->strategy == VK_IMPORT_STORAGE_BUFFER && vk_buffer->view) {
         VkDescriptorSet linear_desc = vk_buffer->descriptor_set;
 
-        // Use async pipelined double-buffering if enabled, otherwise use synchronous copy
-        if (vk->async_pipelining_enabled) {
-            if (create_double_buffered_optimal(vk, vk_buffer)) {
-                // Use the first buffer's descriptor initially
-                vk_buffer->descriptor_set = vk_buffer->optimal_descriptors[vk_buffer->optimal_read_index];
-                vk_log(LOG_INFO, "created double-buffered optimal for async pipelining");
-                // Free linear descriptor set to avoid leaks
-                if (linear_desc) {
-                    vkFreeDescriptorSets(vk->device, vk->descriptor_pool, 1, &linear_desc);
-                }
+        if (create_optimal_copy(vk, vk_buffer)) {
+            // Record descriptor set for optimal view
+            VkDescriptorSetAllocateInfo desc_alloc_info_opt = {
+                .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+                .descriptorPool = vk->descriptor_pool,
+                .descriptorSetCount = 1,
+                .pSetLayouts = &vk->blit_pipeline.descriptor_layout,
+            };
 
-                // Perform initial synchronous copy to populate first buffer
-                // We'll do a simple blocking copy here to get the first frame ready
-                VkCommandBufferAllocateInfo alloc_info_init = {
-                    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-                    .commandPool = vk->command_pool,
-                    .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-                    .commandBufferCount = 1,
+            VkDescriptorSet opt_desc = VK_NULL_HANDLE;
+            if (vkAllocateDescriptorSets(vk->device, &desc_alloc_info_opt, &opt_desc) == VK_SUCCESS) {
+                VkDescriptorImageInfo opt_image_desc = {
+                    .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                    .imageView = vk_buffer->optimal_view,
+                    .sampler = vk->sampler,
                 };
-                VkCommandBuffer init_cmd = VK_NULL_HANDLE;
-                if (vkAllocateCommandBuffers(vk->device, &alloc_info_init, &init_cmd) == VK_SUCCESS) {
-                    VkCommandBufferBeginInfo begin_info_init = {
-                        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-                        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
-                    };
-                    vkBeginCommandBuffer(init_cmd, &begin_info_init);
-
-                    // Copy to first optimal buffer
-                    VkImageMemoryBarrier init_barriers[2] = {
-                        {
-                            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-                            .srcAccessMask = 0,
-                            .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
-                            .oldLayout = VK_IMAGE_LAYOUT_PREINITIALIZED,
-                            .newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-                            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-                            .image = vk_buffer->image,
-                            .subresourceRange = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .baseMipLevel = 0, .levelCount = 1, .baseArrayLayer = 0, .layerCount = 1},
-                        },
-                        {
-                            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-                            .srcAccessMask = 0,
-                            .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
-                            .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-                            .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-                            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-                            .image = vk_buffer->optimal_images[0],
-                            .subresourceRange = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .baseMipLevel = 0, .levelCount = 1, .baseArrayLayer = 0, .layerCount = 1},
-                        },
-                    };
-                    vkCmdPipelineBarrier(init_cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 2, init_barriers);
-
-                    VkImageCopy init_region = {
-                        .srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
-                        .srcOffset = {0, 0, 0},
-                        .dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
-                        .dstOffset = {0, 0, 0},
-                        .extent = {(uint32_t)vk_buffer->width, (uint32_t)vk_buffer->height, 1},
-                    };
-                    vkCmdCopyImage(init_cmd, vk_buffer->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                                   vk_buffer->optimal_images[0], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &init_region);
-
-                    VkImageMemoryBarrier init_post = {
-                        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-                        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
-                        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
-                        .oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                        .newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-                        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-                        .image = vk_buffer->optimal_images[0],
-                        .subresourceRange = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .baseMipLevel = 0, .levelCount = 1, .baseArrayLayer = 0, .layerCount = 1},
-                    };
-                    vkCmdPipelineBarrier(init_cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &init_post);
-
-                    vkEndCommandBuffer(init_cmd);
-                    VkSubmitInfo init_submit = {.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO, .commandBufferCount = 1, .pCommandBuffers = &init_cmd};
-                    vkQueueSubmit(vk->graphics_queue, 1, &init_submit, VK_NULL_HANDLE);
-                    vkQueueWaitIdle(vk->graphics_queue);
-                    vkFreeCommandBuffers(vk->device, vk->command_pool, 1, &init_cmd);
-                    vk_log(LOG_INFO, "initial sync copy to optimal buffer complete");
-                }
-            } else {
-                vk_buffer->descriptor_set = linear_desc;
-            }
-        } else {
-            // Legacy synchronous optimal copy path
-            if (create_optimal_copy(vk, vk_buffer)) {
-                // Record descriptor set for optimal view
-                VkDescriptorSetAllocateInfo desc_alloc_info_opt = {
-                    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-                    .descriptorPool = vk->descriptor_pool,
-                    .descriptorSetCount = 1,
-                    .pSetLayouts = &vk->blit_pipeline.descriptor_layout,
+
+                VkWriteDescriptorSet opt_write = {
+                    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                    .dstSet = opt_desc,
+                    .dstBinding = 0,
+                    .dstArrayElement = 0,
+                    .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                    .descriptorCount = 1,
+                    .pImageInfo = &opt_image_desc,
                 };
 
-                VkDescriptorSet opt_desc = VK_NULL_HANDLE;
-                if (vkAllocateDescriptorSets(vk->device, &desc_alloc_info_opt, &opt_desc) == VK_SUCCESS) {
-                    VkDescriptorImageInfo opt_image_desc = {
-                        .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                        .imageView = vk_buffer->optimal_view,
-                        .sampler = vk->sampler,
-                    };
-
-                    VkWriteDescriptorSet opt_write = {
-                        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-                        .dstSet = opt_desc,
-                        .dstBinding = 0,
-                        .dstArrayElement = 0,
-                        .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                        .descriptorCount = 1,
-                        .pImageInfo = &opt_image_desc,
-                    };
-
-                    vkUpdateDescriptorSets(vk->device, 1, &opt_write, 0, NULL);
-
-                    if (copy_to_optimal(vk, vk_buffer)) {
-                        // Prefer optimal descriptor
-                        vk_buffer->descriptor_set = opt_desc;
-                        vk_log(LOG_INFO, "created optimal-tiling copy for dma-buf import");
-                        // Free linear descriptor set to avoid leaks
-                        if (linear_desc) {
-                            vkFreeDescriptorSets(vk->device, vk->descriptor_pool, 1, &linear_desc);
-                        }
-                    } else {
-                        // Copy failed, keep linear descriptor
-                        vkFreeDescriptorSets(vk->device, vk->descriptor_pool, 1, &opt_desc);
-                        destroy_optimal_copy(vk, vk_buffer);
-                        vk_buffer->descriptor_set = linear_desc;
+                vkUpdateDescriptorSets(vk->device, 1, &opt_write, 0, NULL);
+
+                if (copy_to_optimal(vk, vk_buffer)) {
+                    // Prefer optimal descriptor
+                    vk_buffer->descriptor_set = opt_desc;
+                    vk_log(LOG_INFO, "created optimal-tiling copy for dma-buf import");
+                    // Free linear descriptor set to avoid leaks
+                    if (linear_desc) {
+                        vkFreeDescriptorSets(vk->device, vk->descriptor_pool, 1, &linear_desc);
                     }
                 } else {
+                    // Copy failed, keep linear descriptor
+                    vkFreeDescriptorSets(vk->device, vk->descriptor_pool, 1, &opt_desc);
                     destroy_optimal_copy(vk, vk_buffer);
                     vk_buffer->descriptor_set = linear_desc;
                 }
             } else {
+                destroy_optimal_copy(vk, vk_buffer);
                 vk_buffer->descriptor_set = linear_desc;
             }
+        } else {
+            vk_buffer->descriptor_set = linear_desc;
         }
     }
 
@@ -4840,6 +7787,8 @@ vk_buffer_import(struct server_vk *vk, struct server_buffer *buffer) {
     wl_signal_add(&buffer->events.resource_destroy, &vk_buffer->on_parent_destroy);
 
     wl_list_insert(&vk->capture.buffers, &vk_buffer->link);
+
+    import_tune_imported(vk, vk_buffer, now_ns() - import_start);
     return vk_buffer;
 
 fail:
@@ -4956,46 +7905,345 @@ vk_proxy_copy_to_export(struct server_vk *vk, struct vk_buffer *src, struct serv
             .layerCount = 1,
         },
     };
-    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
-                         0, NULL, 0, NULL, 1, &dst_release);
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                         0, NULL, 0, NULL, 1, &dst_release);
+
+    if (vkEndCommandBuffer(cmd) != VK_SUCCESS) {
+        vk_log(LOG_ERROR, "proxy copy: vkEndCommandBuffer failed");
+        return false;
+    }
+
+    VkSubmitInfo submit = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &cmd,
+    };
+
+    VkResult res = vkQueueSubmit(vk->graphics_queue, 1, &submit, fence);
+    if (res != VK_SUCCESS) {
+        vk_log(LOG_ERROR, "proxy copy: vkQueueSubmit failed: %d", res);
+        return false;
+    }
+
+    // Ensure the export dmabuf contents are complete before Wayland commits the wl_buffer.
+    // This avoids presenting partially-copied frames when the host compositor samples it.
+    // This wait is CPU-blocking, but it avoids the swapchain-present timing stall that caps FPS.
+    res = vkWaitForFences(vk->device, 1, &fence, VK_TRUE, UINT64_MAX);
+    if (res != VK_SUCCESS) {
+        vk_log(LOG_ERROR, "proxy copy: vkWaitForFences failed: %d", res);
+        return false;
+    }
+
+    src->source_prepared = true;
+    src->export_prepared[export_index] = true;
+    return true;
+}
+
+// Renders the latched capture buffer together with the overlays.
+static void
+render_capture_frame(struct server_vk *vk) {
+    struct vk_buffer *vk_buf = vk->capture.current;
+    if (!vk_buf) {
+        vk->capture.deferred = false;
+        return;
+    }
+
+    // Rather than blocking the event loop on a busy frame slot, keep the newest buffer
+    // latched and render it once the slot's release signal arrives (see handle_capture_release).
+    // Without release signals, begin_frame waits for the slot instead.
+    if (vk->capture.release_signals &&
+        vkGetFenceStatus(vk->device, vk->in_flight[vk->current_frame]) != VK_SUCCESS) {
+        vk->capture.deferred = true;
+        return;
+    }
+    vk->capture.deferred = false;
+
+    // Advance animated overlays (e.g., AVIF emotes) on frame ticks.
+    vk_update_animated_images(vk);
+
+    // Update all floating view buffers before rendering
+    struct vk_view *v;
+    wl_list_for_each(v, &vk->views, link) {
+        if (v->view && v->view->surface) {
+            struct server_buffer *view_buffer = server_surface_next_buffer(v->view->surface);
+            if (view_buffer) {
+                // Find or import the buffer
+                struct vk_buffer *vb = NULL;
+                struct vk_buffer *it;
+                wl_list_for_each(it, &vk->capture.buffers, link) {
+                    if (it->parent == view_buffer) {
+                        vb = it;
+                        break;
+                    }
+                }
+                if (!vb) {
+                    vb = vk_buffer_import(vk, view_buffer);
+                    if (vb) {
+                        vk_log(LOG_INFO, "imported floating view buffer: %dx%d", vb->width, vb->height);
+                    }
+                }
+                if (vb && v->current_buffer != vb) {
+                    if (!v->current_buffer) {
+                        vk->render_list.dirty = true;
+                    }
+                    damage_box(vk, &v->dst);
+                    v->current_buffer = vb;
+                    // Update geometry from buffer dimensions
+                    // Position at top-left corner (no margin)
+                    // TODO: Read anchor from config
+                    v->dst.x = 0;
+                    v->dst.y = 0;
+                    v->dst.width = vb->width;
+                    v->dst.height = vb->height;
+                    vk_log(LOG_INFO, "view buffer updated: pos=(%d,%d) size=(%d,%d)", 
+                           v->dst.x, v->dst.y, v->dst.width, v->dst.height);
+                }
+            }
+        }
+
+        // View contents can change without a commit on the capture surface.
+        if (v->enabled && v->current_buffer) {
+            damage_box(vk, &v->dst);
+        }
+    }
+
+    // Render frame with Vulkan
+    if (server_vk_begin_frame(vk)) {
+        server_vk_end_frame(vk);
+    }
+}
+
+// Called once a frame or capture copy has finished on the GPU.
+static int
+handle_capture_release(int fd, uint32_t mask, void *data) {
+    struct vk_release_watch *watch = data;
+    struct server_vk *vk = watch->vk;
+
+    release_watch_disarm(watch);
+
+    capture_release_completed(vk);
+    capture_copy_release_completed(vk);
+    if (vk->capture.deferred) {
+        render_capture_frame(vk);
+    }
+    return 0;
+}
+
+// ============================================================================
+// Frame Pacing
+// ============================================================================
+
+struct vk_present_feedback {
+    struct wl_list link;  // server_vk.pacing.feedbacks
+    struct server_vk *vk;
+    struct wp_presentation_feedback *feedback;
+};
+
+static void
+present_feedback_destroy(struct vk_present_feedback *fb) {
+    wl_list_remove(&fb->link);
+    wp_presentation_feedback_destroy(fb->feedback);
+    free(fb);
+}
+
+static void
+on_present_feedback_sync_output(void *data, struct wp_presentation_feedback *wl,
+                                struct wl_output *output) {
+    // Unused.
+}
+
+static void
+on_present_feedback_presented(void *data, struct wp_presentation_feedback *wl, uint32_t tv_sec_hi,
+                              uint32_t tv_sec_lo, uint32_t tv_nsec, uint32_t refresh,
+                              uint32_t seq_hi, uint32_t seq_lo, uint32_t flags) {
+    struct vk_present_feedback *fb = data;
+    struct server_vk *vk = fb->vk;
+
+    // Timestamps are only comparable with now_ns() if the host uses CLOCK_MONOTONIC.
+    if (vk->server->backend->presentation_clock == CLOCK_MONOTONIC) {
+        uint64_t sec = ((uint64_t)tv_sec_hi << 32) | tv_sec_lo;
+        vk->pacing.last_vblank_ns = sec * 1000000000u + tv_nsec;
+    }
+    if (refresh > 0) {
+        vk->pacing.refresh_ns = refresh;
+    }
+
+    present_feedback_destroy(fb);
+}
+
+static void
+on_present_feedback_discarded(void *data, struct wp_presentation_feedback *wl) {
+    present_feedback_destroy(data);
+}
+
+static const struct wp_presentation_feedback_listener present_feedback_listener = {
+    .sync_output = on_present_feedback_sync_output,
+    .presented = on_present_feedback_presented,
+    .discarded = on_present_feedback_discarded,
+};
+
+static void
+frame_pacing_request_feedback(struct server_vk *vk) {
+    struct wp_presentation *presentation = vk->server->backend->presentation;
+    if (!vk->pacing.enabled || !presentation) {
+        return;
+    }
+
+    struct vk_present_feedback *fb = zalloc(1, sizeof(*fb));
+    fb->vk = vk;
+    fb->feedback = wp_presentation_feedback(presentation, vk->swapchain.wl_surface);
+    check_alloc(fb->feedback);
+    wp_presentation_feedback_add_listener(fb->feedback, &present_feedback_listener, fb);
+    wl_list_insert(&vk->pacing.feedbacks, &fb->link);
+}
+
+static uint64_t
+frame_pacing_refresh_ns(struct server_vk *vk) {
+    if (vk->pacing.refresh_ns) {
+        return vk->pacing.refresh_ns;
+    }
+
+    int32_t refresh_mhz = server_backend_preferred_refresh_mhz(vk->server->backend);
+    if (refresh_mhz <= 0) {
+        refresh_mhz = 60000;
+    }
+    return 1000000000000ull / (uint64_t)refresh_mhz;
+}
+
+// Returns the time at which to start rendering: offset_ns before the first predicted
+// vblank that still leaves that much headroom, and never twice for the same vblank.
+static uint64_t
+frame_pacing_next_deadline(struct server_vk *vk, uint64_t now) {
+    uint64_t refresh = frame_pacing_refresh_ns(vk);
+    uint64_t offset = vk->pacing.offset_ns;
+
+    // Without feedback yet, pretend a vblank just happened.
+    uint64_t vblank = vk->pacing.last_vblank_ns ? vk->pacing.last_vblank_ns : now;
+    if (vblank > now) {
+        vblank -= ((vblank - now) / refresh + 1) * refresh;
+    }
+
+    uint64_t target = vblank + ((now + offset - vblank) / refresh + 1) * refresh;
+    if (target <= vk->pacing.last_target_ns) {
+        target = vk->pacing.last_target_ns + refresh;
+    }
+    vk->pacing.last_target_ns = target;
+
+    return target - offset;
+}
+
+static void
+frame_pacing_schedule(struct server_vk *vk) {
+    if (vk->pacing.pending) {
+        vk->capture.superseded++;
+    }
+    vk->pacing.pending = true;
+
+    if (vk->pacing.armed) {
+        return;
+    }
+
+    uint64_t deadline = frame_pacing_next_deadline(vk, now_ns());
+    struct itimerspec its = {
+        .it_value = {
+            .tv_sec = (time_t)(deadline / 1000000000u),
+            .tv_nsec = (long)(deadline % 1000000000u),
+        },
+    };
+    if (timerfd_settime(vk->pacing.timer_fd, TFD_TIMER_ABSTIME, &its, NULL) != 0) {
+        vk_log(LOG_ERROR, "failed to arm frame pacing timer: %s", strerror(errno));
+        vk->pacing.pending = false;
+        render_capture_frame(vk);
+        return;
+    }
+    vk->pacing.armed = true;
+}
 
-    if (vkEndCommandBuffer(cmd) != VK_SUCCESS) {
-        vk_log(LOG_ERROR, "proxy copy: vkEndCommandBuffer failed");
-        return false;
+static int
+handle_pacing_timer(int32_t fd, uint32_t mask, void *data) {
+    struct server_vk *vk = data;
+
+    uint64_t expirations;
+    if (read(fd, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+        return 0;
     }
 
-    VkSubmitInfo submit = {
-        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-        .commandBufferCount = 1,
-        .pCommandBuffers = &cmd,
-    };
+    vk->pacing.armed = false;
+    if (vk->pacing.pending) {
+        vk->pacing.pending = false;
+        vk->pacing.dropped = false;
+        render_capture_frame(vk);
 
-    VkResult res = vkQueueSubmit(vk->graphics_queue, 1, &submit, fence);
-    if (res != VK_SUCCESS) {
-        vk_log(LOG_ERROR, "proxy copy: vkQueueSubmit failed: %d", res);
-        return false;
+        // The game may not commit again for a while, so a frame which couldn't be presented is
+        // tried again at the next deadline.
+        if (vk->pacing.dropped) {
+            frame_pacing_schedule(vk);
+        }
     }
 
-    // Ensure the export dmabuf contents are complete before Wayland commits the wl_buffer.
-    // This avoids presenting partially-copied frames when the host compositor samples it.
-    // This wait is CPU-blocking, but it avoids the swapchain-present timing stall that caps FPS.
-    res = vkWaitForFences(vk->device, 1, &fence, VK_TRUE, UINT64_MAX);
-    if (res != VK_SUCCESS) {
-        vk_log(LOG_ERROR, "proxy copy: vkWaitForFences failed: %d", res);
+    return 0;
+}
+
+static bool
+create_frame_pacing(struct server_vk *vk) {
+    double offset_ms = 2.0;
+    const char *env_offset = getenv("WAYWALL_VK_PACING_OFFSET_MS");
+    if (env_offset) {
+        char *end = NULL;
+        double value = strtod(env_offset, &end);
+        if (end == env_offset || *end != '\0' || !(value >= 0.0)) {
+            vk_log(LOG_WARN, "invalid WAYWALL_VK_PACING_OFFSET_MS '%s', using %.1f", env_offset,
+                   offset_ms);
+        } else {
+            offset_ms = value;
+        }
+    }
+    vk->pacing.offset_ns = (uint64_t)llround(offset_ms * 1e6);
+
+    vk->pacing.timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    if (vk->pacing.timer_fd == -1) {
+        vk_log(LOG_ERROR, "failed to create frame pacing timerfd: %s", strerror(errno));
         return false;
     }
 
-    src->source_prepared = true;
-    src->export_prepared[export_index] = true;
+    struct wl_event_loop *loop = wl_display_get_event_loop(vk->server->display);
+    vk->pacing.timer = wl_event_loop_add_fd(loop, vk->pacing.timer_fd, WL_EVENT_READABLE,
+                                            handle_pacing_timer, vk);
+    check_alloc(vk->pacing.timer);
+
+    vk_log(LOG_INFO, "frame pacing enabled (offset=%.2fms, presentation feedback=%s)", offset_ms,
+           vk->server->backend->presentation ? "yes" : "no");
     return true;
 }
 
+static void
+destroy_frame_pacing(struct server_vk *vk) {
+    struct vk_present_feedback *fb, *tmp;
+    wl_list_for_each_safe(fb, tmp, &vk->pacing.feedbacks, link) {
+        present_feedback_destroy(fb);
+    }
+
+    if (vk->pacing.timer) {
+        wl_event_source_remove(vk->pacing.timer);
+        vk->pacing.timer = NULL;
+    }
+    if (vk->pacing.timer_fd != -1) {
+        close(vk->pacing.timer_fd);
+        vk->pacing.timer_fd = -1;
+    }
+}
+
 static void
 on_surface_commit(struct wl_listener *listener, void *data) {
     struct server_vk *vk = wl_container_of(listener, vk, on_surface_commit);
 
+    vk->timing.commit_ns = now_ns();
+
     struct server_buffer *buffer = server_surface_next_buffer(vk->capture.surface);
     if (!buffer) {
+        if (vk->capture.current) {
+            damage_full(vk);
+        }
         vk->capture.current = NULL;
         return;
     }
@@ -5044,54 +8292,30 @@ on_surface_commit(struct wl_listener *listener, void *data) {
             return;
         }
 
-        // Start async copy to optimal if pipelining is enabled
-        if (vk->async_pipelining_enabled && vk_buf->async_optimal_valid) {
-            start_async_copy_to_optimal(vk, vk_buf);
-        }
-
-        // Advance animated overlays (e.g., AVIF emotes) on frame ticks.
-        vk_update_animated_images(vk);
-
-        // Update all floating view buffers before rendering
-        struct vk_view *v;
-        wl_list_for_each(v, &vk->views, link) {
-            if (v->view && v->view->surface) {
-                struct server_buffer *view_buffer = server_surface_next_buffer(v->view->surface);
-                if (view_buffer) {
-                    // Find or import the buffer
-                    struct vk_buffer *vb = NULL;
-                    struct vk_buffer *it;
-                    wl_list_for_each(it, &vk->capture.buffers, link) {
-                        if (it->parent == view_buffer) {
-                            vb = it;
-                            break;
-                        }
-                    }
-                    if (!vb) {
-                        vb = vk_buffer_import(vk, view_buffer);
-                        if (vb) {
-                            vk_log(LOG_INFO, "imported floating view buffer: %dx%d", vb->width, vb->height);
-                        }
-                    }
-                    if (vb && v->current_buffer != vb) {
-                        v->current_buffer = vb;
-                        // Update geometry from buffer dimensions
-                        // Position at top-left corner (no margin)
-                        // TODO: Read anchor from config
-                        v->dst.x = 0;
-                        v->dst.y = 0;
-                        v->dst.width = vb->width;
-                        v->dst.height = vb->height;
-                        vk_log(LOG_INFO, "view buffer updated: pos=(%d,%d) size=(%d,%d)", 
-                               v->dst.x, v->dst.y, v->dst.width, v->dst.height);
-                    }
-                }
-            }
+        // A capture which is passed through needs no GPU work at all, unless the swapchain still
+        // has to be cleared.
+        if (passthrough_update(vk, vk_buf, true) && !vk->passthrough.clear) {
+            wl_signal_emit_mutable(&vk->events.frame, NULL);
+            return;
+        }
+
+        damage_capture(vk, vk->capture.surface, vk_buf);
+
+        // Start copying the new buffer right away, so the copy overlaps any frame still in flight.
+        // Frames which copy the capture into the swapchain image don't need it.
+        if (!passthrough_active(vk) && !transfer_present_possible(vk, vk_buf)) {
+            capture_copy_submit(vk, vk_buf);
         }
 
-        // Render frame with Vulkan
-        if (server_vk_begin_frame(vk)) {
-            server_vk_end_frame(vk);
+        // Only the newest buffer is kept. Whatever it replaced before being rendered is
+        // never touched by the GPU, so the client gets it back right away.
+        if (vk->capture.deferred) {
+            vk->capture.superseded++;
+        }
+        if (vk->pacing.enabled) {
+            frame_pacing_schedule(vk);
+        } else {
+            render_capture_frame(vk);
         }
     }
 
@@ -5105,8 +8329,13 @@ on_surface_destroy(struct wl_listener *listener, void *data) {
     wl_list_remove(&vk->on_surface_commit.link);
     wl_list_remove(&vk->on_surface_destroy.link);
 
+    // The subsurface has to go before the remote surface it was created for.
+    passthrough_unmap(vk);
+    vk->passthrough.streak = 0;
+
     vk->capture.surface = NULL;
     vk->capture.current = NULL;
+    damage_full(vk);
 }
 
 static void
@@ -5228,7 +8457,10 @@ server_vk_add_mirror(struct server_vk *vk, const struct vk_mirror_options *optio
     mirror->depth = options->depth;
     mirror->enabled = true;
 
+    mirror->vk = vk;
     wl_list_insert(&vk->mirrors, &mirror->link);
+    vk->render_list.dirty = true;
+    damage_box(vk, &mirror->dst);
 
     // Count total mirrors
     int count = 0;
@@ -5251,8 +8483,12 @@ server_vk_remove_mirror(struct server_vk *vk, struct vk_mirror *mirror) {
     vk_log(LOG_INFO, "removing mirror: src(%d,%d %dx%d)",
            mirror->src.x, mirror->src.y, mirror->src.width, mirror->src.height);
 
+    if (mirror->enabled) {
+        damage_box(vk, &mirror->dst);
+    }
     wl_list_remove(&mirror->link);
     free(mirror);
+    vk->render_list.dirty = true;
 
     // Count remaining
     int count = 0;
@@ -5263,8 +8499,19 @@ server_vk_remove_mirror(struct server_vk *vk, struct vk_mirror *mirror) {
 
 void
 server_vk_mirror_set_enabled(struct vk_mirror *mirror, bool enabled) {
-    if (mirror) {
+    if (mirror && mirror->enabled != enabled) {
         mirror->enabled = enabled;
+        mirror->vk->render_list.dirty = true;
+        damage_box(mirror->vk, &mirror->dst);
+    }
+}
+
+void
+server_vk_mirror_set_depth(struct vk_mirror *mirror, int32_t depth) {
+    if (mirror && mirror->depth != depth) {
+        mirror->depth = depth;
+        mirror->vk->render_list.dirty = true;
+        damage_box(mirror->vk, &mirror->dst);
     }
 }
 
@@ -5272,192 +8519,129 @@ server_vk_mirror_set_enabled(struct vk_mirror *mirror, bool enabled) {
 // Image API
 // ============================================================================
 
-static struct vk_image *
-server_vk_add_rgba_image(struct server_vk *vk, const char *debug_name, uint32_t width, uint32_t height,
-                         const unsigned char *rgba, const struct vk_image_options *options) {
-    if (!rgba || width == 0 || height == 0) {
-        return NULL;
-    }
-
-    struct vk_image *image = zalloc(1, sizeof(*image));
+// Creates the array texture, view and descriptor set for an image and fills one layer per frame.
+static bool
+upload_rgba_image(struct server_vk *vk, struct vk_image *image, const char *debug_name, uint32_t width,
+                  uint32_t height, const struct util_avif_frame *frames, uint32_t frame_count) {
     image->width = (int32_t)width;
     image->height = (int32_t)height;
-    image->dst = options->dst;
-    image->depth = options->depth;
-    image->enabled = true;
-    image->owns_descriptor_set = true;
-    image->owns_image = true;
 
-    vk_log(LOG_INFO, "loading image: %s (%ux%u)", debug_name ? debug_name : "(raw)", width, height);
+    vk_log(LOG_INFO, "loading image: %s (%ux%u, %u frames)", debug_name ? debug_name : "(raw)", width, height,
+           frame_count);
 
+    uint32_t families[2] = { vk->graphics_family, vk->transfer_family };
     VkImageCreateInfo image_ci = {
         .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
         .imageType = VK_IMAGE_TYPE_2D,
         .format = VK_FORMAT_R8G8B8A8_UNORM,
         .extent = { width, height, 1 },
         .mipLevels = 1,
-        .arrayLayers = 1,
+        .arrayLayers = frame_count,
         .samples = VK_SAMPLE_COUNT_1_BIT,
-        .tiling = VK_IMAGE_TILING_LINEAR,  // For direct CPU access
-        .usage = VK_IMAGE_USAGE_SAMPLED_BIT,
-        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
-        .initialLayout = VK_IMAGE_LAYOUT_PREINITIALIZED,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+        // Written on the transfer queue and sampled on the graphics queue
+        .sharingMode = vk->upload.concurrent ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = vk->upload.concurrent ? 2 : 0,
+        .pQueueFamilyIndices = families,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
     };
 
     if (vkCreateImage(vk->device, &image_ci, NULL, &image->image) != VK_SUCCESS) {
-        free(image);
-        return NULL;
-    }
-
-    VkMemoryRequirements mem_reqs;
-    vkGetImageMemoryRequirements(vk->device, image->image, &mem_reqs);
-
-    uint32_t mem_type = find_memory_type(vk, mem_reqs.memoryTypeBits,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-    if (mem_type == UINT32_MAX) {
-        vkDestroyImage(vk->device, image->image, NULL);
-        free(image);
-        return NULL;
-    }
-
-    VkMemoryAllocateInfo alloc_info = {
-        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-        .allocationSize = mem_reqs.size,
-        .memoryTypeIndex = mem_type,
-    };
-    if (vkAllocateMemory(vk->device, &alloc_info, NULL, &image->memory) != VK_SUCCESS) {
-        vkDestroyImage(vk->device, image->image, NULL);
-        free(image);
-        return NULL;
+        return false;
     }
 
-    vkBindImageMemory(vk->device, image->image, image->memory, 0);
-
-    void *mapped;
-    if (vkMapMemory(vk->device, image->memory, 0, mem_reqs.size, 0, &mapped) != VK_SUCCESS) {
-        vkFreeMemory(vk->device, image->memory, NULL);
+    if (!vk_alloc_image(vk, image->image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, false, &image->memory) &&
+        !vk_alloc_image(vk, image->image, 0, false, &image->memory)) {
         vkDestroyImage(vk->device, image->image, NULL);
-        free(image);
-        return NULL;
-    }
-
-    VkImageSubresource subres = { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT };
-    VkSubresourceLayout layout;
-    vkGetImageSubresourceLayout(vk->device, image->image, &subres, &layout);
-
-    const unsigned char *src = rgba;
-    unsigned char *dst = (unsigned char *)mapped + layout.offset;
-    size_t src_row_size = (size_t)width * 4;
-
-    for (uint32_t y = 0; y < height; y++) {
-        memcpy(dst, src, src_row_size);
-        src += src_row_size;
-        dst += layout.rowPitch;
+        return false;
     }
 
-    vkUnmapMemory(vk->device, image->memory);
-
-    // Transition to shader-read layout
-    VkCommandBuffer cmd;
-    VkCommandBufferAllocateInfo cmd_alloc = {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-        .commandPool = vk->command_pool,
-        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-        .commandBufferCount = 1,
-    };
-    vkAllocateCommandBuffers(vk->device, &cmd_alloc, &cmd);
-
-    VkCommandBufferBeginInfo begin_info = {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
-    };
-    vkBeginCommandBuffer(cmd, &begin_info);
-
-    VkImageMemoryBarrier barrier = {
-        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-        .oldLayout = VK_IMAGE_LAYOUT_PREINITIALIZED,
-        .newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-        .image = image->image,
-        .subresourceRange = {
-            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-            .baseMipLevel = 0,
-            .levelCount = 1,
-            .baseArrayLayer = 0,
-            .layerCount = 1,
-        },
-        .srcAccessMask = VK_ACCESS_HOST_WRITE_BIT,
-        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
-    };
-
-    vkCmdPipelineBarrier(cmd,
-        VK_PIPELINE_STAGE_HOST_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-        0, 0, NULL, 0, NULL, 1, &barrier);
-
-    vkEndCommandBuffer(cmd);
-
-    VkSubmitInfo submit = {
-        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-        .commandBufferCount = 1,
-        .pCommandBuffers = &cmd,
-    };
-    vkQueueSubmit(vk->graphics_queue, 1, &submit, VK_NULL_HANDLE);
-    vkQueueWaitIdle(vk->graphics_queue);
-    vkFreeCommandBuffers(vk->device, vk->command_pool, 1, &cmd);
-
     VkImageViewCreateInfo view_ci = {
         .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
         .image = image->image,
-        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY,
         .format = VK_FORMAT_R8G8B8A8_UNORM,
         .subresourceRange = {
             .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
             .baseMipLevel = 0,
             .levelCount = 1,
             .baseArrayLayer = 0,
-            .layerCount = 1,
+            .layerCount = frame_count,
         },
     };
 
     if (vkCreateImageView(vk->device, &view_ci, NULL, &image->view) != VK_SUCCESS) {
-        vkFreeMemory(vk->device, image->memory, NULL);
         vkDestroyImage(vk->device, image->image, NULL);
-        free(image);
-        return NULL;
+        vk_free(vk, &image->memory);
+        return false;
     }
 
-    VkDescriptorSetAllocateInfo ds_alloc = {
-        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-        .descriptorPool = vk->descriptor_pool,
-        .descriptorSetCount = 1,
-        .pSetLayouts = &vk->image_pipeline.descriptor_layout,
-    };
-    if (vkAllocateDescriptorSets(vk->device, &ds_alloc, &image->descriptor_set) != VK_SUCCESS) {
+    image->texture = texture_table_add(vk, image->view, vk->sampler);
+    if (image->texture == VK_TEXTURE_NONE) {
         vkDestroyImageView(vk->device, image->view, NULL);
-        vkFreeMemory(vk->device, image->memory, NULL);
         vkDestroyImage(vk->device, image->image, NULL);
-        free(image);
+        vk_free(vk, &image->memory);
+        return false;
+    }
+
+    // The copies are submitted with the next frame, which waits for them before sampling the image.
+    for (uint32_t i = 0; i < frame_count; i++) {
+        if (upload_image_region(vk, image->image, false, i, 0, 0, width, height,
+                                (const unsigned char *)frames[i].data, (size_t)width * 4)) {
+            continue;
+        }
+
+        // Copies into earlier layers may already be recorded. Let them finish before the image is
+        // destroyed.
+        if (i > 0) {
+            upload_wait(vk);
+        }
+        texture_table_remove(vk, image->texture);
+        image->texture = VK_TEXTURE_NONE;
+        vkDestroyImageView(vk->device, image->view, NULL);
+        vkDestroyImage(vk->device, image->image, NULL);
+        vk_free(vk, &image->memory);
+        return false;
+    }
+
+    // Only take ownership once everything has been created, so a failed upload leaves nothing for
+    // server_vk_remove_image to destroy.
+    image->frame_count = frame_count;
+    image->owns_texture = true;
+    image->owns_image = true;
+    return true;
+}
+
+static struct vk_image *
+server_vk_add_rgba_image(struct server_vk *vk, const char *debug_name, uint32_t width, uint32_t height,
+                         const unsigned char *rgba, const struct vk_image_options *options) {
+    if (!rgba || width == 0 || height == 0) {
         return NULL;
     }
 
-    VkDescriptorImageInfo img_info = {
-        .sampler = vk->sampler,
-        .imageView = image->view,
-        .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-    };
+    struct vk_image *image = zalloc(1, sizeof(*image));
+    image->texture = VK_TEXTURE_NONE;
+    image->dst = options->dst;
+    image->depth = options->depth;
+    image->uv[2] = 1.0f;
+    image->uv[3] = 1.0f;
+    image->enabled = true;
 
-    VkWriteDescriptorSet write = {
-        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-        .dstSet = image->descriptor_set,
-        .dstBinding = 0,
-        .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-        .descriptorCount = 1,
-        .pImageInfo = &img_info,
+    struct util_avif_frame frame = {
+        .data = (char *)rgba,
+        .width = (int32_t)width,
+        .height = (int32_t)height,
     };
-    vkUpdateDescriptorSets(vk->device, 1, &write, 0, NULL);
+    if (!upload_rgba_image(vk, image, debug_name, width, height, &frame, 1)) {
+        free(image);
+        return NULL;
+    }
 
+    image->vk = vk;
     wl_list_insert(&vk->images, &image->link);
+    vk->render_list.dirty = true;
+    damage_box(vk, &image->dst);
     return image;
 }
 
@@ -5540,15 +8724,15 @@ server_vk_create_atlas(struct server_vk *vk, uint32_t width, const char *rgba_da
     atlas->image = tmp->image;
     atlas->memory = tmp->memory;
     atlas->view = tmp->view;
-    atlas->descriptor_set = tmp->descriptor_set;
+    atlas->texture = tmp->texture;
 
     // Prevent temp image cleanup from freeing atlas resources.
-    tmp->owns_descriptor_set = false;
+    tmp->owns_texture = false;
     tmp->owns_image = false;
     tmp->image = VK_NULL_HANDLE;
-    tmp->memory = VK_NULL_HANDLE;
+    tmp->memory = (struct vk_allocation){0};
     tmp->view = VK_NULL_HANDLE;
-    tmp->descriptor_set = VK_NULL_HANDLE;
+    tmp->texture = VK_TEXTURE_NONE;
     server_vk_remove_image(vk, tmp);
 
     vk_log(LOG_INFO, "created atlas: %ux%u", width, height);
@@ -5572,125 +8756,124 @@ server_vk_atlas_unref(struct vk_atlas *atlas) {
 
     struct server_vk *vk = atlas->vk;
     if (vk && vk->device) {
+        // Copies into the atlas may not have been submitted yet.
+        upload_flush(vk);
         vkDeviceWaitIdle(vk->device);
     }
 
     wl_list_remove(&atlas->link);
     wl_list_init(&atlas->link);
 
-    if (vk && atlas->descriptor_set != VK_NULL_HANDLE) {
-        vkFreeDescriptorSets(vk->device, vk->descriptor_pool, 1, &atlas->descriptor_set);
+    if (vk) {
+        texture_table_remove(vk, atlas->texture);
     }
     if (vk && atlas->view) {
         vkDestroyImageView(vk->device, atlas->view, NULL);
     }
-    if (vk && atlas->memory) {
-        vkFreeMemory(vk->device, atlas->memory, NULL);
-    }
     if (vk && atlas->image) {
         vkDestroyImage(vk->device, atlas->image, NULL);
     }
+    if (vk) {
+        vk_free(vk, &atlas->memory);
+    }
 
     free(atlas);
 }
 
-bool
-server_vk_atlas_insert_raw(struct vk_atlas *atlas, const char *data, size_t data_len, uint32_t x, uint32_t y) {
-    if (!atlas || !atlas->vk || !atlas->vk->device || !data || data_len == 0) {
-        return false;
-    }
-
+static bool
+atlas_blit_rgba(struct vk_atlas *atlas, const struct util_avif_frame *png, uint32_t x, uint32_t y) {
     struct server_vk *vk = atlas->vk;
 
-    struct util_png png = util_png_decode_raw(data, data_len, atlas->width);
-    if (!png.data || png.width <= 0 || png.height <= 0) {
-        return false;
-    }
-
-    uint32_t blit_width = (uint32_t)png.width;
-    uint32_t blit_height = (uint32_t)png.height;
+    uint32_t blit_width = (uint32_t)png->width;
+    uint32_t blit_height = (uint32_t)png->height;
 
     if (x + blit_width > atlas->width) blit_width = atlas->width - x;
     if (y + blit_height > atlas->height) blit_height = atlas->height - y;
     if (blit_width == 0 || blit_height == 0) {
-        free(png.data);
         return false;
     }
 
-    vkDeviceWaitIdle(vk->device);
+    if (!upload_image_region(vk, atlas->image, true, 0, x, y, blit_width, blit_height,
+                             (const unsigned char *)png->data, (size_t)png->width * 4)) {
+        return false;
+    }
 
-    VkMemoryRequirements mem_reqs;
-    vkGetImageMemoryRequirements(vk->device, atlas->image, &mem_reqs);
+    // Images sampling from the atlas may already be on screen.
+    struct vk_image *image;
+    wl_list_for_each(image, &vk->images, link) {
+        if (image->atlas == atlas && image->enabled) {
+            damage_box(vk, &image->dst);
+        }
+    }
+    return true;
+}
 
-    void *mapped = NULL;
-    if (vkMapMemory(vk->device, atlas->memory, 0, mem_reqs.size, 0, &mapped) != VK_SUCCESS) {
-        free(png.data);
-        return false;
+struct vk_atlas_upload {
+    struct vk_atlas *atlas;
+    uint32_t x, y;
+    bool done;
+};
+
+static void
+handle_atlas_upload_destroy(void *data) {
+    struct vk_atlas_upload *upload = data;
+
+    // Jobs cancelled before running end up here without having been blitted.
+    upload->atlas->pending_inserts--;
+    if (!upload->done) {
+        upload->atlas->insert_failed = true;
     }
 
-    VkImageSubresource subres = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT};
-    VkSubresourceLayout layout;
-    vkGetImageSubresourceLayout(vk->device, atlas->image, &subres, &layout);
+    server_vk_atlas_unref(upload->atlas);
+    free(upload);
+}
+
+static void
+handle_atlas_upload_decoded(struct ww_decode_job *job, void *data) {
+    struct vk_atlas_upload *upload = data;
 
-    const unsigned char *src = (const unsigned char *)png.data;
-    unsigned char *dst0 = (unsigned char *)mapped + layout.offset;
-    for (uint32_t row = 0; row < blit_height; row++) {
-        unsigned char *dst = dst0 + ((y + row) * (uint32_t)layout.rowPitch) + x * 4;
-        memcpy(dst, src + (size_t)row * (size_t)png.width * 4, (size_t)blit_width * 4);
+    struct util_avif *png = &job->result;
+    if (!png->frames || png->frames[0].width <= 0 || png->frames[0].height <= 0) {
+        vk_log(LOG_ERROR, "failed to decode atlas image");
+    } else if (upload->atlas->vk && upload->atlas->vk->device) {
+        upload->done = atlas_blit_rgba(upload->atlas, &png->frames[0], upload->x, upload->y);
     }
 
-    vkUnmapMemory(vk->device, atlas->memory);
-    free(png.data);
+    handle_atlas_upload_destroy(upload);
+}
 
-    VkCommandBuffer cmd = VK_NULL_HANDLE;
-    VkCommandBufferAllocateInfo cmd_alloc = {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-        .commandPool = vk->command_pool,
-        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-        .commandBufferCount = 1,
-    };
-    if (vkAllocateCommandBuffers(vk->device, &cmd_alloc, &cmd) != VK_SUCCESS) {
+bool
+server_vk_atlas_insert_raw(struct vk_atlas *atlas, const char *data, size_t data_len, uint32_t x, uint32_t y) {
+    if (!atlas || !atlas->vk || !atlas->vk->device || !data || data_len == 0) {
         return false;
     }
 
-    VkCommandBufferBeginInfo begin_info = {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
-    };
-    vkBeginCommandBuffer(cmd, &begin_info);
-
-    VkImageMemoryBarrier barrier = {
-        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-        .oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-        .newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-        .image = atlas->image,
-        .subresourceRange = {
-            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-            .baseMipLevel = 0,
-            .levelCount = 1,
-            .baseArrayLayer = 0,
-            .layerCount = 1,
-        },
-        .srcAccessMask = VK_ACCESS_HOST_WRITE_BIT,
-        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
-    };
+    // Decode on the worker pool. The atlas is kept alive until the upload has been blitted, and
+    // counts it as pending until then so callers can tell when (and whether) it has landed.
+    struct vk_atlas_upload *upload = zalloc(1, sizeof(*upload));
+    upload->atlas = atlas;
+    upload->x = x;
+    upload->y = y;
+    server_vk_atlas_ref(atlas);
+    atlas->pending_inserts++;
 
-    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_HOST_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0,
-                         NULL, 1, &barrier);
+    ww_decode_pool_submit_raw(atlas->vk->decode_pool, WW_DECODE_PNG, data, data_len, atlas->width,
+                              handle_atlas_upload_decoded, handle_atlas_upload_destroy, upload);
+    return true;
+}
 
-    vkEndCommandBuffer(cmd);
+bool
+server_vk_atlas_is_ready(struct vk_atlas *atlas) {
+    return atlas && atlas->pending_inserts == 0;
+}
 
-    VkSubmitInfo submit = {
-        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-        .commandBufferCount = 1,
-        .pCommandBuffers = &cmd,
-    };
-    vkQueueSubmit(vk->graphics_queue, 1, &submit, VK_NULL_HANDLE);
-    vkQueueWaitIdle(vk->graphics_queue);
-    vkFreeCommandBuffers(vk->device, vk->command_pool, 1, &cmd);
+bool
+server_vk_atlas_take_failed(struct vk_atlas *atlas) {
+    if (!atlas || !atlas->insert_failed) {
+        return false;
+    }
 
+    atlas->insert_failed = false;
     return true;
 }
 
@@ -5702,6 +8885,9 @@ server_vk_atlas_get_dump(struct vk_atlas *atlas, size_t *out_len) {
 
     struct server_vk *vk = atlas->vk;
 
+    // Make sure every queued insert_raw has landed in the atlas before reading it back.
+    ww_decode_pool_flush(vk->decode_pool);
+
     size_t pixel_data_size = (size_t)atlas->width * (size_t)atlas->height * 4;
     *out_len = 8 + pixel_data_size;
 
@@ -5718,31 +8904,12 @@ server_vk_atlas_get_dump(struct vk_atlas *atlas, size_t *out_len) {
     dump_data[6] = (char)((atlas->height >> 16) & 0xFF);
     dump_data[7] = (char)((atlas->height >> 24) & 0xFF);
 
-    vkDeviceWaitIdle(vk->device);
-
-    VkMemoryRequirements mem_reqs;
-    vkGetImageMemoryRequirements(vk->device, atlas->image, &mem_reqs);
-
-    void *mapped = NULL;
-    if (vkMapMemory(vk->device, atlas->memory, 0, mem_reqs.size, 0, &mapped) != VK_SUCCESS) {
+    if (!download_image(vk, atlas->image, atlas->width, atlas->height, (unsigned char *)dump_data + 8)) {
         free(dump_data);
         *out_len = 0;
         return NULL;
     }
 
-    VkImageSubresource subres = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT};
-    VkSubresourceLayout layout;
-    vkGetImageSubresourceLayout(vk->device, atlas->image, &subres, &layout);
-
-    unsigned char *out_pixels = (unsigned char *)dump_data + 8;
-    const unsigned char *src0 = (const unsigned char *)mapped + layout.offset;
-    size_t row_bytes = (size_t)atlas->width * 4;
-
-    for (uint32_t row = 0; row < atlas->height; row++) {
-        memcpy(out_pixels + (size_t)row * row_bytes, src0 + (size_t)row * layout.rowPitch, row_bytes);
-    }
-
-    vkUnmapMemory(vk->device, atlas->memory);
     return dump_data;
 }
 
@@ -5758,355 +8925,152 @@ server_vk_add_image_from_atlas(struct server_vk *vk, struct vk_atlas *atlas, str
     image->dst = options->dst;
     image->depth = options->depth;
     image->enabled = true;
-    image->owns_descriptor_set = false;
+    image->owns_texture = false;
     image->owns_image = false;
-    image->descriptor_set = atlas->descriptor_set;
+    image->texture = atlas->texture;
     image->width = src.width;
     image->height = src.height;
 
-    float u0 = (float)src.x / (float)atlas->width;
-    float v0 = (float)src.y / (float)atlas->height;
-    float u1 = (float)(src.x + src.width) / (float)atlas->width;
-    float v1 = (float)(src.y + src.height) / (float)atlas->height;
-
-    struct quad_vertex verts[6] = {
-        {{ -1.0f, -1.0f }, { u0, v0 }},
-        {{ -1.0f,  1.0f }, { u0, v1 }},
-        {{  1.0f,  1.0f }, { u1, v1 }},
-        {{ -1.0f, -1.0f }, { u0, v0 }},
-        {{  1.0f,  1.0f }, { u1, v1 }},
-        {{  1.0f, -1.0f }, { u1, v0 }},
-    };
-
-    VkDeviceSize buffer_size = sizeof(verts);
-    VkBufferCreateInfo buffer_info = {
-        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-        .size = buffer_size,
-        .usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
-    };
-    if (vkCreateBuffer(vk->device, &buffer_info, NULL, &image->vertex_buffer) != VK_SUCCESS) {
-        server_vk_remove_image(vk, image);
-        return NULL;
-    }
-
-    VkMemoryRequirements mem_reqs;
-    vkGetBufferMemoryRequirements(vk->device, image->vertex_buffer, &mem_reqs);
-    uint32_t mem_type = find_memory_type(vk, mem_reqs.memoryTypeBits,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-    if (mem_type == UINT32_MAX) {
-        server_vk_remove_image(vk, image);
-        return NULL;
-    }
-
-    VkMemoryAllocateInfo alloc_info = {
-        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-        .allocationSize = mem_reqs.size,
-        .memoryTypeIndex = mem_type,
-    };
-    if (vkAllocateMemory(vk->device, &alloc_info, NULL, &image->vertex_memory) != VK_SUCCESS) {
-        server_vk_remove_image(vk, image);
-        return NULL;
-    }
-
-    vkBindBufferMemory(vk->device, image->vertex_buffer, image->vertex_memory, 0);
-
-    void *mapped;
-    if (vkMapMemory(vk->device, image->vertex_memory, 0, buffer_size, 0, &mapped) == VK_SUCCESS) {
-        memcpy(mapped, verts, sizeof(verts));
-        vkUnmapMemory(vk->device, image->vertex_memory);
-    }
+    image->uv[0] = (float)src.x / (float)atlas->width;
+    image->uv[1] = (float)src.y / (float)atlas->height;
+    image->uv[2] = (float)src.width / (float)atlas->width;
+    image->uv[3] = (float)src.height / (float)atlas->height;
 
+    image->vk = vk;
     wl_list_insert(&vk->images, &image->link);
+    vk->render_list.dirty = true;
+    damage_box(vk, &image->dst);
     return image;
 }
 
-struct vk_image *
-server_vk_add_image(struct server_vk *vk, const char *path, const struct vk_image_options *options) {
-    // Load PNG file
-    struct util_png png = util_png_decode(path, 8192);  // max 8192x8192
-    if (!png.data || png.width <= 0 || png.height <= 0) {
-        vk_log(LOG_ERROR, "failed to load PNG: %s", path);
-        return NULL;
-    }
-
-    vk_log(LOG_INFO, "loading image: %s (%dx%d)", path, png.width, png.height);
-
-    struct vk_image *image = zalloc(1, sizeof(*image));
-    image->width = png.width;
-    image->height = png.height;
-    image->dst = options->dst;
-    image->enabled = true;
-    image->owns_descriptor_set = true;
-    image->owns_image = true;
-
-    // Create Vulkan image
-    VkImageCreateInfo image_ci = {
-        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
-        .imageType = VK_IMAGE_TYPE_2D,
-        .format = VK_FORMAT_R8G8B8A8_UNORM,  // PNG is RGBA
-        .extent = { png.width, png.height, 1 },
-        .mipLevels = 1,
-        .arrayLayers = 1,
-        .samples = VK_SAMPLE_COUNT_1_BIT,
-        .tiling = VK_IMAGE_TILING_LINEAR,  // For direct CPU access
-        .usage = VK_IMAGE_USAGE_SAMPLED_BIT,
-        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
-        .initialLayout = VK_IMAGE_LAYOUT_PREINITIALIZED,
-    };
-
-    if (vkCreateImage(vk->device, &image_ci, NULL, &image->image) != VK_SUCCESS) {
-        vk_log(LOG_ERROR, "failed to create image for PNG");
-        free(png.data);
-        free(image);
-        return NULL;
-    }
-
-    // Get memory requirements
-    VkMemoryRequirements mem_reqs;
-    vkGetImageMemoryRequirements(vk->device, image->image, &mem_reqs);
-
-    // Find host-visible memory type for direct mapping
-    uint32_t mem_type = find_memory_type(vk, mem_reqs.memoryTypeBits,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+// Takes an image whose decode or upload failed off the pending list. It stays alive, and never
+// shown, until its owner removes it.
+static void
+image_decode_failed(struct vk_image *image) {
+    image->failed = true;
+    wl_list_remove(&image->link);
+    wl_list_init(&image->link);
+}
 
-    if (mem_type == UINT32_MAX) {
-        vk_log(LOG_ERROR, "no suitable memory type for image");
-        vkDestroyImage(vk->device, image->image, NULL);
-        free(png.data);
-        free(image);
-        return NULL;
-    }
+static void
+handle_image_decoded(struct ww_decode_job *job, void *data) {
+    struct vk_image *image = data;
+    struct server_vk *vk = image->vk;
+    const char *name = job->path ? job->path : "(raw)";
 
-    VkMemoryAllocateInfo alloc_info = {
-        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-        .allocationSize = mem_reqs.size,
-        .memoryTypeIndex = mem_type,
-    };
+    image->decode = NULL;
 
-    if (vkAllocateMemory(vk->device, &alloc_info, NULL, &image->memory) != VK_SUCCESS) {
-        vk_log(LOG_ERROR, "failed to allocate image memory");
-        vkDestroyImage(vk->device, image->image, NULL);
-        free(png.data);
-        free(image);
-        return NULL;
+    struct util_avif *avif = &job->result;
+    if (!avif->frames || avif->frame_count == 0 || avif->width <= 0 || avif->height <= 0) {
+        vk_log(LOG_ERROR, "failed to load image: %s", name);
+        image_decode_failed(image);
+        return;
     }
 
-    vkBindImageMemory(vk->device, image->image, image->memory, 0);
-
-    // Map memory and copy PNG data
-    void *mapped;
-    if (vkMapMemory(vk->device, image->memory, 0, mem_reqs.size, 0, &mapped) != VK_SUCCESS) {
-        vk_log(LOG_ERROR, "failed to map image memory");
-        vkFreeMemory(vk->device, image->memory, NULL);
-        vkDestroyImage(vk->device, image->image, NULL);
-        free(png.data);
-        free(image);
-        return NULL;
+    // Every frame is uploaded once, into its own layer of the texture.
+    uint32_t frame_count = avif->is_animated ? (uint32_t)avif->frame_count : 1;
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(vk->physical_device, &props);
+    if (frame_count > props.limits.maxImageArrayLayers) {
+        vk_log(LOG_WARN, "image %s has %u frames, only using the first %u", name, frame_count,
+               props.limits.maxImageArrayLayers);
+        frame_count = props.limits.maxImageArrayLayers;
     }
 
-    // Get image subresource layout for proper row pitch
-    VkImageSubresource subres = { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT };
-    VkSubresourceLayout layout;
-    vkGetImageSubresourceLayout(vk->device, image->image, &subres, &layout);
-
-    // Copy row by row to handle potential padding
-    const char *src = png.data;
-    char *dst = (char *)mapped + layout.offset;
-    size_t src_row_size = png.width * 4;  // RGBA = 4 bytes per pixel
-
-    for (int y = 0; y < png.height; y++) {
-        memcpy(dst, src, src_row_size);
-        src += src_row_size;
-        dst += layout.rowPitch;
+    if (!upload_rgba_image(vk, image, name, (uint32_t)avif->width, (uint32_t)avif->height, avif->frames,
+                           frame_count)) {
+        vk_log(LOG_ERROR, "failed to upload image: %s", name);
+        image_decode_failed(image);
+        return;
     }
 
-    vkUnmapMemory(vk->device, image->memory);
-    free(png.data);
-
-    // Transition image layout (need command buffer)
-    VkCommandBuffer cmd;
-    VkCommandBufferAllocateInfo cmd_alloc = {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-        .commandPool = vk->command_pool,
-        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-        .commandBufferCount = 1,
-    };
-    vkAllocateCommandBuffers(vk->device, &cmd_alloc, &cmd);
-
-    VkCommandBufferBeginInfo begin_info = {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
-    };
-    vkBeginCommandBuffer(cmd, &begin_info);
-
-    VkImageMemoryBarrier barrier = {
-        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-        .oldLayout = VK_IMAGE_LAYOUT_PREINITIALIZED,
-        .newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-        .image = image->image,
-        .subresourceRange = {
-            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-            .baseMipLevel = 0,
-            .levelCount = 1,
-            .baseArrayLayer = 0,
-            .layerCount = 1,
-        },
-        .srcAccessMask = VK_ACCESS_HOST_WRITE_BIT,
-        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
-    };
-
-    vkCmdPipelineBarrier(cmd,
-        VK_PIPELINE_STAGE_HOST_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-        0, 0, NULL, 0, NULL, 1, &barrier);
-
-    vkEndCommandBuffer(cmd);
-
-    VkSubmitInfo submit = {
-        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-        .commandBufferCount = 1,
-        .pCommandBuffers = &cmd,
-    };
-    vkQueueSubmit(vk->graphics_queue, 1, &submit, VK_NULL_HANDLE);
-    vkQueueWaitIdle(vk->graphics_queue);
-    vkFreeCommandBuffers(vk->device, vk->command_pool, 1, &cmd);
-
-    // Create image view
-    VkImageViewCreateInfo view_ci = {
-        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
-        .image = image->image,
-        .viewType = VK_IMAGE_VIEW_TYPE_2D,
-        .format = VK_FORMAT_R8G8B8A8_UNORM,
-        .subresourceRange = {
-            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-            .baseMipLevel = 0,
-            .levelCount = 1,
-            .baseArrayLayer = 0,
-            .layerCount = 1,
-        },
-    };
-
-    if (vkCreateImageView(vk->device, &view_ci, NULL, &image->view) != VK_SUCCESS) {
-        vk_log(LOG_ERROR, "failed to create image view");
-        vkFreeMemory(vk->device, image->memory, NULL);
-        vkDestroyImage(vk->device, image->image, NULL);
-        free(image);
-        return NULL;
-    }
+    if (frame_count > 1) {
+        image->frame_ends_ms = zalloc(frame_count, sizeof(*image->frame_ends_ms));
 
-    // Allocate descriptor set
-    VkDescriptorSetAllocateInfo ds_alloc = {
-        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-        .descriptorPool = vk->descriptor_pool,
-        .descriptorSetCount = 1,
-        .pSetLayouts = &vk->image_pipeline.descriptor_layout,
-    };
+        uint64_t end_ms = 0;
+        for (uint32_t i = 0; i < frame_count; i++) {
+            double dur_s = avif->frames[i].duration;
+            if (!(dur_s > 0.0)) dur_s = 0.1;
+            uint64_t dur_ms = (uint64_t)llround(dur_s * 1000.0);
+            if (dur_ms == 0) dur_ms = 1;
+            end_ms += dur_ms;
+            image->frame_ends_ms[i] = end_ms;
+        }
 
-    if (vkAllocateDescriptorSets(vk->device, &ds_alloc, &image->descriptor_set) != VK_SUCCESS) {
-        vk_log(LOG_ERROR, "failed to allocate image descriptor set");
-        vkDestroyImageView(vk->device, image->view, NULL);
-        vkFreeMemory(vk->device, image->memory, NULL);
-        vkDestroyImage(vk->device, image->image, NULL);
-        free(image);
-        return NULL;
+        // Pick up the shared clock on the next tick.
+        image->next_frame_ms = 0;
     }
 
-    // Update descriptor set
-    VkDescriptorImageInfo img_info = {
-        .sampler = vk->sampler,
-        .imageView = image->view,
-        .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-    };
-
-    VkWriteDescriptorSet write = {
-        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-        .dstSet = image->descriptor_set,
-        .dstBinding = 0,
-        .dstArrayElement = 0,
-        .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-        .descriptorCount = 1,
-        .pImageInfo = &img_info,
-    };
-
-    vkUpdateDescriptorSets(vk->device, 1, &write, 0, NULL);
-
-    // Add to list
+    wl_list_remove(&image->link);
     wl_list_insert(&vk->images, &image->link);
+    vk->render_list.dirty = true;
+    if (image->enabled) {
+        damage_box(vk, &image->dst);
+    }
 
     vk_log(LOG_INFO, "added image: %dx%d -> dst(%d,%d %dx%d)",
            image->width, image->height,
            image->dst.x, image->dst.y, image->dst.width, image->dst.height);
-
-    return image;
 }
 
-struct vk_image *
-server_vk_add_avif_image(struct server_vk *vk, const char *path, const struct vk_image_options *options) {
-    struct util_avif avif = util_avif_decode(path, 4096);
-    if (!avif.frames || avif.frame_count == 0 || avif.width == 0 || avif.height == 0) {
-        util_avif_free(&avif);
-        vk_log(LOG_ERROR, "failed to load AVIF: %s", path);
-        return NULL;
-    }
-
-    struct util_avif_frame *frame0 = &avif.frames[0];
-    struct vk_image *image = server_vk_add_rgba_image(vk, path, (uint32_t)avif.width, (uint32_t)avif.height,
-                                                      (const unsigned char *)frame0->data, options);
-    if (!image) {
-        util_avif_free(&avif);
+// Creates an image which is shown once the worker pool has finished decoding it. The returned image
+// can be used (shown, hidden, moved, removed) immediately.
+static struct vk_image *
+add_decoded_image(struct server_vk *vk, enum ww_decode_format format, const char *path,
+                  unsigned int max_size, const struct vk_image_options *options) {
+    if (access(path, R_OK) != 0) {
+        vk_log(LOG_ERROR, "failed to open image '%s': %s", path, strerror(errno));
         return NULL;
     }
 
-    if (avif.is_animated && avif.frame_count > 1) {
-        // Transfer ownership of decoded frames to the image for per-frame updates.
-        image->frames = avif.frames;
-        image->frame_count = avif.frame_count;
-        image->frame_index = 0;
+    struct vk_image *image = zalloc(1, sizeof(*image));
+    image->texture = VK_TEXTURE_NONE;
+    image->dst = options->dst;
+    image->depth = options->depth;
+    image->uv[2] = 1.0f;
+    image->uv[3] = 1.0f;
+    image->enabled = true;
+    image->vk = vk;
+    wl_list_insert(&vk->pending_images, &image->link);
 
-        double dur_s = frame0->duration;
-        if (!(dur_s > 0.0)) dur_s = 0.1;
-        uint64_t dur_ms = (uint64_t)llround(dur_s * 1000.0);
-        if (dur_ms == 0) dur_ms = 1;
-        image->next_frame_ms = now_ms() + dur_ms;
+    image->decode =
+        ww_decode_pool_submit_file(vk->decode_pool, format, path, max_size, handle_image_decoded, NULL, image);
+    return image;
+}
 
-        avif.frames = NULL;
-        avif.frame_count = 0;
-    }
+struct vk_image *
+server_vk_add_image(struct server_vk *vk, const char *path, const struct vk_image_options *options) {
+    return add_decoded_image(vk, WW_DECODE_PNG, path, 8192, options);  // max 8192x8192
+}
 
-    util_avif_free(&avif);
-    return image;
+struct vk_image *
+server_vk_add_avif_image(struct server_vk *vk, const char *path, const struct vk_image_options *options) {
+    return add_decoded_image(vk, WW_DECODE_AVIF, path, 4096, options);
 }
 
 void
 server_vk_remove_image(struct server_vk *vk, struct vk_image *image) {
     if (!image) return;
-
-    vk_log(LOG_INFO, "removing image: %dx%d", image->width, image->height);
-
-    // Wait for GPU to finish using this image
-    vkDeviceWaitIdle(vk->device);
-
-    if (image->frames) {
-        for (size_t i = 0; i < image->frame_count; i++) {
-            free(image->frames[i].data);
-        }
-        free(image->frames);
-        image->frames = NULL;
-        image->frame_count = 0;
-        image->frame_index = 0;
-        image->next_frame_ms = 0;
+
+    if (image->decode) {
+        ww_decode_job_cancel(vk->decode_pool, image->decode);
+        image->decode = NULL;
     }
 
-    // Free descriptor set back to pool
-    if (image->owns_descriptor_set && image->descriptor_set != VK_NULL_HANDLE) {
-        vkFreeDescriptorSets(vk->device, vk->descriptor_pool, 1, &image->descriptor_set);
+    vk_log(LOG_INFO, "removing image: %dx%d", image->width, image->height);
+
+    // Wait for GPU to finish using this image, including any copies which have not been submitted.
+    // Atlas-backed images share the atlas texture, which waits for the GPU itself once unreferenced.
+    if (image->owns_image || image->owns_texture) {
+        upload_flush(vk);
+        vkDeviceWaitIdle(vk->device);
     }
 
-    if (image->vertex_buffer) {
-        vkFreeMemory(vk->device, image->vertex_memory, NULL);
-        vkDestroyBuffer(vk->device, image->vertex_buffer, NULL);
+    free(image->frame_ends_ms);
+
+    // Release the texture table slot
+    if (image->owns_texture) {
+        texture_table_remove(vk, image->texture);
     }
 
     // Destroy Vulkan resources (if owned by this image)
@@ -6114,12 +9078,10 @@ server_vk_remove_image(struct server_vk *vk, struct vk_image *image) {
         if (image->view) {
             vkDestroyImageView(vk->device, image->view, NULL);
         }
-        if (image->memory) {
-            vkFreeMemory(vk->device, image->memory, NULL);
-        }
         if (image->image) {
             vkDestroyImage(vk->device, image->image, NULL);
         }
+        vk_free(vk, &image->memory);
     }
 
     if (image->atlas) {
@@ -6127,14 +9089,39 @@ server_vk_remove_image(struct server_vk *vk, struct vk_image *image) {
         image->atlas = NULL;
     }
 
+    if (image->enabled) {
+        damage_box(vk, &image->dst);
+    }
     wl_list_remove(&image->link);
     free(image);
+    vk->render_list.dirty = true;
 }
 
 void
 server_vk_image_set_enabled(struct vk_image *image, bool enabled) {
-    if (image) {
+    if (image && image->enabled != enabled) {
         image->enabled = enabled;
+        image->vk->render_list.dirty = true;
+        damage_box(image->vk, &image->dst);
+    }
+}
+
+bool
+server_vk_image_is_ready(struct vk_image *image) {
+    return image && !image->decode && !image->failed && (image->owns_image || image->atlas);
+}
+
+bool
+server_vk_image_has_failed(struct vk_image *image) {
+    return image && image->failed;
+}
+
+void
+server_vk_image_set_depth(struct vk_image *image, int32_t depth) {
+    if (image && image->depth != depth) {
+        image->depth = depth;
+        image->vk->render_list.dirty = true;
+        damage_box(image->vk, &image->dst);
     }
 }
 
@@ -6143,6 +9130,12 @@ server_vk_image_set_enabled(struct vk_image *image, bool enabled) {
 // ============================================================================
 
 #define VK_FONT_ATLAS_SIZE 1024
+
+// Glyphs are rasterized once as signed distance fields at VK_SDF_SIZE pixels per em and scaled to
+// the size of each text when drawn. VK_SDF_SPREAD is the distance (in atlas pixels) covered by the
+// field on either side of the outline.
+#define VK_SDF_SIZE 40
+#define VK_SDF_SPREAD 6
 #define VK_MAX_TEXT_BYTES 16384
 #define VK_MAX_ADVANCE_BYTES 16384
 
@@ -6178,6 +9171,220 @@ struct text_vertex {
     float dst_rgba[4];  // Text color with alpha
 };
 
+// Text which has not changed for this many frames is moved into a device-local vertex buffer.
+#define VK_TEXT_STATIC_FRAMES 120
+#define VK_TEXT_STREAM_MIN_VERTICES 4096
+
+// A device-local text buffer which is freed once upload.frame_timeline reaches frame.
+struct vk_retired_buffer {
+    VkBuffer buffer;
+    struct vk_allocation memory;
+    uint64_t frame;
+};
+
+// Hands the text's device-local buffer over to be freed once no submitted frame can read it.
+static void
+retire_text_buffer(struct server_vk *vk, struct vk_text *text) {
+    if (!text->vertex_buffer) {
+        return;
+    }
+
+    if (vk->text_stream.retired_count >= vk->text_stream.retired_capacity) {
+        vk->text_stream.retired_capacity =
+            vk->text_stream.retired_capacity ? vk->text_stream.retired_capacity * 2 : 8;
+        vk->text_stream.retired =
+            realloc(vk->text_stream.retired,
+                    vk->text_stream.retired_capacity * sizeof(*vk->text_stream.retired));
+        check_alloc(vk->text_stream.retired);
+    }
+
+    vk->text_stream.retired[vk->text_stream.retired_count++] = (struct vk_retired_buffer){
+        .buffer = text->vertex_buffer,
+        .memory = text->vertex_memory,
+        .frame = vk->upload.frames_submitted,
+    };
+    text->vertex_buffer = VK_NULL_HANDLE;
+    text->vertex_memory = (struct vk_allocation){0};
+}
+
+static void
+free_retired_text_buffers(struct server_vk *vk, bool all) {
+    uint64_t completed = UINT64_MAX;
+    if (!all && vkGetSemaphoreCounterValue(vk->device, vk->upload.frame_timeline, &completed) != VK_SUCCESS) {
+        return;
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < vk->text_stream.retired_count; i++) {
+        struct vk_retired_buffer *retired = &vk->text_stream.retired[i];
+        if (retired->frame > completed) {
+            vk->text_stream.retired[kept++] = *retired;
+            continue;
+        }
+        vkDestroyBuffer(vk->device, retired->buffer, NULL);
+        vk_free(vk, &retired->memory);
+    }
+    vk->text_stream.retired_count = kept;
+}
+
+// Must be called after the device is idle.
+static void
+destroy_text_stream(struct server_vk *vk) {
+    for (uint32_t i = 0; i < VK_MAX_FRAMES_IN_FLIGHT; i++) {
+        if (vk->text_stream.buffers[i]) {
+            vkDestroyBuffer(vk->device, vk->text_stream.buffers[i], NULL);
+            vk->text_stream.buffers[i] = VK_NULL_HANDLE;
+        }
+        vk_free(vk, &vk->text_stream.memories[i]);
+        vk->text_stream.capacity[i] = 0;
+    }
+
+    free_retired_text_buffers(vk, true);
+    free(vk->text_stream.retired);
+    vk->text_stream.retired = NULL;
+    vk->text_stream.retired_capacity = 0;
+}
+
+static bool
+ensure_text_stream(struct server_vk *vk, uint32_t slot, size_t count) {
+    if (count <= vk->text_stream.capacity[slot]) {
+        return true;
+    }
+
+    size_t capacity = vk->text_stream.capacity[slot] ? vk->text_stream.capacity[slot]
+                                                     : VK_TEXT_STREAM_MIN_VERTICES;
+    while (capacity < count) {
+        capacity *= 2;
+    }
+
+    // The slot's previous submission has completed (see server_vk_begin_frame), so the old buffer
+    // can be released immediately.
+    if (vk->text_stream.buffers[slot]) {
+        vkDestroyBuffer(vk->device, vk->text_stream.buffers[slot], NULL);
+        vk->text_stream.buffers[slot] = VK_NULL_HANDLE;
+    }
+    vk_free(vk, &vk->text_stream.memories[slot]);
+    vk->text_stream.capacity[slot] = 0;
+
+    VkBufferCreateInfo buffer_info = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = capacity * sizeof(struct text_vertex),
+        .usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+    };
+    if (vkCreateBuffer(vk->device, &buffer_info, NULL, &vk->text_stream.buffers[slot]) != VK_SUCCESS) {
+        vk_log(LOG_ERROR, "failed to create text stream buffer");
+        return false;
+    }
+
+    if (!vk_alloc_buffer(vk, vk->text_stream.buffers[slot],
+                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                         &vk->text_stream.memories[slot])) {
+        vk_log(LOG_ERROR, "failed to allocate text stream memory");
+        vkDestroyBuffer(vk->device, vk->text_stream.buffers[slot], NULL);
+        vk->text_stream.buffers[slot] = VK_NULL_HANDLE;
+        return false;
+    }
+
+    vk->text_stream.capacity[slot] = capacity;
+    return true;
+}
+
+// Copies the vertices of a text which has stopped changing into a device-local buffer. The copy is
+// submitted on the transfer queue ahead of the frame being recorded.
+static bool
+promote_text(struct server_vk *vk, struct vk_text *text) {
+    VkDeviceSize size = text->vertex_count * sizeof(struct text_vertex);
+    uint32_t families[] = {vk->graphics_family, vk->transfer_family};
+
+    VkBufferCreateInfo buffer_info = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = size,
+        .usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        .sharingMode = vk->upload.concurrent ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = vk->upload.concurrent ? 2 : 0,
+        .pQueueFamilyIndices = families,
+    };
+    if (vkCreateBuffer(vk->device, &buffer_info, NULL, &text->vertex_buffer) != VK_SUCCESS) {
+        text->vertex_buffer = VK_NULL_HANDLE;
+        return false;
+    }
+    if (!vk_alloc_buffer(vk, text->vertex_buffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                         &text->vertex_memory)) {
+        goto fail_memory;
+    }
+
+    struct vk_upload_batch *batch = upload_begin(vk);
+    if (!batch) {
+        goto fail_upload;
+    }
+    VkBuffer staging;
+    VkDeviceSize offset;
+    void *mapped;
+    if (!upload_alloc(vk, batch, size, &staging, &offset, &mapped)) {
+        goto fail_upload;
+    }
+    memcpy(mapped, text->vertices, size);
+
+    VkBufferCopy region = {
+        .srcOffset = offset,
+        .dstOffset = 0,
+        .size = size,
+    };
+    vkCmdCopyBuffer(batch->cmd, staging, text->vertex_buffer, 1, &region);
+    return true;
+
+fail_upload:
+    vk_free(vk, &text->vertex_memory);
+
+fail_memory:
+    vkDestroyBuffer(vk->device, text->vertex_buffer, NULL);
+    text->vertex_buffer = VK_NULL_HANDLE;
+    return false;
+}
+
+// Writes the vertices of every visible text which is still changing into the frame's stream region,
+// and promotes text which has stopped changing to a device-local buffer. No buffers are created
+// unless the region needs to grow. Must be called after render_list_update.
+static void
+stream_texts(struct server_vk *vk, uint32_t slot) {
+    free_retired_text_buffers(vk, false);
+    vk->text_stream.used = 0;
+
+    // Texts are visited in render order so that neighbouring texts can be drawn together (see
+    // draw_text_run.) The render list only holds enabled texts.
+    struct vk_render_item *items = vk->render_list.items;
+    size_t count = 0;
+    for (size_t k = 0; k < vk->render_list.count; k++) {
+        struct vk_text *text = items[k].obj;
+        if (items[k].type != ITEM_TEXT || text->vertex_count == 0 || text->vertex_buffer) {
+            continue;
+        }
+        if (text->idle_frames >= VK_TEXT_STATIC_FRAMES && promote_text(vk, text)) {
+            continue;
+        }
+        text->idle_frames++;
+        count += text->vertex_count;
+    }
+
+    if (count == 0 || !ensure_text_stream(vk, slot, count)) {
+        return;
+    }
+
+    struct text_vertex *dst = vk->text_stream.memories[slot].mapped;
+    size_t next = 0;
+    for (size_t k = 0; k < vk->render_list.count; k++) {
+        struct vk_text *text = items[k].obj;
+        if (items[k].type != ITEM_TEXT || text->vertex_count == 0 || text->vertex_buffer) {
+            continue;
+        }
+        memcpy(dst + next, text->vertices, text->vertex_count * sizeof(struct text_vertex));
+        text->stream_first = (uint32_t)next;
+        next += text->vertex_count;
+    }
+    vk->text_stream.used = next;
+}
+
 // UTF-8 decode helper
 static uint32_t
 vk_utf8_decode_bounded(const char **str, const char *end) {
@@ -6221,99 +9428,436 @@ vk_utf8_decode_bounded(const char **str, const char *end) {
         len = 4;
     }
 
-done:
-    *str += (ptrdiff_t)len;
-    return cp;
+done:
+    *str += (ptrdiff_t)len;
+    return cp;
+}
+
+// Glyphs are looked up through an open-addressing hash table of indices into vk->font.glyphs. The
+// table is kept at most half full so that probe sequences stay short.
+#define VK_GLYPH_EMPTY UINT32_MAX
+#define VK_GLYPH_TABLE_SIZE 256
+
+static inline size_t
+glyph_hash(uint32_t codepoint) {
+    return (size_t)(codepoint * 2654435761u);
+}
+
+static struct vk_glyph *
+glyph_lookup(struct server_vk *vk, uint32_t codepoint) {
+    size_t mask = vk->font.glyph_table_size - 1;
+    for (size_t i = glyph_hash(codepoint) & mask;; i = (i + 1) & mask) {
+        uint32_t index = vk->font.glyph_table[i];
+        if (index == VK_GLYPH_EMPTY) {
+            return NULL;
+        }
+        if (vk->font.glyphs[index].codepoint == codepoint) {
+            return &vk->font.glyphs[index];
+        }
+    }
+}
+
+static void
+glyph_table_resize(struct server_vk *vk, size_t size) {
+    free(vk->font.glyph_table);
+    vk->font.glyph_table = malloc(size * sizeof(*vk->font.glyph_table));
+    check_alloc(vk->font.glyph_table);
+    memset(vk->font.glyph_table, 0xFF, size * sizeof(*vk->font.glyph_table));
+    vk->font.glyph_table_size = size;
+
+    size_t mask = size - 1;
+    for (size_t index = 0; index < vk->font.glyph_count; index++) {
+        size_t i = glyph_hash(vk->font.glyphs[index].codepoint) & mask;
+        while (vk->font.glyph_table[i] != VK_GLYPH_EMPTY) {
+            i = (i + 1) & mask;
+        }
+        vk->font.glyph_table[i] = (uint32_t)index;
+    }
+}
+
+static struct vk_glyph *
+glyph_insert(struct server_vk *vk, uint32_t codepoint) {
+    if (vk->font.glyph_count >= vk->font.glyph_capacity) {
+        vk->font.glyph_capacity *= 2;
+        vk->font.glyphs = realloc(vk->font.glyphs, vk->font.glyph_capacity * sizeof(struct vk_glyph));
+        check_alloc(vk->font.glyphs);
+    }
+
+    size_t index = vk->font.glyph_count++;
+    struct vk_glyph *glyph = &vk->font.glyphs[index];
+    *glyph = (struct vk_glyph){.codepoint = codepoint};
+
+    if (vk->font.glyph_count * 2 > vk->font.glyph_table_size) {
+        glyph_table_resize(vk, vk->font.glyph_table_size * 2);
+    } else {
+        size_t mask = vk->font.glyph_table_size - 1;
+        size_t i = glyph_hash(codepoint) & mask;
+        while (vk->font.glyph_table[i] != VK_GLYPH_EMPTY) {
+            i = (i + 1) & mask;
+        }
+        vk->font.glyph_table[i] = (uint32_t)index;
+    }
+
+    return glyph;
+}
+
+// Rendering a distance field is far too slow to do while building a frame, so glyphs are rendered
+// on a worker thread with its own FreeType instance (FT_Face objects cannot be shared between
+// threads.) Finished glyphs are handed back to the main thread through an eventfd, where they are
+// copied into the atlas and any text waiting on them is rebuilt.
+struct vk_glyph_job {
+    struct wl_list link;  // vk_glyph_worker.queued or vk_glyph_worker.completed
+
+    uint32_t codepoint;
+    FT_UInt glyph_index;
+
+    // Tightly packed distance field, or NULL if the glyph has nothing to draw.
+    unsigned char *bitmap;
+    int width, height;
+    int bearing_x, bearing_y;
+};
+
+struct vk_glyph_worker {
+    pthread_t thread;
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;  // signalled when a job is queued or the worker is shutting down
+    struct wl_list queued;     // vk_glyph_job.link
+    struct wl_list completed;  // vk_glyph_job.link
+    bool should_exit;
+
+    int fd;
+    struct wl_event_source *src;
+
+    FT_Library ft;
+    FT_Face face;
+};
+
+static void
+glyph_job_render(struct vk_glyph_worker *worker, struct vk_glyph_job *job) {
+    if (FT_Load_Glyph(worker->face, job->glyph_index, FT_LOAD_NO_HINTING) != 0) {
+        return;
+    }
+    FT_GlyphSlot g = worker->face->glyph;
+
+    // Glyphs without an outline (such as spaces) only need their advance. Outlines go through the
+    // sdf renderer, and embedded bitmaps through bsdf.
+    bool has_outline = g->format == FT_GLYPH_FORMAT_OUTLINE && g->outline.n_contours > 0;
+    if (!has_outline && g->format != FT_GLYPH_FORMAT_BITMAP) {
+        return;
+    }
+    if (FT_Render_Glyph(g, FT_RENDER_MODE_SDF) != 0) {
+        vk_log(LOG_WARN, "failed to render distance field for glyph U+%04" PRIX32, job->codepoint);
+        return;
+    }
+    if (!g->bitmap.buffer || g->bitmap.width == 0 || g->bitmap.rows == 0) {
+        return;
+    }
+
+    job->width = (int)g->bitmap.width;
+    job->height = (int)g->bitmap.rows;
+    job->bearing_x = g->bitmap_left;
+    job->bearing_y = g->bitmap_top;
+    job->bitmap = malloc((size_t)job->width * (size_t)job->height);
+    check_alloc(job->bitmap);
+    for (int y = 0; y < job->height; y++) {
+        memcpy(job->bitmap + (size_t)y * job->width, g->bitmap.buffer + y * g->bitmap.pitch,
+               job->width);
+    }
+}
+
+static void *
+glyph_worker_thread(void *arg) {
+    struct vk_glyph_worker *worker = arg;
+
+    pthread_mutex_lock(&worker->lock);
+    for (;;) {
+        while (wl_list_empty(&worker->queued) && !worker->should_exit) {
+            pthread_cond_wait(&worker->cond, &worker->lock);
+        }
+        if (worker->should_exit) {
+            break;
+        }
+
+        struct vk_glyph_job *job = wl_container_of(worker->queued.prev, job, link);
+        wl_list_remove(&job->link);
+        pthread_mutex_unlock(&worker->lock);
+
+        glyph_job_render(worker, job);
+
+        pthread_mutex_lock(&worker->lock);
+        wl_list_insert(worker->completed.prev, &job->link);
+
+        uint64_t one = 1;
+        if (write(worker->fd, &one, sizeof(one)) != sizeof(one)) {
+            vk_log(LOG_ERROR, "failed to write to glyph worker eventfd: %s", strerror(errno));
+        }
+    }
+    pthread_mutex_unlock(&worker->lock);
+
+    return NULL;
+}
+
+// Copies a rendered glyph into the atlas. Returns false if the atlas is full.
+static bool
+atlas_insert_glyph(struct server_vk *vk, struct vk_glyph *glyph, struct vk_glyph_job *job) {
+    // Check if glyph fits in current row
+    if (vk->font.atlas_x + job->width > vk->font.atlas_width) {
+        vk->font.atlas_x = 0;
+        vk->font.atlas_y += vk->font.atlas_row_height + 1;
+        vk->font.atlas_row_height = 0;
+    }
+
+    // Check if atlas is full
+    if (vk->font.atlas_y + job->height > vk->font.atlas_height) {
+        return false;
+    }
+
+    glyph->width = job->width;
+    glyph->height = job->height;
+    glyph->bearing_x = job->bearing_x;
+    glyph->bearing_y = job->bearing_y;
+    glyph->atlas_x = vk->font.atlas_x;
+    glyph->atlas_y = vk->font.atlas_y;
+
+    VkImageSubresource subres = { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT };
+    VkSubresourceLayout layout;
+    vkGetImageSubresourceLayout(vk->device, vk->font.atlas_image, &subres, &layout);
+
+    unsigned char *dst = (unsigned char *)vk->font.atlas_memory.mapped + layout.offset;
+    for (int y = 0; y < job->height; y++) {
+        unsigned char *row = dst + ((vk->font.atlas_y + y) * layout.rowPitch) + vk->font.atlas_x;
+        memcpy(row, job->bitmap + (size_t)y * job->width, job->width);
+    }
+
+    // Update packing position
+    vk->font.atlas_x += job->width + 1;
+    if (job->height > vk->font.atlas_row_height) {
+        vk->font.atlas_row_height = job->height;
+    }
+
+    return true;
+}
+
+static bool build_text_vertices(struct server_vk *vk, struct vk_text *text);
+
+static int
+handle_glyph_worker(int32_t fd, uint32_t mask, void *data) {
+    struct server_vk *vk = data;
+    struct vk_glyph_worker *worker = vk->font.worker;
+
+    uint64_t count;
+    if (read(fd, &count, sizeof(count)) == -1 && errno != EAGAIN) {
+        vk_log(LOG_ERROR, "failed to read from glyph worker eventfd: %s", strerror(errno));
+    }
+
+    struct wl_list completed;
+    wl_list_init(&completed);
+
+    pthread_mutex_lock(&worker->lock);
+    wl_list_insert_list(&completed, &worker->completed);
+    wl_list_init(&worker->completed);
+    pthread_mutex_unlock(&worker->lock);
+
+    while (!wl_list_empty(&completed)) {
+        struct vk_glyph_job *job = wl_container_of(completed.next, job, link);
+        wl_list_remove(&job->link);
+
+        struct vk_glyph *glyph = glyph_lookup(vk, job->codepoint);
+        if (glyph && job->bitmap && !atlas_insert_glyph(vk, glyph, job)) {
+            vk_log(LOG_WARN, "font atlas full, cannot add glyph U+%04" PRIX32, job->codepoint);
+        }
+        if (glyph) {
+            glyph->ready = true;
+        }
+
+        free(job->bitmap);
+        free(job);
+    }
+
+    struct vk_text *text;
+    wl_list_for_each (text, &vk->texts, link) {
+        if (text->pending_glyphs) {
+            build_text_vertices(vk, text);
+        }
+    }
+
+    return 0;
+}
+
+static struct vk_glyph_worker *
+glyph_worker_create(struct server_vk *vk, const char *font_path) {
+    struct vk_glyph_worker *worker = zalloc(1, sizeof(*worker));
+
+    pthread_mutex_init(&worker->lock, NULL);
+    pthread_cond_init(&worker->cond, NULL);
+    wl_list_init(&worker->queued);
+    wl_list_init(&worker->completed);
+
+    if (FT_Init_FreeType(&worker->ft) != 0) {
+        vk_log(LOG_ERROR, "failed to initialize FreeType for glyph worker");
+        goto fail_ft;
+    }
+
+    // A wider spread keeps edges sharp at larger scales, at the cost of atlas space.
+    FT_Int spread = VK_SDF_SPREAD;
+    FT_Property_Set(worker->ft, "sdf", "spread", &spread);
+    FT_Property_Set(worker->ft, "bsdf", "spread", &spread);
+
+    if (FT_New_Face(worker->ft, font_path, 0, &worker->face) != 0) {
+        vk_log(LOG_ERROR, "failed to load font for glyph worker: %s", font_path);
+        goto fail_face;
+    }
+    if (FT_Set_Pixel_Sizes(worker->face, 0, VK_SDF_SIZE) != 0) {
+        vk_log(LOG_ERROR, "failed to set font size for glyph worker: %s", font_path);
+        goto fail_size;
+    }
+
+    worker->fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (worker->fd == -1) {
+        vk_log(LOG_ERROR, "failed to create glyph worker eventfd: %s", strerror(errno));
+        goto fail_eventfd;
+    }
+
+    struct wl_event_loop *loop = wl_display_get_event_loop(vk->server->display);
+    worker->src =
+        wl_event_loop_add_fd(loop, worker->fd, WL_EVENT_READABLE, handle_glyph_worker, vk);
+    if (!worker->src) {
+        vk_log(LOG_ERROR, "failed to add glyph worker eventfd to event loop");
+        goto fail_source;
+    }
+
+    if (pthread_create(&worker->thread, NULL, glyph_worker_thread, worker) != 0) {
+        vk_log(LOG_ERROR, "failed to create glyph worker thread");
+        goto fail_thread;
+    }
+
+    return worker;
+
+fail_thread:
+    wl_event_source_remove(worker->src);
+
+fail_source:
+    close(worker->fd);
+
+fail_eventfd:
+fail_size:
+    FT_Done_Face(worker->face);
+
+fail_face:
+    FT_Done_FreeType(worker->ft);
+
+fail_ft:
+    pthread_cond_destroy(&worker->cond);
+    pthread_mutex_destroy(&worker->lock);
+    free(worker);
+    return NULL;
+}
+
+static void
+glyph_worker_destroy(struct vk_glyph_worker *worker) {
+    pthread_mutex_lock(&worker->lock);
+    worker->should_exit = true;
+    pthread_cond_broadcast(&worker->cond);
+    pthread_mutex_unlock(&worker->lock);
+
+    // The worker finishes the glyph it is currently rendering before exiting.
+    pthread_join(worker->thread, NULL);
+
+    struct vk_glyph_job *job, *tmp;
+    wl_list_for_each_safe (job, tmp, &worker->queued, link) {
+        wl_list_remove(&job->link);
+        free(job);
+    }
+    wl_list_for_each_safe (job, tmp, &worker->completed, link) {
+        wl_list_remove(&job->link);
+        free(job->bitmap);
+        free(job);
+    }
+
+    wl_event_source_remove(worker->src);
+    close(worker->fd);
+
+    FT_Done_Face(worker->face);
+    FT_Done_FreeType(worker->ft);
+
+    pthread_cond_destroy(&worker->cond);
+    pthread_mutex_destroy(&worker->lock);
+    free(worker);
+}
+
+static void
+glyph_worker_queue(struct vk_glyph_worker *worker, uint32_t codepoint, FT_UInt glyph_index) {
+    struct vk_glyph_job *job = zalloc(1, sizeof(*job));
+    job->codepoint = codepoint;
+    job->glyph_index = glyph_index;
+
+    pthread_mutex_lock(&worker->lock);
+    wl_list_insert(&worker->queued, &job->link);
+    pthread_cond_signal(&worker->cond);
+    pthread_mutex_unlock(&worker->lock);
+}
+
+// Get or queue glyph. Metrics are stored at VK_SDF_SIZE and scaled by the caller. The advance is
+// known immediately, but the glyph has nothing to draw until the worker has rendered it (ready.)
+static struct vk_glyph *
+get_glyph(struct server_vk *vk, uint32_t codepoint) {
+    struct vk_glyph *glyph = glyph_lookup(vk, codepoint);
+    if (glyph) {
+        return glyph;
+    }
+
+    // Reading the advance does not require the glyph to be rendered. Missing codepoints map to
+    // glyph 0 (.notdef), as they did when glyphs were loaded with FT_Load_Char.
+    FT_Face face = (FT_Face)vk->font.ft_face;
+    FT_UInt glyph_index = FT_Get_Char_Index(face, codepoint);
+    FT_Fixed advance;
+    if (FT_Get_Advance(face, glyph_index, FT_LOAD_NO_HINTING, &advance) != 0) {
+        return NULL;  // Glyph not available
+    }
+
+    glyph = glyph_insert(vk, codepoint);
+    glyph->advance = (float)advance / 65536.0f;
+    glyph_worker_queue(vk->font.worker, codepoint, glyph_index);
+
+    return glyph;
+}
+
+// Queues every codepoint in a UTF-8 string for rasterization.
+static void
+prewarm_glyphs(struct server_vk *vk, const char *str) {
+    const char *end = str + strlen(str);
+    while (str < end) {
+        get_glyph(vk, vk_utf8_decode_bounded(&str, end));
+    }
 }
 
-// Initialize FreeType font system
+// Initialize FreeType font system. Glyphs are rendered into a single signed distance field atlas,
+// which is shared by text of every size. Printable ASCII and any codepoints in prewarm are queued
+// for rendering straight away.
 static bool
-init_font_system(struct server_vk *vk, const char *font_path, uint32_t base_size) {
+init_font_system(struct server_vk *vk, const char *font_path, const char *prewarm) {
     FT_Library ft;
     if (FT_Init_FreeType(&ft) != 0) {
         vk_log(LOG_ERROR, "failed to initialize FreeType");
         return false;
     }
-    vk->font.ft_library = ft;
 
     FT_Face face;
     if (FT_New_Face(ft, font_path, 0, &face) != 0) {
         vk_log(LOG_ERROR, "failed to load font: %s", font_path);
-        FT_Done_FreeType(ft);
-        vk->font.ft_library = NULL;
-        return false;
-    }
-    vk->font.ft_face = face;
-    vk->font.base_font_size = base_size > 0 ? base_size : 16;
-    vk->font.sizes = NULL;
-    vk->font.sizes_count = 0;
-    vk->font.sizes_capacity = 0;
-
-    vk_log(LOG_INFO, "initialized font system: %s (base size %u)", font_path, vk->font.base_font_size);
-    return true;
-}
-
-static void
-destroy_font_system(struct server_vk *vk) {
-    // Destroy all font size caches
-    for (size_t i = 0; i < vk->font.sizes_count; i++) {
-        struct vk_font_size *fs = &vk->font.sizes[i];
-        if (fs->atlas_view) vkDestroyImageView(vk->device, fs->atlas_view, NULL);
-        if (fs->atlas_memory) vkFreeMemory(vk->device, fs->atlas_memory, NULL);
-        if (fs->atlas_image) vkDestroyImage(vk->device, fs->atlas_image, NULL);
-        free(fs->glyphs);
-    }
-    free(vk->font.sizes);
-    vk->font.sizes = NULL;
-    vk->font.sizes_count = 0;
-
-    if (vk->font.ft_face) {
-        FT_Done_Face((FT_Face)vk->font.ft_face);
-        vk->font.ft_face = NULL;
-    }
-    if (vk->font.ft_library) {
-        FT_Done_FreeType((FT_Library)vk->font.ft_library);
-        vk->font.ft_library = NULL;
-    }
-}
-
-// Get or create font size cache
-static struct vk_font_size *
-get_font_size(struct server_vk *vk, uint32_t size) {
-    // Look for existing
-    for (size_t i = 0; i < vk->font.sizes_count; i++) {
-        if (vk->font.sizes[i].size == size) {
-            return &vk->font.sizes[i];
-        }
+        goto fail_face;
     }
-
-    // Create new
-    if (vk->font.sizes_count >= vk->font.sizes_capacity) {
-        size_t new_cap = vk->font.sizes_capacity ? vk->font.sizes_capacity * 2 : 4;
-        struct vk_font_size *new_sizes = realloc(vk->font.sizes, new_cap * sizeof(*new_sizes));
-        if (!new_sizes) return NULL;
-        vk->font.sizes = new_sizes;
-        vk->font.sizes_capacity = new_cap;
+    if (FT_Set_Pixel_Sizes(face, 0, VK_SDF_SIZE) != 0) {
+        vk_log(LOG_ERROR, "failed to set font size: %s", font_path);
+        goto fail_size;
     }
 
-    struct vk_font_size *fs = &vk->font.sizes[vk->font.sizes_count++];
-    memset(fs, 0, sizeof(*fs));
-    fs->size = size;
-    fs->glyph_capacity = 128;
-    fs->glyphs = zalloc(fs->glyph_capacity, sizeof(struct vk_glyph));
-    fs->atlas_width = VK_FONT_ATLAS_SIZE;
-    fs->atlas_height = VK_FONT_ATLAS_SIZE;
-
-    // Set FreeType size
-    FT_Face face = (FT_Face)vk->font.ft_face;
-    FT_Set_Pixel_Sizes(face, 0, size);
-
-    // Create atlas image
     VkImageCreateInfo image_ci = {
         .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
         .imageType = VK_IMAGE_TYPE_2D,
-        .format = VK_FORMAT_R8_UNORM,  // Single channel for font glyphs
-        .extent = { fs->atlas_width, fs->atlas_height, 1 },
+        .format = VK_FORMAT_R8_UNORM,  // Single channel distance field
+        .extent = { VK_FONT_ATLAS_SIZE, VK_FONT_ATLAS_SIZE, 1 },
         .mipLevels = 1,
         .arrayLayers = 1,
         .samples = VK_SAMPLE_COUNT_1_BIT,
@@ -6323,45 +9867,25 @@ get_font_size(struct server_vk *vk, uint32_t size) {
         .initialLayout = VK_IMAGE_LAYOUT_PREINITIALIZED,
     };
 
-    if (vkCreateImage(vk->device, &image_ci, NULL, &fs->atlas_image) != VK_SUCCESS) {
+    if (vkCreateImage(vk->device, &image_ci, NULL, &vk->font.atlas_image) != VK_SUCCESS) {
         vk_log(LOG_ERROR, "failed to create font atlas image");
-        vk->font.sizes_count--;
-        return NULL;
+        goto fail_image;
     }
 
-    VkMemoryRequirements mem_reqs;
-    vkGetImageMemoryRequirements(vk->device, fs->atlas_image, &mem_reqs);
-
-    uint32_t mem_type = find_memory_type(vk, mem_reqs.memoryTypeBits,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-    VkMemoryAllocateInfo alloc_info = {
-        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-        .allocationSize = mem_reqs.size,
-        .memoryTypeIndex = mem_type,
-    };
-
-    if (vkAllocateMemory(vk->device, &alloc_info, NULL, &fs->atlas_memory) != VK_SUCCESS) {
+    if (!vk_alloc_image(vk, vk->font.atlas_image,
+                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                        true, &vk->font.atlas_memory)) {
         vk_log(LOG_ERROR, "failed to allocate font atlas memory");
-        vkDestroyImage(vk->device, fs->atlas_image, NULL);
-        vk->font.sizes_count--;
-        return NULL;
+        goto fail_memory;
     }
 
-    vkBindImageMemory(vk->device, fs->atlas_image, fs->atlas_memory, 0);
-
-    // Clear atlas to zero
-    void *mapped;
-    if (vkMapMemory(vk->device, fs->atlas_memory, 0, mem_reqs.size, 0, &mapped) == VK_SUCCESS) {
-        memset(mapped, 0, mem_reqs.size);
-        vkUnmapMemory(vk->device, fs->atlas_memory);
-    }
+    // Clear atlas to zero (the furthest distance outside of any glyph)
+    memset(vk->font.atlas_memory.mapped, 0, vk->font.atlas_memory.size);
 
-    // Create image view
     VkImageViewCreateInfo view_ci = {
         .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
-        .image = fs->atlas_image,
-        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .image = vk->font.atlas_image,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY,  // The texture table holds array views
         .format = VK_FORMAT_R8_UNORM,
         .subresourceRange = {
             .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
@@ -6372,153 +9896,114 @@ get_font_size(struct server_vk *vk, uint32_t size) {
         },
     };
 
-    if (vkCreateImageView(vk->device, &view_ci, NULL, &fs->atlas_view) != VK_SUCCESS) {
+    if (vkCreateImageView(vk->device, &view_ci, NULL, &vk->font.atlas_view) != VK_SUCCESS) {
         vk_log(LOG_ERROR, "failed to create font atlas view");
-        vkFreeMemory(vk->device, fs->atlas_memory, NULL);
-        vkDestroyImage(vk->device, fs->atlas_image, NULL);
-        vk->font.sizes_count--;
-        return NULL;
+        goto fail_view;
     }
 
-    // Allocate descriptor set
-    VkDescriptorSetAllocateInfo ds_alloc = {
-        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-        .descriptorPool = vk->descriptor_pool,
-        .descriptorSetCount = 1,
-        .pSetLayouts = &vk->text_vk_pipeline.descriptor_layout,
-    };
+    // The distance field is interpolated, so it is sampled with the linear sampler.
+    vk->font.atlas_texture = texture_table_add(vk, vk->font.atlas_view, vk->linear_sampler);
+    if (vk->font.atlas_texture == VK_TEXTURE_NONE) {
+        goto fail_texture;
+    }
 
-    if (vkAllocateDescriptorSets(vk->device, &ds_alloc, &fs->atlas_descriptor) != VK_SUCCESS) {
-        vk_log(LOG_ERROR, "failed to allocate font atlas descriptor");
-        vkDestroyImageView(vk->device, fs->atlas_view, NULL);
-        vkFreeMemory(vk->device, fs->atlas_memory, NULL);
-        vkDestroyImage(vk->device, fs->atlas_image, NULL);
-        vk->font.sizes_count--;
-        return NULL;
+    vk->font.worker = glyph_worker_create(vk, font_path);
+    if (!vk->font.worker) {
+        goto fail_worker;
     }
 
-    // Update descriptor set
-    VkDescriptorImageInfo img_info = {
-        .sampler = vk->sampler,
-        .imageView = fs->atlas_view,
-        .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-    };
+    vk->font.ft_library = ft;
+    vk->font.ft_face = face;
+    vk->font.glyph_capacity = 128;
+    vk->font.glyphs = zalloc(vk->font.glyph_capacity, sizeof(*vk->font.glyphs));
+    vk->font.glyph_count = 0;
+    glyph_table_resize(vk, VK_GLYPH_TABLE_SIZE);
+    vk->font.atlas_width = VK_FONT_ATLAS_SIZE;
+    vk->font.atlas_height = VK_FONT_ATLAS_SIZE;
 
-    VkWriteDescriptorSet write = {
-        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-        .dstSet = fs->atlas_descriptor,
-        .dstBinding = 0,
-        .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-        .descriptorCount = 1,
-        .pImageInfo = &img_info,
-    };
+    for (uint32_t cp = 0x20; cp < 0x7F; cp++) {
+        get_glyph(vk, cp);
+    }
+    if (prewarm) {
+        prewarm_glyphs(vk, prewarm);
+    }
 
-    vkUpdateDescriptorSets(vk->device, 1, &write, 0, NULL);
-    fs->atlas_initialized = true;
+    vk_log(LOG_INFO, "initialized font system: %s (%d px distance field, %zu glyphs queued)",
+           font_path, VK_SDF_SIZE, vk->font.glyph_count);
+    return true;
 
-    vk_log(LOG_INFO, "created font size cache: %u px", size);
-    return fs;
-}
+fail_worker:
+    texture_table_remove(vk, vk->font.atlas_texture);
 
-// Get or render glyph
-static struct vk_glyph *
-get_glyph(struct server_vk *vk, struct vk_font_size *fs, uint32_t codepoint) {
-    // Look for existing
-    for (size_t i = 0; i < fs->glyph_count; i++) {
-        if (fs->glyphs[i].codepoint == codepoint) {
-            return &fs->glyphs[i];
-        }
-    }
+fail_texture:
+    vkDestroyImageView(vk->device, vk->font.atlas_view, NULL);
+    vk->font.atlas_view = VK_NULL_HANDLE;
 
-    // Render new glyph
-    FT_Face face = (FT_Face)vk->font.ft_face;
-    FT_Set_Pixel_Sizes(face, 0, fs->size);
+fail_view:
+fail_memory:
+    vkDestroyImage(vk->device, vk->font.atlas_image, NULL);
+    vk->font.atlas_image = VK_NULL_HANDLE;
+    vk_free(vk, &vk->font.atlas_memory);
 
-    if (FT_Load_Char(face, codepoint, FT_LOAD_RENDER) != 0) {
-        return NULL;  // Glyph not available
-    }
+fail_image:
+fail_size:
+    FT_Done_Face(face);
 
-    FT_GlyphSlot g = face->glyph;
+fail_face:
+    FT_Done_FreeType(ft);
+    return false;
+}
 
-    // Check if we need to expand glyphs array
-    if (fs->glyph_count >= fs->glyph_capacity) {
-        fs->glyph_capacity *= 2;
-        fs->glyphs = realloc(fs->glyphs, fs->glyph_capacity * sizeof(struct vk_glyph));
+static void
+destroy_font_system(struct server_vk *vk) {
+    if (vk->font.worker) {
+        glyph_worker_destroy(vk->font.worker);
+        vk->font.worker = NULL;
     }
 
-    // Check if glyph fits in current row
-    if (fs->atlas_x + (int)g->bitmap.width > fs->atlas_width) {
-        fs->atlas_x = 0;
-        fs->atlas_y += fs->atlas_row_height + 1;
-        fs->atlas_row_height = 0;
+    if (vk->font.atlas_view) {
+        texture_table_remove(vk, vk->font.atlas_texture);
+        vkDestroyImageView(vk->device, vk->font.atlas_view, NULL);
+        vk->font.atlas_view = VK_NULL_HANDLE;
     }
-
-    // Check if atlas is full
-    if (fs->atlas_y + (int)g->bitmap.rows > fs->atlas_height) {
-        vk_log(LOG_WARN, "font atlas full for size %u", fs->size);
-        return NULL;
+    if (vk->font.atlas_image) {
+        vkDestroyImage(vk->device, vk->font.atlas_image, NULL);
+        vk->font.atlas_image = VK_NULL_HANDLE;
     }
+    vk_free(vk, &vk->font.atlas_memory);
 
-    struct vk_glyph *glyph = &fs->glyphs[fs->glyph_count++];
-    glyph->codepoint = codepoint;
-    glyph->width = g->bitmap.width;
-    glyph->height = g->bitmap.rows;
-    glyph->bearing_x = g->bitmap_left;
-    glyph->bearing_y = g->bitmap_top;
-    glyph->advance = g->advance.x >> 6;
-    glyph->atlas_x = fs->atlas_x;
-    glyph->atlas_y = fs->atlas_y;
-
-    // Copy glyph bitmap to atlas
-    if (g->bitmap.buffer && g->bitmap.width > 0 && g->bitmap.rows > 0) {
-        void *mapped;
-        VkMemoryRequirements mem_reqs;
-        vkGetImageMemoryRequirements(vk->device, fs->atlas_image, &mem_reqs);
-
-        if (vkMapMemory(vk->device, fs->atlas_memory, 0, mem_reqs.size, 0, &mapped) == VK_SUCCESS) {
-            VkImageSubresource subres = { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT };
-            VkSubresourceLayout layout;
-            vkGetImageSubresourceLayout(vk->device, fs->atlas_image, &subres, &layout);
-
-            unsigned char *dst = (unsigned char *)mapped + layout.offset;
-            for (unsigned int y = 0; y < g->bitmap.rows; y++) {
-                unsigned char *row = dst + ((fs->atlas_y + y) * layout.rowPitch) + fs->atlas_x;
-                memcpy(row, g->bitmap.buffer + y * g->bitmap.pitch, g->bitmap.width);
-            }
-            vkUnmapMemory(vk->device, fs->atlas_memory);
-        }
-    }
+    free(vk->font.glyphs);
+    vk->font.glyphs = NULL;
+    vk->font.glyph_count = 0;
+    free(vk->font.glyph_table);
+    vk->font.glyph_table = NULL;
+    vk->font.glyph_table_size = 0;
 
-    // Update packing position
-    fs->atlas_x += glyph->width + 1;
-    if (glyph->height > fs->atlas_row_height) {
-        fs->atlas_row_height = glyph->height;
+    if (vk->font.ft_face) {
+        FT_Done_Face((FT_Face)vk->font.ft_face);
+        vk->font.ft_face = NULL;
+    }
+    if (vk->font.ft_library) {
+        FT_Done_FreeType((FT_Library)vk->font.ft_library);
+        vk->font.ft_library = NULL;
     }
-
-    return glyph;
 }
 
 // Create text pipeline
 static bool
 create_text_vk_pipeline(struct server_vk *vk) {
-    // Create descriptor set layout (same as image - combined image sampler)
-    if (!create_descriptor_set_layout(vk, &vk->text_vk_pipeline.descriptor_layout)) {
-        vk_log(LOG_ERROR, "failed to create text descriptor set layout");
-        return false;
-    }
-
-    // Push constant range (shared texcopy vertex shader expects this)
+    // Push constant range (sizes for the shared texcopy vertex shader, atlas slot for glyph.frag)
     VkPushConstantRange push_constant = {
-        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
         .offset = 0,
-        .size = sizeof(struct vk_push_constants),
+        .size = sizeof(struct text_push_constants),
     };
 
     // Pipeline layout
     VkPipelineLayoutCreateInfo layout_info = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
         .setLayoutCount = 1,
-        .pSetLayouts = &vk->text_vk_pipeline.descriptor_layout,
+        .pSetLayouts = &vk->textures.layout,
         .pushConstantRangeCount = 1,
         .pPushConstantRanges = &push_constant,
     };
@@ -6528,8 +10013,8 @@ create_text_vk_pipeline(struct server_vk *vk) {
         return false;
     }
 
-    // Use the text.frag shader
-    VkShaderModule text_frag = create_shader_module(vk->device, text_frag_spv, text_frag_spv_size);
+    // Glyphs are sampled from the texture table
+    VkShaderModule text_frag = create_shader_module(vk->device, glyph_frag_spv, glyph_frag_spv_size);
     if (!text_frag) {
         vk_log(LOG_ERROR, "failed to create text shader module");
         return false;
@@ -6640,7 +10125,7 @@ create_text_vk_pipeline(struct server_vk *vk) {
         .subpass = 0,
     };
 
-    VkResult result = vkCreateGraphicsPipelines(vk->device, VK_NULL_HANDLE, 1, &pipeline_ci, NULL, &vk->text_vk_pipeline.pipeline);
+    VkResult result = vkCreateGraphicsPipelines(vk->device, vk->pipeline_cache, 1, &pipeline_ci, NULL, &vk->text_vk_pipeline.pipeline);
     vkDestroyShaderModule(vk->device, text_frag, NULL);
 
     if (result != VK_SUCCESS) {
@@ -6653,13 +10138,21 @@ create_text_vk_pipeline(struct server_vk *vk) {
 }
 
 // Draw all text objects
-// Note: This logic has been moved to draw_text_single and draw_sorted_objects.
+// Note: This logic has been moved to draw_text_run and draw_sorted_objects.
 // Keeping this comment as a placeholder where the old function was.
 
 // Build text vertex buffer
 static bool
 build_text_vertices(struct server_vk *vk, struct vk_text *text) {
-    if (!text->text || text->text[0] == '\0' || !text->font) {
+    // The old glyphs go away wherever they were; the new ones are damaged below.
+    damage_box(vk, &text->bounds);
+    text->bounds = (struct box){0};
+
+    // Changed text goes back to being streamed until it settles again.
+    retire_text_buffer(vk, text);
+    text->idle_frames = 0;
+
+    if (!text->text || text->text[0] == '\0' || !vk->font.ft_face) {
         text->vertex_count = 0;
         return true;
     }
@@ -6671,9 +10164,15 @@ build_text_vertices(struct server_vk *vk, struct vk_text *text) {
         vk_log(LOG_WARN, "text truncated for rendering (%zu bytes > %u)", total_len, VK_MAX_TEXT_BYTES);
     }
 
-    // Worst-case: every byte is a glyph -> 6 vertices per byte.
+    // Worst-case: every byte is a glyph -> 6 vertices per byte. The array is kept between
+    // rebuilds, so text which changes every frame does not allocate.
     size_t max_vertices = used_len * 6;
-    struct text_vertex *vertices = zalloc(max_vertices ? max_vertices : 6, sizeof(*vertices));
+    if (max_vertices > text->vertex_capacity) {
+        text->vertices = realloc(text->vertices, max_vertices * sizeof(*text->vertices));
+        check_alloc(text->vertices);
+        text->vertex_capacity = max_vertices;
+    }
+    struct text_vertex *vertices = text->vertices;
 
     // Parse inline tags compatible with the OpenGL text renderer:
     // - "<#RRGGBBAA>" changes the current color
@@ -6690,6 +10189,11 @@ build_text_vertices(struct server_vk *vk, struct vk_text *text) {
     int32_t y = text->y; // baseline y in pixels (top-left origin, y down)
     size_t vtx_idx = 0;
 
+    // Glyph metrics are stored at the size of the distance field.
+    float scale = (float)text->size / (float)VK_SDF_SIZE;
+    text->pending_glyphs = false;
+    struct vk_damage bounds = {0};
+
     const char *p = text->text;
     const char *end = text->text + used_len;
     while (p < end && *p) {
@@ -6752,15 +10256,23 @@ build_text_vertices(struct server_vk *vk, struct vk_text *text) {
             continue;
         }
 
-        struct vk_glyph *g = get_glyph(vk, text->font, cp);
+        struct vk_glyph *g = get_glyph(vk, cp);
         if (!g) {
             continue;
         }
+        if (!g->ready) {
+            // Leave a gap for the glyph. The text is rebuilt once the worker has rendered it.
+            text->pending_glyphs = true;
+        }
+        if (g->width == 0 || g->height == 0) {
+            x += (int32_t)lroundf(g->advance * scale);
+            continue;
+        }
 
-        float px = (float)(x + g->bearing_x);
-        float py = (float)(y - g->bearing_y);
-        float pw = (float)g->width;
-        float ph = (float)g->height;
+        float px = (float)x + (float)g->bearing_x * scale;
+        float py = (float)y - (float)g->bearing_y * scale;
+        float pw = (float)g->width * scale;
+        float ph = (float)g->height * scale;
 
         float u0 = (float)g->atlas_x;
         float v0 = (float)g->atlas_y;
@@ -6776,6 +10288,8 @@ build_text_vertices(struct server_vk *vk, struct vk_text *text) {
             // Shouldn't happen due to conservative allocation, but guard anyway.
             break;
         }
+        damage_union(&bounds, (int32_t)floorf(x0), (int32_t)floorf(y0), (int32_t)ceilf(x1),
+                     (int32_t)ceilf(y1));
 
         // Triangle 1
         vertices[vtx_idx].src_pos[0] = u0; vertices[vtx_idx].src_pos[1] = v0;
@@ -6815,65 +10329,20 @@ build_text_vertices(struct server_vk *vk, struct vk_text *text) {
         memcpy(vertices[vtx_idx].dst_rgba, current_color, sizeof(current_color));
         vtx_idx++;
 
-        x += g->advance;
+        x += (int32_t)lroundf(g->advance * scale);
     }
 
     text->vertex_count = vtx_idx;
-
-    // Create or update vertex buffer
-    if (text->vertex_buffer) {
-        vkDeviceWaitIdle(vk->device);
-        vkFreeMemory(vk->device, text->vertex_memory, NULL);
-        vkDestroyBuffer(vk->device, text->vertex_buffer, NULL);
-        text->vertex_buffer = VK_NULL_HANDLE;
-        text->vertex_memory = VK_NULL_HANDLE;
-    }
-
-    if (vtx_idx == 0) {
-        free(vertices);
-        return true;
-    }
-
-    VkBufferCreateInfo buffer_ci = {
-        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-        .size = vtx_idx * sizeof(struct text_vertex),
-        .usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
-    };
-
-    if (vkCreateBuffer(vk->device, &buffer_ci, NULL, &text->vertex_buffer) != VK_SUCCESS) {
-        free(vertices);
-        return false;
-    }
-
-    VkMemoryRequirements mem_reqs;
-    vkGetBufferMemoryRequirements(vk->device, text->vertex_buffer, &mem_reqs);
-
-    uint32_t mem_type = find_memory_type(vk, mem_reqs.memoryTypeBits,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-    VkMemoryAllocateInfo alloc_info = {
-        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-        .allocationSize = mem_reqs.size,
-        .memoryTypeIndex = mem_type,
-    };
-
-    if (vkAllocateMemory(vk->device, &alloc_info, NULL, &text->vertex_memory) != VK_SUCCESS) {
-        vkDestroyBuffer(vk->device, text->vertex_buffer, NULL);
-        text->vertex_buffer = VK_NULL_HANDLE;
-        free(vertices);
-        return false;
-    }
-
-    vkBindBufferMemory(vk->device, text->vertex_buffer, text->vertex_memory, 0);
-
-    void *mapped;
-    if (vkMapMemory(vk->device, text->vertex_memory, 0, buffer_ci.size, 0, &mapped) == VK_SUCCESS) {
-        memcpy(mapped, vertices, vtx_idx * sizeof(struct text_vertex));
-        vkUnmapMemory(vk->device, text->vertex_memory);
+    if (!damage_empty(&bounds)) {
+        text->bounds = (struct box){
+            .x = bounds.x1,
+            .y = bounds.y1,
+            .width = bounds.x2 - bounds.x1,
+            .height = bounds.y2 - bounds.y1,
+        };
+        damage_box(vk, &text->bounds);
     }
 
-    free(vertices);
     text->dirty = false;
     return true;
 }
@@ -6902,15 +10371,6 @@ server_vk_add_text(struct server_vk *vk, const char *str, const struct vk_text_o
     text->enabled = true;
     text->dirty = true;
 
-    // Get font size cache (size is pixel size)
-    uint32_t font_size = text->size;
-    text->font = get_font_size(vk, font_size);
-    if (!text->font) {
-        free(text->text);
-        free(text);
-        return NULL;
-    }
-
     // Build initial vertices
     if (!build_text_vertices(vk, text)) {
         free(text->text);
@@ -6919,6 +10379,7 @@ server_vk_add_text(struct server_vk *vk, const char *str, const struct vk_text_o
     }
 
     wl_list_insert(&vk->texts, &text->link);
+    vk->render_list.dirty = true;
 
     vk_log(LOG_INFO, "added text: \"%s\" at (%d,%d) size=%u color=0x%08x",
            text->text, text->x, text->y, text->size, text->color);
@@ -6932,22 +10393,33 @@ server_vk_remove_text(struct server_vk *vk, struct vk_text *text) {
 
     vk_log(LOG_INFO, "removing text: \"%s\"", text->text);
 
-    vkDeviceWaitIdle(vk->device);
+    retire_text_buffer(vk, text);
 
-    if (text->vertex_buffer) {
-        vkFreeMemory(vk->device, text->vertex_memory, NULL);
-        vkDestroyBuffer(vk->device, text->vertex_buffer, NULL);
+    if (text->enabled) {
+        damage_box(vk, &text->bounds);
     }
-
     wl_list_remove(&text->link);
+    free(text->vertices);
     free(text->text);
     free(text);
+    vk->render_list.dirty = true;
 }
 
 void
 server_vk_text_set_enabled(struct vk_text *text, bool enabled) {
-    if (text) {
+    if (text && text->enabled != enabled) {
         text->enabled = enabled;
+        text->vk->render_list.dirty = true;
+        damage_box(text->vk, &text->bounds);
+    }
+}
+
+void
+server_vk_text_set_depth(struct vk_text *text, int32_t depth) {
+    if (text && text->depth != depth) {
+        text->depth = depth;
+        text->vk->render_list.dirty = true;
+        damage_box(text->vk, &text->bounds);
     }
 }
 
@@ -6977,88 +10449,253 @@ server_vk_text_set_color(struct vk_text *text, uint32_t color) {
     build_text_vertices(text->vk, text);
 }
 
-struct vk_advance_ret
-server_vk_text_advance(struct server_vk *vk, const char *data, size_t data_len, uint32_t size) {
-    if (!vk || !vk->font.ft_face || !data || data_len == 0 || size == 0) {
-        return (struct vk_advance_ret){ .x = 0, .y = 0 };
+// Layouts are cached in a direct-mapped table indexed by a hash of the string, size and width. Lua
+// chat code measures the same words and lines over and over, so most lookups are hits. The extra
+// entry at the end holds the result for strings too long to be worth caching.
+#define VK_LAYOUT_CACHE_SIZE 512
+#define VK_LAYOUT_CACHE_MAX_BYTES 1024
+
+struct vk_layout_entry {
+    char *data;
+    size_t len;
+    uint32_t size;
+    int32_t max_width;
+    bool valid;
+
+    struct vk_text_line *lines;
+    size_t line_count;
+    size_t line_capacity;
+};
+
+static uint64_t
+layout_hash(const char *data, size_t len, uint32_t size, int32_t max_width) {
+    // FNV-1a
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (unsigned char)data[i]) * 0x100000001b3ull;
+    }
+    hash = (hash ^ size) * 0x100000001b3ull;
+    hash = (hash ^ (uint32_t)max_width) * 0x100000001b3ull;
+    return hash;
+}
+
+static void
+layout_push_line(struct vk_layout_entry *entry, size_t start, size_t end, int32_t width) {
+    if (entry->line_count >= entry->line_capacity) {
+        entry->line_capacity = entry->line_capacity ? entry->line_capacity * 2 : 4;
+        entry->lines = realloc(entry->lines, entry->line_capacity * sizeof(*entry->lines));
+        check_alloc(entry->lines);
+    }
+    entry->lines[entry->line_count++] = (struct vk_text_line){
+        .start = start,
+        .end = end,
+        .width = width,
+    };
+}
+
+// Returns the length of the inline tag at p, or 0 if there is none. *advance is set to the number
+// of pixels the tag advances by. Matches the tags understood by build_text_vertices.
+static size_t
+layout_parse_tag(const char *p, const char *end, int32_t *advance) {
+    *advance = 0;
+
+    // Color tags: <#RRGGBBAA> / <#RRGGBB>
+    if (p + 3 < end && p[0] == '<' && p[1] == '#') {
+        int hex_len = 0;
+        const char *q = p + 2;
+        while ((q + hex_len) < end && hex_len < 8) {
+            char c = q[hex_len];
+            if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'))) {
+                break;
+            }
+            hex_len++;
+        }
+        if ((hex_len == 6 || hex_len == 8) && (q + hex_len) < end && q[hex_len] == '>') {
+            return (size_t)(q + hex_len + 1 - p);
+        }
     }
 
-    if (data_len > VK_MAX_ADVANCE_BYTES) {
-        data_len = VK_MAX_ADVANCE_BYTES;
+    // Advance-only tags: <+N>
+    if (p + 3 < end && p[0] == '<' && p[1] == '+') {
+        const char *q = p + 2;
+        char buf[64];
+        size_t n = 0;
+        while (q < end && *q != '>' && n + 1 < sizeof(buf)) {
+            buf[n++] = *q++;
+        }
+        if (q < end && *q == '>' && n > 0) {
+            buf[n] = '\0';
+            char *endptr = NULL;
+            double adv = strtod(buf, &endptr);
+            if (endptr && endptr != buf && *endptr == '\0') {
+                *advance = (int32_t)llround(adv);
+                return (size_t)(q + 1 - p);
+            }
+        }
     }
 
-    struct vk_font_size *fs = get_font_size(vk, size);
-    if (!fs) {
-        return (struct vk_advance_ret){ .x = 0, .y = 0 };
+    // If this looks like an advance tag but we failed to parse it, skip it as text.
+    // This prevents raw "<+...>" from leaking into chat when Lua emits floats.
+    if (p + 2 < end && p[0] == '<' && p[1] == '+') {
+        const char *q = p + 2;
+        while (q < end && *q && *q != '>') q++;
+        if (q < end && *q == '>') {
+            return (size_t)(q + 1 - p);
+        }
     }
 
+    return 0;
+}
+
+// Splits data into lines. Lines end at newlines and, if max_width is positive, before the word
+// which would make them wider than max_width. Words longer than a whole line are split between
+// glyphs. The spaces at a wrap point belong to neither line.
+static void
+layout_text(struct server_vk *vk, struct vk_layout_entry *entry, const char *data, size_t data_len,
+            uint32_t size, int32_t max_width) {
+    float scale = (float)size / (float)VK_SDF_SIZE;
+    entry->line_count = 0;
+
+    size_t line_start = 0;
     int32_t x = 0;
-    int32_t y = 0;
+
+    // The most recent run of spaces on the current line
+    bool has_break = false;
+    bool prev_space = false;
+    size_t break_end = 0, break_next = 0;
+    int32_t break_width = 0, break_next_x = 0;
 
     const char *p = data;
     const char *end = data + data_len;
     while (p < end && *p) {
-        // Skip color tags: <#RRGGBBAA> / <#RRGGBB>
-        if (p + 3 < end && p[0] == '<' && p[1] == '#') {
-            int hex_len = 0;
-            const char *q = p + 2;
-            while ((q + hex_len) < end && hex_len < 8) {
-                char c = q[hex_len];
-                if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'))) {
-                    break;
-                }
-                hex_len++;
-            }
-            if ((hex_len == 6 || hex_len == 8) && (q + hex_len) < end && q[hex_len] == '>') {
-                p = q + hex_len + 1;
+        size_t token_start = (size_t)(p - data);
+
+        int32_t advance = 0;
+        size_t tag_len = layout_parse_tag(p, end, &advance);
+        uint32_t cp = 0;
+        if (tag_len > 0) {
+            p += tag_len;
+        } else {
+            cp = vk_utf8_decode_bounded(&p, end);
+            if (cp == '\n') {
+                layout_push_line(entry, line_start, token_start, x);
+                line_start = (size_t)(p - data);
+                x = 0;
+                has_break = prev_space = false;
                 continue;
             }
-        }
 
-        // Handle advance-only tags: <+N>
-        if (p + 3 < end && p[0] == '<' && p[1] == '+') {
-            const char *q = p + 2;
-            char buf[64];
-            size_t n = 0;
-            while (q < end && *q != '>' && n + 1 < sizeof(buf)) {
-                buf[n++] = *q++;
-            }
-            if (q < end && *q == '>' && n > 0) {
-                buf[n] = '\0';
-                char *endptr = NULL;
-                double adv = strtod(buf, &endptr);
-                if (endptr && endptr != buf && *endptr == '\0') {
-                    x += (int32_t)llround(adv);
-                    p = q + 1;
-                    continue;
-                }
+            struct vk_glyph *g = get_glyph(vk, cp);
+            if (g) {
+                advance = (int32_t)lroundf(g->advance * scale);
             }
         }
 
-        // If this looks like an advance tag but we failed to parse it, skip it as text.
-        // This prevents raw "<+...>" from leaking into chat when Lua emits floats.
-        if (p + 2 < end && p[0] == '<' && p[1] == '+') {
-            const char *q = p + 2;
-            while (q < end && *q && *q != '>') q++;
-            if (q < end && *q == '>') {
-                p = q + 1;
-                continue;
+        if (cp == ' ') {
+            if (!prev_space) {
+                break_end = token_start;
+                break_width = x;
             }
+            x += advance;
+            break_next = (size_t)(p - data);
+            break_next_x = x;
+            has_break = prev_space = true;
+            continue;
         }
+        prev_space = false;
 
-        uint32_t cp = vk_utf8_decode_bounded(&p, end);
-        if (cp == '\n') {
-            x = 0;
-            y += (int32_t)size;
-            continue;
+        if (max_width > 0 && x + advance > max_width && token_start > line_start) {
+            if (has_break) {
+                layout_push_line(entry, line_start, break_end, break_width);
+                line_start = break_next;
+                x -= break_next_x;
+            } else {
+                layout_push_line(entry, line_start, token_start, x);
+                line_start = token_start;
+                x = 0;
+            }
+            has_break = false;
         }
+        x += advance;
+    }
+
+    layout_push_line(entry, line_start, (size_t)(p - data), x);
+}
+
+static struct vk_layout_entry *
+get_layout(struct server_vk *vk, const char *data, size_t data_len, uint32_t size, int32_t max_width) {
+    if (!vk->layout_cache.entries) {
+        vk->layout_cache.entries = zalloc(VK_LAYOUT_CACHE_SIZE + 1, sizeof(*vk->layout_cache.entries));
+    }
 
-        struct vk_glyph *g = get_glyph(vk, fs, cp);
-        if (!g) continue;
-        x += g->advance;
+    if (data_len > VK_LAYOUT_CACHE_MAX_BYTES) {
+        struct vk_layout_entry *entry = &vk->layout_cache.entries[VK_LAYOUT_CACHE_SIZE];
+        layout_text(vk, entry, data, data_len, size, max_width);
+        return entry;
     }
 
-    return (struct vk_advance_ret){ .x = x, .y = y };
+    uint64_t hash = layout_hash(data, data_len, size, max_width);
+    struct vk_layout_entry *entry = &vk->layout_cache.entries[hash % VK_LAYOUT_CACHE_SIZE];
+    if (entry->valid && entry->len == data_len && entry->size == size &&
+        entry->max_width == max_width && memcmp(entry->data, data, data_len) == 0) {
+        return entry;
+    }
+
+    free(entry->data);
+    entry->data = malloc(data_len ? data_len : 1);
+    check_alloc(entry->data);
+    memcpy(entry->data, data, data_len);
+    entry->len = data_len;
+    entry->size = size;
+    entry->max_width = max_width;
+    entry->valid = true;
+
+    layout_text(vk, entry, data, data_len, size, max_width);
+    return entry;
+}
+
+static void
+destroy_layout_cache(struct server_vk *vk) {
+    if (!vk->layout_cache.entries) {
+        return;
+    }
+    for (size_t i = 0; i < VK_LAYOUT_CACHE_SIZE + 1; i++) {
+        free(vk->layout_cache.entries[i].data);
+        free(vk->layout_cache.entries[i].lines);
+    }
+    free(vk->layout_cache.entries);
+    vk->layout_cache.entries = NULL;
+}
+
+size_t
+server_vk_text_layout(struct server_vk *vk, const char *data, size_t data_len, uint32_t size,
+                      int32_t max_width, const struct vk_text_line **out) {
+    *out = NULL;
+    if (!vk || !vk->font.ft_face || !data || data_len == 0 || size == 0) {
+        return 0;
+    }
+
+    struct vk_layout_entry *entry = get_layout(vk, data, data_len, size, max_width);
+    *out = entry->lines;
+    return entry->line_count;
+}
+
+struct vk_advance_ret
+server_vk_text_advance(struct server_vk *vk, const char *data, size_t data_len, uint32_t size) {
+    if (!vk || !vk->font.ft_face || !data || data_len == 0 || size == 0) {
+        return (struct vk_advance_ret){ .x = 0, .y = 0 };
+    }
+
+    if (data_len > VK_MAX_ADVANCE_BYTES) {
+        data_len = VK_MAX_ADVANCE_BYTES;
+    }
+
+    // Without a width limit, lines only end at newlines. The advance is the width of the last line.
+    struct vk_layout_entry *entry = get_layout(vk, data, data_len, size, 0);
+    return (struct vk_advance_ret){
+        .x = entry->lines[entry->line_count - 1].width,
+        .y = (int32_t)((entry->line_count - 1) * size),
+    };
 }
 
 // ============================================================================
@@ -7072,19 +10709,28 @@ server_vk_add_view(struct server_vk *vk, struct server_view *view) {
     v->view = view;
     v->enabled = true;
     wl_list_insert(&vk->views, &v->link);
+    vk->render_list.dirty = true;
     return v;
 }
 
 void
 server_vk_remove_view(struct server_vk *vk, struct vk_view *view) {
+    if (view->enabled && view->current_buffer) {
+        damage_box(vk, &view->dst);
+    }
     wl_list_remove(&view->link);
     free(view);
+    vk->render_list.dirty = true;
 }
 
 void
 server_vk_view_set_buffer(struct vk_view *view, struct server_buffer *buffer) {
     if (!buffer) {
-        view->current_buffer = NULL;
+        if (view->current_buffer) {
+            view->current_buffer = NULL;
+            view->vk->render_list.dirty = true;
+            damage_box(view->vk, &view->dst);
+        }
         return;
     }
     
@@ -7105,18 +10751,28 @@ server_vk_view_set_buffer(struct vk_view *view, struct server_buffer *buffer) {
         }
     }
     
-    view->current_buffer = b;
+    if (view->current_buffer != b) {
+        view->current_buffer = b;
+        view->vk->render_list.dirty = true;
+        damage_box(view->vk, &view->dst);
+    }
 }
 
 void
 server_vk_view_set_geometry(struct vk_view *view, int32_t x, int32_t y, int32_t width, int32_t height) {
+    damage_box(view->vk, &view->dst);
     view->dst.x = x;
     view->dst.y = y;
     view->dst.width = width;
     view->dst.height = height;
+    damage_box(view->vk, &view->dst);
 }
 
 void
 server_vk_view_set_enabled(struct vk_view *view, bool enabled) {
-    view->enabled = enabled;
+    if (view->enabled != enabled) {
+        view->enabled = enabled;
+        view->vk->render_list.dirty = true;
+        damage_box(view->vk, &view->dst);
+    }
 }
@@ -13,10 +13,6 @@
 
 #define SRV_COMPOSITOR_VERSION 5
 
-struct server_surface_damage {
-    int32_t x, y, width, height;
-};
-
 struct server_surface_frame {
     struct wl_resource *resource; // wl_callback
     struct wl_list link;
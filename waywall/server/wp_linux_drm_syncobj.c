@@ -216,7 +216,6 @@ drm_syncobj_manager_get_surface(struct wl_client *client, struct wl_resource *re
 
     syncobj_surface->vk_sem = VK_NULL_HANDLE;
     syncobj_surface->vk_sem_release = VK_NULL_HANDLE;
-    syncobj_surface->imported_fd = -1;
     syncobj_surface->imported_release_fd = -1;
 
     syncobj_surface->on_surface_destroy.notify = on_surface_destroy;
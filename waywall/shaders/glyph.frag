@@ -0,0 +1,34 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+// Inputs from vertex shader
+layout(location = 0) in vec2 f_src_pos;
+layout(location = 1) in vec4 f_src_rgba;
+layout(location = 2) in vec4 f_dst_rgba;
+
+// Output color
+layout(location = 0) out vec4 out_color;
+
+// Texture table shared with image.frag (the font atlas is a single-layer array view)
+layout(set = 0, binding = 0) uniform sampler2DArray textures[];
+
+// The atlas holds signed distance fields, where 128/255 lies on the glyph outline
+const float EDGE = 128.0 / 255.0;
+
+// The sizes at the start of the block are used by the vertex shader
+layout(push_constant) uniform PushConstants {
+    layout(offset = 16) uint texture_index;
+} pc;
+
+void main() {
+    float dist = texture(textures[pc.texture_index], vec3(f_src_pos, 0.0)).r;  // Font atlas uses R channel
+
+    // Antialias over roughly one screen pixel regardless of the scale the glyph is drawn at
+    float width = 0.5 * fwidth(dist);
+    float alpha = smoothstep(EDGE - width, EDGE + width, dist);
+    if (alpha < 0.01)
+        discard;
+    // Output pre-multiplied alpha for correct compositing
+    float final_alpha = f_dst_rgba.a * alpha;
+    out_color = vec4(f_dst_rgba.rgb * final_alpha, final_alpha);
+}
@@ -1,12 +1,18 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout(location = 0) in vec2 f_uv;
+layout(location = 3) flat in float f_layer;
+layout(location = 4) flat in uint f_texture;
 layout(location = 0) out vec4 out_color;
 
-layout(set = 0, binding = 0) uniform sampler2D tex;
+// Texture table shared by every overlay texture. Still images have a single layer, animated
+// images have one layer per frame.
+layout(set = 0, binding = 0) uniform sampler2DArray textures[];
 
 void main() {
-    vec4 color = texture(tex, f_uv);
+    // Instances in one draw may use different textures
+    vec4 color = texture(textures[nonuniformEXT(f_texture)], vec3(f_uv, f_layer));
     // Output pre-multiplied alpha for correct compositing with transparent background
     out_color = vec4(color.rgb * color.a, color.a);
 }
@@ -1,6 +1,9 @@
 #version 450
 
+// Position in the game buffer (pixels), interpolated across the source region
 layout(location = 0) in vec2 f_uv;
+layout(location = 1) flat in vec4 f_key_in;   // Input color to match (rgb) + tolerance
+layout(location = 2) flat in vec4 f_key_out;  // Output color to replace with (rgb) + enabled
 layout(location = 0) out vec4 out_color;
 
 // Storage buffer containing the raw dma-buf pixel data
@@ -8,30 +11,19 @@ layout(set = 0, binding = 0) readonly buffer PixelData {
     uint pixels[];
 } pixel_data;
 
-// Push constants for mirror rendering
+// Push constants shared with overlay.vert
 layout(push_constant) uniform PushConstants {
+    vec2 screen_size;
+
     // Game texture dimensions
     int game_width;
     int game_height;
     int game_stride;
-
-    // Source region in game (pixels)
-    int src_x;
-    int src_y;
-    int src_w;
-    int src_h;
-
-    // Color keying
-    int color_key_enabled;
-    float key_r, key_g, key_b;      // Input color to match
-    float out_r, out_g, out_b;      // Output color to replace with
-    float tolerance;                 // Color match tolerance
 } pc;
 
 void main() {
-    // Map UV (0-1) to source region in game
-    int px = pc.src_x + int(f_uv.x * float(pc.src_w));
-    int py = pc.src_y + int(f_uv.y * float(pc.src_h));
+    int px = int(f_uv.x);
+    int py = int(f_uv.y);
 
     // Clamp to game bounds
     px = clamp(px, 0, pc.game_width - 1);
@@ -48,15 +40,14 @@ void main() {
     float r = float((packed >> 16) & 0xFF) / 255.0;
 
     // Apply color keying if enabled
-    if (pc.color_key_enabled != 0) {
+    if (f_key_out.a != 0.0) {
         // Check if this pixel matches the key color (within tolerance)
-        float dr = abs(r - pc.key_r);
-        float dg = abs(g - pc.key_g);
-        float db = abs(b - pc.key_b);
+        vec3 d = abs(vec3(r, g, b) - f_key_in.rgb);
+        float tolerance = f_key_in.a;
 
-        if (dr <= pc.tolerance && dg <= pc.tolerance && db <= pc.tolerance) {
+        if (d.r <= tolerance && d.g <= tolerance && d.b <= tolerance) {
             // Matched -> render with output color (opaque)
-            out_color = vec4(pc.out_r, pc.out_g, pc.out_b, 1.0);
+            out_color = vec4(f_key_out.rgb, 1.0);
         } else {
             // Not matched -> transparent (don't render)
             out_color = vec4(0.0, 0.0, 0.0, 0.0);
@@ -0,0 +1,44 @@
+#version 450
+
+// Position in the resident capture (pixels), interpolated across the source region
+layout(location = 0) in vec2 f_uv;
+layout(location = 1) flat in vec4 f_key_in;   // Input color to match (rgb) + tolerance
+layout(location = 2) flat in vec4 f_key_out;  // Output color to replace with (rgb) + enabled
+layout(location = 0) out vec4 out_color;
+
+// Device-local copy of the part of the game read this frame
+layout(set = 0, binding = 0) uniform sampler2D u_capture;
+
+// Push constants shared with overlay.vert
+layout(push_constant) uniform PushConstants {
+    vec2 screen_size;
+
+    // Size of the copied region, which may be smaller than the image
+    int game_width;
+    int game_height;
+    int game_stride;
+} pc;
+
+void main() {
+    // Clamp to the copied region (matches clamping to the game bounds in mirror.frag)
+    vec2 pos = clamp(f_uv, vec2(0.5), vec2(pc.game_width, pc.game_height) - 0.5);
+    vec3 color = texture(u_capture, pos / vec2(textureSize(u_capture, 0))).rgb;
+
+    // Apply color keying if enabled
+    if (f_key_out.a != 0.0) {
+        // Check if this pixel matches the key color (within tolerance)
+        vec3 d = abs(color - f_key_in.rgb);
+        float tolerance = f_key_in.a;
+
+        if (d.r <= tolerance && d.g <= tolerance && d.b <= tolerance) {
+            // Matched -> render with output color (opaque)
+            out_color = vec4(f_key_out.rgb, 1.0);
+        } else {
+            // Not matched -> transparent (don't render)
+            out_color = vec4(0.0, 0.0, 0.0, 0.0);
+        }
+    } else {
+        // No color keying -> render as-is
+        out_color = vec4(color, 1.0);
+    }
+}
@@ -0,0 +1,38 @@
+#version 450
+
+// Instanced overlay quad vertex shader (mirrors and images)
+layout(location = 0) in vec2 a_pos;
+layout(location = 1) in vec2 a_uv;
+
+// Per-instance attributes
+layout(location = 2) in vec4 i_dst;      // Destination rect on screen (pixels)
+layout(location = 3) in vec4 i_src;      // Source rect (image: normalized UV, mirror: game pixels)
+layout(location = 4) in vec4 i_key_in;   // Color key input rgb + tolerance
+layout(location = 5) in vec4 i_key_out;  // Color key output rgb + enabled
+layout(location = 6) in float i_layer;   // Image: array layer (animation frame)
+layout(location = 7) in uint i_texture;  // Image: slot in the texture table
+
+layout(push_constant) uniform PushConstants {
+    vec2 screen_size;
+    int game_width;
+    int game_height;
+    int game_stride;
+} pc;
+
+layout(location = 0) out vec2 f_uv;
+layout(location = 1) flat out vec4 f_key_in;
+layout(location = 2) flat out vec4 f_key_out;
+layout(location = 3) flat out float f_layer;
+layout(location = 4) flat out uint f_texture;
+
+void main() {
+    // The shared quad spans [-1, 1]; map it onto the destination rect.
+    vec2 px = i_dst.xy + (a_pos * 0.5 + 0.5) * i_dst.zw;
+    gl_Position = vec4(2.0 * px / pc.screen_size - 1.0, 0.0, 1.0);
+
+    f_uv = i_src.xy + a_uv * i_src.zw;
+    f_key_in = i_key_in;
+    f_key_out = i_key_out;
+    f_layer = i_layer;
+    f_texture = i_texture;
+}
@@ -1,5 +1,6 @@
 #include "util/avif.h"
 #include "util/alloc.h"
+#include "util/cache.h"
 #include "util/log.h"
 #include <avif/avif.h>
 #include <fcntl.h>
@@ -48,6 +49,10 @@ struct util_avif
 util_avif_decode_raw(const char *data, size_t data_size, unsigned int max_size) {
     struct util_avif result = {0};
 
+    if (util_cache_image_load(data, data_size, max_size, &result)) {
+        return result;
+    }
+
     avifDecoder *decoder = avifDecoderCreate();
     if (!decoder) {
         ww_log(LOG_ERROR, "failed to create AVIF decoder");
@@ -132,6 +137,7 @@ util_avif_decode_raw(const char *data, size_t data_size, unsigned int max_size)
     }
 
     avifDecoderDestroy(decoder);
+    util_cache_image_store(data, data_size, max_size, &result);
     return result;
 
 fail_frames:
@@ -155,11 +161,14 @@ util_avif_free(struct util_avif *avif) {
     }
 
     if (avif->frames) {
-        for (size_t i = 0; i < avif->frame_count; i++) {
+        for (size_t i = 0; i < avif->frame_count && !avif->map; i++) {
             free(avif->frames[i].data);
         }
         free(avif->frames);
     }
+    if (avif->map) {
+        munmap(avif->map, avif->map_size);
+    }
 
     memset(avif, 0, sizeof(*avif));
 }
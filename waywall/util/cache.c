@@ -0,0 +1,554 @@
+#include "util/cache.h"
+#include "util/alloc.h"
+#include "util/log.h"
+#include "util/prelude.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#define HTTP_MAGIC "WWHTTP1"
+#define IMAGE_MAGIC "WWIMG01"
+
+// Frame data in image entries is aligned so that a mapped entry can be copied or uploaded directly.
+#define IMAGE_ALIGN 64
+
+// Linux's limit on the number of iovecs passed to writev.
+#define MAX_IOVECS 1024
+
+// Once a directory of entries grows past its limit, the least recently used entries are removed.
+#define HTTP_LIMIT (128ull << 20)
+#define IMAGE_LIMIT (512ull << 20)
+
+struct http_header {
+    char magic[8];
+    uint64_t expires;
+    uint64_t body_size;
+    uint32_t key_len, etag_len, last_modified_len;
+    uint32_t reserved;
+};
+
+struct image_header {
+    char magic[8];
+    uint64_t source_size;
+    uint32_t max_size;
+    uint32_t frame_count;
+    int32_t width, height;
+    int32_t loop_count;
+    uint32_t is_animated;
+};
+
+struct image_frame {
+    int32_t width, height;
+    double duration;
+    uint64_t offset, size;
+};
+
+static pthread_once_t cache_once = PTHREAD_ONCE_INIT;
+static char cache_root[PATH_MAX];
+static bool cache_enabled = false;
+
+static bool
+make_dir(const char *path) {
+    if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+        ww_log_errno(LOG_ERROR, "failed to create cache directory at '%s'", path);
+        return false;
+    }
+    return true;
+}
+
+static void
+cache_init() {
+    const char *disable = getenv("WAYWALL_NO_CACHE");
+    if (disable && strcmp(disable, "1") == 0) {
+        ww_log(LOG_INFO, "on-disk cache disabled");
+        return;
+    }
+
+    int n;
+    const char *env = getenv("XDG_CACHE_HOME");
+    if (env && env[0]) {
+        n = snprintf(cache_root, sizeof(cache_root), "%s/waywall", env);
+    } else {
+        env = getenv("HOME");
+        if (!env) {
+            ww_log(LOG_WARN, "no XDG_CACHE_HOME or HOME environment variables, cache disabled");
+            return;
+        }
+
+        char parent[PATH_MAX];
+        snprintf(parent, sizeof(parent), "%s/.cache", env);
+        if (!make_dir(parent)) {
+            return;
+        }
+        n = snprintf(cache_root, sizeof(cache_root), "%s/.cache/waywall", env);
+    }
+    if (n < 0 || (size_t)n >= sizeof(cache_root) - 32) {
+        ww_log(LOG_WARN, "cache directory path is too long, cache disabled");
+        return;
+    }
+
+    char sub[PATH_MAX];
+    if (!make_dir(cache_root)) {
+        return;
+    }
+    snprintf(sub, sizeof(sub), "%s/http", cache_root);
+    if (!make_dir(sub)) {
+        return;
+    }
+    snprintf(sub, sizeof(sub), "%s/image", cache_root);
+    if (!make_dir(sub)) {
+        return;
+    }
+
+    cache_enabled = true;
+}
+
+static bool
+cache_ready() {
+    pthread_once(&cache_once, cache_init);
+    return cache_enabled;
+}
+
+uint64_t
+util_cache_hash(const void *data, size_t size) {
+    // 64-bit FNV-1a.
+    const unsigned char *bytes = data;
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static void *
+map_entry(const char *path, size_t *out_size) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        if (errno != ENOENT) {
+            ww_log_errno(LOG_WARN, "failed to open cache entry '%s'", path);
+        }
+        return NULL;
+    }
+
+    struct stat stat;
+    if (fstat(fd, &stat) != 0 || stat.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+
+    void *map = mmap(NULL, stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        ww_log_errno(LOG_WARN, "failed to mmap cache entry '%s'", path);
+        return NULL;
+    }
+
+    *out_size = stat.st_size;
+    return map;
+}
+
+static void
+write_entry(const char *dir, const char *path, struct iovec *iov, int iovcnt) {
+    char tmp[PATH_MAX];
+    snprintf(tmp, sizeof(tmp), "%s/.tmp-XXXXXX", dir);
+
+    int fd = mkstemp(tmp);
+    if (fd == -1) {
+        ww_log_errno(LOG_WARN, "failed to create temporary cache entry");
+        return;
+    }
+
+    size_t total = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        total += iov[i].iov_len;
+    }
+
+    // Cache entries are small enough that a short write indicates a real problem (e.g. a full disk)
+    // rather than something worth retrying.
+    ssize_t n = writev(fd, iov, iovcnt);
+    close(fd);
+    if (n < 0 || (size_t)n != total) {
+        ww_log_errno(LOG_WARN, "failed to write cache entry");
+        unlink(tmp);
+        return;
+    }
+
+    if (rename(tmp, path) != 0) {
+        ww_log_errno(LOG_WARN, "failed to rename cache entry");
+        unlink(tmp);
+    }
+}
+
+// Marks an entry as recently used, so that it is pruned last.
+static void
+touch_entry(const char *path) {
+    utimensat(AT_FDCWD, path, NULL, 0);
+}
+
+struct prune_entry {
+    char name[NAME_MAX + 1];
+    struct timespec mtime;
+    uint64_t size;
+};
+
+static int
+compare_prune_entries(const void *a, const void *b) {
+    const struct prune_entry *x = a, *y = b;
+    if (x->mtime.tv_sec != y->mtime.tv_sec) {
+        return x->mtime.tv_sec < y->mtime.tv_sec ? -1 : 1;
+    }
+    if (x->mtime.tv_nsec != y->mtime.tv_nsec) {
+        return x->mtime.tv_nsec < y->mtime.tv_nsec ? -1 : 1;
+    }
+    return 0;
+}
+
+// Removes the least recently used entries in dir until it holds at most limit bytes.
+static void
+prune_dir(const char *dir, uint64_t limit) {
+    DIR *d = opendir(dir);
+    if (!d) {
+        ww_log_errno(LOG_WARN, "failed to open cache directory '%s'", dir);
+        return;
+    }
+
+    struct prune_entry *entries = NULL;
+    size_t count = 0, cap = 0;
+    uint64_t total = 0;
+
+    struct dirent *ent;
+    while ((ent = readdir(d))) {
+        // Skips "." and "..", as well as temporary entries which are still being written.
+        if (ent->d_name[0] == '.') {
+            continue;
+        }
+
+        struct stat stat;
+        if (fstatat(dirfd(d), ent->d_name, &stat, 0) != 0 || !S_ISREG(stat.st_mode)) {
+            continue;
+        }
+
+        if (count == cap) {
+            cap = cap ? cap * 2 : 64;
+            entries = realloc(entries, cap * sizeof(*entries));
+            check_alloc(entries);
+        }
+        struct prune_entry *entry = &entries[count++];
+        snprintf(entry->name, sizeof(entry->name), "%s", ent->d_name);
+        entry->mtime = stat.st_mtim;
+        entry->size = stat.st_size;
+        total += stat.st_size;
+    }
+
+    if (total > limit) {
+        qsort(entries, count, sizeof(*entries), compare_prune_entries);
+        for (size_t i = 0; i < count && total > limit; i++) {
+            if (unlinkat(dirfd(d), entries[i].name, 0) == 0 || errno == ENOENT) {
+                total -= entries[i].size;
+            }
+        }
+    }
+
+    free(entries);
+    closedir(d);
+}
+
+static char *
+copy_string(const char *src, size_t len) {
+    if (len == 0) {
+        return NULL;
+    }
+
+    char *dst = malloc(len + 1);
+    check_alloc(dst);
+    memcpy(dst, src, len);
+    dst[len] = '\0';
+    return dst;
+}
+
+bool
+util_cache_http_load(const char *key, struct util_cache_http *out) {
+    if (!cache_ready()) {
+        return false;
+    }
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/http/%016jx", cache_root,
+             (uintmax_t)util_cache_hash(key, strlen(key)));
+
+    size_t size;
+    char *map = map_entry(path, &size);
+    if (!map) {
+        return false;
+    }
+
+    struct http_header header;
+    if (size < sizeof(header)) {
+        goto fail;
+    }
+    memcpy(&header, map, sizeof(header));
+
+    if (memcmp(header.magic, HTTP_MAGIC, sizeof(header.magic)) != 0) {
+        goto fail;
+    }
+
+    size_t key_len = strlen(key);
+    size_t need = sizeof(header) + (size_t)header.key_len + header.etag_len +
+                  header.last_modified_len + header.body_size;
+    if (size != need || header.key_len != key_len) {
+        goto fail;
+    }
+
+    const char *ptr = map + sizeof(header);
+    if (memcmp(ptr, key, key_len) != 0) {
+        // Hash collision with a different key.
+        goto fail;
+    }
+    ptr += key_len;
+
+    out->etag = copy_string(ptr, header.etag_len);
+    ptr += header.etag_len;
+    out->last_modified = copy_string(ptr, header.last_modified_len);
+    ptr += header.last_modified_len;
+    out->expires = header.expires;
+
+    out->body = malloc(header.body_size + 1);
+    check_alloc(out->body);
+    memcpy(out->body, ptr, header.body_size);
+    out->body[header.body_size] = '\0';
+    out->body_size = header.body_size;
+
+    munmap(map, size);
+    touch_entry(path);
+    return true;
+
+fail:
+    munmap(map, size);
+    return false;
+}
+
+void
+util_cache_http_store(const char *key, const struct util_cache_http *entry) {
+    if (!cache_ready()) {
+        return;
+    }
+
+    char dir[PATH_MAX], path[PATH_MAX];
+    snprintf(dir, sizeof(dir), "%s/http", cache_root);
+    snprintf(path, sizeof(path), "%s/%016jx", dir, (uintmax_t)util_cache_hash(key, strlen(key)));
+
+    size_t etag_len = entry->etag ? strlen(entry->etag) : 0;
+    size_t last_modified_len = entry->last_modified ? strlen(entry->last_modified) : 0;
+
+    struct http_header header = {
+        .magic = HTTP_MAGIC,
+        .expires = entry->expires,
+        .body_size = entry->body_size,
+        .key_len = strlen(key),
+        .etag_len = etag_len,
+        .last_modified_len = last_modified_len,
+    };
+
+    struct iovec iov[] = {
+        {.iov_base = &header, .iov_len = sizeof(header)},
+        {.iov_base = (void *)key, .iov_len = header.key_len},
+        {.iov_base = entry->etag, .iov_len = etag_len},
+        {.iov_base = entry->last_modified, .iov_len = last_modified_len},
+        {.iov_base = entry->body, .iov_len = entry->body_size},
+    };
+    write_entry(dir, path, iov, STATIC_ARRLEN(iov));
+    prune_dir(dir, HTTP_LIMIT);
+}
+
+void
+util_cache_http_free(struct util_cache_http *entry) {
+    free(entry->etag);
+    free(entry->last_modified);
+    free(entry->body);
+    memset(entry, 0, sizeof(*entry));
+}
+
+static void
+image_path(char *path, size_t size, const char *data, size_t data_size, unsigned int max_size) {
+    snprintf(path, size, "%s/image/%016jx-%zx-%u", cache_root,
+             (uintmax_t)util_cache_hash(data, data_size), data_size, max_size);
+}
+
+bool
+util_cache_image_load(const char *data, size_t data_size, unsigned int max_size,
+                      struct util_avif *out) {
+    if (!cache_ready()) {
+        return false;
+    }
+
+    char path[PATH_MAX];
+    image_path(path, sizeof(path), data, data_size, max_size);
+
+    size_t size;
+    char *map = map_entry(path, &size);
+    if (!map) {
+        return false;
+    }
+
+    struct image_header header;
+    if (size < sizeof(header)) {
+        goto fail;
+    }
+    memcpy(&header, map, sizeof(header));
+
+    if (memcmp(header.magic, IMAGE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.source_size != data_size || header.max_size != max_size ||
+        header.frame_count == 0) {
+        goto fail;
+    }
+    if (size < sizeof(header) + (size_t)header.frame_count * sizeof(struct image_frame)) {
+        goto fail;
+    }
+
+    struct util_avif result = {0};
+    result.frame_count = header.frame_count;
+    result.is_animated = header.is_animated;
+    result.loop_count = header.loop_count;
+    result.width = header.width;
+    result.height = header.height;
+    result.frames = zalloc(result.frame_count, sizeof(*result.frames));
+
+    for (size_t i = 0; i < result.frame_count; i++) {
+        struct image_frame frame;
+        memcpy(&frame, map + sizeof(header) + i * sizeof(frame), sizeof(frame));
+
+        if (frame.offset > size || frame.size > size - frame.offset ||
+            frame.size != (uint64_t)frame.width * (uint64_t)frame.height * 4) {
+            free(result.frames);
+            goto fail;
+        }
+
+        result.frames[i].width = frame.width;
+        result.frames[i].height = frame.height;
+        result.frames[i].duration = frame.duration;
+        result.frames[i].size = frame.size;
+        result.frames[i].data = map + frame.offset;
+    }
+
+    // The frames are handed out in place, so the mapping lives until util_avif_free.
+    result.map = map;
+    result.map_size = size;
+    touch_entry(path);
+    *out = result;
+    return true;
+
+fail:
+    munmap(map, size);
+    return false;
+}
+
+void
+util_cache_image_store(const char *data, size_t data_size, unsigned int max_size,
+                       const struct util_avif *image) {
+    if (!cache_ready() || image->frame_count == 0) {
+        return;
+    }
+
+    char dir[PATH_MAX], path[PATH_MAX];
+    snprintf(dir, sizeof(dir), "%s/image", cache_root);
+    image_path(path, sizeof(path), data, data_size, max_size);
+
+    struct image_header header = {
+        .magic = IMAGE_MAGIC,
+        .source_size = data_size,
+        .max_size = max_size,
+        .frame_count = image->frame_count,
+        .width = image->width,
+        .height = image->height,
+        .loop_count = image->loop_count,
+        .is_animated = image->is_animated,
+    };
+
+    // One iovec each for the header, frame table, and every frame's padding and pixel data.
+    size_t iovcnt = 2 + image->frame_count * 2;
+    if (iovcnt > MAX_IOVECS) {
+        return;
+    }
+
+    struct iovec *iov = zalloc(iovcnt, sizeof(*iov));
+    struct image_frame *frames = zalloc(image->frame_count, sizeof(*frames));
+    static const char padding[IMAGE_ALIGN] = {0};
+
+    iov[0] = (struct iovec){.iov_base = &header, .iov_len = sizeof(header)};
+    iov[1] = (struct iovec){.iov_base = frames, .iov_len = image->frame_count * sizeof(*frames)};
+
+    uint64_t offset = sizeof(header) + image->frame_count * sizeof(*frames);
+    for (size_t i = 0; i < image->frame_count; i++) {
+        const struct util_avif_frame *src = &image->frames[i];
+
+        uint64_t pad = (IMAGE_ALIGN - offset % IMAGE_ALIGN) % IMAGE_ALIGN;
+        offset += pad;
+
+        frames[i] = (struct image_frame){
+            .width = src->width,
+            .height = src->height,
+            .duration = src->duration,
+            .offset = offset,
+            .size = src->size,
+        };
+        iov[2 + i * 2] = (struct iovec){.iov_base = (void *)padding, .iov_len = pad};
+        iov[3 + i * 2] = (struct iovec){.iov_base = src->data, .iov_len = src->size};
+
+        offset += src->size;
+    }
+
+    write_entry(dir, path, iov, iovcnt);
+    prune_dir(dir, IMAGE_LIMIT);
+
+    free(frames);
+    free(iov);
+}
+
+bool
+util_cache_blob_load(const char *name, char **out, size_t *out_size) {
+    if (!cache_ready()) {
+        return false;
+    }
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", cache_root, name);
+
+    size_t size;
+    char *map = map_entry(path, &size);
+    if (!map) {
+        return false;
+    }
+
+    *out = malloc(size);
+    check_alloc(*out);
+    memcpy(*out, map, size);
+    *out_size = size;
+
+    munmap(map, size);
+    return true;
+}
+
+void
+util_cache_blob_store(const char *name, const void *data, size_t size) {
+    if (!cache_ready()) {
+        return;
+    }
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", cache_root, name);
+
+    struct iovec iov[] = {
+        {.iov_base = (void *)data, .iov_len = size},
+    };
+    write_entry(cache_root, path, iov, STATIC_ARRLEN(iov));
+}
@@ -1,60 +1,70 @@
 #include "util/png.h"
 #include "util/alloc.h"
+#include "util/cache.h"
 #include "util/log.h"
 #include <fcntl.h>
 #include <spng.h>
 #include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
-struct util_png
-util_png_decode(const char *path, unsigned int max_size) {
-    struct util_png result = {0};
-
+static void *
+map_file(const char *path, size_t *out_size) {
     int fd = open(path, O_RDONLY);
     if (fd == -1) {
         ww_log_errno(LOG_ERROR, "failed to open PNG");
-        return result;
+        return NULL;
     }
 
     struct stat stat;
     if (fstat(fd, &stat) != 0) {
         ww_log_errno(LOG_ERROR, "failed to stat PNG");
-        goto fail_stat;
+        close(fd);
+        return NULL;
     }
 
     void *buf = mmap(NULL, stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
     if (buf == MAP_FAILED) {
         ww_log_errno(LOG_ERROR, "failed to mmap PNG (size %ju)", (uintmax_t)stat.st_size);
-        goto fail_mmap;
+        return NULL;
     }
 
+    *out_size = stat.st_size;
+    return buf;
+}
+
+static struct util_png
+decode(const char *data, size_t data_size, unsigned int max_size) {
+    struct util_png result = {0};
+
     struct spng_ctx *ctx = spng_ctx_new(0);
     if (!ctx) {
         ww_log(LOG_ERROR, "failed to create spng context");
-        goto fail_spng_ctx;
+        return result;
     }
     spng_set_image_limits(ctx, max_size, max_size);
 
-    int err = spng_set_png_buffer(ctx, buf, stat.st_size);
+    int err = spng_set_png_buffer(ctx, data, data_size);
     if (err != 0) {
         ww_log(LOG_ERROR, "failed to set PNG buffer: %s", spng_strerror(err));
-        goto fail_spng_set_png_buffer;
+        goto fail_set_buffer;
     }
 
     struct spng_ihdr ihdr;
     err = spng_get_ihdr(ctx, &ihdr);
     if (err != 0) {
         ww_log(LOG_ERROR, "failed to get image header: %s", spng_strerror(err));
-        goto fail_spng_get_ihdr;
+        goto fail_get_ihdr;
     }
 
     err = spng_decoded_image_size(ctx, SPNG_FMT_RGBA8, &result.size);
     if (err != 0) {
         ww_log(LOG_ERROR, "failed to get size of decoded image: %s", spng_strerror(err));
-        goto fail_spng_decoded_image_size;
+        goto fail_get_size;
     }
 
     result.data = malloc(result.size);
@@ -63,90 +73,116 @@ util_png_decode(const char *path, unsigned int max_size) {
     err = spng_decode_image(ctx, result.data, result.size, SPNG_FMT_RGBA8, SPNG_DECODE_TRNS);
     if (err != 0) {
         ww_log(LOG_ERROR, "failed to decode image: %s", spng_strerror(err));
-        goto fail_spng_decode_image;
+        goto fail_decode;
     }
 
     result.width = (int)ihdr.width;
     result.height = (int)ihdr.height;
 
     spng_ctx_free(ctx);
-    munmap(buf, stat.st_size);
-    close(fd);
+
+    struct util_avif_frame frame = {
+        .data = result.data,
+        .size = result.size,
+        .width = result.width,
+        .height = result.height,
+    };
+    struct util_avif image = {
+        .frames = &frame,
+        .frame_count = 1,
+        .width = result.width,
+        .height = result.height,
+    };
+    util_cache_image_store(data, data_size, max_size, &image);
 
     return result;
 
-fail_spng_decode_image:
+fail_decode:
     free(result.data);
 
-fail_spng_decoded_image_size:
-fail_spng_get_ihdr:
-fail_spng_set_png_buffer:
+fail_get_size:
+fail_get_ihdr:
+fail_set_buffer:
     spng_ctx_free(ctx);
 
-fail_spng_ctx:
-    munmap(buf, stat.st_size);
-
-fail_mmap:
-fail_stat:
-    close(fd);
-
     result.data = NULL;
     return result;
 }
 
 struct util_png
-util_png_decode_raw(const char *data, size_t data_size, unsigned int max_size) {
+util_png_decode(const char *path, unsigned int max_size) {
     struct util_png result = {0};
 
-    struct spng_ctx *ctx = spng_ctx_new(0);
-    if (!ctx) {
-        ww_log(LOG_ERROR, "failed to create spng context");
+    size_t size;
+    void *buf = map_file(path, &size);
+    if (!buf) {
         return result;
     }
-    spng_set_image_limits(ctx, max_size, max_size);
 
-    int err = spng_set_png_buffer(ctx, data, data_size);
-    if (err != 0) {
-        ww_log(LOG_ERROR, "failed to set PNG buffer: %s", spng_strerror(err));
-        goto fail_set_buffer;
-    }
-
-    struct spng_ihdr ihdr;
-    err = spng_get_ihdr(ctx, &ihdr);
-    if (err != 0) {
-        ww_log(LOG_ERROR, "failed to get image header: %s", spng_strerror(err));
-        goto fail_get_ihdr;
-    }
+    result = util_png_decode_raw(buf, size, max_size);
+    munmap(buf, size);
+    return result;
+}
 
-    err = spng_decoded_image_size(ctx, SPNG_FMT_RGBA8, &result.size);
-    if (err != 0) {
-        ww_log(LOG_ERROR, "failed to get size of decoded image: %s", spng_strerror(err));
-        goto fail_get_size;
+struct util_png
+util_png_decode_raw(const char *data, size_t data_size, unsigned int max_size) {
+    struct util_avif cached;
+    if (!util_cache_image_load(data, data_size, max_size, &cached)) {
+        return decode(data, data_size, max_size);
     }
 
+    // PNGs are always stored as a single frame, which lives in the cache mapping.
+    struct util_png result = {
+        .size = cached.frames[0].size,
+        .width = cached.frames[0].width,
+        .height = cached.frames[0].height,
+    };
     result.data = malloc(result.size);
     check_alloc(result.data);
+    memcpy(result.data, cached.frames[0].data, result.size);
 
-    err = spng_decode_image(ctx, result.data, result.size, SPNG_FMT_RGBA8, SPNG_DECODE_TRNS);
-    if (err != 0) {
-        ww_log(LOG_ERROR, "failed to decode image: %s", spng_strerror(err));
-        goto fail_decode;
-    }
+    util_avif_free(&cached);
+    return result;
+}
 
-    result.width = (int)ihdr.width;
-    result.height = (int)ihdr.height;
+struct util_avif
+util_png_decode_image(const char *path, unsigned int max_size) {
+    struct util_avif result = {0};
 
-    spng_ctx_free(ctx);
+    size_t size;
+    void *buf = map_file(path, &size);
+    if (!buf) {
+        return result;
+    }
+
+    result = util_png_decode_image_raw(buf, size, max_size);
+    munmap(buf, size);
     return result;
+}
 
-fail_decode:
-    free(result.data);
+struct util_avif
+util_png_decode_image_raw(const char *data, size_t data_size, unsigned int max_size) {
+    struct util_avif result = {0};
 
-fail_get_size:
-fail_get_ihdr:
-fail_set_buffer:
-    spng_ctx_free(ctx);
+    // Cached images are returned in place, without copying their pixel data.
+    if (util_cache_image_load(data, data_size, max_size, &result)) {
+        return result;
+    }
 
-    result.data = NULL;
+    struct util_png png = decode(data, data_size, max_size);
+    if (!png.data) {
+        return result;
+    }
+
+    result.frames = zalloc(1, sizeof(*result.frames));
+    result.frames[0] = (struct util_avif_frame){
+        .data = png.data,
+        .size = png.size,
+        .width = png.width,
+        .height = png.height,
+    };
+    result.frame_count = 1;
+    result.width = png.width;
+    result.height = png.height;
     return result;
 }